@@ -0,0 +1,119 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+
+/*
+ * Two contexts share all the CPU workers. The first one is flooded with
+ * tasks, the second one gets fewer tasks but a weight three times as big, so
+ * it should get the larger share of the workers and not have to wait for the
+ * first one to be done.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NTASKS 16
+#else
+#define NTASKS 128
+#endif
+
+#define TASK_LENGTH 1000.
+
+#define FPRINTF(ofile, fmt, ...) do { if (!getenv("STARPU_SSILENT")) {fprintf(ofile, fmt, ## __VA_ARGS__); }} while(0)
+
+static void busy_func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+	double start = starpu_timing_now();
+
+	while (starpu_timing_now() - start < TASK_LENGTH)
+		;
+}
+
+static struct starpu_codelet busy_cl =
+{
+	.cpu_funcs = {busy_func},
+	.nbuffers = 0,
+	.name = "busy"
+};
+
+int main(void)
+{
+	int ncpus;
+	int procs[STARPU_NMAXWORKERS];
+	double consumed1, consumed2;
+	unsigned long ntasks1, ntasks2;
+	int i, ret;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV)
+		return 77;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	ncpus = starpu_cpu_worker_get_count();
+	if (ncpus == 0)
+	{
+		starpu_shutdown();
+		return 77;
+	}
+	starpu_worker_get_ids_by_type(STARPU_CPU_WORKER, procs, ncpus);
+
+	unsigned sched_ctx1 = starpu_sched_ctx_create(procs, ncpus, "ctx1", STARPU_SCHED_CTX_POLICY_NAME, "eager", 0);
+	unsigned sched_ctx2 = starpu_sched_ctx_create(procs, ncpus, "ctx2", STARPU_SCHED_CTX_POLICY_NAME, "eager", 0);
+
+	starpu_sched_ctx_set_weight(sched_ctx1, 1.);
+	starpu_sched_ctx_set_weight(sched_ctx2, 3.);
+
+	/* Flood the first context */
+	for (i = 0; i < 4 * NTASKS * ncpus; i++)
+	{
+		ret = starpu_task_insert(&busy_cl, STARPU_SCHED_CTX, sched_ctx1, 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+
+	for (i = 0; i < NTASKS * ncpus; i++)
+	{
+		ret = starpu_task_insert(&busy_cl, STARPU_SCHED_CTX, sched_ctx2, 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+
+	/* Look at the shares when the second context is done */
+	starpu_task_wait_for_all_in_ctx(sched_ctx2);
+	consumed1 = starpu_sched_ctx_get_consumed_time(sched_ctx1);
+	consumed2 = starpu_sched_ctx_get_consumed_time(sched_ctx2);
+	ntasks1 = starpu_sched_ctx_get_nexecuted_tasks(sched_ctx1);
+	ntasks2 = starpu_sched_ctx_get_nexecuted_tasks(sched_ctx2);
+
+	starpu_task_wait_for_all();
+
+	FPRINTF(stderr, "ctx1 consumed %.0f us (%lu tasks), ctx2 consumed %.0f us (%lu tasks) while ctx2 had tasks\n",
+		consumed1, ntasks1, consumed2, ntasks2);
+
+	starpu_sched_ctx_delete(sched_ctx1);
+	starpu_sched_ctx_delete(sched_ctx2);
+	starpu_shutdown();
+
+	/* Without fair share, ctx1 would have been mostly done before ctx2
+	 * even started */
+	if (consumed2 < consumed1)
+	{
+		FPRINTF(stderr, "ctx2 did not get the larger share\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
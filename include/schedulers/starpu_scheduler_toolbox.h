@@ -119,6 +119,15 @@ struct starpu_task *starpu_st_fifo_taskq_pop_task(starpu_st_fifo_taskq_t fifo, i
 */
 struct starpu_task *starpu_st_fifo_taskq_pop_local_task(starpu_st_fifo_taskq_t fifo);
 
+/**
+   Pop, among the first \p lookahead tasks that \p workerid can execute, the
+   one which has the least data to fetch on the memory node of the worker. A
+   task which was passed over \p max_skips times this way is popped first, to
+   avoid starvation. With a \p lookahead of 0 or 1, this is the same as
+   starpu_st_fifo_taskq_pop_task().
+*/
+struct starpu_task *starpu_st_fifo_taskq_pop_task_lookahead(starpu_st_fifo_taskq_t fifo_queue, int workerid, unsigned lookahead, unsigned max_skips);
+
 /**
    Pop the first task with the highest priority that can be executed on the calling driver and taking into account readiness of data
 */
@@ -151,6 +160,8 @@ struct starpu_task *starpu_st_prio_deque_pop_task_for_worker(starpu_st_prio_dequ
 /** return a task that can be executed by workerid from the back of the list for the highest priority */
 struct starpu_task *starpu_st_prio_deque_deque_task_for_worker(starpu_st_prio_deque_t pdeque, int workerid, struct starpu_task **skipped);
 struct starpu_task *starpu_st_prio_deque_deque_first_ready_task(starpu_st_prio_deque_t pdeque, unsigned workerid);
+/** same as starpu_st_fifo_taskq_pop_task_lookahead(), but only among the tasks of the highest priority that \p workerid can execute */
+struct starpu_task *starpu_st_prio_deque_pop_task_lookahead(starpu_st_prio_deque_t pdeque, int workerid, unsigned lookahead, unsigned max_skips, struct starpu_task **skipped);
 
 struct starpu_task *starpu_st_prio_deque_pop_task(starpu_st_prio_deque_t pdeque);
 struct starpu_task *starpu_st_prio_deque_highest_task(starpu_st_prio_deque_t pdeque);
@@ -215,6 +215,16 @@ void starpu_data_unregister_no_coherency(starpu_data_handle_t handle);
 */
 void starpu_data_unregister_submit(starpu_data_handle_t handle);
 
+/**
+   Call starpu_data_unregister_submit() on the \p nhandles handles of
+   the \p handles array. Instead of waiting for each handle separately,
+   the handles are gathered in a few tasks which access them all, the
+   handles get destroyed when these tasks are executed. This is much
+   cheaper than unregistering many handles one by one. See \ref
+   TemporaryData for more details.
+*/
+void starpu_data_unregister_submit_array(starpu_data_handle_t *handles, unsigned nhandles);
+
 /**
    Destroy all replicates of the data \p handle immediately. After
    data invalidation, the first access to \p handle must be performed
@@ -738,6 +738,20 @@ struct starpu_data_interface_ops
 */
 void starpu_data_register(starpu_data_handle_t *handleptr, int home_node, void *data_interface, struct starpu_data_interface_ops *ops);
 
+/**
+   Register \p nhandles pieces of data at once, like
+   starpu_data_register() would, into the handles located at the
+   \p handleptrs array. \p data_interfaces is an array of \p nhandles
+   interfaces of size starpu_data_interface_ops::interface_size, all
+   located in \p home_node and using the same \p ops. The handles are
+   allocated together, which is much cheaper than registering them one
+   by one when there are many of them. They can be unregistered
+   separately, or together with starpu_data_unregister_submit_array().
+
+   See \ref TemporaryData for more details.
+*/
+void starpu_data_register_array(starpu_data_handle_t *handleptrs, unsigned nhandles, int home_node, void *data_interfaces, struct starpu_data_interface_ops *ops);
+
 /**
    Register the given data interface operations. If the field
    starpu_data_interface_ops::field is set to
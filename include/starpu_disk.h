@@ -133,6 +133,23 @@ struct starpu_disk_ops
 	*/
 	void (*free_request)(void *async_channel);
 
+	/**
+	   Map \p size bytes of \p obj in \p base, from offset \p offset, in the
+	   address space, so that main memory can access them directly, without
+	   copy. This is optional, it is used when mapping is enabled with
+	   \ref STARPU_ENABLE_MAP. Return the address of the mapping, or \c NULL
+	   if it could not be done, in which case StarPU falls back to
+	   allocating main memory and reading the data. The backend should start
+	   reading the data in the background, since the mapping is requested
+	   when the data is fetched or prefetched for a task.
+	*/
+	void *(*map)(void *base, void *obj, off_t offset, size_t size);
+	/**
+	   Unmap \p addr, which was returned by a previous call to
+	   starpu_disk_ops::map with the same \p obj, \p offset and \p size.
+	*/
+	void (*unmap)(void *base, void *obj, void *addr, off_t offset, size_t size);
+
 	/* TODO: readv, writev, read2d, write2d, etc. */
 };
 
@@ -172,6 +189,19 @@ extern struct starpu_disk_ops starpu_disk_unistd_ops;
 */
 extern struct starpu_disk_ops starpu_disk_unistd_o_direct_ops;
 
+/**
+   Use the unistd library (read, write...) to allocate and open files, and
+   perform asynchronous transfers through an io_uring ring, with files
+   registered in the ring and requests submitted by batches (see \ref
+   STARPU_DISK_IO_URING_BATCH).
+
+   <strong>Warning: It creates one file per allocation !</strong>
+
+   Only available on Linux systems. When io_uring is not available at
+   runtime, transfers are synchronous.
+*/
+extern struct starpu_disk_ops starpu_disk_unistd_io_uring_ops;
+
 /**
    Use the leveldb created by Google. More information at https://code.google.com/p/leveldb/
    Do not support asynchronous transfers.
@@ -289,6 +289,56 @@ int starpu_bus_get_ngpus(int busid);
 */
 int starpu_bus_get_profiling_info(int busid, struct starpu_profiling_bus_info *bus_info);
 
+/**
+   Kinds of scheduling latencies recorded for each worker and scheduling
+   context, see starpu_sched_latency_get_worker_stats().
+*/
+enum starpu_sched_latency_kind
+{
+	STARPU_SCHED_LATENCY_PUSH,	      /**< time spent in the push_task method of the scheduling policy */
+	STARPU_SCHED_LATENCY_POP,	      /**< time spent in the pop_task method of the scheduling policy, for the calls which returned a task */
+	STARPU_SCHED_LATENCY_READY_TO_START, /**< time between a task becoming ready and the start of its execution */
+	STARPU_SCHED_LATENCY_LOCK_WAIT,      /**< time spent waiting for the scheduling lock of a worker, when it was not immediately available. This is only recorded per worker, for the worker which waited. */
+	STARPU_SCHED_LATENCY_NKINDS
+};
+
+/**
+   Summary of the distribution of a kind of scheduling latency. Latencies
+   are recorded in log-linear histograms, so that the percentiles are
+   precise within 12.5%.
+*/
+struct starpu_sched_latency_stats
+{
+	/** Number of recorded latencies */
+	unsigned long count;
+	/** Mean latency, in microseconds */
+	double mean;
+	/** Minimum and maximum latencies, in microseconds */
+	double min, max;
+	/** Median, 90th, 99th and 99.9th percentiles, in microseconds */
+	double p50, p90, p99, p999;
+};
+
+/**
+   Get the distribution of the scheduling latencies of kind \p kind
+   recorded for the worker \p workerid, since the initialization of
+   StarPU. Push latencies are recorded for the worker which pushed the
+   task, if any, lock waits for the worker which waited, and the other
+   latencies for the worker which ran the task.
+   Return 0 on success, or -EINVAL if \p workerid or \p kind is invalid.
+   Latencies are recorded unless the environment variable \ref
+   STARPU_SCHED_LATENCY is set to 0, in which case the counts are 0.
+   See \ref SchedulingLatency for more details.
+*/
+int starpu_sched_latency_get_worker_stats(int workerid, enum starpu_sched_latency_kind kind, struct starpu_sched_latency_stats *stats);
+
+/**
+   Same as starpu_sched_latency_get_worker_stats(), but for the tasks of
+   the scheduling context \p sched_ctx_id.
+   See \ref SchedulingLatency for more details.
+*/
+int starpu_sched_latency_get_ctx_stats(unsigned sched_ctx_id, enum starpu_sched_latency_kind kind, struct starpu_sched_latency_stats *stats);
+
 /* Some helper functions to manipulate profiling API output */
 /* Reset timespec */
 static __starpu_inline void starpu_timespec_clear(struct timespec *tsp)
@@ -374,6 +424,16 @@ void starpu_profiling_bus_helper_display_summary(void);
 */
 void starpu_profiling_worker_helper_display_summary(void);
 
+/**
+   Display the distribution of the scheduling latencies of each worker
+   and scheduling context (see starpu_sched_latency_get_worker_stats())
+   on \c stderr if the environment variable \ref
+   STARPU_SCHED_LATENCY_STATS is defined. The function is called
+   automatically by starpu_shutdown().
+   See \ref SchedulingLatency for more details.
+*/
+void starpu_profiling_sched_latency_helper_display_summary(void);
+
 /**
    Display statistics about the current data handles registered
    within StarPU. StarPU must have been configured with the configure
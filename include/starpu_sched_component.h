@@ -486,19 +486,70 @@ struct starpu_sched_component_prio_data
 	double exp_len_threshold;
 	int ready;
 	int exp;
+	/** run tasks with a deadline (see starpu_task::deadline) before
+	    the other tasks, in deadline order */
+	int deadline;
 };
 struct starpu_sched_component *starpu_sched_component_prio_create(struct starpu_sched_tree *tree, struct starpu_sched_component_prio_data *prio_data) STARPU_ATTRIBUTE_MALLOC;
 int starpu_sched_component_is_prio(struct starpu_sched_component *component);
 
 /** @} */
 
+/**
+   @name Flow-control Memory-Pressure Component API
+   @{
+*/
+
+/**
+   Parameters of the memory-pressure component
+*/
+struct starpu_sched_component_mem_pressure_data
+{
+	/** percentage of the memory of the node that the queued tasks
+	    may use, 90 by default */
+	unsigned threshold;
+	/** number of queued tasks among which a task whose data is
+	    already on the node may be picked, 16 by default */
+	unsigned window;
+};
+
+/**
+   Return a struct starpu_sched_component with a fifo which keeps track of
+   the amount of data that the queued tasks will have to allocate on the
+   memory node of the workers below. When the memory used on the node plus
+   this planned footprint would exceed the threshold of the memory limit of
+   the node (see \ref HowToLimitMemoryPerNode), pushes are refused, and pulls
+   favour tasks whose data is already on the node. It does not sort tasks,
+   it is meant to be connected above a fifo or prio component, to which it
+   only lets the tasks which fit in memory.
+*/
+struct starpu_sched_component *starpu_sched_component_mem_pressure_create(struct starpu_sched_tree *tree, struct starpu_sched_component_mem_pressure_data *mem_pressure_data) STARPU_ATTRIBUTE_MALLOC;
+
+/**
+   return true iff \p component is a memory-pressure component
+*/
+int starpu_sched_component_is_mem_pressure(struct starpu_sched_component *component);
+
+/** @} */
+
 /**
    @name Resource-mapping Work-Stealing Component API
    @{
 */
 
 /**
-   return a component that perform a work stealing scheduling. Tasks are pushed in a round robin way. estimated_end return the average of expected length of fifos, starting at the average of the expected_end of his children. When a worker have to steal a task, it steal a task in a round robin way, and get the last pushed task of the higher priority.
+   Parameters of the work stealing component
+*/
+struct starpu_sched_component_work_stealing_data
+{
+	/** when non-zero, tasks are pushed to the child whose workers
+	    already have most of their data, instead of in a round robin
+	    way */
+	int data_locality;
+};
+
+/**
+   return a component that perform a work stealing scheduling. \p arg can be a pointer to a struct starpu_sched_component_work_stealing_data, or NULL. Tasks are pushed in a round robin way. estimated_end return the average of expected length of fifos, starting at the average of the expected_end of his children. When a worker have to steal a task, it steal a task in a round robin way, and get the last pushed task of the higher priority. When work stealing components are stacked, a worker also steals from the queues of the work stealing components below its siblings.
 */
 struct starpu_sched_component *starpu_sched_component_work_stealing_create(struct starpu_sched_tree *tree, void *arg) STARPU_ATTRIBUTE_MALLOC;
 
@@ -596,6 +647,35 @@ int starpu_sched_component_is_mct(struct starpu_sched_component *component);
 struct starpu_sched_component *starpu_sched_component_heft_create(struct starpu_sched_tree *tree, struct starpu_sched_component_mct_data *mct_data) STARPU_ATTRIBUTE_MALLOC;
 int starpu_sched_component_is_heft(struct starpu_sched_component *component);
 
+/**
+   create an insertion-based heft component with mct_data parameters. Besides
+   appending tasks at the end of the expected queue of its children, it can
+   place a task in an idle gap left in the expected timeline of a child, e.g.
+   while that child is waiting for the data of its next task.
+*/
+struct starpu_sched_component *starpu_sched_component_heft_insert_create(struct starpu_sched_tree *tree, struct starpu_sched_component_mct_data *mct_data) STARPU_ATTRIBUTE_MALLOC;
+int starpu_sched_component_is_heft_insert(struct starpu_sched_component *component);
+
+/** @} */
+
+/**
+   @name Resource-mapping EDF Component API
+   @{
+*/
+
+/**
+   create a deadline-aware component with mct_data parameters. Tasks
+   without deadline are mapped like the mct component does. A task
+   with a deadline (see starpu_task::deadline) is mapped, among the
+   children which are expected to complete it by its deadline, to the one
+   which completes it first, assuming that it will be run before the tasks
+   without deadline queued there. If no child is expected to meet the
+   deadline, the task is mapped to the one which completes it first, and
+   accounted as late in starpu_task_deadline_get_stats().
+*/
+struct starpu_sched_component *starpu_sched_component_edf_create(struct starpu_sched_tree *tree, struct starpu_sched_component_mct_data *mct_data) STARPU_ATTRIBUTE_MALLOC;
+int starpu_sched_component_is_edf(struct starpu_sched_component *component);
+
 /** @} */
 
 /**
@@ -847,6 +927,12 @@ struct starpu_sched_tree *starpu_sched_component_make_scheduler(unsigned sched_c
 */
 #define STARPU_SCHED_SIMPLE_PRE_DECISION (1 << 14)
 
+/**
+   Request that the sorted fifos run tasks with a deadline (see
+   starpu_task::deadline) before the other tasks, in deadline order
+*/
+#define STARPU_SCHED_SIMPLE_DEADLINE (1 << 16)
+
 /**
    Create a simple modular scheduler tree around a scheduling decision-making
    component \p component. The details of what should be built around \p component
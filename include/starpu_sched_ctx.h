@@ -188,6 +188,34 @@ void starpu_sched_ctx_set_inheritor(unsigned sched_ctx_id, unsigned inheritor);
 
 unsigned starpu_sched_ctx_get_inheritor(unsigned sched_ctx_id);
 
+/**
+   Set the fair-share weight of the context \p sched_ctx_id, 1 by
+   default, and enable fair sharing (see \ref STARPU_SCHED_CTX_FAIR_SHARE):
+   workers which are shared between contexts which all have tasks for
+   them then pop from these contexts so that the worker time consumed by
+   each context is proportional to its weight.
+   See \ref FairShareBetweenContexts for more details.
+*/
+void starpu_sched_ctx_set_weight(unsigned sched_ctx_id, double weight);
+
+/**
+   Return the fair-share weight of the context \p sched_ctx_id
+*/
+double starpu_sched_ctx_get_weight(unsigned sched_ctx_id);
+
+/**
+   Return the worker time, in us, consumed by the tasks of the context
+   \p sched_ctx_id. This is only maintained when profiling or fair
+   sharing is enabled.
+*/
+double starpu_sched_ctx_get_consumed_time(unsigned sched_ctx_id);
+
+/**
+   Return the number of tasks of the context \p sched_ctx_id accounted
+   in starpu_sched_ctx_get_consumed_time()
+*/
+unsigned long starpu_sched_ctx_get_nexecuted_tasks(unsigned sched_ctx_id);
+
 unsigned starpu_sched_ctx_get_hierarchy_level(unsigned sched_ctx_id);
 
 /**
@@ -189,6 +189,12 @@ enum starpu_task_status
 */
 typedef void (*starpu_cpu_func_t)(void **, void *);
 
+/**
+   CPU implementation of a codelet which runs a batch of tasks at once,
+   see starpu_codelet::cpu_batch_func.
+*/
+typedef void (*starpu_cpu_batch_func_t)(unsigned, void **[], void *[]);
+
 /**
    CUDA implementation of a codelet.
 */
@@ -413,6 +419,24 @@ struct starpu_codelet
 	*/
 	starpu_cpu_func_t cpu_funcs[STARPU_MAXIMPLEMENTATIONS];
 
+	/**
+	   Optional function pointer to a CPU implementation of the
+	   codelet which runs several tasks at once. When task batching
+	   is enabled with \ref STARPU_CPU_BATCH, a CPU worker which gets
+	   several ready tasks of this codelet in a row may run them
+	   with a single call to this function instead of calling the
+	   function of starpu_codelet::cpu_funcs for each of them. The
+	   function prototype must be:
+	   \code{.c}
+	   void cpu_batch_func(unsigned ntasks, void **buffers[], void *cl_args[])
+	   \endcode
+	   where \p buffers[i] and \p cl_args[i] are the data and the
+	   starpu_task::cl_arg of the i-th task of the batch. Without this
+	   function, the tasks of a batch are run one after the other
+	   with starpu_codelet::cpu_funcs.
+	*/
+	starpu_cpu_batch_func_t cpu_batch_func;
+
 	/**
 	   Optional array of function pointers to the CUDA
 	   implementations of the codelet. The functions must be
@@ -1284,6 +1308,21 @@ struct starpu_task
 	*/
 	int priority;
 
+	/**
+	   Optional field, the default value is 0, which means no deadline.
+	   This field indicates the date, as returned by
+	   starpu_timing_now(), by which the task should be completed.
+	   Deadline-aware scheduling strategies such as \c modular-edf
+	   use it to run the task before tasks without deadline, and
+	   on a worker which is expected to meet it. Whether the task
+	   actually completed in time is accounted in the statistics
+	   returned by starpu_task_deadline_get_stats().
+
+	   With starpu_task_insert() and alike this can be specified thanks to
+	   ::STARPU_TASK_DEADLINE followed by a double.
+	*/
+	double deadline;
+
 	/**
 	   Current state of the task.
 
@@ -1849,6 +1888,26 @@ int starpu_task_nready(void);
 */
 int starpu_task_nsubmitted(void);
 
+/**
+   Statistics about tasks which have a deadline, see
+   starpu_task_deadline_get_stats()
+*/
+struct starpu_task_deadline_stats
+{
+	unsigned long ntasks;	/**< Number of completed tasks which had a deadline */
+	unsigned long nmissed;	/**< Number of them which completed after their deadline */
+	unsigned long nlate;	/**< Number of tasks which the scheduler could not place on a worker expected to meet their deadline */
+};
+
+/**
+   Fill \p stats with the statistics about the tasks which had a
+   deadline (see starpu_task::deadline) since starpu_init(). \c nlate
+   is only maintained by deadline-aware scheduling strategies, it
+   provides an early feedback about tasks which will probably miss
+   their deadline, e.g. to throttle the submission of background work.
+*/
+void starpu_task_deadline_get_stats(struct starpu_task_deadline_stats *stats);
+
 /**
    Set the iteration number for all the tasks to be submitted after
    this call. This is typically called at the beginning of a task
@@ -404,7 +404,13 @@ extern "C" {
 /**
    This has to be the last mode value plus 1
 */
-#define STARPU_SHIFTED_MODE_MAX (52 << STARPU_MODE_SHIFT)
+/**
+   Used when calling starpu_task_insert(), must be followed by a
+   double specifying the value to be set in starpu_task::deadline
+*/
+#define STARPU_TASK_DEADLINE (52 << STARPU_MODE_SHIFT)
+
+#define STARPU_SHIFTED_MODE_MAX (53 << STARPU_MODE_SHIFT)
 
 /**
    Set the given \p task corresponding to \p cl with the following arguments.
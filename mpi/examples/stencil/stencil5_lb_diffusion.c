@@ -0,0 +1,251 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Stencil with an injected imbalance, balanced by the diffusion load
+ * balancer: the rows of the grid are distributed by blocks, and tasks run
+ * -imbalance times slower on node 0, as if it was a slower machine. Every
+ * -period iterations, starpu_mpi_lb_balance() lets the load balancer migrate
+ * cells from the loaded nodes to their neighbours. Run with -nolb to compare
+ * with the static distribution.
+ */
+
+#include <starpu_mpi.h>
+#include <starpu_mpi_lb.h>
+#include <helper.h>
+
+#ifdef STARPU_QUICK_CHECK
+#  define NITER_DEF	6
+#  define X		8
+#  define Y		8
+#  define WORK_DEF	50
+#else
+#  define NITER_DEF	20
+#  define X		16
+#  define Y		16
+#  define WORK_DEF	200
+#endif
+
+int display = 0;
+int niter = NITER_DEF;
+int period = 2;
+int lb = 1;
+double imbalance = 4.;
+double work = WORK_DEF;
+
+/* How much slower the local node is */
+static double slowdown = 1.;
+
+static void stencil5(float *xy, float xm1y, float xp1y, float xym1, float xyp1)
+{
+	*xy = (*xy + xm1y + xp1y + xym1 + xyp1) / 5;
+}
+
+void stencil5_cpu(void *descr[], void *_args)
+{
+	(void)_args;
+	float *xy = (float *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	float *xm1y = (float *)STARPU_VARIABLE_GET_PTR(descr[1]);
+	float *xp1y = (float *)STARPU_VARIABLE_GET_PTR(descr[2]);
+	float *xym1 = (float *)STARPU_VARIABLE_GET_PTR(descr[3]);
+	float *xyp1 = (float *)STARPU_VARIABLE_GET_PTR(descr[4]);
+
+	stencil5(xy, *xm1y, *xp1y, *xym1, *xyp1);
+
+	/* Simulate some computation */
+	double start = starpu_timing_now();
+	while (starpu_timing_now() - start < work * slowdown)
+		;
+}
+
+struct starpu_codelet stencil5_cl =
+{
+	.cpu_funcs = {stencil5_cpu},
+	.nbuffers = 5,
+	.modes = {STARPU_RW, STARPU_R, STARPU_R, STARPU_R, STARPU_R},
+};
+
+/* Block distribution of the rows */
+int my_distrib(int x, int nb_nodes)
+{
+	return (x * nb_nodes) / X;
+}
+
+static void parse_args(int argc, char **argv)
+{
+	int i;
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-iter") == 0)
+			niter = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-period") == 0)
+			period = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-imbalance") == 0)
+			imbalance = atof(argv[++i]);
+		else if (strcmp(argv[i], "-work") == 0)
+			work = atof(argv[++i]);
+		else if (strcmp(argv[i], "-nolb") == 0)
+			lb = 0;
+		else if (strcmp(argv[i], "-display") == 0)
+			display = 1;
+		else
+		{
+			fprintf(stderr, "Usage: %s [-iter n] [-period n] [-imbalance factor] [-work us] [-nolb] [-display]\n", argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/* The rows being distributed by blocks, nodes exchange cells with the
+ * previous and next nodes */
+void get_neighbors(int **neighbor_ids, int *nneighbors)
+{
+	int rank, size;
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	*nneighbors = 0;
+	*neighbor_ids = malloc(2*sizeof(int));
+	if (rank > 0)
+		(*neighbor_ids)[(*nneighbors)++] = rank-1;
+	if (rank < size-1)
+		(*neighbor_ids)[(*nneighbors)++] = rank+1;
+}
+
+int main(int argc, char **argv)
+{
+	int my_rank, size, x, y, loop;
+	float matrix[X][Y];
+	float reference[X][Y];
+	starpu_data_handle_t data_handles[X][Y];
+	struct starpu_mpi_lb_conf itf;
+	int ret, errors = 0;
+
+	parse_args(argc, argv);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, 1, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &my_rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2 || size > X || starpu_cpu_worker_get_count() == 0)
+	{
+		FPRINTF(stderr, "We need at least 2 processes, at most %d, and a CPU worker.\n", X);
+		starpu_mpi_shutdown();
+		if (my_rank == 0) return 77; else return 0;
+	}
+
+	if (my_rank == 0)
+		slowdown = imbalance;
+
+	if (lb)
+	{
+		itf.get_neighbors = get_neighbors;
+		itf.get_data_unit_to_migrate = NULL;
+		starpu_mpi_lb_init("diffusion", &itf);
+	}
+
+	/* Initial data values, the same on all nodes */
+	starpu_srand48(42);
+	for(x = 0; x < X; x++)
+		for (y = 0; y < Y; y++)
+		{
+			matrix[x][y] = (float)starpu_drand48();
+			reference[x][y] = matrix[x][y];
+		}
+
+	/* All nodes register all cells, so that they can be migrated
+	 * anywhere */
+	for(x = 0; x < X; x++)
+	{
+		for (y = 0; y < Y; y++)
+		{
+			int owner = my_distrib(x, size);
+			if (owner == my_rank)
+				starpu_variable_data_register(&data_handles[x][y], STARPU_MAIN_RAM, (uintptr_t)&(matrix[x][y]), sizeof(float));
+			else
+				starpu_variable_data_register(&data_handles[x][y], -1, (uintptr_t)NULL, sizeof(float));
+			starpu_data_set_coordinates(data_handles[x][y], 2, x, y);
+			starpu_mpi_data_register(data_handles[x][y], (y*X)+x, owner);
+		}
+	}
+
+	double start = starpu_timing_now();
+	double phase_start = start;
+	for(loop=0 ; loop<niter; loop++)
+	{
+		starpu_iteration_push(loop);
+
+		for (x = 1; x < X-1; x++)
+		{
+			for (y = 1; y < Y-1; y++)
+			{
+				ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &stencil5_cl, STARPU_RW, data_handles[x][y],
+							     STARPU_R, data_handles[x-1][y], STARPU_R, data_handles[x+1][y],
+							     STARPU_R, data_handles[x][y-1], STARPU_R, data_handles[x][y+1],
+							     0);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+			}
+		}
+		starpu_iteration_pop();
+
+		if ((loop+1) % period == 0)
+		{
+			if (lb)
+				starpu_mpi_lb_balance();
+
+			if (display)
+			{
+				int owned = 0;
+				for(x = 0; x < X; x++)
+					for (y = 0; y < Y; y++)
+						owned += starpu_mpi_data_get_rank(data_handles[x][y]) == my_rank;
+				double now = starpu_timing_now();
+				FPRINTF_MPI(stderr, "iteration %d: %d cells, %.2f ms since last step\n", loop, owned, (now - phase_start) / 1000.);
+				phase_start = now;
+			}
+		}
+	}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	double end = starpu_timing_now();
+
+	FPRINTF_MPI(stderr, "%s: %.2f ms\n", lb ? "diffusion" : "static", (end - start) / 1000.);
+
+	/* Brings the migrated cells back to their original owner */
+	if (lb)
+		starpu_mpi_lb_shutdown();
+
+	for(x = 0; x < X; x++)
+		for (y = 0; y < Y; y++)
+			starpu_data_unregister(data_handles[x][y]);
+
+	/* Check the cells owned by the local node */
+	for(loop=0 ; loop<niter; loop++)
+		for (x = 1; x < X-1; x++)
+			for (y = 1; y < Y-1; y++)
+				stencil5(&reference[x][y], reference[x-1][y], reference[x+1][y], reference[x][y-1], reference[x][y+1]);
+	for(x = 0; x < X; x++)
+		for (y = 0; y < Y; y++)
+			if (my_distrib(x, size) == my_rank && matrix[x][y] != reference[x][y])
+			{
+				FPRINTF_MPI(stderr, "cell [%d][%d] is %f instead of %f\n", x, y, matrix[x][y], reference[x][y]);
+				errors++;
+			}
+
+	starpu_mpi_shutdown();
+
+	return errors ? EXIT_FAILURE : 0;
+}
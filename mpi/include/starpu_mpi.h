@@ -505,6 +505,25 @@ int starpu_mpi_cached_send_set(starpu_data_handle_t data, int dest);
  */
 void starpu_mpi_cached_send_clear(starpu_data_handle_t data);
 
+/**
+   Statistics of the reception cache, see starpu_mpi_cache_stats_retrieve()
+*/
+struct starpu_mpi_cache_stats
+{
+	unsigned long hits;	/**< Number of times received data was found in the cache */
+	unsigned long misses;	/**< Number of times data had to be received */
+	unsigned long evictions;	/**< Number of copies evicted because of \ref STARPU_MPI_CACHE_LIMIT */
+	size_t evicted_size;	/**< Amount of bytes evicted */
+	size_t size;	/**< Current amount of bytes of received data in the cache */
+	size_t max_size;	/**< Maximum amount of bytes of received data which was in the cache */
+};
+
+/**
+   Retrieve the statistics of the reception cache of the current node
+   in \p stats. They are all 0 if the cache is disabled.
+*/
+void starpu_mpi_cache_stats_retrieve(struct starpu_mpi_cache_stats *stats);
+
 /** @} */
 
 /**
@@ -786,6 +805,17 @@ void starpu_mpi_data_migrate(MPI_Comm comm, starpu_data_handle_t handle, int new
    most data in ::STARPU_R mode
 */
 #define STARPU_MPI_NODE_SELECTION_MOST_R_DATA 0
+/**
+   Define the policy in which the selected node is the one which
+   minimizes the estimated amount of bytes to be transferred, taking
+   into account the replicas kept by the MPI cache on all nodes (see
+   \ref STARPU_MPI_CACHE), as well as the transfers back to the owners of
+   the data written to. Ties are broken by selecting the node to which
+   the least tasks were recently assigned (see \ref
+   STARPU_MPI_NODE_SELECTION_LOAD_WINDOW), then the node with the
+   lowest rank.
+*/
+#define STARPU_MPI_NODE_SELECTION_MIN_TRANSFER 1
 
 typedef int (*starpu_mpi_select_node_policy_func_t)(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data);
 
@@ -836,7 +866,10 @@ int starpu_mpi_node_selection_get_current_policy(void);
    Set the current policy used to select the node which will execute
    the codelet. The policy ::STARPU_MPI_NODE_SELECTION_MOST_R_DATA
    selects the node having the most data in ::STARPU_R mode so as to
-   minimize the amount of data to be transferred.
+   minimize the amount of data to be transferred. The policy
+   ::STARPU_MPI_NODE_SELECTION_MIN_TRANSFER additionally takes into
+   account the data already cached by the nodes, and balances the tasks
+   between the nodes which would need the same transfers.
 */
 int starpu_mpi_node_selection_set_current_policy(int policy);
 
@@ -39,6 +39,17 @@ struct starpu_mpi_lb_conf
 void starpu_mpi_lb_init(const char *lb_policy_name, struct starpu_mpi_lb_conf *);
 void starpu_mpi_lb_shutdown(void);
 
+/**
+   Perform a balancing step with the current load balancer, if it
+   supports explicit steps, as the \c diffusion policy does. This is
+   collective: it has to be called by all nodes at the same point of
+   the task submission flow, e.g. between two iterations. Pieces of
+   data are then migrated asynchronously with
+   starpu_mpi_data_migrate(), so they have to be registered on the
+   nodes they may be migrated to.
+*/
+void starpu_mpi_lb_balance(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,8 @@
 #include <common/config.h>
 
 #include <starpu_mpi_lb.h>
+#include <starpu_mpi_private.h>
+#include <starpu_mpi_task_insert.h>
 #include "policy/load_balancer_policy.h"
 
 #if defined(STARPU_USE_MPI_MPI)
@@ -35,7 +37,7 @@ static void post_exec_hook_wrapper(struct starpu_task *task, unsigned sched_ctx_
 {
 	//fprintf(stderr,"I am called ! \n");
 	if (defined_policy && defined_policy->finished_task_entry_point)
-		defined_policy->finished_task_entry_point();
+		defined_policy->finished_task_entry_point(task);
 	if (saved_post_exec_hook[sched_ctx_id])
 		saved_post_exec_hook[sched_ctx_id](task, sched_ctx_id);
 }
@@ -43,6 +45,7 @@ static void post_exec_hook_wrapper(struct starpu_task *task, unsigned sched_ctx_
 static struct load_balancer_policy *predefined_policies[] =
 {
 	&load_heat_propagation_policy,
+	&load_diffusion_policy,
 	NULL
 };
 
@@ -96,12 +99,15 @@ void starpu_mpi_lb_init(const char *lb_policy_name, struct starpu_mpi_lb_conf *i
 	if (ret != 0)
 	{
 		_STARPU_MSG("Error (%d) in %s->init: invalid starpu_mpi_lb_conf. Load balancing will be disabled for this run.\n", ret, defined_policy->policy_name);
+		defined_policy = NULL;
 		return;
 	}
 
 	/* starpu_register_hook(submitted_task, defined_policy->submitted_task_entry_point); */
 	if (defined_policy->submitted_task_entry_point)
 		starpu_mpi_pre_submit_hook_register(defined_policy->submitted_task_entry_point);
+	if (defined_policy->cancelled_task_entry_point)
+		_starpu_mpi_pre_submit_hook_cancel_register(defined_policy->cancelled_task_entry_point);
 
 	/* starpu_register_hook(finished_task, defined_policy->finished_task_entry_point); */
 	if (defined_policy->finished_task_entry_point)
@@ -124,6 +130,12 @@ void starpu_mpi_lb_init(const char *lb_policy_name, struct starpu_mpi_lb_conf *i
 	return;
 }
 
+void starpu_mpi_lb_balance(void)
+{
+	if (defined_policy && defined_policy->balance_entry_point)
+		defined_policy->balance_entry_point();
+}
+
 void starpu_mpi_lb_shutdown()
 {
 	if (!defined_policy)
@@ -139,6 +151,8 @@ void starpu_mpi_lb_shutdown()
 	/* starpu_unregister_hook(submitted_task, defined_policy->submitted_task_entry_point); */
 	if (defined_policy->submitted_task_entry_point)
 		starpu_mpi_pre_submit_hook_unregister();
+	if (defined_policy->cancelled_task_entry_point)
+		_starpu_mpi_pre_submit_hook_cancel_register(NULL);
 
 	/* starpu_unregister_hook(finished_task, defined_policy->finished_task_entry_point); */
 	if (defined_policy->finished_task_entry_point)
@@ -157,4 +171,17 @@ void starpu_mpi_lb_shutdown()
 	defined_policy = NULL;
 }
 
+void _starpu_mpi_lb_data_clear(starpu_data_handle_t data_handle)
+{
+	if (defined_policy && defined_policy->data_clear_entry_point)
+		defined_policy->data_clear_entry_point(data_handle);
+}
+
+#else /* STARPU_USE_MPI_MPI */
+
+void _starpu_mpi_lb_data_clear(starpu_data_handle_t data_handle)
+{
+	(void)data_handle;
+}
+
 #endif /* STARPU_USE_MPI_MPI */
@@ -36,7 +36,15 @@ struct load_balancer_policy
 	int (*init)(struct starpu_mpi_lb_conf *);
 	int (*deinit)();
 	void (*submitted_task_entry_point)();
-	void (*finished_task_entry_point)();
+	void (*finished_task_entry_point)(struct starpu_task *task);
+	/** Optional, undoes submitted_task_entry_point when the submission of
+	 * the task then failed */
+	void (*cancelled_task_entry_point)(struct starpu_task *task);
+	/** Optional, the data is being unregistered */
+	void (*data_clear_entry_point)(starpu_data_handle_t handle);
+	/** Optional balancing step explicitly requested by the application
+	 * through starpu_mpi_lb_balance() */
+	void (*balance_entry_point)(void);
 
 	/** Name of the load balancing policy. The selection of the load balancer is
 	 * performed through the use of the STARPU_MPI_LB=name environment
@@ -46,6 +54,7 @@ struct load_balancer_policy
 };
 
 extern struct load_balancer_policy load_heat_propagation_policy;
+extern struct load_balancer_policy load_diffusion_policy;
 
 #ifdef __cplusplus
 }
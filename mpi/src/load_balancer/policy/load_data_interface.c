@@ -72,6 +72,16 @@ int load_data_inc_nsubmitted_tasks(starpu_data_handle_t handle)
 	return 0;
 }
 
+int load_data_dec_nsubmitted_tasks(starpu_data_handle_t handle)
+{
+	struct load_data_interface *ld_interface =
+		(struct load_data_interface *) starpu_data_get_interface_on_node(handle, STARPU_MAIN_RAM);
+
+	(ld_interface->nsubmitted_tasks)--;
+
+	return 0;
+}
+
 int load_data_inc_nfinished_tasks(starpu_data_handle_t handle)
 {
 	struct load_data_interface *ld_interface =
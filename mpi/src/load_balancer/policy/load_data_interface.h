@@ -54,6 +54,7 @@ int load_data_get_nsubmitted_tasks(starpu_data_handle_t handle);
 int load_data_get_nfinished_tasks(starpu_data_handle_t handle);
 
 int load_data_inc_nsubmitted_tasks(starpu_data_handle_t handle);
+int load_data_dec_nsubmitted_tasks(starpu_data_handle_t handle);
 int load_data_inc_nfinished_tasks(starpu_data_handle_t handle);
 
 int load_data_next_phase(starpu_data_handle_t handle);
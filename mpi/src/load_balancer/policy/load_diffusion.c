@@ -0,0 +1,673 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include <starpu_scheduler.h>
+#include <mpi/starpu_mpi_tag.h>
+#include <common/uthash.h>
+#include <common/utils.h>
+#include <math.h>
+#include <starpu_mpi_private.h>
+#include "load_balancer_policy.h"
+#include "data_movements_interface.h"
+#include <common/config.h>
+
+/*
+ * Diffusion load balancer.
+ *
+ * Contrary to the heat propagation policy, the load is not provided by the
+ * application, it is measured: the execution time of each task executed by the
+ * local node (from task profiling, or from the performance model when
+ * profiling information is not available) is accounted to the pieces of data
+ * it writes, since these are the ones which decide where the task gets
+ * executed. The expected load of a piece of data for the next balancing period
+ * is its average task duration multiplied by the number of tasks submitted on
+ * it during the last period.
+ *
+ * At each balancing step, which has to be triggered collectively by calling
+ * starpu_mpi_lb_balance(), nodes exchange their load with their neighbours,
+ * and each node computes the diffusion flow (L_i - L_j) / (1 + max(d_i, d_j))
+ * towards each less loaded neighbour j. The flow is filled with local pieces
+ * of data, preferring the ones with the most load per byte, and only taking
+ * the ones whose load outweighs the estimated time for transferring them. The
+ * amount of bytes moved out at each step is bounded as well. The resulting
+ * plan is sent to all nodes, which all apply it at the same point of the task
+ * flow with starpu_mpi_data_migrate(), so that migrations are asynchronous.
+ */
+
+#if defined(STARPU_USE_MPI_MPI)
+
+static starpu_mpi_tag_t TAG_LOAD(int n)
+{
+	return ((starpu_mpi_tag_t) n+1) << 24;
+}
+
+static starpu_mpi_tag_t TAG_MOV(int n)
+{
+	return ((starpu_mpi_tag_t) n+1) << 20;
+}
+
+/* Measured activity of a piece of data written by tasks executed on the local
+ * node */
+struct handle_load_entry
+{
+	UT_hash_handle hh;
+	starpu_data_handle_t handle;
+	/* Cumulated execution time (us) and number of the finished tasks */
+	double time;
+	unsigned nfinished;
+	/* Number of tasks submitted since the last balancing step */
+	unsigned nsubmitted;
+};
+
+static struct handle_load_entry *handle_loads = NULL;
+static starpu_pthread_mutex_t handle_loads_mutex;
+
+/* Pieces of data which have been migrated by the load balancer, and their
+ * original owner, to bring them back at deinitialization time. Also protected
+ * by handle_loads_mutex, since handles are dropped when unregistered. */
+struct moved_data_entry
+{
+	UT_hash_handle hh;
+	starpu_data_handle_t handle;
+	int home_rank;
+};
+
+static struct moved_data_entry *mdh = NULL;
+
+/* MPI infos */
+static int my_rank;
+static int world_size;
+
+static int *neighbor_ids = NULL;
+static int nneighbors = 0;
+
+/* Load and degree of the local node, and of the neighbours */
+static double local_load[2];
+static starpu_data_handle_t local_load_handle;
+static double (*neighbor_loads)[2] = NULL;
+static starpu_data_handle_t *neighbor_load_handles = NULL;
+
+/* One data_movements_handle per node, see load_heat_propagation.c */
+static starpu_data_handle_t *data_movements_handles = NULL;
+
+static struct starpu_mpi_lb_conf *user_itf = NULL;
+
+/* Relative imbalance below which no data is moved */
+static double imbalance_threshold;
+/* Estimated cost of moving data, in us per byte */
+static double byte_cost;
+/* Maximum amount of bytes moved out of the local node at each step */
+static size_t max_bytes;
+
+static int saved_profiling;
+
+/******************************************************************************
+ *                              Measures                                      *
+ *****************************************************************************/
+
+static struct handle_load_entry *get_handle_load(starpu_data_handle_t handle)
+{
+	struct handle_load_entry *entry;
+	HASH_FIND_PTR(handle_loads, &handle, entry);
+	if (!entry)
+	{
+		_STARPU_MPI_CALLOC(entry, 1, sizeof(*entry));
+		entry->handle = handle;
+		HASH_ADD_PTR(handle_loads, handle, entry);
+	}
+	return entry;
+}
+
+static unsigned nwritten_buffers(struct starpu_task *task)
+{
+	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
+	unsigned i, nw = 0;
+	for (i = 0; i < nbuffers; i++)
+		if (STARPU_TASK_GET_MODE(task, i) & STARPU_W)
+			nw++;
+	return nw;
+}
+
+static double task_duration(struct starpu_task *task)
+{
+	struct starpu_profiling_task_info *info = task->profiling_info;
+	/* Dates are relative to the initialization of StarPU */
+	if (info && (info->end_time.tv_sec || info->end_time.tv_nsec))
+		return starpu_timing_timespec_delay_us(&info->start_time, &info->end_time);
+
+	int workerid = starpu_worker_get_id();
+	if (workerid < 0)
+		return 0.;
+	double length = starpu_task_worker_expected_length(task, workerid, task->sched_ctx, starpu_task_get_implementation(task));
+	if (isnan(length))
+		return 0.;
+	return length;
+}
+
+/* Expected load of the piece of data for the next period, given the average
+ * duration of the tasks of the local node when nothing was measured for it */
+static double expected_load(struct handle_load_entry *entry, double average)
+{
+	if (entry->nfinished)
+		average = entry->time / entry->nfinished;
+	return average * entry->nsubmitted;
+}
+
+/******************************************************************************
+ *                              Balancing                                     *
+ *****************************************************************************/
+
+struct candidate
+{
+	starpu_data_handle_t handle;
+	double load;
+	size_t size;
+};
+
+/* Most load per byte first */
+static int candidate_cmp(const void *a, const void *b)
+{
+	const struct candidate *ca = a, *cb = b;
+	double ra = ca->load / (ca->size ? ca->size : 1);
+	double rb = cb->load / (cb->size ? cb->size : 1);
+	if (ra > rb)
+		return -1;
+	if (ra < rb)
+		return 1;
+	return 0;
+}
+
+/* Collect the local pieces of data which can be moved, and compute the local
+ * load */
+static double collect_candidates(struct candidate **candidates, int *ncandidates)
+{
+	struct handle_load_entry *entry, *tmp;
+	double total_time = 0., load = 0.;
+	unsigned total_finished = 0;
+	int n = 0;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&handle_loads_mutex);
+	HASH_ITER(hh, handle_loads, entry, tmp)
+	{
+		total_time += entry->time;
+		total_finished += entry->nfinished;
+	}
+	double average = total_finished ? total_time / total_finished : 0.;
+
+	_STARPU_MPI_CALLOC(*candidates, HASH_COUNT(handle_loads) + 1, sizeof(struct candidate));
+	HASH_ITER(hh, handle_loads, entry, tmp)
+	{
+		double handle_load = expected_load(entry, average);
+		load += handle_load;
+		if (handle_load > 0. && starpu_mpi_data_get_rank(entry->handle) == my_rank)
+		{
+			(*candidates)[n].handle = entry->handle;
+			(*candidates)[n].load = handle_load;
+			(*candidates)[n].size = starpu_data_get_size(entry->handle);
+			n++;
+		}
+		entry->nsubmitted = 0;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&handle_loads_mutex);
+
+	qsort(*candidates, n, sizeof(struct candidate), candidate_cmp);
+	*ncandidates = n;
+	return load;
+}
+
+static void exchange_loads(void)
+{
+	starpu_mpi_req send_req[nneighbors];
+	starpu_mpi_req recv_req[nneighbors];
+	int i, ret;
+
+	for (i = 0; i < nneighbors; i++)
+	{
+		ret = starpu_mpi_isend(local_load_handle, &send_req[i], neighbor_ids[i], TAG_LOAD(my_rank), MPI_COMM_WORLD);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_isend");
+		ret = starpu_mpi_irecv(neighbor_load_handles[i], &recv_req[i], neighbor_ids[i], TAG_LOAD(neighbor_ids[i]), MPI_COMM_WORLD);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv");
+	}
+	for (i = 0; i < nneighbors; i++)
+	{
+		ret = starpu_mpi_wait(&send_req[i], MPI_STATUS_IGNORE);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+		ret = starpu_mpi_wait(&recv_req[i], MPI_STATUS_IGNORE);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+	}
+}
+
+/* Fills data_movements_handles[my_rank] with the local part of the plan */
+static void compute_plan(void)
+{
+	struct candidate *candidates;
+	int ncandidates;
+	double my_load;
+	size_t moved_bytes = 0;
+	int i, n, nmoves = 0;
+	int *dst;
+
+	my_load = collect_candidates(&candidates, &ncandidates);
+
+	starpu_data_acquire(local_load_handle, STARPU_W);
+	local_load[0] = my_load;
+	local_load[1] = nneighbors;
+	starpu_data_release(local_load_handle);
+
+	exchange_loads();
+
+	_STARPU_MPI_MALLOC(dst, (ncandidates + 1) * sizeof(int));
+	for (n = 0; n < ncandidates; n++)
+		dst[n] = -1;
+
+	for (i = 0; i < nneighbors; i++)
+	{
+		starpu_data_acquire(neighbor_load_handles[i], STARPU_R);
+		double neighbor_load = neighbor_loads[i][0];
+		double neighbor_degree = neighbor_loads[i][1];
+		starpu_data_release(neighbor_load_handles[i]);
+
+		double diff = my_load - neighbor_load;
+		if (diff <= 0. || diff < imbalance_threshold * my_load)
+			continue;
+
+		double flow = diff / (1. + STARPU_MAX((double) nneighbors, neighbor_degree));
+		_STARPU_MPI_DEBUG(3, "node %d load %lf, neighbour %d load %lf, flow %lf\n", my_rank, my_load, neighbor_ids[i], neighbor_load, flow);
+
+		for (n = 0; n < ncandidates && flow > 0.; n++)
+		{
+			if (dst[n] != -1)
+				continue;
+			/* Overshooting the flow by less than itself still gets
+			 * closer to the balance */
+			if (candidates[n].load > 2. * flow)
+				continue;
+			/* Not worth the transfer */
+			if (candidates[n].load <= byte_cost * candidates[n].size)
+				continue;
+			if (max_bytes && moved_bytes + candidates[n].size > max_bytes)
+				continue;
+
+			dst[n] = neighbor_ids[i];
+			flow -= candidates[n].load;
+			moved_bytes += candidates[n].size;
+			nmoves++;
+		}
+	}
+
+	starpu_data_acquire_on_node(data_movements_handles[my_rank], STARPU_MAIN_RAM, STARPU_RW);
+	data_movements_reallocate_tables(data_movements_handles[my_rank], STARPU_MAIN_RAM, nmoves);
+	if (nmoves)
+	{
+		starpu_mpi_tag_t *tags = data_movements_get_tags_table(data_movements_handles[my_rank]);
+		int *ranks = data_movements_get_ranks_table(data_movements_handles[my_rank]);
+		i = 0;
+		for (n = 0; n < ncandidates; n++)
+		{
+			if (dst[n] == -1)
+				continue;
+			tags[i] = starpu_mpi_data_get_tag(candidates[n].handle);
+			ranks[i] = dst[n];
+			i++;
+		}
+	}
+	starpu_data_release_on_node(data_movements_handles[my_rank], STARPU_MAIN_RAM);
+
+	_STARPU_MPI_DEBUG(3, "node %d moves %d data (%lu bytes) out\n", my_rank, nmoves, (unsigned long) moved_bytes);
+
+	free(dst);
+	free(candidates);
+}
+
+static void exchange_data_movements_infos(void)
+{
+	starpu_mpi_req send_req[world_size];
+	starpu_mpi_req recv_req[world_size];
+	int i, ret;
+
+	for (i = 0; i < world_size; i++)
+	{
+		if (i == my_rank)
+			continue;
+		ret = starpu_mpi_isend(data_movements_handles[my_rank], &send_req[i], i, TAG_MOV(my_rank), MPI_COMM_WORLD);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_isend");
+		ret = starpu_mpi_irecv(data_movements_handles[i], &recv_req[i], i, TAG_MOV(i), MPI_COMM_WORLD);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv");
+	}
+	for (i = 0; i < world_size; i++)
+	{
+		if (i == my_rank)
+			continue;
+		ret = starpu_mpi_wait(&send_req[i], MPI_STATUS_IGNORE);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+		ret = starpu_mpi_wait(&recv_req[i], MPI_STATUS_IGNORE);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+	}
+}
+
+static void migrate(starpu_data_handle_t handle, int dst_rank)
+{
+	int src_rank = starpu_mpi_data_get_rank(handle);
+	struct moved_data_entry *md;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&handle_loads_mutex);
+	HASH_FIND_PTR(mdh, &handle, md);
+	if (!md)
+	{
+		_STARPU_MPI_MALLOC(md, sizeof(*md));
+		md->handle = handle;
+		md->home_rank = src_rank;
+		HASH_ADD_PTR(mdh, handle, md);
+	}
+	else if (md->home_rank == dst_rank)
+	{
+		HASH_DEL(mdh, md);
+		free(md);
+	}
+
+	if (src_rank == my_rank)
+	{
+		/* The tasks on it will not be executed here any more */
+		struct handle_load_entry *entry;
+		HASH_FIND_PTR(handle_loads, &handle, entry);
+		if (entry)
+		{
+			HASH_DEL(handle_loads, entry);
+			free(entry);
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&handle_loads_mutex);
+
+	_STARPU_MPI_DEBUG(3, "Migrating data %"PRIi64" from node %d to node %d\n", starpu_mpi_data_get_tag(handle), src_rank, dst_rank);
+	starpu_mpi_data_migrate(MPI_COMM_WORLD, handle, dst_rank);
+}
+
+/* All nodes apply the whole plan in the same order */
+static void apply_plan(void)
+{
+	int i, j;
+
+	for (i = 0; i < world_size; i++)
+	{
+		int nmoves = data_movements_get_size_tables(data_movements_handles[i]);
+		starpu_mpi_tag_t *tags = data_movements_get_tags_table(data_movements_handles[i]);
+		int *ranks = data_movements_get_ranks_table(data_movements_handles[i]);
+
+		for (j = 0; j < nmoves; j++)
+		{
+			starpu_data_handle_t handle = _starpu_mpi_tag_get_data_handle_from_tag(tags[j]);
+			/* The local node does not know about this data */
+			if (!handle)
+				continue;
+			STARPU_ASSERT_MSG(starpu_mpi_data_get_rank(handle) == i, "data %"PRIi64" was expected to be owned by node %d\n", tags[j], i);
+			migrate(handle, ranks[j]);
+		}
+	}
+}
+
+static void clean_balance(void)
+{
+	int i;
+	starpu_mpi_cache_flush(MPI_COMM_WORLD, local_load_handle);
+	for (i = 0; i < nneighbors; i++)
+		starpu_mpi_cache_flush(MPI_COMM_WORLD, neighbor_load_handles[i]);
+	for (i = 0; i < world_size; i++)
+		starpu_mpi_cache_flush(MPI_COMM_WORLD, data_movements_handles[i]);
+}
+
+/******************************************************************************
+ *                    Diffusion Load Balancer Entry Points                    *
+ *****************************************************************************/
+
+static void submitted_task_diffusion(struct starpu_task *task)
+{
+	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
+	unsigned i;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&handle_loads_mutex);
+	for (i = 0; i < nbuffers; i++)
+		if (STARPU_TASK_GET_MODE(task, i) & STARPU_W)
+			get_handle_load(STARPU_TASK_GET_HANDLE(task, i))->nsubmitted++;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&handle_loads_mutex);
+}
+
+static void cancelled_task_diffusion(struct starpu_task *task)
+{
+	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
+	unsigned i;
+
+	/* The submission failed, the task will never be executed */
+	STARPU_PTHREAD_MUTEX_LOCK(&handle_loads_mutex);
+	for (i = 0; i < nbuffers; i++)
+		if (STARPU_TASK_GET_MODE(task, i) & STARPU_W)
+		{
+			struct handle_load_entry *entry;
+			starpu_data_handle_t handle = STARPU_TASK_GET_HANDLE(task, i);
+			HASH_FIND_PTR(handle_loads, &handle, entry);
+			if (entry && entry->nsubmitted)
+				entry->nsubmitted--;
+		}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&handle_loads_mutex);
+}
+
+static void finished_task_diffusion(struct starpu_task *task)
+{
+	unsigned nw = nwritten_buffers(task);
+	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
+	unsigned i;
+
+	if (!nw)
+		return;
+
+	double duration = task_duration(task) / nw;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&handle_loads_mutex);
+	for (i = 0; i < nbuffers; i++)
+		if (STARPU_TASK_GET_MODE(task, i) & STARPU_W)
+		{
+			struct handle_load_entry *entry = get_handle_load(STARPU_TASK_GET_HANDLE(task, i));
+			entry->time += duration;
+			entry->nfinished++;
+		}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&handle_loads_mutex);
+}
+
+static void data_clear_diffusion(starpu_data_handle_t handle)
+{
+	struct handle_load_entry *entry;
+	struct moved_data_entry *md;
+
+	/* Do not keep pointers to the unregistered handle */
+	STARPU_PTHREAD_MUTEX_LOCK(&handle_loads_mutex);
+	HASH_FIND_PTR(handle_loads, &handle, entry);
+	if (entry)
+	{
+		HASH_DEL(handle_loads, entry);
+		free(entry);
+	}
+	HASH_FIND_PTR(mdh, &handle, md);
+	if (md)
+	{
+		HASH_DEL(mdh, md);
+		free(md);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&handle_loads_mutex);
+}
+
+static void balance_diffusion(void)
+{
+	compute_plan();
+	exchange_data_movements_infos();
+	apply_plan();
+	clean_balance();
+}
+
+/******************************************************************************
+ *                  Initialization / Deinitialization                         *
+ *****************************************************************************/
+
+static int init_diffusion(struct starpu_mpi_lb_conf *itf)
+{
+	int i;
+
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &world_size);
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &my_rank);
+
+	/* The data units are chosen by the policy itself */
+	if (!(itf && itf->get_neighbors))
+	{
+		_STARPU_MSG("Error: struct starpu_mpi_lb_conf %p invalid\n", itf);
+		return 1;
+	}
+
+	_STARPU_MPI_MALLOC(user_itf, sizeof(struct starpu_mpi_lb_conf));
+	memcpy(user_itf, itf, sizeof(struct starpu_mpi_lb_conf));
+
+	user_itf->get_neighbors(&neighbor_ids, &nneighbors);
+	if (nneighbors == 0)
+	{
+		_STARPU_MSG("Error: Function get_neighbors returning 0 neighbor\n");
+		free(user_itf);
+		user_itf = NULL;
+		return 2;
+	}
+
+	imbalance_threshold = starpu_getenv_float_default("LB_DIFFUSION_THRESHOLD", 0.1);
+	byte_cost = starpu_getenv_float_default("LB_DIFFUSION_BYTE_COST", 0.001);
+	max_bytes = starpu_getenv_number_default("LB_DIFFUSION_MAX_BYTES", 16*1024*1024);
+
+	/* Get actual execution times */
+	saved_profiling = starpu_profiling_status_set(STARPU_PROFILING_ENABLE);
+
+	STARPU_PTHREAD_MUTEX_INIT(&handle_loads_mutex, NULL);
+	handle_loads = NULL;
+	mdh = NULL;
+
+	starpu_vector_data_register(&local_load_handle, STARPU_MAIN_RAM, (uintptr_t) local_load, 2, sizeof(double));
+	starpu_mpi_data_register(local_load_handle, TAG_LOAD(my_rank), my_rank);
+
+	_STARPU_MPI_CALLOC(neighbor_loads, nneighbors, sizeof(*neighbor_loads));
+	_STARPU_MPI_CALLOC(neighbor_load_handles, nneighbors, sizeof(starpu_data_handle_t));
+	for (i = 0; i < nneighbors; i++)
+	{
+		starpu_vector_data_register(&neighbor_load_handles[i], STARPU_MAIN_RAM, (uintptr_t) neighbor_loads[i], 2, sizeof(double));
+		starpu_mpi_data_register(neighbor_load_handles[i], TAG_LOAD(neighbor_ids[i]), neighbor_ids[i]);
+	}
+
+	_STARPU_MPI_MALLOC(data_movements_handles, world_size*sizeof(starpu_data_handle_t));
+	for (i = 0; i < world_size; i++)
+	{
+		data_movements_data_register(&data_movements_handles[i], STARPU_MAIN_RAM, NULL, NULL, 0);
+		starpu_mpi_data_register(data_movements_handles[i], TAG_MOV(i), i);
+	}
+
+	return 0;
+}
+
+/* Bring back all migrated data to their original owner, to ensure the
+ * consistency with the ranks of data originally registered by the
+ * application. All nodes know about all migrations, so no exchange is
+ * needed. */
+static void move_back_data(void)
+{
+	struct moved_data_entry *md, *tmp;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&handle_loads_mutex);
+	HASH_ITER(hh, mdh, md, tmp)
+	{
+		_STARPU_MPI_DEBUG(3, "Moving back data %"PRIi64" to node %d\n", starpu_mpi_data_get_tag(md->handle), md->home_rank);
+		starpu_mpi_data_migrate(MPI_COMM_WORLD, md->handle, md->home_rank);
+		HASH_DEL(mdh, md);
+		free(md);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&handle_loads_mutex);
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+}
+
+static int deinit_diffusion(void)
+{
+	struct handle_load_entry *entry, *tmp;
+	int i;
+
+	if ((!user_itf) || (nneighbors == 0))
+		return 1;
+
+	_STARPU_DEBUG("Shutting down diffusion lb policy\n");
+
+	move_back_data();
+
+	HASH_ITER(hh, handle_loads, entry, tmp)
+	{
+		HASH_DEL(handle_loads, entry);
+		free(entry);
+	}
+
+	starpu_mpi_cache_flush(MPI_COMM_WORLD, local_load_handle);
+	starpu_data_unregister(local_load_handle);
+
+	for (i = 0; i < nneighbors; i++)
+	{
+		starpu_mpi_cache_flush(MPI_COMM_WORLD, neighbor_load_handles[i]);
+		starpu_data_unregister(neighbor_load_handles[i]);
+	}
+	free(neighbor_load_handles);
+	neighbor_load_handles = NULL;
+	free(neighbor_loads);
+	neighbor_loads = NULL;
+
+	nneighbors = 0;
+	free(neighbor_ids);
+	neighbor_ids = NULL;
+
+	for (i = 0; i < world_size; i++)
+	{
+		starpu_mpi_cache_flush(MPI_COMM_WORLD, data_movements_handles[i]);
+		starpu_data_acquire_on_node(data_movements_handles[i], STARPU_MAIN_RAM, STARPU_W);
+		data_movements_reallocate_tables(data_movements_handles[i], STARPU_MAIN_RAM, 0);
+		starpu_data_release_on_node(data_movements_handles[i], STARPU_MAIN_RAM);
+		starpu_data_unregister(data_movements_handles[i]);
+	}
+	free(data_movements_handles);
+	data_movements_handles = NULL;
+
+	starpu_profiling_status_set(saved_profiling);
+
+	/* Only now, the handles above are cleared from data_clear_diffusion */
+	STARPU_PTHREAD_MUTEX_DESTROY(&handle_loads_mutex);
+	free(user_itf);
+	user_itf = NULL;
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                  Policy                                    *
+ *****************************************************************************/
+
+struct load_balancer_policy load_diffusion_policy =
+{
+	.init = init_diffusion,
+	.deinit = deinit_diffusion,
+	.submitted_task_entry_point = submitted_task_diffusion,
+	.cancelled_task_entry_point = cancelled_task_diffusion,
+	.finished_task_entry_point = finished_task_diffusion,
+	.data_clear_entry_point = data_clear_diffusion,
+	.balance_entry_point = balance_diffusion,
+	.policy_name = "diffusion"
+};
+
+#endif
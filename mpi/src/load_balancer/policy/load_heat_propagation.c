@@ -401,8 +401,16 @@ static void submitted_task_heat(struct starpu_task *task)
 	}
 }
 
-static void finished_task_heat()
+static void cancelled_task_heat(struct starpu_task *task)
 {
+	(void)task;
+	/* The submission failed, the task will never finish */
+	load_data_dec_nsubmitted_tasks(*load_data_handle);
+}
+
+static void finished_task_heat(struct starpu_task *task)
+{
+	(void)task;
 	//fprintf(stderr,"Try to decrement nsubmitted_tasks...");
 	STARPU_PTHREAD_MUTEX_LOCK(&load_data_mutex);
 
@@ -659,6 +667,7 @@ struct load_balancer_policy load_heat_propagation_policy =
 	.init = init_heat,
 	.deinit = deinit_heat,
 	.submitted_task_entry_point = submitted_task_heat,
+	.cancelled_task_entry_point = cancelled_task_heat,
 	.finished_task_entry_point = finished_task_heat,
 	.policy_name = "heat"
 };
@@ -56,13 +56,13 @@ int _starpu_mpi_choose_node(starpu_data_handle_t handle, enum starpu_data_access
 				 * a clue that we want to push directly to the GPU */
 				if (_starpu_mpi_has_cuda
 				        && starpu_node_get_kind(i) == STARPU_CUDA_RAM
-					&& handle->per_node[i].allocated
+					&& _starpu_data_peek_replicate(handle, i)->allocated
 					&& (_starpu_mpi_cuda_devid == -1 || _starpu_mpi_cuda_devid == starpu_memory_node_get_devid(i)))
 					/* This node already has allocated buffers, let's just use it */
 					return i;
 				if (_starpu_mpi_has_hip
 				        && starpu_node_get_kind(i) == STARPU_HIP_RAM
-					&& handle->per_node[i].allocated
+					&& _starpu_data_peek_replicate(handle, i)->allocated
 					&& (_starpu_mpi_hip_devid == -1 || _starpu_mpi_hip_devid == starpu_memory_node_get_devid(i)))
 					/* This node already has allocated buffers, let's just use it */
 					return i;
@@ -73,7 +73,7 @@ int _starpu_mpi_choose_node(starpu_data_handle_t handle, enum starpu_data_access
 			/* Note: We take as a hint that it's allocated on a NUMA node as
 			 * a clue that we want to push directly to that NUMA node */
 			if (starpu_node_get_kind(i) == STARPU_CPU_RAM
-				&& handle->per_node[i].allocated)
+				&& _starpu_data_peek_replicate(handle, i)->allocated)
 				/* This node already has allocated buffers, let's just use it */
 				return i;
 		}
@@ -105,7 +105,7 @@ int _starpu_mpi_choose_node(starpu_data_handle_t handle, enum starpu_data_access
 		unsigned i;
 		for (i = 0; i < STARPU_MAXNODES; i++)
 		{
-			if (handle->per_node[i].state != STARPU_INVALID)
+			if (_starpu_data_peek_replicate(handle, i)->state != STARPU_INVALID)
 			{
 				/* If this node already has the value, let's just use it */
 				/* TODO: rather pick up place next to NIC */
@@ -483,6 +483,8 @@ void _starpu_mpi_data_clear(starpu_data_handle_t data_handle)
 	struct _starpu_mpi_data *data = data_handle->mpi_data;
 	_mpi_backend._starpu_mpi_backend_data_clear(data_handle);
 	_starpu_mpi_cache_data_clear(data_handle);
+	_starpu_mpi_select_node_data_clear(data_handle);
+	_starpu_mpi_lb_data_clear(data_handle);
 	_starpu_spin_destroy(&data->coop_lock);
 	free(data->redux_map);
 	data->redux_map = NULL;
@@ -20,6 +20,7 @@
 
 #include <starpu_mpi_cache.h>
 #include <starpu_mpi_cache_stats.h>
+#include <starpu_mpi_select_node.h>
 #include <starpu_mpi_private.h>
 #include <mpi_failure_tolerance/starpu_mpi_ft_stats.h>
 
@@ -30,6 +31,37 @@ struct _starpu_data_entry
 	starpu_data_handle_t data_handle;
 };
 
+/*
+ * When the size of the cache is bounded (STARPU_MPI_CACHE_LIMIT), the data
+ * received from each node is kept in an LRU list, and the least recently used
+ * copies are evicted when the share of the budget for that node is exceeded.
+ *
+ * The nodes sending data keep the same lists for the data they sent to each
+ * node: both sides see exactly the same sequence of cache operations for a
+ * given pair of nodes, so they take the same eviction decisions, and the
+ * sender knows that it has to send the data again after the receiver evicted
+ * it.
+ */
+LIST_TYPE(_starpu_mpi_cache_lru,
+	starpu_data_handle_t data_handle;
+	int node;
+	size_t size;
+);
+
+struct _starpu_mpi_cache_node
+{
+	/** Data received from the node, least recently used first */
+	struct _starpu_mpi_cache_lru_list received;
+	size_t received_size;
+	/** Data sent to the node, least recently used first */
+	struct _starpu_mpi_cache_lru_list sent;
+	size_t sent_size;
+};
+
+/* Budget for the data received from each node, 0 if unbounded */
+static size_t _cache_node_limit;
+static struct _starpu_mpi_cache_node *_cache_nodes;
+
 static starpu_pthread_mutex_t _cache_mutex;
 static struct _starpu_data_entry *_cache_data = NULL;
 int _starpu_cache_enabled=1;
@@ -37,6 +69,7 @@ static MPI_Comm _starpu_cache_comm;
 static int _starpu_cache_comm_size;
 
 static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle);
+static void _starpu_mpi_cache_data_remove_nolock(starpu_data_handle_t data_handle);
 
 int starpu_mpi_cache_is_enabled()
 {
@@ -80,6 +113,162 @@ void _starpu_mpi_cache_init(MPI_Comm comm)
 	starpu_mpi_comm_size(comm, &_starpu_cache_comm_size);
 	_starpu_mpi_cache_stats_init();
 	STARPU_PTHREAD_MUTEX_INIT(&_cache_mutex, NULL);
+
+	starpu_ssize_t limit = starpu_getenv_number_default("STARPU_MPI_CACHE_LIMIT", 0);
+	if (limit > 0 && _starpu_cache_comm_size > 1)
+	{
+		int i;
+		/* The share of each node has to be known by the senders, split the budget evenly */
+		_cache_node_limit = (limit * 1024 * 1024) / (_starpu_cache_comm_size - 1);
+		_STARPU_MPI_CALLOC(_cache_nodes, _starpu_cache_comm_size, sizeof(_cache_nodes[0]));
+		for(i=0 ; i<_starpu_cache_comm_size ; i++)
+		{
+			_starpu_mpi_cache_lru_list_init(&_cache_nodes[i].received);
+			_starpu_mpi_cache_lru_list_init(&_cache_nodes[i].sent);
+		}
+	}
+}
+
+/**************************************
+ * Size bound
+ **************************************/
+
+size_t _starpu_mpi_cache_get_node_limit(void)
+{
+	return _cache_node_limit;
+}
+
+/* Drop the received copy of the data from the LRU lists */
+static void _starpu_mpi_cache_lru_received_remove_nolock(struct _starpu_mpi_data *mpi_data)
+{
+	struct _starpu_mpi_cache_lru *lru = mpi_data->cache_received_lru;
+	if (lru == NULL)
+		return;
+	_starpu_mpi_cache_lru_list_erase(&_cache_nodes[lru->node].received, lru);
+	_cache_nodes[lru->node].received_size -= lru->size;
+	_starpu_mpi_cache_lru_delete(lru);
+	mpi_data->cache_received_lru = NULL;
+}
+
+/* Drop the copy of the data sent to the node from the LRU lists */
+static void _starpu_mpi_cache_lru_sent_remove_nolock(struct _starpu_mpi_data *mpi_data, int node)
+{
+	struct _starpu_mpi_cache_lru *lru = mpi_data->cache_sent_lru ? mpi_data->cache_sent_lru[node] : NULL;
+	if (lru == NULL)
+		return;
+	_starpu_mpi_cache_lru_list_erase(&_cache_nodes[node].sent, lru);
+	_cache_nodes[node].sent_size -= lru->size;
+	_starpu_mpi_cache_lru_delete(lru);
+	mpi_data->cache_sent_lru[node] = NULL;
+}
+
+/* Forget about the data in the cache if it is not cached any more at all */
+static void _starpu_mpi_cache_data_remove_unused_nolock(starpu_data_handle_t data_handle)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	int i;
+
+	if (mpi_data->cache_received)
+		return;
+	for(i=0 ; i<_starpu_cache_comm_size ; i++)
+		if (mpi_data->cache_sent[i])
+			return;
+	_starpu_mpi_cache_data_remove_nolock(data_handle);
+}
+
+static void _starpu_mpi_cache_evict_received_nolock(struct _starpu_mpi_cache_lru *lru)
+{
+	starpu_data_handle_t data_handle = lru->data_handle;
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	int node = lru->node;
+
+	_STARPU_MPI_DEBUG(2, "Evicting received data %p from the cache\n", data_handle);
+	_starpu_mpi_cache_stats_evict(node, data_handle);
+	_starpu_mpi_cache_stats_dec(node, data_handle);
+	_starpu_mpi_cache_stats_received_dec(node, data_handle);
+	_starpu_mpi_cache_lru_received_remove_nolock(mpi_data);
+	mpi_data->cache_received = 0;
+	mpi_data->ft_induced_cache_received = 0;
+	mpi_data->ft_induced_cache_received_count = 0;
+	starpu_data_invalidate_submit(data_handle);
+	_starpu_mpi_cache_data_remove_unused_nolock(data_handle);
+}
+
+static void _starpu_mpi_cache_evict_sent_nolock(struct _starpu_mpi_cache_lru *lru)
+{
+	starpu_data_handle_t data_handle = lru->data_handle;
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	int node = lru->node;
+
+	_STARPU_MPI_DEBUG(2, "Node %d evicted data %p from its cache\n", node, data_handle);
+	_starpu_mpi_cache_lru_sent_remove_nolock(mpi_data, node);
+	mpi_data->cache_sent[node] = 0;
+	_starpu_mpi_cache_data_remove_unused_nolock(data_handle);
+}
+
+/* The data was received, or used again */
+static void _starpu_mpi_cache_lru_received_use_nolock(starpu_data_handle_t data_handle, int node)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	struct _starpu_mpi_cache_lru *lru = mpi_data->cache_received_lru;
+
+	if (_cache_node_limit == 0)
+		return;
+
+	if (lru)
+	{
+		_starpu_mpi_cache_lru_list_erase(&_cache_nodes[lru->node].received, lru);
+		_starpu_mpi_cache_lru_list_push_back(&_cache_nodes[lru->node].received, lru);
+		return;
+	}
+
+	lru = _starpu_mpi_cache_lru_new();
+	lru->data_handle = data_handle;
+	lru->node = node;
+	lru->size = starpu_data_get_size(data_handle);
+
+	/* Make room for it */
+	while (_cache_nodes[node].received_size + lru->size > _cache_node_limit
+	       && !_starpu_mpi_cache_lru_list_empty(&_cache_nodes[node].received))
+		_starpu_mpi_cache_evict_received_nolock(_starpu_mpi_cache_lru_list_front(&_cache_nodes[node].received));
+
+	_starpu_mpi_cache_lru_list_push_back(&_cache_nodes[node].received, lru);
+	_cache_nodes[node].received_size += lru->size;
+	mpi_data->cache_received_lru = lru;
+}
+
+/* The data was sent to the node, or would have been sent again */
+static void _starpu_mpi_cache_lru_sent_use_nolock(starpu_data_handle_t data_handle, int node)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	struct _starpu_mpi_cache_lru *lru;
+
+	if (_cache_node_limit == 0)
+		return;
+
+	if (mpi_data->cache_sent_lru == NULL)
+		_STARPU_MPI_CALLOC(mpi_data->cache_sent_lru, _starpu_cache_comm_size, sizeof(mpi_data->cache_sent_lru[0]));
+	lru = mpi_data->cache_sent_lru[node];
+	if (lru)
+	{
+		_starpu_mpi_cache_lru_list_erase(&_cache_nodes[node].sent, lru);
+		_starpu_mpi_cache_lru_list_push_back(&_cache_nodes[node].sent, lru);
+		return;
+	}
+
+	lru = _starpu_mpi_cache_lru_new();
+	lru->data_handle = data_handle;
+	lru->node = node;
+	lru->size = starpu_data_get_size(data_handle);
+
+	/* Mirror the evictions the node is doing */
+	while (_cache_nodes[node].sent_size + lru->size > _cache_node_limit
+	       && !_starpu_mpi_cache_lru_list_empty(&_cache_nodes[node].sent))
+		_starpu_mpi_cache_evict_sent_nolock(_starpu_mpi_cache_lru_list_front(&_cache_nodes[node].sent));
+
+	_starpu_mpi_cache_lru_list_push_back(&_cache_nodes[node].sent, lru);
+	_cache_nodes[node].sent_size += lru->size;
+	mpi_data->cache_sent_lru[node] = lru;
 }
 
 void _starpu_mpi_cache_shutdown()
@@ -95,6 +284,18 @@ void _starpu_mpi_cache_shutdown()
 		HASH_DEL(_cache_data, entry);
 		free(entry);
 	}
+	if (_cache_nodes)
+	{
+		int i;
+		for(i=0 ; i<_starpu_cache_comm_size ; i++)
+		{
+			STARPU_ASSERT(_starpu_mpi_cache_lru_list_empty(&_cache_nodes[i].received));
+			STARPU_ASSERT(_starpu_mpi_cache_lru_list_empty(&_cache_nodes[i].sent));
+		}
+		free(_cache_nodes);
+		_cache_nodes = NULL;
+		_cache_node_limit = 0;
+	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	STARPU_PTHREAD_MUTEX_DESTROY(&_cache_mutex);
 	_starpu_mpi_cache_stats_shutdown();
@@ -119,6 +320,7 @@ void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle)
 	}
 
 	free(mpi_data->cache_sent);
+	free(mpi_data->cache_sent_lru);
 }
 
 void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle)
@@ -198,7 +400,9 @@ void starpu_mpi_cached_receive_clear(starpu_data_handle_t data_handle)
 		mpi_data->ft_induced_cache_received_count = 0;
 		starpu_data_invalidate_submit(data_handle);
 		_starpu_mpi_cache_data_remove_nolock(data_handle);
+		_starpu_mpi_cache_lru_received_remove_nolock(mpi_data);
 		_starpu_mpi_cache_stats_dec(mpi_rank, data_handle);
+		_starpu_mpi_cache_stats_received_dec(mpi_rank, data_handle);
 	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 }
@@ -222,10 +426,14 @@ int starpu_mpi_cached_receive_set(starpu_data_handle_t data_handle)
 		_STARPU_MPI_DEBUG(2, "Noting that data %p has already been received by %d\n", data_handle, mpi_rank);
 		mpi_data->cache_received = 1;
 		_starpu_mpi_cache_data_add_nolock(data_handle);
+		_starpu_mpi_cache_lru_received_use_nolock(data_handle, mpi_rank);
 		_starpu_mpi_cache_stats_inc(mpi_rank, data_handle);
+		_starpu_mpi_cache_stats_miss(mpi_rank, data_handle);
 	}
 	else
 	{
+		_starpu_mpi_cache_stats_hit(mpi_rank, data_handle);
+		_starpu_mpi_cache_lru_received_use_nolock(data_handle, mpi_rank);
 #ifdef STARPU_USE_MPI_FT_STATS
 		if (mpi_data->ft_induced_cache_received == 1 && mpi_data->ft_induced_cache_received_count == 0)
 		{
@@ -262,10 +470,14 @@ int starpu_mpi_cached_cp_receive_set(starpu_data_handle_t data_handle)
 		_STARPU_MPI_FT_STATS_RECV_CP_DATA(starpu_data_get_size(data_handle));
 #endif
 		_starpu_mpi_cache_data_add_nolock(data_handle);
+		_starpu_mpi_cache_lru_received_use_nolock(data_handle, mpi_rank);
 		_starpu_mpi_cache_stats_inc(mpi_rank, data_handle);
+		_starpu_mpi_cache_stats_miss(mpi_rank, data_handle);
 	}
 	else
 	{
+		_starpu_mpi_cache_stats_hit(mpi_rank, data_handle);
+		_starpu_mpi_cache_lru_received_use_nolock(data_handle, mpi_rank);
 #ifdef STARPU_USE_MPI_FT_STATS
 		if (mpi_data->ft_induced_cache_received == 1)
 			_STARPU_MPI_FT_STATS_RECV_CP_CACHED_CP_DATA(starpu_data_get_size(data_handle));
@@ -313,6 +525,7 @@ void starpu_mpi_cached_send_clear(starpu_data_handle_t data_handle)
 			_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
 			mpi_data->cache_sent[n] = 0;
 			_starpu_mpi_cache_data_remove_nolock(data_handle);
+			_starpu_mpi_cache_lru_sent_remove_nolock(mpi_data, n);
 		}
 	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
@@ -339,6 +552,7 @@ int starpu_mpi_cached_send_set(starpu_data_handle_t data_handle, int dest)
 	{
 		_STARPU_MPI_DEBUG(2, "Do not send data %p to node %d as it has already been sent\n", data_handle, dest);
 	}
+	_starpu_mpi_cache_lru_sent_use_nolock(data_handle, dest);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	return already_sent;
 }
@@ -373,6 +587,7 @@ static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle)
 		{
 			_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
 			mpi_data->cache_sent[i] = 0;
+			_starpu_mpi_cache_lru_sent_remove_nolock(mpi_data, i);
 			_starpu_mpi_cache_stats_dec(i, data_handle);
 		}
 	}
@@ -384,7 +599,9 @@ static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle)
 		mpi_data->cache_received = 0;
 		mpi_data->ft_induced_cache_received = 0;
 		mpi_data->ft_induced_cache_received_count = 0;
+		_starpu_mpi_cache_lru_received_remove_nolock(mpi_data);
 		_starpu_mpi_cache_stats_dec(mpi_rank, data_handle);
+		_starpu_mpi_cache_stats_received_dec(mpi_rank, data_handle);
 	}
 }
 
@@ -404,6 +621,7 @@ static void _starpu_mpi_cache_flush_and_invalidate_nolock(MPI_Comm comm, starpu_
 void starpu_mpi_cache_flush(MPI_Comm comm, starpu_data_handle_t data_handle)
 {
 	_starpu_mpi_data_flush(data_handle);
+	_starpu_mpi_select_node_data_flush(data_handle);
 
 	if (_starpu_cache_enabled == 0)
 		return;
@@ -418,6 +636,8 @@ void starpu_mpi_cache_flush_all_data(MPI_Comm comm)
 {
 	struct _starpu_data_entry *entry=NULL, *tmp=NULL;
 
+	_starpu_mpi_select_node_flush_all();
+
 	if (_starpu_cache_enabled == 0)
 		return;
 
@@ -430,3 +650,16 @@ void starpu_mpi_cache_flush_all_data(MPI_Comm comm)
 	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 }
+
+void starpu_mpi_cache_stats_retrieve(struct starpu_mpi_cache_stats *stats)
+{
+	if (_starpu_cache_enabled == 0)
+	{
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	_starpu_mpi_cache_stats_get(stats);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+}
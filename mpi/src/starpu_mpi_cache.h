@@ -33,6 +33,8 @@ void _starpu_mpi_cache_init(MPI_Comm comm);
 void _starpu_mpi_cache_shutdown();
 void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle);
 void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle);
+/** Budget for the data received by a node from another node, 0 if unbounded */
+size_t _starpu_mpi_cache_get_node_limit(void);
 
 #ifdef __cplusplus
 }
@@ -21,6 +21,9 @@
 
 static int stats_enabled=0;
 
+/* Always maintained, they are cheap and the cache mutex is held anyway */
+static struct starpu_mpi_cache_stats cache_stats;
+
 void _starpu_mpi_cache_stats_init()
 {
 	stats_enabled = starpu_getenv_number("STARPU_MPI_CACHE_STATS");
@@ -39,6 +42,10 @@ void _starpu_mpi_cache_stats_shutdown()
 {
 	if (stats_enabled == 0)
 		return;
+
+	_STARPU_MPI_MSG("[communication cache] hits %lu misses %lu evictions %lu (%ld bytes) max size %ld bytes\n",
+			cache_stats.hits, cache_stats.misses, cache_stats.evictions,
+			(long)cache_stats.evicted_size, (long)cache_stats.max_size);
 }
 
 void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_handle, int count)
@@ -59,3 +66,44 @@ void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_hand
 		_STARPU_MPI_MSG("[communication cache] - %10ld from %u\n", (long)size, dst);
 	}
 }
+
+void _starpu_mpi_cache_stats_hit(unsigned src, starpu_data_handle_t data_handle)
+{
+	(void)src;
+	(void)data_handle;
+	cache_stats.hits++;
+}
+
+void _starpu_mpi_cache_stats_miss(unsigned src, starpu_data_handle_t data_handle)
+{
+	(void)src;
+	cache_stats.misses++;
+	cache_stats.size += starpu_data_get_size(data_handle);
+	if (cache_stats.size > cache_stats.max_size)
+		cache_stats.max_size = cache_stats.size;
+}
+
+void _starpu_mpi_cache_stats_received_dec(unsigned src, starpu_data_handle_t data_handle)
+{
+	(void)src;
+	cache_stats.size -= starpu_data_get_size(data_handle);
+}
+
+void _starpu_mpi_cache_stats_evict(unsigned src, starpu_data_handle_t data_handle)
+{
+	size_t size;
+
+	size = starpu_data_get_size(data_handle);
+	cache_stats.evictions++;
+	cache_stats.evicted_size += size;
+
+	if (stats_enabled == 0)
+		return;
+
+	_STARPU_MPI_MSG("[communication cache] evict %10ld from %u\n", (long)size, src);
+}
+
+void _starpu_mpi_cache_stats_get(struct starpu_mpi_cache_stats *stats)
+{
+	*stats = cache_stats;
+}
@@ -20,6 +20,7 @@
 #include <starpu.h>
 #include <stdlib.h>
 #include <mpi.h>
+#include <starpu_mpi.h>
 
 /** @file */
 
@@ -36,6 +37,15 @@ void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_hand
 #define _starpu_mpi_cache_stats_inc(dst, data_handle) _starpu_mpi_cache_stats_update(dst, data_handle, +1)
 #define _starpu_mpi_cache_stats_dec(dst, data_handle) _starpu_mpi_cache_stats_update(dst, data_handle, -1)
 
+/** Hit and miss of the receive cache, data received from \p src */
+void _starpu_mpi_cache_stats_hit(unsigned src, starpu_data_handle_t data_handle);
+void _starpu_mpi_cache_stats_miss(unsigned src, starpu_data_handle_t data_handle);
+/** A received copy left the cache */
+void _starpu_mpi_cache_stats_received_dec(unsigned src, starpu_data_handle_t data_handle);
+/** A received copy was evicted to bound the size of the cache */
+void _starpu_mpi_cache_stats_evict(unsigned src, starpu_data_handle_t data_handle);
+void _starpu_mpi_cache_stats_get(struct starpu_mpi_cache_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
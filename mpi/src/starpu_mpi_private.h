@@ -211,6 +211,8 @@ struct _starpu_mpi_coop_sends
 	long pre_sync_jobid;
 };
 
+struct _starpu_mpi_cache_lru;
+
 /** Initialized in starpu_mpi_data_register_comm */
 struct _starpu_mpi_data
 {
@@ -222,6 +224,11 @@ struct _starpu_mpi_data
 	unsigned int ft_induced_cache_received_count:1;
 	unsigned int modified:1; // Whether the data has been modified since the registration.
 
+	/** Position of the received copy, and of the copies sent to each
+	  * node, in the LRU lists of the cache when its size is bounded */
+	struct _starpu_mpi_cache_lru *cache_received_lru;
+	struct _starpu_mpi_cache_lru **cache_sent_lru;
+
 	/** Array used to store the contributing nodes to this data
 	  * when it is accessed in (MPI_)REDUX mode. */
 	char* redux_map;
@@ -234,6 +241,17 @@ struct _starpu_mpi_data
 
 	/** When provided, wait the given number of sends to start a coop, instead of just waiting that data are ready */
 	unsigned nb_future_sends;
+
+	/** Ranks which hold a valid replica of the data besides its owner,
+	  * as seen by the ::STARPU_MPI_NODE_SELECTION_MIN_TRANSFER policy.
+	  * This is maintained identically on all ranks. */
+	char *select_node_replicas;
+	int select_node_nb_nodes;
+	/** Cache flush generation select_node_replicas corresponds to */
+	unsigned select_node_gen;
+	/** Position of the replicas in the LRU lists mirroring the cache
+	  * evictions, when the size of the cache is bounded */
+	struct _starpu_mpi_select_node_lru **select_node_lru;
 };
 
 struct _starpu_mpi_data *_starpu_mpi_data_get(starpu_data_handle_t data_handle);
@@ -349,6 +367,9 @@ int _starpu_mpi_choose_node(starpu_data_handle_t data_handle, enum starpu_data_a
 
 void _starpu_mpi_data_flush(starpu_data_handle_t data_handle);
 
+/** The data is being unregistered, let the load balancer forget about it */
+void _starpu_mpi_lb_data_clear(starpu_data_handle_t data_handle);
+
 /** To be called at initialization to set up the tags upper bound */
 void _starpu_mpi_tags_init(void);
 
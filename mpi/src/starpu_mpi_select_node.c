@@ -22,21 +22,85 @@
 #include <starpu_data.h>
 #include <starpu_mpi_private.h>
 #include <starpu_mpi_select_node.h>
+#include <starpu_mpi_cache.h>
 #include <datawizard/coherency.h>
 
 static int _current_policy = STARPU_MPI_NODE_SELECTION_MOST_R_DATA;
-static int _last_predefined_policy = STARPU_MPI_NODE_SELECTION_MOST_R_DATA;
+static int _last_predefined_policy = STARPU_MPI_NODE_SELECTION_MIN_TRANSFER;
 static starpu_mpi_select_node_policy_func_t _policies[_STARPU_MPI_NODE_SELECTION_MAX_POLICY];
 
+/*
+ * State of the STARPU_MPI_NODE_SELECTION_MIN_TRANSFER policy.
+ *
+ * The selection is made independently on every rank and all ranks must come
+ * up with the same answer, so this state can not be taken from the local MPI
+ * cache, which only knows about the local side of the communications.
+ * Instead, it is fed with the placement of every task, which all ranks see in
+ * the same order, and thus stays identical on all ranks.
+ *
+ * When the size of the cache is bounded (STARPU_MPI_CACHE_LIMIT), the
+ * replicas also get evicted. A rank only sees the evictions of the copies it
+ * received or sent, so instead of listening to them, the replicas are kept
+ * in LRU lists mirroring the ones of the cache, with the same budget, for
+ * every pair of receiving rank and owner, and dropped when the cache would
+ * evict them.
+ */
+LIST_TYPE(_starpu_mpi_select_node_lru,
+	struct _starpu_mpi_data *mpi_data;
+	int node;
+	/** Index of the list of the pair in _min_transfer_lru */
+	int pair;
+	size_t size;
+);
+
+static starpu_pthread_mutex_t _min_transfer_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+/** Whether task placements are being tracked */
+static int _min_transfer_enabled;
+/** Bumped by starpu_mpi_cache_flush_all_data() to invalidate all replicas at once */
+static unsigned _min_transfer_gen = 1;
+/** Number of tasks recently placed on each rank, halved every _min_transfer_window placements */
+static unsigned *_min_transfer_load;
+static int _min_transfer_nb_nodes;
+static unsigned _min_transfer_window;
+static unsigned _min_transfer_nplaced;
+/** Replicas held by each rank, per owner, least recently used first, indexed by node * _min_transfer_lru_nb_nodes + owner */
+static struct _starpu_mpi_select_node_lru_list *_min_transfer_lru;
+static size_t *_min_transfer_lru_size;
+static int _min_transfer_lru_nb_nodes;
+
 int _starpu_mpi_select_node_with_most_data(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data);
+int _starpu_mpi_select_node_with_min_transfer(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data);
 
 void _starpu_mpi_select_node_init()
 {
 	int i;
 
 	_policies[STARPU_MPI_NODE_SELECTION_MOST_R_DATA] = _starpu_mpi_select_node_with_most_data;
+	_policies[STARPU_MPI_NODE_SELECTION_MIN_TRANSFER] = _starpu_mpi_select_node_with_min_transfer;
 	for(i=_last_predefined_policy+1 ; i<_STARPU_MPI_NODE_SELECTION_MAX_POLICY ; i++)
 		_policies[i] = NULL;
+
+	_min_transfer_window = starpu_getenv_number_default("STARPU_MPI_NODE_SELECTION_LOAD_WINDOW", 256);
+	if (_min_transfer_window == 0)
+		_min_transfer_window = 1;
+}
+
+static void _starpu_mpi_select_node_lru_clear(void);
+
+void _starpu_mpi_select_node_shutdown()
+{
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_transfer_mutex);
+	_starpu_mpi_select_node_lru_clear();
+	free(_min_transfer_lru);
+	_min_transfer_lru = NULL;
+	free(_min_transfer_lru_size);
+	_min_transfer_lru_size = NULL;
+	_min_transfer_lru_nb_nodes = 0;
+	free(_min_transfer_load);
+	_min_transfer_load = NULL;
+	_min_transfer_nb_nodes = 0;
+	_min_transfer_enabled = 0;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_transfer_mutex);
 }
 
 int starpu_mpi_node_selection_get_current_policy()
@@ -48,6 +112,12 @@ int starpu_mpi_node_selection_set_current_policy(int policy)
 {
 	STARPU_ASSERT_MSG(_policies[policy] != NULL, "Policy %d invalid.\n", policy);
 	_current_policy = policy;
+	if (policy == STARPU_MPI_NODE_SELECTION_MIN_TRANSFER)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&_min_transfer_mutex);
+		_min_transfer_enabled = 1;
+		STARPU_PTHREAD_MUTEX_UNLOCK(&_min_transfer_mutex);
+	}
 	return 0;
 }
 
@@ -112,6 +182,308 @@ int _starpu_mpi_select_node_with_most_data(int me, int nb_nodes, struct starpu_d
 	return xrank;
 }
 
+/* Make sure the per-rank arrays can hold nb_nodes entries, must be called
+ * with _min_transfer_mutex held */
+static void _starpu_mpi_select_node_min_transfer_resize(int nb_nodes)
+{
+	if (nb_nodes <= _min_transfer_nb_nodes)
+		return;
+	_STARPU_MPI_REALLOC(_min_transfer_load, nb_nodes * sizeof(_min_transfer_load[0]));
+	memset(&_min_transfer_load[_min_transfer_nb_nodes], 0, (nb_nodes - _min_transfer_nb_nodes) * sizeof(_min_transfer_load[0]));
+	_min_transfer_nb_nodes = nb_nodes;
+}
+
+/* Forget the replica of the data on the node from the LRU lists, must be
+ * called with _min_transfer_mutex held */
+static void _starpu_mpi_select_node_lru_drop(struct _starpu_mpi_data *mpi_data, int node)
+{
+	struct _starpu_mpi_select_node_lru *lru;
+
+	if (!mpi_data->select_node_lru || !mpi_data->select_node_lru[node])
+		return;
+	lru = mpi_data->select_node_lru[node];
+	_starpu_mpi_select_node_lru_list_erase(&_min_transfer_lru[lru->pair], lru);
+	_min_transfer_lru_size[lru->pair] -= lru->size;
+	_starpu_mpi_select_node_lru_delete(lru);
+	mpi_data->select_node_lru[node] = NULL;
+}
+
+/* Drop all the LRU lists, must be called with _min_transfer_mutex held */
+static void _starpu_mpi_select_node_lru_clear(void)
+{
+	int pair;
+
+	for(pair=0 ; pair<_min_transfer_lru_nb_nodes * _min_transfer_lru_nb_nodes ; pair++)
+	{
+		while (!_starpu_mpi_select_node_lru_list_empty(&_min_transfer_lru[pair]))
+		{
+			struct _starpu_mpi_select_node_lru *lru = _starpu_mpi_select_node_lru_list_pop_front(&_min_transfer_lru[pair]);
+			lru->mpi_data->select_node_lru[lru->node] = NULL;
+			_starpu_mpi_select_node_lru_delete(lru);
+		}
+		_min_transfer_lru_size[pair] = 0;
+	}
+}
+
+/* Record that the replica of the data on the node was used, and drop the
+ * least recently used replicas the cache of the node would evict to make room
+ * for it, must be called with _min_transfer_mutex held */
+static void _starpu_mpi_select_node_lru_use(starpu_data_handle_t data, int nb_nodes, int node, int owner)
+{
+	struct _starpu_mpi_data *mpi_data = data->mpi_data;
+	size_t limit = _starpu_mpi_cache_get_node_limit();
+	struct _starpu_mpi_select_node_lru *lru;
+	int pair;
+
+	if (limit == 0)
+		return;
+
+	if (!_min_transfer_lru)
+	{
+		/* The communicator size does not change, the lists are
+		 * allocated once */
+		_STARPU_MPI_CALLOC(_min_transfer_lru, nb_nodes * nb_nodes, sizeof(_min_transfer_lru[0]));
+		_STARPU_MPI_CALLOC(_min_transfer_lru_size, nb_nodes * nb_nodes, sizeof(_min_transfer_lru_size[0]));
+		for(pair=0 ; pair<nb_nodes * nb_nodes ; pair++)
+			_starpu_mpi_select_node_lru_list_init(&_min_transfer_lru[pair]);
+		_min_transfer_lru_nb_nodes = nb_nodes;
+	}
+	if (node >= _min_transfer_lru_nb_nodes || owner >= _min_transfer_lru_nb_nodes)
+		return;
+	pair = node * _min_transfer_lru_nb_nodes + owner;
+
+	if (!mpi_data->select_node_lru)
+		_STARPU_MPI_CALLOC(mpi_data->select_node_lru, _min_transfer_lru_nb_nodes, sizeof(mpi_data->select_node_lru[0]));
+	lru = mpi_data->select_node_lru[node];
+	if (lru)
+	{
+		_starpu_mpi_select_node_lru_list_erase(&_min_transfer_lru[pair], lru);
+		_starpu_mpi_select_node_lru_list_push_back(&_min_transfer_lru[pair], lru);
+		return;
+	}
+
+	lru = _starpu_mpi_select_node_lru_new();
+	lru->mpi_data = mpi_data;
+	lru->node = node;
+	lru->pair = pair;
+	lru->size = starpu_data_get_size(data);
+
+	/* Make room for it like the cache of the node does */
+	while (_min_transfer_lru_size[pair] + lru->size > limit
+	       && !_starpu_mpi_select_node_lru_list_empty(&_min_transfer_lru[pair]))
+	{
+		struct _starpu_mpi_select_node_lru *evicted = _starpu_mpi_select_node_lru_list_front(&_min_transfer_lru[pair]);
+		evicted->mpi_data->select_node_replicas[node] = 0;
+		_starpu_mpi_select_node_lru_drop(evicted->mpi_data, node);
+	}
+
+	_starpu_mpi_select_node_lru_list_push_back(&_min_transfer_lru[pair], lru);
+	_min_transfer_lru_size[pair] += lru->size;
+	mpi_data->select_node_lru[node] = lru;
+}
+
+/* Forget about replicas if the cache was flushed in between, must be called
+ * with _min_transfer_mutex held */
+static void _starpu_mpi_select_node_replicas_check(struct _starpu_mpi_data *mpi_data)
+{
+	if (mpi_data->select_node_replicas && mpi_data->select_node_gen != _min_transfer_gen)
+	{
+		memset(mpi_data->select_node_replicas, 0, mpi_data->select_node_nb_nodes);
+		mpi_data->select_node_gen = _min_transfer_gen;
+	}
+}
+
+/* Whether the node is known to hold a valid replica of the data, besides its
+ * owner, must be called with _min_transfer_mutex held */
+static int _starpu_mpi_select_node_has_replica(struct _starpu_mpi_data *mpi_data, int node)
+{
+	_starpu_mpi_select_node_replicas_check(mpi_data);
+	return node < mpi_data->select_node_nb_nodes && mpi_data->select_node_replicas[node];
+}
+
+/* Record that the node got a valid replica of the data, or used it again,
+ * must be called with _min_transfer_mutex held */
+static void _starpu_mpi_select_node_add_replica(starpu_data_handle_t data, int nb_nodes, int node, int owner)
+{
+	struct _starpu_mpi_data *mpi_data = data->mpi_data;
+	_starpu_mpi_select_node_replicas_check(mpi_data);
+	if (mpi_data->select_node_nb_nodes < nb_nodes)
+	{
+		_STARPU_MPI_REALLOC(mpi_data->select_node_replicas, nb_nodes);
+		memset(&mpi_data->select_node_replicas[mpi_data->select_node_nb_nodes], 0, nb_nodes - mpi_data->select_node_nb_nodes);
+		mpi_data->select_node_nb_nodes = nb_nodes;
+		mpi_data->select_node_gen = _min_transfer_gen;
+	}
+	mpi_data->select_node_replicas[node] = 1;
+	_starpu_mpi_select_node_lru_use(data, nb_nodes, node, owner);
+}
+
+/* Drop all replicas of the data, must be called with _min_transfer_mutex held */
+static void _starpu_mpi_select_node_drop_replicas(struct _starpu_mpi_data *mpi_data)
+{
+	int node;
+
+	if (mpi_data->select_node_replicas)
+		memset(mpi_data->select_node_replicas, 0, mpi_data->select_node_nb_nodes);
+	if (mpi_data->select_node_lru)
+		for(node=0 ; node<_min_transfer_lru_nb_nodes ; node++)
+			_starpu_mpi_select_node_lru_drop(mpi_data, node);
+}
+
+/* Return the owner of the data, or -1 if it is not handled by the usual
+ * owner-based coherency */
+static int _starpu_mpi_select_node_get_owner(starpu_data_handle_t data, enum starpu_data_access_mode mode)
+{
+	int rank;
+
+	if (!data || !data->mpi_data || (mode & STARPU_MPI_REDUX))
+		return -1;
+	rank = starpu_mpi_data_get_rank(data);
+	/* STARPU_MPI_PER_NODE data are available everywhere */
+	return rank < 0 ? -1 : rank;
+}
+
+int _starpu_mpi_select_node_with_min_transfer(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data)
+{
+	size_t *bytes_to_nodes;
+	int i, node;
+	int xrank = 0;
+
+	(void)me;
+	_STARPU_MPI_CALLOC(bytes_to_nodes, nb_nodes, sizeof(size_t));
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_transfer_mutex);
+	/* The policy may be used through STARPU_NODE_SELECTION_POLICY only,
+	 * start tracking placements from now on, this happens at the same
+	 * point on all ranks */
+	_min_transfer_enabled = 1;
+	_starpu_mpi_select_node_min_transfer_resize(nb_nodes);
+
+	for(i= 0 ; i<nb_data ; i++)
+	{
+		starpu_data_handle_t data = descr[i].handle;
+		enum starpu_data_access_mode mode = descr[i].mode;
+		int rank = _starpu_mpi_select_node_get_owner(data, mode);
+
+		if (rank == -1)
+			continue;
+
+		size_t size = data->ops->get_size(data);
+
+		if (mode & STARPU_R)
+		{
+			/* Has to be sent to any node which does not hold a valid replica yet */
+			for(node=0 ; node<nb_nodes ; node++)
+				if (node != rank && !_starpu_mpi_select_node_has_replica(data->mpi_data, node))
+					bytes_to_nodes[node] += size;
+		}
+
+		if (mode & STARPU_W)
+		{
+			/* Would have to transfer it back */
+			for(node=0 ; node<nb_nodes ; node++)
+				if (node != rank)
+					bytes_to_nodes[node] += size;
+		}
+	}
+
+	/* Least bytes moved, then least recent work, then lowest rank */
+	for(node=1 ; node<nb_nodes ; node++)
+	{
+		if (bytes_to_nodes[node] < bytes_to_nodes[xrank]
+		    || (bytes_to_nodes[node] == bytes_to_nodes[xrank] && _min_transfer_load[node] < _min_transfer_load[xrank]))
+			xrank = node;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_transfer_mutex);
+
+	free(bytes_to_nodes);
+	return xrank;
+}
+
+void _starpu_mpi_select_node_task_placed(int xrank, int nb_nodes, struct starpu_data_descr *descr, int nb_data)
+{
+	int i, node;
+
+	if (xrank < 0 || xrank >= nb_nodes)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_transfer_mutex);
+	if (!_min_transfer_enabled)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&_min_transfer_mutex);
+		return;
+	}
+	_starpu_mpi_select_node_min_transfer_resize(nb_nodes);
+
+	for(i= 0 ; i<nb_data ; i++)
+	{
+		starpu_data_handle_t data = descr[i].handle;
+		enum starpu_data_access_mode mode = descr[i].mode;
+		int rank = _starpu_mpi_select_node_get_owner(data, mode);
+
+		if (rank == -1)
+			continue;
+
+		if ((mode & STARPU_W) || (mode & STARPU_REDUX))
+		{
+			/* Modified, the owner gets it back and the other
+			 * replicas are dropped from the cache */
+			_starpu_mpi_select_node_drop_replicas(data->mpi_data);
+		}
+		else if ((mode & STARPU_R) && xrank != rank && _starpu_cache_enabled)
+		{
+			/* Received data is kept in the cache */
+			_starpu_mpi_select_node_add_replica(data, nb_nodes, xrank, rank);
+		}
+	}
+
+	_min_transfer_load[xrank]++;
+	if (++_min_transfer_nplaced >= _min_transfer_window)
+	{
+		/* Age the load estimation, so it reflects the pending work */
+		for(node=0 ; node<_min_transfer_nb_nodes ; node++)
+			_min_transfer_load[node] /= 2;
+		_min_transfer_nplaced = 0;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_transfer_mutex);
+}
+
+void _starpu_mpi_select_node_data_flush(starpu_data_handle_t data_handle)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+	if (!mpi_data)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_transfer_mutex);
+	_starpu_mpi_select_node_drop_replicas(mpi_data);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_transfer_mutex);
+}
+
+void _starpu_mpi_select_node_flush_all(void)
+{
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_transfer_mutex);
+	_min_transfer_gen++;
+	_starpu_mpi_select_node_lru_clear();
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_transfer_mutex);
+}
+
+void _starpu_mpi_select_node_data_clear(starpu_data_handle_t data_handle)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	if (mpi_data->select_node_lru)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&_min_transfer_mutex);
+		_starpu_mpi_select_node_drop_replicas(mpi_data);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&_min_transfer_mutex);
+		free(mpi_data->select_node_lru);
+		mpi_data->select_node_lru = NULL;
+	}
+	free(mpi_data->select_node_replicas);
+	mpi_data->select_node_replicas = NULL;
+	mpi_data->select_node_nb_nodes = 0;
+}
+
 int _starpu_mpi_select_node(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data, int policy)
 {
 	int ppolicy = policy == STARPU_MPI_NODE_SELECTION_CURRENT_POLICY ? _current_policy : policy;
@@ -29,8 +29,20 @@ extern "C"
 #define _STARPU_MPI_NODE_SELECTION_MAX_POLICY 24
 
 void _starpu_mpi_select_node_init();
+void _starpu_mpi_select_node_shutdown();
 int _starpu_mpi_select_node(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data, int policy);
 
+/** Record where a task is going to be executed, for policies which need to
+ * know where data replicas are. Must be called on all nodes for every task,
+ * whether the node was selected by a policy or not. */
+void _starpu_mpi_select_node_task_placed(int xrank, int nb_nodes, struct starpu_data_descr *descr, int nb_data);
+/** The cache of the data was flushed */
+void _starpu_mpi_select_node_data_flush(starpu_data_handle_t data_handle);
+/** The cache of all data was flushed */
+void _starpu_mpi_select_node_flush_all(void);
+/** The data is being unregistered */
+void _starpu_mpi_select_node_data_clear(starpu_data_handle_t data_handle);
+
 #ifdef __cplusplus
 }
 #endif
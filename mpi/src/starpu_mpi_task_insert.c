@@ -42,6 +42,7 @@
 	} while (0)
 
 static void (*pre_submit_hook)(struct starpu_task *task) = NULL;
+static void (*pre_submit_hook_cancel)(struct starpu_task *task) = NULL;
 
 /* reduction wrap-up */
 // entry in the table
@@ -59,6 +60,17 @@ void _starpu_mpi_pre_submit_hook_call(struct starpu_task *task)
 		pre_submit_hook(task);
 }
 
+void _starpu_mpi_pre_submit_hook_cancel_call(struct starpu_task *task)
+{
+	if (pre_submit_hook_cancel)
+		pre_submit_hook_cancel(task);
+}
+
+void _starpu_mpi_pre_submit_hook_cancel_register(void (*f)(struct starpu_task *))
+{
+	pre_submit_hook_cancel = f;
+}
+
 int starpu_mpi_pre_submit_hook_register(void (*f)(struct starpu_task *))
 {
 	if (pre_submit_hook)
@@ -572,6 +584,10 @@ int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nod
 		{
 			(void)va_arg(varg_list_copy, void *);
 		}
+		else if (arg_type==STARPU_TASK_DEADLINE)
+		{
+			(void)va_arg(varg_list_copy, double);
+		}
 		else if (arg_type==STARPU_TASK_FILE)
 		{
 			(void)va_arg(varg_list_copy, const char *);
@@ -600,6 +616,7 @@ int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nod
 		_STARPU_MPI_DEBUG(100, "Inconsistent=%d - xrank=%d\n", inconsistent_execute, *xrank);
 		*do_execute = *xrank == STARPU_MPI_PER_NODE || (me == *xrank);
 	}
+	_starpu_mpi_select_node_task_placed(*xrank, nb_nodes, descrs, nb_data);
 	_STARPU_MPI_DEBUG(100, "do_execute=%d\n", *do_execute);
 
 	*descrs_p = descrs;
@@ -770,6 +787,9 @@ int _starpu_mpi_task_insert_v(MPI_Comm comm, struct starpu_codelet *codelet, va_
 	if (ret == 1)
 	{
 		do_execute = 1;
+		/* Call the hook before submission, the task may be already
+		 * destroyed after it */
+		_starpu_mpi_pre_submit_hook_call(task);
 		ret = starpu_task_submit(task);
 
 		if (STARPU_UNLIKELY(ret == -ENODEV))
@@ -780,6 +800,7 @@ int _starpu_mpi_task_insert_v(MPI_Comm comm, struct starpu_codelet *codelet, va_
 				    task->cl->name ? task->cl->name :
 				    (task->cl->model && task->cl->model->symbol)?task->cl->model->symbol:"none");
 
+			_starpu_mpi_pre_submit_hook_cancel_call(task);
 			task->destroy = 0;
 			starpu_task_destroy(task);
 			free(descrs);
@@ -790,9 +811,6 @@ int _starpu_mpi_task_insert_v(MPI_Comm comm, struct starpu_codelet *codelet, va_
 	int val = _starpu_mpi_task_postbuild_v(comm, xrank, do_execute, descrs, nb_data, prio);
 	free(descrs);
 
-	if (ret == 1)
-		_starpu_mpi_pre_submit_hook_call(task);
-
 	return val;
 }
 
@@ -925,6 +943,7 @@ int starpu_mpi_task_exchange_data_before_execution(MPI_Comm comm, struct starpu_
 		_STARPU_MPI_DEBUG(100, "Inconsistent=%d - xrank=%d\n", inconsistent_execute, params->xrank);
 		params->do_execute = (params->xrank == STARPU_MPI_PER_NODE) || (me == params->xrank);
 	}
+	_starpu_mpi_select_node_task_placed(params->xrank, nb_nodes, descrs, nb_data);
 
 	for(i=0 ; i<nb_data ; i++)
 	{
@@ -30,6 +30,10 @@ int _starpu_mpi_task_postbuild_v(MPI_Comm comm, int xrank, int do_execute, struc
 void _starpu_mpi_redux_wrapup_data_all();
 void _starpu_mpi_redux_wrapup_data(starpu_data_handle_t data_handle);
 void _starpu_mpi_pre_submit_hook_call(struct starpu_task *task);
+/** Register a function undoing the pre-submit hook when the submission of
+ * the task then failed */
+void _starpu_mpi_pre_submit_hook_cancel_register(void (*f)(struct starpu_task *));
+void _starpu_mpi_pre_submit_hook_cancel_call(struct starpu_task *task);
 
 #ifdef __cplusplus
 }
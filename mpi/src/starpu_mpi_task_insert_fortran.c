@@ -413,6 +413,11 @@ int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_no
 			arg_i++;
 			/* void * */
 		}
+		else if (arg_type==STARPU_TASK_DEADLINE)
+		{
+			arg_i++;
+			/* double */
+		}
 		else if (arg_type==STARPU_TASK_FILE)
 		{
 			arg_i++;
@@ -443,6 +448,7 @@ int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_no
 		_STARPU_MPI_DEBUG(100, "Inconsistent=%d - xrank=%d\n", inconsistent_execute, *xrank);
 		*do_execute = *xrank == STARPU_MPI_PER_NODE || (me == *xrank);
 	}
+	_starpu_mpi_select_node_task_placed(*xrank, nb_nodes, descrs, nb_data);
 	_STARPU_MPI_DEBUG(100, "do_execute=%d\n", *do_execute);
 
 	*descrs_p = descrs;
@@ -557,6 +563,9 @@ int _fstarpu_mpi_task_insert_v(MPI_Comm comm, struct starpu_codelet *codelet, vo
 	if (ret == 1)
 	{
 		do_execute = 1;
+		/* Call the hook before submission, the task may be already
+		 * destroyed after it */
+		_starpu_mpi_pre_submit_hook_call(task);
 		ret = starpu_task_submit(task);
 
 		if (STARPU_UNLIKELY(ret == -ENODEV))
@@ -567,6 +576,7 @@ int _fstarpu_mpi_task_insert_v(MPI_Comm comm, struct starpu_codelet *codelet, vo
 				    task->cl->name ? task->cl->name :
 				    (task->cl->model && task->cl->model->symbol)?task->cl->model->symbol:"none");
 
+			_starpu_mpi_pre_submit_hook_cancel_call(task);
 			task->destroy = 0;
 			starpu_task_destroy(task);
 			free(descrs);
@@ -577,9 +587,6 @@ int _fstarpu_mpi_task_insert_v(MPI_Comm comm, struct starpu_codelet *codelet, vo
 	int val = _starpu_mpi_task_postbuild_v(comm, xrank, do_execute, descrs, nb_data, prio);
 	free(descrs);
 
-	if (ret == 1)
-		_starpu_mpi_pre_submit_hook_call(task);
-
 	return val;
 }
 
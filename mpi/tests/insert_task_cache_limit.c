@@ -0,0 +1,208 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Check that the size of the MPI cache is bounded by STARPU_MPI_CACHE_LIMIT:
+ * node 1 reads blocks owned by node 0 with a cache which can only hold a few
+ * of them, the least recently used ones get evicted, and node 0 has to send
+ * them again.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NB_DATA		8
+#define NB_ELEMENTS	(64*1024)
+#define LIMIT		1	/* MiB */
+
+void func_cpu(void *descr[], void *_args)
+{
+	unsigned *v = (unsigned *)STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	int *acc = (int *)STARPU_VARIABLE_GET_PTR(descr[1]);
+	unsigned i;
+	(void)_args;
+
+	for (i = 0; i < n; i++)
+		STARPU_ASSERT(v[i] == 42);
+	(*acc)++;
+}
+
+struct starpu_codelet mycodelet =
+{
+	.cpu_funcs = {func_cpu},
+	.nbuffers = 2,
+	.modes = {STARPU_R, STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+/* Sequence of blocks read by node 1 */
+static int sequence[] = { 0, 1, 2, 3, 4, 5, 6, 7, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7 };
+#define NB_READS (int)(sizeof(sequence)/sizeof(sequence[0]))
+
+/* Simulate the LRU cache of node 1 */
+static void simulate(size_t capacity, unsigned long *hits, unsigned long *misses, unsigned long *evictions)
+{
+	int cached[NB_DATA];
+	int ncached = 0;
+	int i, j, k;
+
+	*hits = *misses = *evictions = 0;
+	for (i = 0; i < NB_READS; i++)
+	{
+		for (j = 0; j < ncached; j++)
+			if (cached[j] == sequence[i])
+				break;
+		if (j < ncached)
+		{
+			(*hits)++;
+			/* Move to the most recently used position */
+			for (k = j; k < ncached - 1; k++)
+				cached[k] = cached[k+1];
+			cached[ncached-1] = sequence[i];
+			continue;
+		}
+		(*misses)++;
+		/* Make room for it */
+		while (ncached > 0 && ncached + 1 > (int) capacity)
+		{
+			(*evictions)++;
+			for (k = 0; k < ncached - 1; k++)
+				cached[k] = cached[k+1];
+			ncached--;
+		}
+		cached[ncached++] = sequence[i];
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int ret, rank, size, i;
+	int mpi_init;
+	unsigned *v[NB_DATA];
+	starpu_data_handle_t data_handles[NB_DATA];
+	int acc = 0;
+	starpu_data_handle_t acc_handle;
+	struct starpu_mpi_cache_stats stats;
+	size_t *comm_amount;
+	char limit[16];
+
+	snprintf(limit, sizeof(limit), "%d", LIMIT);
+	setenv("STARPU_MPI_CACHE_LIMIT", limit, 1);
+	setenv("STARPU_MPI_CACHE", "1", 1);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2 || starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes and a CPU worker.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	starpu_mpi_comm_stats_enable();
+
+	for (i = 0; i < NB_DATA; i++)
+	{
+		if (rank == 0)
+		{
+			int j;
+			v[i] = malloc(NB_ELEMENTS * sizeof(unsigned));
+			for (j = 0; j < NB_ELEMENTS; j++)
+				v[i][j] = 42;
+			starpu_vector_data_register(&data_handles[i], STARPU_MAIN_RAM, (uintptr_t)v[i], NB_ELEMENTS, sizeof(unsigned));
+		}
+		else
+			starpu_vector_data_register(&data_handles[i], -1, (uintptr_t)NULL, NB_ELEMENTS, sizeof(unsigned));
+		starpu_mpi_data_register(data_handles[i], i, 0);
+	}
+	if (rank == 1)
+		starpu_variable_data_register(&acc_handle, STARPU_MAIN_RAM, (uintptr_t)&acc, sizeof(acc));
+	else
+		starpu_variable_data_register(&acc_handle, -1, (uintptr_t)NULL, sizeof(acc));
+	starpu_mpi_data_register(acc_handle, NB_DATA, 1);
+
+	for (i = 0; i < NB_READS; i++)
+	{
+		ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &mycodelet,
+					     STARPU_R, data_handles[sequence[i]],
+					     STARPU_RW, acc_handle,
+					     0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+	}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+	starpu_mpi_cache_stats_retrieve(&stats);
+	comm_amount = malloc(size * sizeof(size_t));
+	starpu_mpi_comm_stats_retrieve(comm_amount);
+
+	for (i = 0; i < NB_DATA; i++)
+	{
+		starpu_data_unregister(data_handles[i]);
+		if (rank == 0)
+			free(v[i]);
+	}
+	starpu_data_unregister(acc_handle);
+
+	if (rank == 0 || rank == 1)
+	{
+		size_t block_size = NB_ELEMENTS * sizeof(unsigned);
+		size_t share = (LIMIT * 1024 * 1024) / (size - 1);
+		unsigned long hits, misses, evictions;
+
+		simulate(share / block_size, &hits, &misses, &evictions);
+		FPRINTF_MPI(stderr, "hits %lu misses %lu evictions %lu max size %lu, sent %lu bytes\n", stats.hits, stats.misses, stats.evictions, (unsigned long) stats.max_size, (unsigned long) comm_amount[1]);
+
+		if (rank == 1)
+		{
+			STARPU_ASSERT_MSG(acc == NB_READS, "accumulator is %d instead of %d\n", acc, NB_READS);
+			STARPU_ASSERT_MSG(stats.hits == hits, "%lu hits instead of %lu\n", stats.hits, hits);
+			STARPU_ASSERT_MSG(stats.misses == misses, "%lu misses instead of %lu\n", stats.misses, misses);
+			STARPU_ASSERT_MSG(stats.evictions == evictions, "%lu evictions instead of %lu\n", stats.evictions, evictions);
+			STARPU_ASSERT_MSG(stats.max_size <= share || stats.max_size == block_size, "cache grew up to %lu bytes\n", (unsigned long) stats.max_size);
+		}
+		else
+		{
+			/* The evicted blocks had to be sent again */
+			STARPU_ASSERT_MSG(comm_amount[1] == misses * block_size, "%lu bytes sent instead of %lu\n", (unsigned long) comm_amount[1], (unsigned long) (misses * block_size));
+		}
+	}
+	free(comm_amount);
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return 0;
+}
+#endif
@@ -0,0 +1,240 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Compare the node selection policies STARPU_MPI_NODE_SELECTION_MOST_R_DATA
+ * and STARPU_MPI_NODE_SELECTION_MIN_TRANSFER on an imbalanced case: all the
+ * blocks are owned by node 0, but they first get read by all nodes, and are
+ * thus in the MPI cache of all nodes. Tasks then read pairs of blocks and
+ * update counters owned by different nodes, so that the node has to be
+ * selected by the policy. MOST_R_DATA executes them all on node 0, while
+ * MIN_TRANSFER notices that the blocks are already available everywhere and
+ * spreads them over the nodes owning the counters.
+ *
+ * Each node prints the number of tasks it executed, the amount of bytes it
+ * sent, and the time taken by the second phase.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NBLOCKS	8
+#define BLOCK	(16*1024)
+#define NITER	2
+#else
+#define NBLOCKS	32
+#define BLOCK	(256*1024)
+#define NITER	8
+#endif
+
+static unsigned executed;
+
+void read_cpu(void *descr[], void *_args)
+{
+	float *block = (float *)STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	int *acc = (int *)STARPU_VARIABLE_GET_PTR(descr[1]);
+	unsigned i;
+	(void)_args;
+
+	for (i = 0; i < n; i++)
+		STARPU_ASSERT(block[i] == 1.f);
+	(*acc)++;
+}
+
+struct starpu_codelet read_cl =
+{
+	.cpu_funcs = {read_cpu},
+	.nbuffers = 2,
+	.modes = {STARPU_R, STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+void work_cpu(void *descr[], void *_args)
+{
+	float *block1 = (float *)STARPU_VECTOR_GET_PTR(descr[0]);
+	float *block2 = (float *)STARPU_VECTOR_GET_PTR(descr[1]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	int *counter1 = (int *)STARPU_VARIABLE_GET_PTR(descr[2]);
+	int *counter2 = (int *)STARPU_VARIABLE_GET_PTR(descr[3]);
+	unsigned i, j;
+	float sum = 0.;
+	(void)_args;
+
+	/* Simulate some computation */
+	for (j = 0; j < 16; j++)
+		for (i = 0; i < n; i++)
+			sum += block1[i] * block2[i];
+	STARPU_ASSERT(sum == 16. * n);
+
+	(*counter1)++;
+	(*counter2)++;
+	STARPU_ATOMIC_ADD(&executed, 1);
+}
+
+struct starpu_codelet work_cl =
+{
+	.cpu_funcs = {work_cpu},
+	.nbuffers = 4,
+	.modes = {STARPU_R, STARPU_R, STARPU_RW, STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+static void run(int rank, int size, int policy, const char *name)
+{
+	float *blocks[NBLOCKS];
+	starpu_data_handle_t block_handles[NBLOCKS];
+	int acc, counter;
+	starpu_data_handle_t acc_handles[size];
+	starpu_data_handle_t counter_handles[size];
+	size_t *stats_before, *stats_after;
+	size_t sent = 0;
+	int expected;
+	int i, r, iter;
+	int ret;
+
+	starpu_mpi_node_selection_set_current_policy(policy);
+	executed = 0;
+
+	for (i = 0; i < NBLOCKS; i++)
+	{
+		if (rank == 0)
+		{
+			int j;
+			starpu_malloc((void **)&blocks[i], BLOCK * sizeof(float));
+			for (j = 0; j < BLOCK; j++)
+				blocks[i][j] = 1.f;
+			starpu_vector_data_register(&block_handles[i], STARPU_MAIN_RAM, (uintptr_t)blocks[i], BLOCK, sizeof(float));
+		}
+		else
+			starpu_vector_data_register(&block_handles[i], -1, (uintptr_t)NULL, BLOCK, sizeof(float));
+		starpu_mpi_data_register(block_handles[i], i, 0);
+	}
+
+	acc = 0;
+	counter = 0;
+	for (r = 0; r < size; r++)
+	{
+		if (r == rank)
+		{
+			starpu_variable_data_register(&acc_handles[r], STARPU_MAIN_RAM, (uintptr_t)&acc, sizeof(acc));
+			starpu_variable_data_register(&counter_handles[r], STARPU_MAIN_RAM, (uintptr_t)&counter, sizeof(counter));
+		}
+		else
+		{
+			starpu_variable_data_register(&acc_handles[r], -1, (uintptr_t)NULL, sizeof(acc));
+			starpu_variable_data_register(&counter_handles[r], -1, (uintptr_t)NULL, sizeof(counter));
+		}
+		starpu_mpi_data_register(acc_handles[r], NBLOCKS + r, r);
+		starpu_mpi_data_register(counter_handles[r], NBLOCKS + size + r, r);
+	}
+
+	/* First phase: all nodes read all blocks, which get cached */
+	for (r = 0; r < size; r++)
+		for (i = 0; i < NBLOCKS; i++)
+		{
+			ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &read_cl,
+						     STARPU_R, block_handles[i],
+						     STARPU_RW, acc_handles[r],
+						     0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+	starpu_task_wait_for_all();
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+
+	/* Second phase: the node has to be selected by the policy */
+	stats_before = calloc(size, sizeof(size_t));
+	stats_after = calloc(size, sizeof(size_t));
+	starpu_mpi_comm_stats_retrieve(stats_before);
+	double start = starpu_timing_now();
+	for (iter = 0; iter < NITER; iter++)
+		for (i = 0; i < NBLOCKS; i++)
+		{
+			ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &work_cl,
+						     STARPU_R, block_handles[i],
+						     STARPU_R, block_handles[(i+1)%NBLOCKS],
+						     STARPU_RW, counter_handles[i%size],
+						     STARPU_RW, counter_handles[(i+1)%size],
+						     0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+	starpu_task_wait_for_all();
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+	double end = starpu_timing_now();
+	starpu_mpi_comm_stats_retrieve(stats_after);
+	for (r = 0; r < size; r++)
+		sent += stats_after[r] - stats_before[r];
+	free(stats_before);
+	free(stats_after);
+
+	for (i = 0; i < NBLOCKS; i++)
+	{
+		starpu_data_unregister(block_handles[i]);
+		if (rank == 0)
+			starpu_free_noflag(blocks[i], BLOCK * sizeof(float));
+	}
+	for (r = 0; r < size; r++)
+	{
+		starpu_data_unregister(acc_handles[r]);
+		starpu_data_unregister(counter_handles[r]);
+	}
+
+	STARPU_ASSERT_MSG(acc == NBLOCKS, "accumulator is %d instead of %d\n", acc, NBLOCKS);
+	expected = 0;
+	for (i = 0; i < NBLOCKS; i++)
+		expected += (i%size == rank) + ((i+1)%size == rank);
+	expected *= NITER;
+	STARPU_ASSERT_MSG(counter == expected, "counter is %d instead of %d\n", counter, expected);
+
+	FPRINTF_MPI(stderr, "%s: executed %u tasks out of %d, sent %lu bytes, %.2f ms\n", name, executed, NITER*NBLOCKS, (unsigned long) sent, (end - start) / 1000.);
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+	int rank, size;
+	int mpi_init;
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2 || starpu_cpu_worker_get_count() == 0 || !starpu_mpi_cache_is_enabled())
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes, a CPU worker and the MPI cache.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	starpu_mpi_comm_stats_enable();
+
+	run(rank, size, STARPU_MPI_NODE_SELECTION_MOST_R_DATA, "most_r_data");
+	run(rank, size, STARPU_MPI_NODE_SELECTION_MIN_TRANSFER, "min_transfer");
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return 0;
+}
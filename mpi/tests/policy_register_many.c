@@ -45,7 +45,8 @@ int main(int argc, char **argv)
 	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, &conf);
 	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
 
-	for(i=0 ; i<_STARPU_MPI_NODE_SELECTION_MAX_POLICY-1 ; i++)
+	// Fill all the slots left after the 2 predefined policies
+	for(i=0 ; i<_STARPU_MPI_NODE_SELECTION_MAX_POLICY-2 ; i++)
 	{
 		policy = starpu_mpi_node_selection_register_policy(starpu_mpi_select_node_my_policy);
 		FPRINTF_MPI(stderr, "New policy %d\n", policy);
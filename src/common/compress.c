@@ -0,0 +1,92 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <limits.h>
+#include <common/compress.h>
+#include <common/utils.h>
+
+#if defined(STARPU_HAVE_LZ4)
+#include <lz4.h>
+#elif defined(STARPU_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+const char *_starpu_compress_codec_name(void)
+{
+#if defined(STARPU_HAVE_LZ4)
+	return "lz4";
+#elif defined(STARPU_HAVE_ZLIB)
+	return "zlib";
+#else
+	return NULL;
+#endif
+}
+
+size_t _starpu_compress_bound(size_t size)
+{
+#if defined(STARPU_HAVE_LZ4)
+	if (size > LZ4_MAX_INPUT_SIZE)
+		return 0;
+	return LZ4_compressBound(size);
+#elif defined(STARPU_HAVE_ZLIB)
+	return compressBound(size);
+#else
+	(void) size;
+	return 0;
+#endif
+}
+
+int _starpu_compress(const void *src, size_t src_size, void *dst, size_t *dst_size)
+{
+#if defined(STARPU_HAVE_LZ4)
+	if (src_size > LZ4_MAX_INPUT_SIZE || *dst_size > INT_MAX)
+		return -1;
+	int ret = LZ4_compress_default(src, dst, src_size, *dst_size);
+	if (ret <= 0)
+		return -1;
+	*dst_size = ret;
+	return 0;
+#elif defined(STARPU_HAVE_ZLIB)
+	uLongf len = *dst_size;
+	if (compress2(dst, &len, src, src_size, Z_BEST_SPEED) != Z_OK)
+		return -1;
+	*dst_size = len;
+	return 0;
+#else
+	(void) src; (void) src_size; (void) dst; (void) dst_size;
+	return -1;
+#endif
+}
+
+int _starpu_decompress(const void *src, size_t src_size, void *dst, size_t dst_size)
+{
+#if defined(STARPU_HAVE_LZ4)
+	if (src_size > INT_MAX || dst_size > INT_MAX)
+		return -1;
+	int ret = LZ4_decompress_safe(src, dst, src_size, dst_size);
+	if (ret < 0 || (size_t) ret != dst_size)
+		return -1;
+	return 0;
+#elif defined(STARPU_HAVE_ZLIB)
+	uLongf len = dst_size;
+	if (uncompress(dst, &len, src, src_size) != Z_OK || len != dst_size)
+		return -1;
+	return 0;
+#else
+	(void) src; (void) src_size; (void) dst; (void) dst_size;
+	return -1;
+#endif
+}
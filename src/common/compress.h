@@ -0,0 +1,53 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __COMPRESS_H__
+#define __COMPRESS_H__
+
+/** @file */
+
+/* Thin wrapper over the fast compression codec selected at configure time
+ * (lz4 when available, otherwise zlib at its fastest level). */
+
+#include <stdlib.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+#if defined(STARPU_HAVE_LZ4) || defined(STARPU_HAVE_ZLIB)
+#define STARPU_HAVE_COMPRESSION 1
+#endif
+
+/** Return the name of the codec, or NULL if StarPU was built without any */
+const char *_starpu_compress_codec_name(void);
+
+/** Return the size of the buffer that _starpu_compress() may need to
+ * compress \p size bytes */
+size_t _starpu_compress_bound(size_t size);
+
+/** Compress \p src_size bytes from \p src into \p dst, which holds
+ * \p *dst_size bytes. On success, return 0 and set \p *dst_size to the
+ * compressed size. Return -1 if the data could not be compressed in the
+ * given space, in which case the caller should send it raw. */
+int _starpu_compress(const void *src, size_t src_size, void *dst, size_t *dst_size);
+
+/** Decompress \p src_size bytes from \p src into \p dst, which must get
+ * exactly \p dst_size bytes. Return 0 on success, -1 on corrupted data. */
+int _starpu_decompress(const void *src, size_t src_size, void *dst, size_t dst_size);
+
+#pragma GCC visibility pop
+
+#endif // __COMPRESS_H__
@@ -1412,7 +1412,7 @@ do {										\
 	const size_t __data_size = handle->ops->get_size(handle); \
 	const starpu_ssize_t __max_data_size = _starpu_data_get_max_size(handle); \
 	char __buf[(FXT_MAX_PARAMS-4)*sizeof(long)]; \
-	void *__interface = handle->per_node[0].data_interface; \
+	void *__interface = starpu_data_get_interface_on_node(handle, STARPU_MAIN_RAM); \
 	if (handle->ops->describe) \
 		handle->ops->describe(__interface, __buf, sizeof(__buf)); \
 	else \
@@ -83,6 +83,7 @@ void _starpu_perf_counter_init(struct _starpu_machine_config *pconfig)
 
 	/* call counter registration routines in each modules */
 	_starpu__task_c__register_counters();
+	_starpu__sched_latency_c__register_counters();
 }
 
 void _starpu_perf_counter_exit(void)
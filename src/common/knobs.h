@@ -285,6 +285,7 @@ extern starpu_perf_counter_int64_t _starpu_task__g_current_ready__value;
 
 /* performance counter registration routines per modules */
 void _starpu__task_c__register_counters(void);	/* module: task.c */
+void _starpu__sched_latency_c__register_counters(void);	/* module: sched_latency.c */
 
 
 /* -------------------------------------------------------------------- */
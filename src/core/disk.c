@@ -38,6 +38,7 @@
 #include <drivers/disk/driver_disk.h>
 #include <profiling/profiling.h>
 #include <common/uthash.h>
+#include <common/compress.h>
 
 struct disk_register
 {
@@ -45,6 +46,12 @@ struct disk_register
 	struct starpu_disk_ops *functions;
 	/* disk condition (1 = all authorizations,  */
 	int flag;
+	/* Accounting of the time during which some request is in flight */
+	starpu_pthread_mutex_t busy_mutex;
+	unsigned nbusy;
+	double busy_start;
+	double busy_time;
+	double register_time;
 };
 
 static int add_disk_in_list(int devid, struct starpu_disk_ops *func, void *base);
@@ -54,12 +61,46 @@ static int disk_number = 0;
 
 int starpu_disk_swap_node = -1;
 
+/* A request is being processed by disk \p devid */
+static void disk_busy(int devid)
+{
+	struct disk_register *dr = disk_register_list[devid];
+	STARPU_PTHREAD_MUTEX_LOCK(&dr->busy_mutex);
+	if (!dr->nbusy++)
+		dr->busy_start = starpu_timing_now();
+	STARPU_PTHREAD_MUTEX_UNLOCK(&dr->busy_mutex);
+}
+
+/* A request was completed by disk \p devid */
+static void disk_idle(int devid)
+{
+	struct disk_register *dr = disk_register_list[devid];
+	STARPU_PTHREAD_MUTEX_LOCK(&dr->busy_mutex);
+	STARPU_ASSERT(dr->nbusy > 0);
+	if (!--dr->nbusy)
+		dr->busy_time += starpu_timing_now() - dr->busy_start;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&dr->busy_mutex);
+}
+
+void _starpu_disk_get_busy_time(int devid, double *busy, double *elapsed)
+{
+	struct disk_register *dr = disk_register_list[devid];
+	double now = starpu_timing_now();
+	STARPU_PTHREAD_MUTEX_LOCK(&dr->busy_mutex);
+	*busy = dr->busy_time;
+	if (dr->nbusy)
+		*busy += now - dr->busy_start;
+	*elapsed = now - dr->register_time;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&dr->busy_mutex);
+}
+
 static void add_async_event(struct _starpu_async_channel * channel, void * event)
 {
 	if (!event)
 		return;
 
 	struct _starpu_disk_event *disk_event = _starpu_disk_get_event(&channel->event);
+	disk_busy(starpu_memory_node_get_devid(disk_event->memory_node));
 	if (disk_event->requests == NULL)
 	{
 		disk_event->requests = _starpu_disk_backend_event_list_new();
@@ -135,7 +176,7 @@ int starpu_disk_register(struct starpu_disk_ops *func, void *parameter, starpu_s
 	void *base = func->plug(parameter, size);
 
 	/* remember it */
-	int n STARPU_ATTRIBUTE_UNUSED = add_disk_in_list(disk_device, func, base);
+	int n = add_disk_in_list(disk_device, func, base);
 
 #ifdef STARPU_SIMGRID
 	char name[16];
@@ -149,6 +190,28 @@ int starpu_disk_register(struct starpu_disk_ops *func, void *parameter, starpu_s
 	/* have a problem with the disk */
 	if (ret == 0)
 		return -ENOENT;
+
+	/* Now that the raw bandwidth is known, stage small objects in a log if requested */
+	if (starpu_getenv_number_default("STARPU_DISK_LOG", 0))
+	{
+		void *log_base = _starpu_disk_log_plug(disk_register_list[n]->functions, disk_register_list[n]->base, disk_memnode);
+		if (log_base)
+		{
+			disk_register_list[n]->base = log_base;
+			disk_register_list[n]->functions = &_starpu_disk_log_ops;
+		}
+		/* Otherwise keep using the backend directly */
+	}
+
+#ifdef STARPU_HAVE_COMPRESSION
+	/* and compress data if requested */
+	int compress = starpu_getenv_number_default("STARPU_DISK_COMPRESS", 0);
+	if (compress)
+	{
+		disk_register_list[n]->base = _starpu_disk_compress_plug(disk_register_list[n]->functions, disk_register_list[n]->base, disk_memnode, compress);
+		disk_register_list[n]->functions = &_starpu_disk_compress_ops;
+	}
+#endif
 	if (size >= 0)
 		_starpu_memory_manager_set_global_memory_size(disk_memnode, size);
 
@@ -173,6 +236,7 @@ void _starpu_disk_unregister(void)
 
 		/* don't forget to unplug */
 		disk_register_list[i]->functions->unplug(disk_register_list[i]->base);
+		STARPU_PTHREAD_MUTEX_DESTROY(&disk_register_list[i]->busy_mutex);
 		free(disk_register_list[i]);
 		disk_register_list[i] = NULL;
 
@@ -222,7 +286,9 @@ int _starpu_disk_read(int src_dev, int dst_dev STARPU_ATTRIBUTE_UNUSED, void *ob
 	/* asynchronous request failed or synchronous request is asked */
 	if (channel == NULL || !event)
 	{
+		disk_busy(src_dev);
 		disk_register_list[src_dev]->functions->read(disk_register_list[src_dev]->base, obj, buf, offset, size);
+		disk_idle(src_dev);
 		return 0;
 	}
 	return -EAGAIN;
@@ -253,7 +319,9 @@ int _starpu_disk_write(int src_dev STARPU_ATTRIBUTE_UNUSED, int dst_dev, void *o
 	/* asynchronous request failed or synchronous request is asked */
 	if (channel == NULL || !event)
 	{
+		disk_busy(dst_dev);
 		disk_register_list[dst_dev]->functions->write(disk_register_list[dst_dev]->base, obj, buf, offset, size);
+		disk_idle(dst_dev);
 		return 0;
 	}
 	return -EAGAIN;
@@ -301,6 +369,19 @@ int _starpu_disk_copy(int src_dev, void *obj_src, off_t offset_src, int dst_dev,
 }
 
 /* src_dev == disk dev and dst_dev == STARPU_CPU_RAM */
+void *_starpu_disk_map(int src_dev, void *obj, off_t offset, size_t size)
+{
+	if (disk_register_list[src_dev]->functions->map == NULL)
+		return NULL;
+	return disk_register_list[src_dev]->functions->map(disk_register_list[src_dev]->base, obj, offset, size);
+}
+
+void _starpu_disk_unmap(int src_dev, void *obj, void *addr, off_t offset, size_t size)
+{
+	STARPU_ASSERT(disk_register_list[src_dev]->functions->unmap);
+	disk_register_list[src_dev]->functions->unmap(disk_register_list[src_dev]->base, obj, addr, offset, size);
+}
+
 int _starpu_disk_full_read(int src_dev, int dst_dev, void *obj, void **ptr, size_t *size, struct _starpu_async_channel *channel)
 {
 	void *event = NULL;
@@ -326,7 +407,9 @@ int _starpu_disk_full_read(int src_dev, int dst_dev, void *obj, void **ptr, size
 	/* asynchronous request failed or synchronous request is asked */
 	if (channel == NULL || !event)
 	{
+		disk_busy(src_dev);
 		disk_register_list[src_dev]->functions->full_read(disk_register_list[src_dev]->base, obj, ptr, size, dst_node);
+		disk_idle(src_dev);
 		return 0;
 	}
 	return -EAGAIN;
@@ -357,7 +440,9 @@ int _starpu_disk_full_write(int src_dev STARPU_ATTRIBUTE_UNUSED, int dst_dev, vo
 	/* asynchronous request failed or synchronous request is asked */
 	if (channel == NULL || !event)
 	{
+		disk_busy(dst_dev);
 		disk_register_list[dst_dev]->functions->full_write(disk_register_list[dst_dev]->base, obj, ptr, size);
+		disk_idle(dst_dev);
 		return 0;
 	}
 	return -EAGAIN;
@@ -394,6 +479,7 @@ void starpu_disk_wait_request(struct _starpu_async_channel *async_channel)
 			disk_register_list[devid]->functions->wait_request(event->backend_event);
 
 			disk_register_list[devid]->functions->free_request(event->backend_event);
+			disk_idle(devid);
 
 			_starpu_disk_backend_event_list_erase(disk_event->requests, event);
 
@@ -429,6 +515,7 @@ int starpu_disk_test_request(struct _starpu_async_channel *async_channel)
 				if (res)
 				{
 					disk_register_list[devid]->functions->free_request(event->backend_event);
+					disk_idle(devid);
 
 					_starpu_disk_backend_event_list_erase(disk_event->requests, event);
 
@@ -468,6 +555,10 @@ static int add_disk_in_list(int devid,  struct starpu_disk_ops *func, void *base
 	dr->base = base;
 	dr->flag = STARPU_DISK_ALL;
 	dr->functions = func;
+	STARPU_PTHREAD_MUTEX_INIT(&dr->busy_mutex, NULL);
+	dr->nbusy = 0;
+	dr->busy_time = 0.;
+	dr->register_time = starpu_timing_now();
 	disk_register_list[devid] = dr;
 	return devid;
 }
@@ -524,6 +615,15 @@ void _starpu_swap_init(void)
 		return;
 #endif
 
+	}
+	else if (!strcmp(backend, "unistd_io_uring"))
+	{
+#ifdef STARPU_LINUX_SYS
+		ops = &starpu_disk_unistd_io_uring_ops;
+#else
+		_STARPU_DISP("Warning: io_uring support is not compiled in, could not enable disk swap\n");
+		return;
+#endif
 	}
 	else if (!strcmp(backend, "leveldb"))
 	{
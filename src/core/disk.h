@@ -42,6 +42,9 @@ int _starpu_disk_read(int src_dev, int dst_dev, void *obj, void *buf, off_t offs
 /** src_dev is for the moment the STARU_MAIN_RAM, dst_dev is a disk device */
 int _starpu_disk_write(int src_dev, int dst_dev, void *obj, void *buf, off_t offset, size_t size, struct _starpu_async_channel * async_channel);
 
+void *_starpu_disk_map(int src_dev, void *obj, off_t offset, size_t size);
+void _starpu_disk_unmap(int src_dev, void *obj, void *addr, off_t offset, size_t size);
+
 int _starpu_disk_full_read(int src_dev, int dst_dev, void * obj, void ** ptr, size_t * size, struct _starpu_async_channel * async_channel);
 int _starpu_disk_full_write(int src_dev, int dst_dev, void * obj, void * ptr, size_t size, struct _starpu_async_channel * async_channel);
 
@@ -63,8 +66,25 @@ int _starpu_get_disk_flag(int devid);
 /** unregister disk */
 void _starpu_disk_unregister(void);
 
+/** Return in \p busy the time during which disk \p devid had requests in
+ * flight, and in \p elapsed the time since it was registered, in us */
+void _starpu_disk_get_busy_time(int devid, double *busy, double *elapsed);
+
 void _starpu_swap_init(void);
 
+/** Wrap the backend \p ops of disk memory node \p node, already plugged as
+ * \p base, so that data written to it gets compressed when it pays off, see
+ * STARPU_DISK_COMPRESS. Return the base to be used with _starpu_disk_compress_ops */
+void *_starpu_disk_compress_plug(struct starpu_disk_ops *ops, void *base, unsigned node, int mode);
+extern struct starpu_disk_ops _starpu_disk_compress_ops;
+
+/** Wrap the backend \p ops of disk memory node \p node, already plugged as
+ * \p base, so that small objects get appended to a log of large segments, see
+ * STARPU_DISK_LOG. Return the base to be used with _starpu_disk_log_ops, or NULL if the
+ * log could not be set up, in which case \p base keeps being used directly */
+void *_starpu_disk_log_plug(struct starpu_disk_ops *ops, void *base, unsigned node);
+extern struct starpu_disk_ops _starpu_disk_log_ops;
+
 static inline struct _starpu_disk_event *_starpu_disk_get_event(union _starpu_async_channel_event *_event)
 {
 	struct _starpu_disk_event *event;
@@ -0,0 +1,533 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <common/config.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <starpu.h>
+#include <common/utils.h>
+#include <common/compress.h>
+#include <core/disk.h>
+
+/* ------------------- compress data written to another backend -------------------  */
+
+/*
+ * This wraps the backend of a disk, so that objects written as a whole are
+ * stored compressed at the beginning of the backend object, when the measured
+ * compression ratio and codec throughputs make it faster than writing and
+ * reading back the raw data at the disk bandwidth. Partial accesses to
+ * compressed objects go through a decompressed copy. Compressed transfers are
+ * performed synchronously.
+ */
+
+/* Objects are written raw again if their estimated compression ratio gets over
+ * this */
+#define COMPRESS_RATIO_MAX 0.9
+/* Weight of the latest measurement in the running estimates */
+#define COMPRESS_ALPHA 0.25
+/* While compression does not pay off for an object, still try it once every
+ * that many writes, in case the data got more compressible */
+#define COMPRESS_PROBE_PERIOD 32
+
+struct _starpu_disk_compress_base
+{
+	/* The wrapped backend */
+	struct starpu_disk_ops *ops;
+	void *base;
+	unsigned node;
+
+	int mode;
+	size_t min_size;
+	int stats;
+	size_t page_size;
+
+	/* Protects the estimates and statistics */
+	starpu_pthread_mutex_t mutex;
+	/* Running estimates of the compressed/raw size ratio, and of the
+	 * codec throughputs in MB/s, over all objects */
+	double ratio;
+	double compress_speed;
+	double decompress_speed;
+
+	unsigned long nwrites;
+	unsigned long ncompressed;
+	size_t bytes_raw;
+	size_t bytes_written;
+};
+
+struct _starpu_disk_compress_obj
+{
+	/* The object of the wrapped backend */
+	void *obj;
+	size_t size;
+	/* Size of the compressed data, or 0 if the object is stored raw */
+	size_t compressed_size;
+	/* Last compression ratio measured for this object, or -1 */
+	double ratio;
+	/* Number of writes performed raw since the last compression attempt */
+	unsigned skipped;
+	starpu_pthread_mutex_t mutex;
+};
+
+struct _starpu_disk_compress_request
+{
+	struct _starpu_disk_compress_base *base;
+	void *event;
+};
+
+static double _starpu_disk_compress_average(double estimate, double value)
+{
+	if (estimate < 0.)
+		return value;
+	return (1. - COMPRESS_ALPHA) * estimate + COMPRESS_ALPHA * value;
+}
+
+/* Decide whether writing SIZE bytes of OBJ compressed is worth it. The data
+ * will have to be compressed now and decompressed when read back, which has to
+ * take less time than writing and reading back the bytes it saves, at the disk
+ * bandwidth that we get from the bus perfmodel. Must be called with the object
+ * mutex held. */
+static int _starpu_disk_compress_pays_off(struct _starpu_disk_compress_base *base, struct _starpu_disk_compress_obj *obj, size_t size)
+{
+	double ratio;
+	int pays_off;
+
+	if (size < base->min_size)
+		return 0;
+	if (base->mode == 2)
+		return 1;
+
+	/* Nothing measured yet for this piece of data, try */
+	ratio = obj->ratio;
+	if (ratio < 0.)
+		return 1;
+
+	double write_bandwidth = starpu_transfer_bandwidth(STARPU_MAIN_RAM, base->node);
+	double read_bandwidth = starpu_transfer_bandwidth(base->node, STARPU_MAIN_RAM);
+	if (base->compress_speed <= 0. || base->decompress_speed <= 0.
+	    || isnan(write_bandwidth) || write_bandwidth <= 0.
+	    || isnan(read_bandwidth) || read_bandwidth <= 0.)
+		/* Disk not calibrated, only rely on the ratio */
+		pays_off = ratio < COMPRESS_RATIO_MAX;
+	else
+	{
+		/* All in us, the bandwidths are in MB/s, i.e. bytes/us */
+		double raw_time = size / write_bandwidth + size / read_bandwidth;
+		double compressed_time = size / base->compress_speed + size / base->decompress_speed
+			+ size * ratio * (1. / write_bandwidth + 1. / read_bandwidth);
+		pays_off = compressed_time < raw_time && ratio < COMPRESS_RATIO_MAX;
+	}
+
+	if (!pays_off && ++obj->skipped >= COMPRESS_PROBE_PERIOD)
+		return 1;
+	return pays_off;
+}
+
+static void _starpu_disk_compress_account(struct _starpu_disk_compress_base *base, size_t size, size_t written)
+{
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	base->nwrites++;
+	if (written < size)
+		base->ncompressed++;
+	base->bytes_raw += size;
+	base->bytes_written += written;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+}
+
+/* Try to write the whole OBJ from BUF in compressed form.
+ * Return -1 if it did not compress enough, the data should then be written raw.
+ * Must be called with the object mutex held. */
+static int _starpu_disk_compress_store(struct _starpu_disk_compress_base *base, struct _starpu_disk_compress_obj *obj, const void *buf)
+{
+	size_t size = obj->size;
+	/* No need to go beyond the raw size */
+	size_t compressed_size = size;
+	size_t padded_size;
+	void *compressed;
+	double start, end;
+	int ret;
+
+	if (_starpu_malloc_flags_on_node(STARPU_MAIN_RAM, &compressed, size, 0))
+		/* Not enough memory to compress, write it raw */
+		return -1;
+
+	start = starpu_timing_now();
+	ret = _starpu_compress(buf, size, compressed, &compressed_size);
+	end = starpu_timing_now();
+
+	/* Some backends can only write whole pages */
+	padded_size = (compressed_size + base->page_size - 1) / base->page_size * base->page_size;
+	if (ret == 0 && padded_size >= size)
+		ret = -1;
+
+	obj->ratio = ret ? 1. : (double) compressed_size / size;
+	obj->skipped = 0;
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	base->ratio = _starpu_disk_compress_average(base->ratio, obj->ratio);
+	if (end > start)
+		base->compress_speed = _starpu_disk_compress_average(base->compress_speed, size / (end - start));
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+
+	if (ret == 0)
+	{
+		memset((char *) compressed + compressed_size, 0, padded_size - compressed_size);
+		ret = base->ops->write(base->base, obj->obj, compressed, 0, padded_size);
+		if (ret == 0)
+		{
+			obj->compressed_size = compressed_size;
+			_starpu_disk_compress_account(base, size, padded_size);
+		}
+	}
+
+	_starpu_free_flags_on_node(STARPU_MAIN_RAM, compressed, size, 0);
+	return ret;
+}
+
+/* Read the whole compressed OBJ into BUF.
+ * Must be called with the object mutex held. */
+static int _starpu_disk_compress_load(struct _starpu_disk_compress_base *base, struct _starpu_disk_compress_obj *obj, void *buf)
+{
+	size_t size = obj->size;
+	size_t padded_size = (obj->compressed_size + base->page_size - 1) / base->page_size * base->page_size;
+	void *compressed;
+	double start, end;
+	int ret;
+
+	if (_starpu_malloc_flags_on_node(STARPU_MAIN_RAM, &compressed, padded_size, 0))
+		return -ENOMEM;
+	ret = base->ops->read(base->base, obj->obj, compressed, 0, padded_size);
+	if (ret == 0)
+	{
+		start = starpu_timing_now();
+		ret = _starpu_decompress(compressed, obj->compressed_size, buf, size);
+		end = starpu_timing_now();
+		STARPU_ASSERT_MSG(ret == 0, "Compressed disk object is corrupted");
+
+		if (end > start)
+		{
+			STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+			base->decompress_speed = _starpu_disk_compress_average(base->decompress_speed, size / (end - start));
+			STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+		}
+	}
+	_starpu_free_flags_on_node(STARPU_MAIN_RAM, compressed, padded_size, 0);
+	return ret;
+}
+
+static void *_starpu_disk_compress_wrap(void *inner, size_t size)
+{
+	struct _starpu_disk_compress_obj *obj;
+
+	if (!inner)
+		return NULL;
+
+	_STARPU_MALLOC(obj, sizeof(*obj));
+	obj->obj = inner;
+	obj->size = size;
+	obj->compressed_size = 0;
+	obj->ratio = -1.;
+	obj->skipped = 0;
+	STARPU_PTHREAD_MUTEX_INIT(&obj->mutex, NULL);
+	return obj;
+}
+
+static void *starpu_disk_compress_alloc(void *base, size_t size)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	return _starpu_disk_compress_wrap(fileBase->ops->alloc(fileBase->base, size), size);
+}
+
+static void starpu_disk_compress_free(void *base, void *obj, size_t size)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	struct _starpu_disk_compress_obj *tmp = obj;
+
+	fileBase->ops->free(fileBase->base, tmp->obj, size);
+	STARPU_PTHREAD_MUTEX_DESTROY(&tmp->mutex);
+	free(tmp);
+}
+
+static void *starpu_disk_compress_open(void *base, void *pos, size_t size)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	/* Existing data is raw */
+	return _starpu_disk_compress_wrap(fileBase->ops->open(fileBase->base, pos, size), size);
+}
+
+static void starpu_disk_compress_close(void *base, void *obj, size_t size)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	struct _starpu_disk_compress_obj *tmp = obj;
+
+	if (tmp->compressed_size)
+	{
+		/* The file belongs to the application, put back its raw content */
+		void *whole;
+		if (_starpu_malloc_flags_on_node(STARPU_MAIN_RAM, &whole, tmp->size, 0))
+			_STARPU_DISP("Warning: not enough memory to decompress disk object %p, it is left compressed\n", tmp->obj);
+		else
+		{
+			if (_starpu_disk_compress_load(fileBase, tmp, whole) == 0)
+				fileBase->ops->write(fileBase->base, tmp->obj, whole, 0, tmp->size);
+			else
+				_STARPU_DISP("Warning: could not read back disk object %p, it is left compressed\n", tmp->obj);
+			_starpu_free_flags_on_node(STARPU_MAIN_RAM, whole, tmp->size, 0);
+		}
+	}
+	fileBase->ops->close(fileBase->base, tmp->obj, size);
+	STARPU_PTHREAD_MUTEX_DESTROY(&tmp->mutex);
+	free(tmp);
+}
+
+static int starpu_disk_compress_read(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	struct _starpu_disk_compress_obj *tmp = obj;
+	int ret;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&tmp->mutex);
+	if (!tmp->compressed_size)
+		ret = fileBase->ops->read(fileBase->base, tmp->obj, buf, offset, size);
+	else if (offset == 0 && size == tmp->size)
+		ret = _starpu_disk_compress_load(fileBase, tmp, buf);
+	else
+	{
+		/* Partial read, decompress everything */
+		void *whole;
+		ret = _starpu_malloc_flags_on_node(STARPU_MAIN_RAM, &whole, tmp->size, 0);
+		if (ret == 0)
+		{
+			ret = _starpu_disk_compress_load(fileBase, tmp, whole);
+			if (ret == 0)
+				memcpy(buf, (char *) whole + offset, size);
+			_starpu_free_flags_on_node(STARPU_MAIN_RAM, whole, tmp->size, 0);
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&tmp->mutex);
+	return ret;
+}
+
+static int starpu_disk_compress_write(void *base, void *obj, const void *buf, off_t offset, size_t size)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	struct _starpu_disk_compress_obj *tmp = obj;
+	int ret;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&tmp->mutex);
+	if (offset == 0 && size == tmp->size)
+	{
+		if (_starpu_disk_compress_pays_off(fileBase, tmp, size)
+		    && _starpu_disk_compress_store(fileBase, tmp, buf) == 0)
+		{
+			STARPU_PTHREAD_MUTEX_UNLOCK(&tmp->mutex);
+			return 0;
+		}
+		ret = fileBase->ops->write(fileBase->base, tmp->obj, buf, 0, size);
+		tmp->compressed_size = 0;
+		_starpu_disk_compress_account(fileBase, size, size);
+	}
+	else if (tmp->compressed_size)
+	{
+		/* Partial write, rewrite everything raw */
+		void *whole;
+		ret = _starpu_malloc_flags_on_node(STARPU_MAIN_RAM, &whole, tmp->size, 0);
+		if (ret == 0)
+		{
+			ret = _starpu_disk_compress_load(fileBase, tmp, whole);
+			if (ret == 0)
+			{
+				memcpy((char *) whole + offset, buf, size);
+				ret = fileBase->ops->write(fileBase->base, tmp->obj, whole, 0, tmp->size);
+				tmp->compressed_size = 0;
+			}
+			_starpu_free_flags_on_node(STARPU_MAIN_RAM, whole, tmp->size, 0);
+		}
+	}
+	else
+		ret = fileBase->ops->write(fileBase->base, tmp->obj, buf, offset, size);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&tmp->mutex);
+	return ret;
+}
+
+static void *_starpu_disk_compress_request(struct _starpu_disk_compress_base *base, void *event)
+{
+	struct _starpu_disk_compress_request *req;
+
+	if (!event)
+		return NULL;
+	_STARPU_MALLOC(req, sizeof(*req));
+	req->base = base;
+	req->event = event;
+	return req;
+}
+
+static void *starpu_disk_compress_async_read(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	struct _starpu_disk_compress_obj *tmp = obj;
+	void *event = NULL;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&tmp->mutex);
+	/* Compressed objects are read synchronously */
+	if (!tmp->compressed_size && fileBase->ops->async_read)
+		event = fileBase->ops->async_read(fileBase->base, tmp->obj, buf, offset, size);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&tmp->mutex);
+	return _starpu_disk_compress_request(fileBase, event);
+}
+
+static void *starpu_disk_compress_async_write(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	struct _starpu_disk_compress_obj *tmp = obj;
+	void *event = NULL;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&tmp->mutex);
+	/* Compressed objects are written synchronously */
+	if (fileBase->ops->async_write && !tmp->compressed_size
+	    && !(offset == 0 && size == tmp->size && _starpu_disk_compress_pays_off(fileBase, tmp, size)))
+	{
+		event = fileBase->ops->async_write(fileBase->base, tmp->obj, buf, offset, size);
+		if (event && offset == 0 && size == tmp->size)
+			_starpu_disk_compress_account(fileBase, size, size);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&tmp->mutex);
+	return _starpu_disk_compress_request(fileBase, event);
+}
+
+static void starpu_disk_compress_wait_request(void *async_channel)
+{
+	struct _starpu_disk_compress_request *req = async_channel;
+	req->base->ops->wait_request(req->event);
+}
+
+static int starpu_disk_compress_test_request(void *async_channel)
+{
+	struct _starpu_disk_compress_request *req = async_channel;
+	return req->base->ops->test_request(req->event);
+}
+
+static void starpu_disk_compress_free_request(void *async_channel)
+{
+	struct _starpu_disk_compress_request *req = async_channel;
+	req->base->ops->free_request(req->event);
+	free(req);
+}
+
+static int starpu_disk_compress_full_read(void *base, void *obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	struct _starpu_disk_compress_obj *tmp = obj;
+	int ret;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&tmp->mutex);
+	if (!tmp->compressed_size)
+		ret = fileBase->ops->full_read(fileBase->base, tmp->obj, ptr, size, dst_node);
+	else
+	{
+		*size = tmp->size;
+		ret = _starpu_malloc_flags_on_node(dst_node, ptr, *size, 0);
+		if (ret == 0)
+		{
+			ret = _starpu_disk_compress_load(fileBase, tmp, *ptr);
+			if (ret)
+			{
+				_starpu_free_flags_on_node(dst_node, *ptr, *size, 0);
+				*ptr = NULL;
+			}
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&tmp->mutex);
+	return ret;
+}
+
+static int starpu_disk_compress_full_write(void *base, void *obj, void *ptr, size_t size)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+	struct _starpu_disk_compress_obj *tmp = obj;
+	int ret;
+
+	/* Packed data is stored raw, its size is the size of the object */
+	STARPU_PTHREAD_MUTEX_LOCK(&tmp->mutex);
+	ret = fileBase->ops->full_write(fileBase->base, tmp->obj, ptr, size);
+	tmp->size = size;
+	tmp->compressed_size = 0;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&tmp->mutex);
+	return ret;
+}
+
+static void starpu_disk_compress_unplug(void *base)
+{
+	struct _starpu_disk_compress_base *fileBase = base;
+
+	if (fileBase->stats && fileBase->nwrites)
+		_STARPU_DISP("Writes to disk node %u: %lu compressed out of %lu, %.2f MiB written for %.2f MiB of data (ratio estimate %.3f, %s throughput estimates %.2f MB/s compression, %.2f MB/s decompression)\n",
+			     fileBase->node, fileBase->ncompressed, fileBase->nwrites,
+			     (double) fileBase->bytes_written / (1024*1024),
+			     (double) fileBase->bytes_raw / (1024*1024),
+			     fileBase->ratio, _starpu_compress_codec_name(),
+			     fileBase->compress_speed, fileBase->decompress_speed);
+
+	fileBase->ops->unplug(fileBase->base);
+	STARPU_PTHREAD_MUTEX_DESTROY(&fileBase->mutex);
+	free(fileBase);
+}
+
+void *_starpu_disk_compress_plug(struct starpu_disk_ops *ops, void *base, unsigned node, int mode)
+{
+	struct _starpu_disk_compress_base *fileBase;
+
+	_STARPU_CALLOC(fileBase, 1, sizeof(*fileBase));
+	fileBase->ops = ops;
+	fileBase->base = base;
+	fileBase->node = node;
+	fileBase->mode = mode;
+	fileBase->min_size = starpu_getenv_number_default("STARPU_DISK_COMPRESS_MIN_SIZE", 64*1024);
+	fileBase->stats = starpu_getenv_number_default("STARPU_DISK_COMPRESS_STATS", 0);
+	fileBase->page_size = getpagesize();
+	fileBase->ratio = -1.;
+	fileBase->compress_speed = -1.;
+	fileBase->decompress_speed = -1.;
+	STARPU_PTHREAD_MUTEX_INIT(&fileBase->mutex, NULL);
+	return fileBase;
+}
+
+/* Only used through _starpu_disk_compress_plug, once the wrapped backend has
+ * been plugged and its bandwidth measured */
+struct starpu_disk_ops _starpu_disk_compress_ops =
+{
+	.alloc = starpu_disk_compress_alloc,
+	.free = starpu_disk_compress_free,
+	.open = starpu_disk_compress_open,
+	.close = starpu_disk_compress_close,
+	.read = starpu_disk_compress_read,
+	.write = starpu_disk_compress_write,
+	.unplug = starpu_disk_compress_unplug,
+	/* Copies between disks go through main memory */
+	.copy = NULL,
+	.async_read = starpu_disk_compress_async_read,
+	.async_write = starpu_disk_compress_async_write,
+	.wait_request = starpu_disk_compress_wait_request,
+	.test_request = starpu_disk_compress_test_request,
+	.free_request = starpu_disk_compress_free_request,
+	.full_read = starpu_disk_compress_full_read,
+	.full_write = starpu_disk_compress_full_write
+};
@@ -0,0 +1,768 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/config.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <starpu.h>
+#include <common/list.h>
+#include <common/thread.h>
+#include <common/utils.h>
+#include <core/disk.h>
+
+/* ------------------- stage small objects in a log on another backend -------------------  */
+
+/*
+ * This wraps the backend of a disk, so that small objects do not get a backend
+ * object each, but are appended to large backend objects, the segments, through
+ * a buffer in main memory, thus turning the writes of many small pieces of data
+ * into a few large sequential writes. Each object records where its latest
+ * version lies in the log. Segments which mostly contain stale versions are
+ * compacted by a background thread, which appends their live objects again,
+ * and frees them. Large objects, and files opened by the application, are
+ * stored in their own backend objects as usual.
+ *
+ * Room is reserved in the log when objects are allocated: enough segments are
+ * kept allocated for twice the size of the logged objects, since segments get
+ * compacted when less than half of them is live, plus the current and a spare
+ * segment. When the backend has no room for that, the allocation fails, so
+ * that the memory manager can evict data. If appending still finds no
+ * segment, e.g. because compaction is lagging behind, the object is moved to
+ * its own backend object.
+ */
+
+/* Size of the buffer in main memory where data is appended before being
+ * written to the current segment */
+#define LOG_BUFFER_SIZE (4*1024*1024)
+/* Segments are compacted when less than this part of them is live */
+#define LOG_COMPACT_RATIO 0.5
+
+struct _starpu_disk_log_segment;
+
+LIST_TYPE(_starpu_disk_log_obj,
+	/* The object of the wrapped backend, for large objects and opened
+	 * files, NULL for objects stored in the log */
+	void *obj;
+	size_t size;
+	/* Where the latest version of the object is stored, NULL if it was
+	 * never written */
+	struct _starpu_disk_log_segment *segment;
+	off_t offset;
+	/* Size taken in the segment */
+	size_t logged_size;
+	/* Room reserved in the log for the object, 0 if it is stored in its
+	 * own backend object */
+	size_t reserved;
+);
+
+LIST_TYPE(_starpu_disk_log_segment,
+	/* The object of the wrapped backend */
+	void *obj;
+	/* Amount of data appended, including stale versions */
+	size_t used;
+	/* Amount of data of the objects whose latest version is here */
+	size_t live;
+	/* Amount of data actually written to the backend, the rest is in the
+	 * buffer */
+	size_t flushed;
+	/* Number of reads in progress without the mutex */
+	unsigned readers;
+	/* The objects whose latest version is here */
+	struct _starpu_disk_log_obj_list objs;
+);
+
+struct _starpu_disk_log_base
+{
+	/* The wrapped backend */
+	struct starpu_disk_ops *ops;
+	void *base;
+	unsigned node;
+
+	size_t segment_size;
+	size_t max_size;
+	size_t page_size;
+	int stats;
+
+	/* Protects everything below */
+	starpu_pthread_mutex_t mutex;
+	/* The segment being appended to, its data beyond flushed is in buffer,
+	 * NULL if none could be allocated yet */
+	struct _starpu_disk_log_segment *current;
+	void *buffer;
+	/* The other segments */
+	struct _starpu_disk_log_segment_list segments;
+	/* Empty segments kept allocated for the reservations */
+	struct _starpu_disk_log_segment_list free_segments;
+	/* Number of segments allocated on the backend */
+	size_t nallocated;
+	/* Room reserved by the objects stored in the log */
+	size_t reserved;
+
+	/* Compaction thread */
+	starpu_pthread_t thread;
+	starpu_pthread_cond_t cond;
+	int stop;
+
+	unsigned long nwrites;
+	size_t bytes_logged;
+	unsigned long nflushes;
+	size_t bytes_flushed;
+	unsigned long nsegments;
+	unsigned long ncompacted;
+	size_t bytes_compacted;
+};
+
+struct _starpu_disk_log_request
+{
+	struct _starpu_disk_log_base *base;
+	void *event;
+};
+
+static size_t _starpu_disk_log_padded(struct _starpu_disk_log_base *base, size_t size)
+{
+	/* Some backends can only write whole pages */
+	return (size + base->page_size - 1) / base->page_size * base->page_size;
+}
+
+/* Allocate a segment on the backend, or return NULL if there is no room left */
+static struct _starpu_disk_log_segment *_starpu_disk_log_alloc_segment(struct _starpu_disk_log_base *base)
+{
+	void *obj = base->ops->alloc(base->base, base->segment_size);
+	struct _starpu_disk_log_segment *segment;
+
+	if (!obj)
+		return NULL;
+	segment = _starpu_disk_log_segment_new();
+	segment->obj = obj;
+	base->nallocated++;
+	base->nsegments++;
+	return segment;
+}
+
+/* Get an empty segment, preferably one kept for the reservations, or return
+ * NULL if there is no room left. Must be called with the mutex held */
+static struct _starpu_disk_log_segment *_starpu_disk_log_new_segment(struct _starpu_disk_log_base *base)
+{
+	struct _starpu_disk_log_segment *segment;
+
+	if (!_starpu_disk_log_segment_list_empty(&base->free_segments))
+		segment = _starpu_disk_log_segment_list_pop_front(&base->free_segments);
+	else if (!(segment = _starpu_disk_log_alloc_segment(base)))
+		return NULL;
+	segment->used = 0;
+	segment->live = 0;
+	segment->flushed = 0;
+	segment->readers = 0;
+	_starpu_disk_log_obj_list_init(&segment->objs);
+	return segment;
+}
+
+/* Number of segments needed for the reservations */
+static size_t _starpu_disk_log_needed(struct _starpu_disk_log_base *base)
+{
+	return (2 * base->reserved + base->segment_size - 1) / base->segment_size + 2;
+}
+
+/* Give back the segments which are not needed for the reservations any more.
+ * Must be called with the mutex held */
+static void _starpu_disk_log_trim(struct _starpu_disk_log_base *base)
+{
+	while (!_starpu_disk_log_segment_list_empty(&base->free_segments)
+	       && base->nallocated > _starpu_disk_log_needed(base))
+	{
+		struct _starpu_disk_log_segment *segment = _starpu_disk_log_segment_list_pop_front(&base->free_segments);
+		base->ops->free(base->base, segment->obj, base->segment_size);
+		_starpu_disk_log_segment_delete(segment);
+		base->nallocated--;
+	}
+}
+
+/* Reserve room in the log for OBJ with SIZE bytes, allocating segments if
+ * needed. Return -ENOSPC, leaving the reservation unchanged, if the backend
+ * does not have enough room. Must be called with the mutex held */
+static int _starpu_disk_log_reserve(struct _starpu_disk_log_base *base, struct _starpu_disk_log_obj *obj, size_t size)
+{
+	size_t old = obj->reserved;
+
+	base->reserved = base->reserved - old + _starpu_disk_log_padded(base, size);
+	obj->reserved = _starpu_disk_log_padded(base, size);
+	while (base->nallocated < _starpu_disk_log_needed(base))
+	{
+		struct _starpu_disk_log_segment *segment = _starpu_disk_log_alloc_segment(base);
+		if (!segment)
+		{
+			base->reserved = base->reserved - obj->reserved + old;
+			obj->reserved = old;
+			_starpu_disk_log_trim(base);
+			return -ENOSPC;
+		}
+		_starpu_disk_log_segment_list_push_back(&base->free_segments, segment);
+		STARPU_PTHREAD_COND_SIGNAL(&base->cond);
+	}
+	_starpu_disk_log_trim(base);
+	return 0;
+}
+
+/* Release the room reserved for OBJ. Must be called with the mutex held */
+static void _starpu_disk_log_unreserve(struct _starpu_disk_log_base *base, struct _starpu_disk_log_obj *obj)
+{
+	base->reserved -= obj->reserved;
+	obj->reserved = 0;
+	_starpu_disk_log_trim(base);
+}
+
+/* Write the buffer to the current segment. Must be called with the mutex held */
+static void _starpu_disk_log_flush(struct _starpu_disk_log_base *base)
+{
+	struct _starpu_disk_log_segment *segment = base->current;
+	size_t size;
+	int ret;
+
+	if (!segment)
+		return;
+	size = segment->used - segment->flushed;
+	if (!size)
+		return;
+	ret = base->ops->write(base->base, segment->obj, base->buffer, segment->flushed, size);
+	STARPU_ASSERT_MSG(ret == 0, "Could not write %zu bytes to the log of disk node %u", size, base->node);
+	segment->flushed = segment->used;
+	base->nflushes++;
+	base->bytes_flushed += size;
+}
+
+/* Free SEGMENT if nothing uses it any more, or have it compacted if it is
+ * mostly stale. Must be called with the mutex held */
+static void _starpu_disk_log_release(struct _starpu_disk_log_base *base, struct _starpu_disk_log_segment *segment)
+{
+	if (segment == base->current)
+		return;
+	if (!segment->live && !segment->readers)
+	{
+		_starpu_disk_log_segment_list_erase(&base->segments, segment);
+		_starpu_disk_log_segment_list_push_back(&base->free_segments, segment);
+		_starpu_disk_log_trim(base);
+		/* Compaction may have been waiting for room */
+		STARPU_PTHREAD_COND_SIGNAL(&base->cond);
+	}
+	else if (segment->live < segment->used * LOG_COMPACT_RATIO)
+		STARPU_PTHREAD_COND_SIGNAL(&base->cond);
+}
+
+/* Forget the current version of OBJ. Must be called with the mutex held */
+static void _starpu_disk_log_drop(struct _starpu_disk_log_base *base, struct _starpu_disk_log_obj *obj)
+{
+	struct _starpu_disk_log_segment *segment = obj->segment;
+
+	if (!segment)
+		return;
+	_starpu_disk_log_obj_list_erase(&segment->objs, obj);
+	segment->live -= obj->logged_size;
+	obj->segment = NULL;
+	_starpu_disk_log_release(base, segment);
+}
+
+/* Whether SIZE bytes can be appended without allocating a segment on the
+ * backend. Must be called with the mutex held */
+static int _starpu_disk_log_has_room(struct _starpu_disk_log_base *base, size_t size)
+{
+	struct _starpu_disk_log_segment *segment = base->current;
+	return (segment && segment->used + _starpu_disk_log_padded(base, size) <= base->segment_size)
+		|| !_starpu_disk_log_segment_list_empty(&base->free_segments);
+}
+
+/* The log has no room for OBJ, store its SIZE bytes from BUF in its own
+ * backend object instead. Must be called with the mutex held */
+static int _starpu_disk_log_move_out(struct _starpu_disk_log_base *base, struct _starpu_disk_log_obj *obj, const void *buf, size_t size)
+{
+	void *inner = base->ops->alloc(base->base, obj->size);
+
+	if (!inner)
+		return -ENOSPC;
+	_starpu_disk_log_unreserve(base, obj);
+	obj->obj = inner;
+	return base->ops->write(base->base, inner, buf, 0, size);
+}
+
+/* Append SIZE bytes from BUF as the new version of OBJ. Must be called with
+ * the mutex held */
+static int _starpu_disk_log_append(struct _starpu_disk_log_base *base, struct _starpu_disk_log_obj *obj, const void *buf, size_t size)
+{
+	size_t padded = _starpu_disk_log_padded(base, size);
+	struct _starpu_disk_log_segment *segment = base->current;
+
+	STARPU_ASSERT(padded <= LOG_BUFFER_SIZE);
+	_starpu_disk_log_drop(base, obj);
+
+	if (!segment || segment->used + padded > base->segment_size)
+	{
+		/* Segment full, start another one */
+		struct _starpu_disk_log_segment *next = _starpu_disk_log_new_segment(base);
+		if (!next)
+			return _starpu_disk_log_move_out(base, obj, buf, size);
+		_starpu_disk_log_flush(base);
+		base->current = next;
+		if (segment)
+		{
+			_starpu_disk_log_segment_list_push_back(&base->segments, segment);
+			_starpu_disk_log_release(base, segment);
+		}
+		segment = next;
+	}
+	else if (segment->used + padded - segment->flushed > LOG_BUFFER_SIZE)
+		_starpu_disk_log_flush(base);
+
+	char *dst = (char *) base->buffer + (segment->used - segment->flushed);
+	memcpy(dst, buf, size);
+	memset(dst + size, 0, padded - size);
+
+	obj->segment = segment;
+	obj->offset = segment->used;
+	obj->logged_size = padded;
+	segment->used += padded;
+	segment->live += padded;
+	_starpu_disk_log_obj_list_push_back(&segment->objs, obj);
+	return 0;
+}
+
+/* Read SIZE bytes at OFFSET of the logged OBJ into BUF. Must be called with
+ * the mutex held, which is released during the actual read unless KEEP_LOCK
+ * is set */
+static int _starpu_disk_log_read_logged(struct _starpu_disk_log_base *base, struct _starpu_disk_log_obj *obj, void *buf, off_t offset, size_t size, int keep_lock)
+{
+	struct _starpu_disk_log_segment *segment = obj->segment;
+	size_t pos = obj->offset + offset;
+	int ret;
+
+	if (!segment)
+	{
+		/* Never written */
+		memset(buf, 0, size);
+		return 0;
+	}
+
+	if (segment == base->current && pos >= segment->flushed)
+	{
+		memcpy(buf, (char *) base->buffer + (pos - segment->flushed), size);
+		return 0;
+	}
+
+	if (keep_lock)
+		return base->ops->read(base->base, segment->obj, buf, pos, size);
+
+	/* Data in a segment is never modified, the mutex is not needed for
+	 * the read itself */
+	segment->readers++;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+	ret = base->ops->read(base->base, segment->obj, buf, pos, size);
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	segment->readers--;
+	_starpu_disk_log_release(base, segment);
+	return ret;
+}
+
+/* Find a segment to be compacted. Must be called with the mutex held */
+static struct _starpu_disk_log_segment *_starpu_disk_log_victim(struct _starpu_disk_log_base *base)
+{
+	struct _starpu_disk_log_segment *segment;
+
+	for (segment = _starpu_disk_log_segment_list_begin(&base->segments);
+	     segment != _starpu_disk_log_segment_list_end(&base->segments);
+	     segment = _starpu_disk_log_segment_list_next(segment))
+		if (segment->live && segment->live < segment->used * LOG_COMPACT_RATIO)
+			return segment;
+	return NULL;
+}
+
+static void *_starpu_disk_log_compact(void *arg)
+{
+	struct _starpu_disk_log_base *base = arg;
+	void *tmp;
+
+	if (_starpu_malloc_flags_on_node(STARPU_MAIN_RAM, &tmp, base->max_size, 0))
+	{
+		_STARPU_DISP("Warning: not enough memory to compact the log of disk node %u\n", base->node);
+		return NULL;
+	}
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	while (1)
+	{
+		struct _starpu_disk_log_segment *segment;
+		struct _starpu_disk_log_obj *obj = NULL;
+
+		/* Objects are only moved within the log, wait for room */
+		while (!base->stop
+		       && !((segment = _starpu_disk_log_victim(base))
+			    && _starpu_disk_log_has_room(base, (obj = _starpu_disk_log_obj_list_front(&segment->objs))->size)))
+			STARPU_PTHREAD_COND_WAIT(&base->cond, &base->mutex);
+		if (base->stop)
+			break;
+
+		/* Move one object at a time, to let the others access the log */
+		size_t size = obj->size;
+		int ret = _starpu_disk_log_read_logged(base, obj, tmp, 0, size, 1);
+		STARPU_ASSERT_MSG(ret == 0, "Could not read %zu bytes from the log of disk node %u", size, base->node);
+		if (segment->live == obj->logged_size)
+			base->ncompacted++;
+		ret = _starpu_disk_log_append(base, obj, tmp, size);
+		STARPU_ASSERT(ret == 0);
+		base->bytes_compacted += size;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+
+	_starpu_free_flags_on_node(STARPU_MAIN_RAM, tmp, base->max_size, 0);
+	return NULL;
+}
+
+static void *_starpu_disk_log_wrap(void *inner, size_t size)
+{
+	struct _starpu_disk_log_obj *obj = _starpu_disk_log_obj_new();
+	obj->obj = inner;
+	obj->size = size;
+	obj->segment = NULL;
+	obj->offset = 0;
+	obj->logged_size = 0;
+	obj->reserved = 0;
+	return obj;
+}
+
+static void *starpu_disk_log_alloc(void *base, size_t size)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	struct _starpu_disk_log_obj *obj;
+	int ret;
+
+	if (size > fileBase->max_size)
+	{
+		void *inner = fileBase->ops->alloc(fileBase->base, size);
+		if (!inner)
+			return NULL;
+		return _starpu_disk_log_wrap(inner, size);
+	}
+
+	obj = _starpu_disk_log_wrap(NULL, size);
+	STARPU_PTHREAD_MUTEX_LOCK(&fileBase->mutex);
+	ret = _starpu_disk_log_reserve(fileBase, obj, size);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+	if (ret)
+	{
+		/* Let the memory manager evict data */
+		_starpu_disk_log_obj_delete(obj);
+		return NULL;
+	}
+	return obj;
+}
+
+static void starpu_disk_log_free(void *base, void *obj, size_t size)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	struct _starpu_disk_log_obj *tmp = obj;
+
+	if (tmp->obj)
+		fileBase->ops->free(fileBase->base, tmp->obj, size);
+	else
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&fileBase->mutex);
+		_starpu_disk_log_drop(fileBase, tmp);
+		_starpu_disk_log_unreserve(fileBase, tmp);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+	}
+	_starpu_disk_log_obj_delete(tmp);
+}
+
+static void *starpu_disk_log_open(void *base, void *pos, size_t size)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	/* The file belongs to the application, keep writing to it */
+	void *inner = fileBase->ops->open(fileBase->base, pos, size);
+	if (!inner)
+		return NULL;
+	return _starpu_disk_log_wrap(inner, size);
+}
+
+static void starpu_disk_log_close(void *base, void *obj, size_t size)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	struct _starpu_disk_log_obj *tmp = obj;
+
+	fileBase->ops->close(fileBase->base, tmp->obj, size);
+	_starpu_disk_log_obj_delete(tmp);
+}
+
+static int starpu_disk_log_read(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	struct _starpu_disk_log_obj *tmp = obj;
+	int ret;
+
+	if (tmp->obj)
+		return fileBase->ops->read(fileBase->base, tmp->obj, buf, offset, size);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&fileBase->mutex);
+	ret = _starpu_disk_log_read_logged(fileBase, tmp, buf, offset, size, 0);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+	return ret;
+}
+
+static int starpu_disk_log_write(void *base, void *obj, const void *buf, off_t offset, size_t size)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	struct _starpu_disk_log_obj *tmp = obj;
+	int ret = 0;
+
+	if (tmp->obj)
+		return fileBase->ops->write(fileBase->base, tmp->obj, buf, offset, size);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&fileBase->mutex);
+	fileBase->nwrites++;
+	fileBase->bytes_logged += size;
+	if (offset == 0 && size == tmp->size)
+		ret = _starpu_disk_log_append(fileBase, tmp, buf, size);
+	else
+	{
+		/* Partial write, append a whole new version */
+		void *whole;
+		ret = _starpu_malloc_flags_on_node(STARPU_MAIN_RAM, &whole, tmp->size, 0);
+		if (ret == 0)
+		{
+			ret = _starpu_disk_log_read_logged(fileBase, tmp, whole, 0, tmp->size, 0);
+			if (ret == 0)
+			{
+				memcpy((char *) whole + offset, buf, size);
+				ret = _starpu_disk_log_append(fileBase, tmp, whole, tmp->size);
+			}
+			_starpu_free_flags_on_node(STARPU_MAIN_RAM, whole, tmp->size, 0);
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+	return ret;
+}
+
+static void *_starpu_disk_log_request(struct _starpu_disk_log_base *base, void *event)
+{
+	struct _starpu_disk_log_request *req;
+
+	if (!event)
+		return NULL;
+	_STARPU_MALLOC(req, sizeof(*req));
+	req->base = base;
+	req->event = event;
+	return req;
+}
+
+static void *starpu_disk_log_async_read(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	struct _starpu_disk_log_obj *tmp = obj;
+
+	/* Logged objects are small, they are read synchronously */
+	if (!tmp->obj || !fileBase->ops->async_read)
+		return NULL;
+	return _starpu_disk_log_request(fileBase, fileBase->ops->async_read(fileBase->base, tmp->obj, buf, offset, size));
+}
+
+static void *starpu_disk_log_async_write(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	struct _starpu_disk_log_obj *tmp = obj;
+
+	/* Logged objects only get copied to the buffer most often */
+	if (!tmp->obj || !fileBase->ops->async_write)
+		return NULL;
+	return _starpu_disk_log_request(fileBase, fileBase->ops->async_write(fileBase->base, tmp->obj, buf, offset, size));
+}
+
+static void starpu_disk_log_wait_request(void *async_channel)
+{
+	struct _starpu_disk_log_request *req = async_channel;
+	req->base->ops->wait_request(req->event);
+}
+
+static int starpu_disk_log_test_request(void *async_channel)
+{
+	struct _starpu_disk_log_request *req = async_channel;
+	return req->base->ops->test_request(req->event);
+}
+
+static void starpu_disk_log_free_request(void *async_channel)
+{
+	struct _starpu_disk_log_request *req = async_channel;
+	req->base->ops->free_request(req->event);
+	free(req);
+}
+
+static int starpu_disk_log_full_read(void *base, void *obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	struct _starpu_disk_log_obj *tmp = obj;
+	int ret;
+
+	if (tmp->obj)
+		return fileBase->ops->full_read(fileBase->base, tmp->obj, ptr, size, dst_node);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&fileBase->mutex);
+	*size = tmp->size;
+	ret = _starpu_malloc_flags_on_node(dst_node, ptr, *size, 0);
+	if (ret == 0)
+		ret = _starpu_disk_log_read_logged(fileBase, tmp, *ptr, 0, *size, 0);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+	return ret;
+}
+
+static int starpu_disk_log_full_write(void *base, void *obj, void *ptr, size_t size)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+	struct _starpu_disk_log_obj *tmp = obj;
+	int ret;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&fileBase->mutex);
+	if (!tmp->obj && (size > fileBase->max_size || _starpu_disk_log_reserve(fileBase, tmp, size)))
+	{
+		/* Packed data got too large for the log, or there is no room
+		 * left for it */
+		void *inner = fileBase->ops->alloc(fileBase->base, size);
+		if (!inner)
+		{
+			STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+			return -ENOSPC;
+		}
+		_starpu_disk_log_drop(fileBase, tmp);
+		_starpu_disk_log_unreserve(fileBase, tmp);
+		tmp->obj = inner;
+	}
+
+	tmp->size = size;
+	if (tmp->obj)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+		return fileBase->ops->full_write(fileBase->base, tmp->obj, ptr, size);
+	}
+
+	fileBase->nwrites++;
+	fileBase->bytes_logged += size;
+	ret = _starpu_disk_log_append(fileBase, tmp, ptr, size);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+	return ret;
+}
+
+static void starpu_disk_log_unplug(void *base)
+{
+	struct _starpu_disk_log_base *fileBase = base;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&fileBase->mutex);
+	fileBase->stop = 1;
+	STARPU_PTHREAD_COND_SIGNAL(&fileBase->cond);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+	STARPU_PTHREAD_JOIN(fileBase->thread, NULL);
+
+	if (fileBase->stats && fileBase->nwrites)
+		_STARPU_DISP("Log of disk node %u: %lu writes of %.2f MiB in total, written with %lu writes of %.2f MiB on average, %lu segments of %.2f MiB used, %lu compacted, %.2f MiB moved\n",
+			     fileBase->node, fileBase->nwrites,
+			     (double) fileBase->bytes_logged / (1024*1024),
+			     fileBase->nflushes,
+			     fileBase->nflushes ? (double) fileBase->bytes_flushed / fileBase->nflushes / (1024*1024) : 0.,
+			     fileBase->nsegments,
+			     (double) fileBase->segment_size / (1024*1024),
+			     fileBase->ncompacted,
+			     (double) fileBase->bytes_compacted / (1024*1024));
+
+	while (!_starpu_disk_log_segment_list_empty(&fileBase->segments))
+	{
+		struct _starpu_disk_log_segment *segment = _starpu_disk_log_segment_list_pop_front(&fileBase->segments);
+		fileBase->ops->free(fileBase->base, segment->obj, fileBase->segment_size);
+		_starpu_disk_log_segment_delete(segment);
+	}
+	while (!_starpu_disk_log_segment_list_empty(&fileBase->free_segments))
+	{
+		struct _starpu_disk_log_segment *segment = _starpu_disk_log_segment_list_pop_front(&fileBase->free_segments);
+		fileBase->ops->free(fileBase->base, segment->obj, fileBase->segment_size);
+		_starpu_disk_log_segment_delete(segment);
+	}
+	if (fileBase->current)
+	{
+		fileBase->ops->free(fileBase->base, fileBase->current->obj, fileBase->segment_size);
+		_starpu_disk_log_segment_delete(fileBase->current);
+	}
+	_starpu_free_flags_on_node(STARPU_MAIN_RAM, fileBase->buffer, LOG_BUFFER_SIZE, 0);
+
+	fileBase->ops->unplug(fileBase->base);
+	STARPU_PTHREAD_COND_DESTROY(&fileBase->cond);
+	STARPU_PTHREAD_MUTEX_DESTROY(&fileBase->mutex);
+	free(fileBase);
+}
+
+void *_starpu_disk_log_plug(struct starpu_disk_ops *ops, void *base, unsigned node)
+{
+	struct _starpu_disk_log_base *fileBase;
+
+	_STARPU_CALLOC(fileBase, 1, sizeof(*fileBase));
+	fileBase->ops = ops;
+	fileBase->base = base;
+	fileBase->node = node;
+	fileBase->page_size = getpagesize();
+	fileBase->segment_size = (size_t) starpu_getenv_number_default("STARPU_DISK_LOG_SEGMENT_SIZE", 64) * 1024 * 1024;
+	fileBase->max_size = starpu_getenv_number_default("STARPU_DISK_LOG_MAX_SIZE", 1024*1024);
+	fileBase->stats = starpu_getenv_number_default("STARPU_DISK_LOG_STATS", 0);
+
+	/* Objects have to fit in the buffer */
+	if (fileBase->segment_size < LOG_BUFFER_SIZE)
+		fileBase->segment_size = LOG_BUFFER_SIZE;
+	if (_starpu_disk_log_padded(fileBase, fileBase->max_size) > LOG_BUFFER_SIZE)
+		fileBase->max_size = LOG_BUFFER_SIZE;
+
+	if (_starpu_malloc_flags_on_node(STARPU_MAIN_RAM, &fileBase->buffer, LOG_BUFFER_SIZE, 0))
+	{
+		_STARPU_DISP("Warning: not enough memory for the log buffer of disk node %u, not logging its writes\n", node);
+		free(fileBase);
+		return NULL;
+	}
+
+	STARPU_PTHREAD_MUTEX_INIT(&fileBase->mutex, NULL);
+	STARPU_PTHREAD_COND_INIT(&fileBase->cond, NULL);
+	_starpu_disk_log_segment_list_init(&fileBase->segments);
+	_starpu_disk_log_segment_list_init(&fileBase->free_segments);
+	/* Segments are then allocated along the reservations */
+	fileBase->current = NULL;
+
+	STARPU_PTHREAD_CREATE(&fileBase->thread, NULL, _starpu_disk_log_compact, fileBase);
+	return fileBase;
+}
+
+/* Only used through _starpu_disk_log_plug, once the wrapped backend has been
+ * plugged and its bandwidth measured */
+struct starpu_disk_ops _starpu_disk_log_ops =
+{
+	.alloc = starpu_disk_log_alloc,
+	.free = starpu_disk_log_free,
+	.open = starpu_disk_log_open,
+	.close = starpu_disk_log_close,
+	.read = starpu_disk_log_read,
+	.write = starpu_disk_log_write,
+	.unplug = starpu_disk_log_unplug,
+	/* Copies between disks go through main memory */
+	.copy = NULL,
+	.async_read = starpu_disk_log_async_read,
+	.async_write = starpu_disk_log_async_write,
+	.wait_request = starpu_disk_log_wait_request,
+	.test_request = starpu_disk_log_test_request,
+	.free_request = starpu_disk_log_free_request,
+	.full_read = starpu_disk_log_full_read,
+	.full_write = starpu_disk_log_full_write
+};
@@ -77,5 +77,7 @@ struct starpu_disk_ops starpu_disk_unistd_ops =
 	.free_request = starpu_unistd_global_free_request,
 #endif
 	.full_read = starpu_unistd_global_full_read,
-	.full_write = starpu_unistd_global_full_write
+	.full_write = starpu_unistd_global_full_write,
+	.map = starpu_unistd_global_map,
+	.unmap = starpu_unistd_global_unmap,
 };
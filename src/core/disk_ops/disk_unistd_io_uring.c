@@ -0,0 +1,620 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <common/config.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <starpu.h>
+#include <core/disk.h>
+#include <core/perfmodel/perfmodel.h>
+#include <core/disk_ops/unistd/disk_unistd_global.h>
+#include <datawizard/copy_driver.h>
+#include <datawizard/data_request.h>
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_MMAP) && defined(__NR_io_uring_setup)
+#define STARPU_IO_URING 1
+#include <sys/mman.h>
+#include <linux/io_uring.h>
+#endif
+
+/* ------------------- use io_uring to write on disk -------------------  */
+
+/*
+ * Objects are the unistd ones, the reads and writes are however submitted
+ * through an io_uring ring per disk. Asynchronous requests are only queued in
+ * the submission ring, and submitted by batches, either when enough of them
+ * are queued, or when the disk driver progression tests or waits for a
+ * request. Completions are polled from the completion ring without any system
+ * call.
+ */
+
+/* Number of files registered in the ring, i.e. files which the kernel does
+ * not need to look up on each request */
+#define STARPU_IO_URING_FILES 64
+
+struct starpu_io_uring_obj
+{
+	/* Must be first, the unistd layer frees the whole object */
+	struct starpu_unistd_global_obj unistd;
+	/* Index of the file in the registered files of the ring, or -1 */
+	int slot;
+};
+
+struct starpu_io_uring_base
+{
+	/* Base of the unistd layer */
+	void *unistd;
+#ifdef STARPU_IO_URING
+	/* Protects the rings, the registered files, and the requests state */
+	starpu_pthread_mutex_t mutex;
+	int fd;
+
+	void *sq_ptr;
+	size_t sq_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned sq_entries;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	void *cq_ptr;
+	size_t cq_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	/* Number of requests queued in the submission ring but not submitted yet */
+	unsigned queued;
+	/* Number of requests to queue before submitting them */
+	unsigned batch;
+
+	int files_registered;
+	struct starpu_io_uring_obj *files[STARPU_IO_URING_FILES];
+#endif
+};
+
+#ifdef STARPU_IO_URING
+struct starpu_io_uring_request
+{
+	struct starpu_io_uring_base *base;
+	struct starpu_io_uring_obj *obj;
+	/* Descriptor reopened for this request, or -1 */
+	int fd;
+	unsigned char opcode;
+	char *buf;
+	off_t offset;
+	/* What remains to be transferred */
+	size_t len;
+	int finished;
+};
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static int starpu_io_uring_init(struct starpu_io_uring_base *base)
+{
+	struct io_uring_params p;
+	unsigned nb_event = MAX_PENDING_REQUESTS_PER_NODE + MAX_PENDING_PREFETCH_REQUESTS_PER_NODE + MAX_PENDING_IDLE_REQUESTS_PER_NODE;
+	int fds[STARPU_IO_URING_FILES];
+	unsigned i;
+	char *ptr;
+
+	memset(&p, 0, sizeof(p));
+	base->fd = io_uring_setup(nb_event, &p);
+	if (base->fd < 0)
+	{
+		_STARPU_DISP("Could not create io_uring ring: %s, falling back to synchronous accesses\n", strerror(errno));
+		return -1;
+	}
+	/* IORING_OP_READ and IORING_OP_WRITE came along IORING_FEAT_RW_CUR_POS */
+	if (!(p.features & IORING_FEAT_NODROP) || !(p.features & IORING_FEAT_RW_CUR_POS))
+	{
+		_STARPU_DISP("io_uring is too old, falling back to synchronous accesses\n");
+		close(base->fd);
+		base->fd = -1;
+		return -1;
+	}
+
+	base->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	base->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (base->cq_size > base->sq_size)
+			base->sq_size = base->cq_size;
+		base->cq_size = base->sq_size;
+	}
+
+	base->sq_ptr = mmap(NULL, base->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, base->fd, IORING_OFF_SQ_RING);
+	STARPU_ASSERT_MSG(base->sq_ptr != MAP_FAILED, "Could not map io_uring submission ring: %s", strerror(errno));
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		base->cq_ptr = base->sq_ptr;
+	else
+	{
+		base->cq_ptr = mmap(NULL, base->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, base->fd, IORING_OFF_CQ_RING);
+		STARPU_ASSERT_MSG(base->cq_ptr != MAP_FAILED, "Could not map io_uring completion ring: %s", strerror(errno));
+	}
+	base->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	base->sqes = mmap(NULL, base->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, base->fd, IORING_OFF_SQES);
+	STARPU_ASSERT_MSG(base->sqes != MAP_FAILED, "Could not map io_uring submission entries: %s", strerror(errno));
+
+	ptr = base->sq_ptr;
+	base->sq_head = (unsigned *) (ptr + p.sq_off.head);
+	base->sq_tail = (unsigned *) (ptr + p.sq_off.tail);
+	base->sq_mask = (unsigned *) (ptr + p.sq_off.ring_mask);
+	base->sq_array = (unsigned *) (ptr + p.sq_off.array);
+	base->sq_entries = p.sq_entries;
+
+	ptr = base->cq_ptr;
+	base->cq_head = (unsigned *) (ptr + p.cq_off.head);
+	base->cq_tail = (unsigned *) (ptr + p.cq_off.tail);
+	base->cq_mask = (unsigned *) (ptr + p.cq_off.ring_mask);
+	base->cqes = (struct io_uring_cqe *) (ptr + p.cq_off.cqes);
+
+	base->queued = 0;
+	base->batch = starpu_getenv_number_default("STARPU_DISK_IO_URING_BATCH", 8);
+	if (base->batch < 1)
+		base->batch = 1;
+	if (base->batch > base->sq_entries)
+		base->batch = base->sq_entries;
+
+	/* Reserve empty slots for the files, which get filled on allocation */
+	for (i = 0; i < STARPU_IO_URING_FILES; i++)
+	{
+		fds[i] = -1;
+		base->files[i] = NULL;
+	}
+	base->files_registered = io_uring_register(base->fd, IORING_REGISTER_FILES, fds, STARPU_IO_URING_FILES) == 0;
+
+	STARPU_PTHREAD_MUTEX_INIT(&base->mutex, NULL);
+	return 0;
+}
+
+static void starpu_io_uring_deinit(struct starpu_io_uring_base *base)
+{
+	if (base->fd < 0)
+		return;
+
+	STARPU_ASSERT(base->queued == 0);
+	STARPU_PTHREAD_MUTEX_DESTROY(&base->mutex);
+	munmap(base->sqes, base->sqes_size);
+	if (base->cq_ptr != base->sq_ptr)
+		munmap(base->cq_ptr, base->cq_size);
+	munmap(base->sq_ptr, base->sq_size);
+	close(base->fd);
+}
+
+/* Set the registered file SLOT of the ring to DESCRIPTOR */
+static void starpu_io_uring_update_file(struct starpu_io_uring_base *base, int slot, int descriptor)
+{
+	struct io_uring_files_update up;
+	int ret;
+
+	memset(&up, 0, sizeof(up));
+	up.offset = slot;
+	up.fds = (uintptr_t) &descriptor;
+	ret = io_uring_register(base->fd, IORING_REGISTER_FILES_UPDATE, &up, 1);
+	STARPU_ASSERT_MSG(ret == 1, "Could not update io_uring registered file: %s", strerror(errno));
+}
+
+static void starpu_io_uring_register_file(struct starpu_io_uring_base *base, struct starpu_io_uring_obj *obj)
+{
+	int i;
+
+	obj->slot = -1;
+	if (base->fd < 0 || !base->files_registered || obj->unistd.descriptor < 0)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	for (i = 0; i < STARPU_IO_URING_FILES; i++)
+		if (!base->files[i])
+		{
+			base->files[i] = obj;
+			obj->slot = i;
+			starpu_io_uring_update_file(base, i, obj->unistd.descriptor);
+			break;
+		}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+}
+
+static void starpu_io_uring_unregister_file(struct starpu_io_uring_base *base, struct starpu_io_uring_obj *obj)
+{
+	if (obj->slot < 0)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	starpu_io_uring_update_file(base, obj->slot, -1);
+	base->files[obj->slot] = NULL;
+	obj->slot = -1;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+}
+
+/* Submit the queued requests, with the mutex held */
+static void starpu_io_uring_submit(struct starpu_io_uring_base *base)
+{
+	while (base->queued)
+	{
+		int ret = io_uring_enter(base->fd, base->queued, 0, 0);
+		if (ret < 0)
+		{
+			STARPU_ASSERT_MSG(errno == EINTR || errno == EAGAIN || errno == EBUSY, "io_uring_enter failed: %s", strerror(errno));
+			continue;
+		}
+		STARPU_ASSERT((unsigned) ret <= base->queued);
+		base->queued -= ret;
+	}
+}
+
+/* Put the remainder of REQ in the submission ring, with the mutex held */
+static void starpu_io_uring_queue(struct starpu_io_uring_base *base, struct starpu_io_uring_request *req)
+{
+	unsigned tail = *base->sq_tail;
+	unsigned index;
+	struct io_uring_sqe *sqe;
+
+	/* The kernel consumes the entries on submission */
+	STARPU_RMB();
+	if (tail - *(volatile unsigned *) base->sq_head == base->sq_entries)
+		starpu_io_uring_submit(base);
+
+	index = tail & *base->sq_mask;
+	sqe = &base->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = req->opcode;
+	if (req->obj->slot >= 0 && req->fd < 0)
+	{
+		sqe->fd = req->obj->slot;
+		sqe->flags = IOSQE_FIXED_FILE;
+	}
+	else
+		sqe->fd = req->fd >= 0 ? req->fd : req->obj->unistd.descriptor;
+	sqe->addr = (uintptr_t) req->buf;
+	sqe->len = req->len;
+	sqe->off = req->offset;
+	sqe->user_data = (uintptr_t) req;
+	base->sq_array[index] = index;
+
+	/* Make the entry visible before the tail */
+	STARPU_WMB();
+	*(volatile unsigned *) base->sq_tail = tail + 1;
+
+	if (++base->queued >= base->batch)
+		starpu_io_uring_submit(base);
+}
+
+/* Process the available completions, with the mutex held */
+static void starpu_io_uring_reap(struct starpu_io_uring_base *base)
+{
+	unsigned head = *base->cq_head;
+	unsigned tail;
+
+	tail = *(volatile unsigned *) base->cq_tail;
+	STARPU_RMB();
+
+	for ( ; head != tail; head++)
+	{
+		struct io_uring_cqe *cqe = &base->cqes[head & *base->cq_mask];
+		struct starpu_io_uring_request *req = (struct starpu_io_uring_request *) (uintptr_t) cqe->user_data;
+		int res = cqe->res;
+
+		if (res == -EINTR || res == -EAGAIN)
+			/* Just retry */
+			starpu_io_uring_queue(base, req);
+		else
+		{
+			STARPU_ASSERT_MSG(res >= 0, "io_uring request failed: %s", strerror(-res));
+			STARPU_ASSERT_MSG(res > 0 || req->len == 0, "io_uring request was truncated");
+			if ((size_t) res < req->len)
+			{
+				/* Short transfer, submit the remainder */
+				req->buf += res;
+				req->offset += res;
+				req->len -= res;
+				starpu_io_uring_queue(base, req);
+			}
+			else
+				req->finished = 1;
+		}
+	}
+
+	/* Release the entries to the kernel */
+	STARPU_SYNCHRONIZE();
+	*(volatile unsigned *) base->cq_head = head;
+}
+
+static void *starpu_unistd_io_uring_async(void *base, void *obj, void *buf, off_t offset, size_t size, unsigned char opcode)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	struct starpu_io_uring_obj *tmp = (struct starpu_io_uring_obj *) obj;
+	struct starpu_io_uring_request *req;
+
+	if (fileBase->fd < 0)
+		return NULL;
+
+#ifdef STARPU_LINUX_SYS
+	/* on Linux, read() (and similar operations) will transfer at most 0x7ffff000 bytes, see read(2) */
+	if (size > 0x7ffff000)
+		return NULL;
+#endif
+
+	_STARPU_MALLOC(req, sizeof(*req));
+	req->base = fileBase;
+	req->obj = tmp;
+	req->fd = -1;
+	if (tmp->unistd.descriptor < 0)
+	{
+		req->fd = open(tmp->unistd.path, tmp->unistd.flags);
+		STARPU_ASSERT_MSG(req->fd >= 0, "Reopening file %s failed: errno %d", tmp->unistd.path, errno);
+	}
+	req->opcode = opcode;
+	req->buf = buf;
+	req->offset = offset;
+	req->len = size;
+	req->finished = 0;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&fileBase->mutex);
+	starpu_io_uring_queue(fileBase, req);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+
+	return req;
+}
+
+static void *starpu_unistd_io_uring_async_read(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	return starpu_unistd_io_uring_async(base, obj, buf, offset, size, IORING_OP_READ);
+}
+
+static void *starpu_unistd_io_uring_async_write(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	return starpu_unistd_io_uring_async(base, obj, buf, offset, size, IORING_OP_WRITE);
+}
+
+static int starpu_unistd_io_uring_test_request(void *async_channel)
+{
+	struct starpu_io_uring_request *req = async_channel;
+	struct starpu_io_uring_base *base = req->base;
+	int finished;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	if (!req->finished)
+	{
+		/* Submit whatever is still pending in the current batch */
+		starpu_io_uring_submit(base);
+		starpu_io_uring_reap(base);
+	}
+	finished = req->finished;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+
+	return finished;
+}
+
+static void starpu_unistd_io_uring_wait_request(void *async_channel)
+{
+	struct starpu_io_uring_request *req = async_channel;
+	struct starpu_io_uring_base *base = req->base;
+
+	/* Keep the mutex while sleeping, so that nobody else reaps our
+	 * completion while we are waiting for it */
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	starpu_io_uring_submit(base);
+	starpu_io_uring_reap(base);
+	while (!req->finished)
+	{
+		int ret = io_uring_enter(base->fd, base->queued, 1, IORING_ENTER_GETEVENTS);
+		if (ret < 0)
+			STARPU_ASSERT_MSG(errno == EINTR || errno == EAGAIN || errno == EBUSY, "io_uring_enter failed: %s", strerror(errno));
+		else
+			base->queued -= ret;
+		starpu_io_uring_reap(base);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+}
+
+static void starpu_unistd_io_uring_free_request(void *async_channel)
+{
+	struct starpu_io_uring_request *req = async_channel;
+
+	if (req->fd >= 0)
+		close(req->fd);
+	free(req);
+}
+#endif
+
+/* allocation memory on disk */
+static void *starpu_unistd_io_uring_alloc(void *base, size_t size)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	struct starpu_io_uring_obj *obj;
+
+	_STARPU_MALLOC(obj, sizeof(*obj));
+	obj->unistd.flags = O_RDWR | O_BINARY;
+	obj->slot = -1;
+	if (!starpu_unistd_global_alloc(&obj->unistd, fileBase->unistd, size))
+		return NULL;
+#ifdef STARPU_IO_URING
+	starpu_io_uring_register_file(fileBase, obj);
+#endif
+	return obj;
+}
+
+/* free memory on disk */
+static void starpu_unistd_io_uring_free(void *base, void *obj, size_t size)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+
+#ifdef STARPU_IO_URING
+	starpu_io_uring_unregister_file(fileBase, obj);
+#endif
+	starpu_unistd_global_free(fileBase->unistd, obj, size);
+}
+
+/* open an existing memory on disk */
+static void *starpu_unistd_io_uring_open(void *base, void *pos, size_t size)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	struct starpu_io_uring_obj *obj;
+
+	_STARPU_MALLOC(obj, sizeof(*obj));
+	obj->unistd.flags = O_RDWR | O_BINARY;
+	obj->slot = -1;
+	if (!starpu_unistd_global_open(&obj->unistd, fileBase->unistd, pos, size))
+		return NULL;
+#ifdef STARPU_IO_URING
+	starpu_io_uring_register_file(fileBase, obj);
+#endif
+	return obj;
+}
+
+/* free memory without delete it */
+static void starpu_unistd_io_uring_close(void *base, void *obj, size_t size)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+
+#ifdef STARPU_IO_URING
+	starpu_io_uring_unregister_file(fileBase, obj);
+#endif
+	starpu_unistd_global_close(fileBase->unistd, obj, size);
+}
+
+static int starpu_unistd_io_uring_read(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	return starpu_unistd_global_read(fileBase->unistd, obj, buf, offset, size);
+}
+
+static int starpu_unistd_io_uring_write(void *base, void *obj, const void *buf, off_t offset, size_t size)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	return starpu_unistd_global_write(fileBase->unistd, obj, buf, offset, size);
+}
+
+static int starpu_unistd_io_uring_full_read(void *base, void *obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	return starpu_unistd_global_full_read(fileBase->unistd, obj, ptr, size, dst_node);
+}
+
+static int starpu_unistd_io_uring_full_write(void *base, void *obj, void *ptr, size_t size)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	return starpu_unistd_global_full_write(fileBase->unistd, obj, ptr, size);
+}
+
+#ifdef HAVE_MMAP
+static void *starpu_unistd_io_uring_map(void *base, void *obj, off_t offset, size_t size)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	return starpu_unistd_global_map(fileBase->unistd, obj, offset, size);
+}
+
+static void starpu_unistd_io_uring_unmap(void *base, void *obj, void *addr, off_t offset, size_t size)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	starpu_unistd_global_unmap(fileBase->unistd, obj, addr, offset, size);
+}
+#endif
+
+#ifdef STARPU_UNISTD_USE_COPY
+static void *starpu_unistd_io_uring_copy(void *base_src, void *obj_src, off_t offset_src, void *base_dst, void *obj_dst, off_t offset_dst, size_t size)
+{
+	struct starpu_io_uring_base *fileBase_src = (struct starpu_io_uring_base *) base_src;
+	struct starpu_io_uring_base *fileBase_dst = (struct starpu_io_uring_base *) base_dst;
+	return starpu_unistd_global_copy(fileBase_src->unistd, obj_src, offset_src, fileBase_dst->unistd, obj_dst, offset_dst, size);
+}
+#endif
+
+/* create a new copy of parameter == base */
+static void *starpu_unistd_io_uring_plug(void *parameter, starpu_ssize_t size)
+{
+	struct starpu_io_uring_base *base;
+
+	_STARPU_CALLOC(base, 1, sizeof(*base));
+	base->unistd = starpu_unistd_global_plug(parameter, size);
+#ifdef STARPU_IO_URING
+	starpu_io_uring_init(base);
+#endif
+	return base;
+}
+
+/* free memory allocated for the base */
+static void starpu_unistd_io_uring_unplug(void *base)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+
+#ifdef STARPU_IO_URING
+	starpu_io_uring_deinit(fileBase);
+#endif
+	starpu_unistd_global_unplug(fileBase->unistd);
+	free(fileBase);
+}
+
+static int starpu_unistd_io_uring_bandwidth(unsigned node, void *base)
+{
+	struct starpu_io_uring_base *fileBase = (struct starpu_io_uring_base *) base;
+	return _starpu_get_unistd_global_bandwidth_between_disk_and_main_ram(node, fileBase->unistd);
+}
+
+struct starpu_disk_ops starpu_disk_unistd_io_uring_ops =
+{
+	.alloc = starpu_unistd_io_uring_alloc,
+	.free = starpu_unistd_io_uring_free,
+	.open = starpu_unistd_io_uring_open,
+	.close = starpu_unistd_io_uring_close,
+	.read = starpu_unistd_io_uring_read,
+	.write = starpu_unistd_io_uring_write,
+	.plug = starpu_unistd_io_uring_plug,
+	.unplug = starpu_unistd_io_uring_unplug,
+#ifdef STARPU_UNISTD_USE_COPY
+	.copy = starpu_unistd_io_uring_copy,
+#else
+	.copy = NULL,
+#endif
+	.bandwidth = starpu_unistd_io_uring_bandwidth,
+#ifdef STARPU_IO_URING
+	.async_read = starpu_unistd_io_uring_async_read,
+	.async_write = starpu_unistd_io_uring_async_write,
+	.wait_request = starpu_unistd_io_uring_wait_request,
+	.test_request = starpu_unistd_io_uring_test_request,
+	.free_request = starpu_unistd_io_uring_free_request,
+#endif
+#ifdef HAVE_MMAP
+	.map = starpu_unistd_io_uring_map,
+	.unmap = starpu_unistd_io_uring_unmap,
+#endif
+	.full_read = starpu_unistd_io_uring_full_read,
+	.full_write = starpu_unistd_io_uring_full_write
+};
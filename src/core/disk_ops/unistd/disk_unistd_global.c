@@ -30,6 +30,9 @@
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <starpu.h>
 #include <core/disk.h>
 #include <core/perfmodel/perfmodel.h>
@@ -278,6 +281,42 @@ void starpu_unistd_global_close(void *base STARPU_ATTRIBUTE_UNUSED, void *obj, s
 	_starpu_unistd_fini(tmp);
 }
 
+/* map the memory disk in main memory */
+void *starpu_unistd_global_map(void *base STARPU_ATTRIBUTE_UNUSED, void *obj STARPU_ATTRIBUTE_UNUSED, off_t offset STARPU_ATTRIBUTE_UNUSED, size_t size STARPU_ATTRIBUTE_UNUSED)
+{
+#ifdef HAVE_MMAP
+	struct starpu_unistd_global_obj *tmp = (struct starpu_unistd_global_obj *) obj;
+	off_t shift = offset % getpagesize();
+	int fd = tmp->descriptor;
+	void *addr;
+
+	if (fd < 0)
+		fd = _starpu_unistd_reopen(tmp);
+	addr = mmap(NULL, size + shift, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset - shift);
+	if (tmp->descriptor < 0)
+		/* The mapping keeps the file referenced */
+		_starpu_unistd_reclose(fd);
+	if (addr == MAP_FAILED)
+		return NULL;
+#ifdef MADV_WILLNEED
+	/* This is requested on fetch or prefetch, let the page cache start
+	 * reading the data in the background */
+	madvise(addr, size + shift, MADV_WILLNEED);
+#endif
+	return (char *) addr + shift;
+#else
+	return NULL;
+#endif
+}
+
+void starpu_unistd_global_unmap(void *base STARPU_ATTRIBUTE_UNUSED, void *obj STARPU_ATTRIBUTE_UNUSED, void *addr STARPU_ATTRIBUTE_UNUSED, off_t offset STARPU_ATTRIBUTE_UNUSED, size_t size STARPU_ATTRIBUTE_UNUSED)
+{
+#ifdef HAVE_MMAP
+	off_t shift = offset % getpagesize();
+	munmap((char *) addr - shift, size + shift);
+#endif
+}
+
 /* read the memory disk */
 int starpu_unistd_global_read(void *base STARPU_ATTRIBUTE_UNUSED, void *obj, void *buf, off_t offset, size_t size)
 {
@@ -371,6 +371,9 @@ void _starpu_handle_job_termination(struct _starpu_job *j)
 #endif
 		;
 
+	if (!continuation && task->deadline != 0.)
+		_starpu_task_deadline_terminated(task);
+
 	if (!continuation)
 	{
 		void (*epilogue_callback)(void *) = task->epilogue_callback_func;
@@ -159,6 +159,14 @@ struct _starpu_job
 	double cumulated_energy_consumed;
 #endif
 
+	/** When the task became ready, to record the ready-to-start scheduling
+	 * latency, see STARPU_SCHED_LATENCY */
+	double ready_time;
+
+	/** How many times a lookahead pop took a task queued after this one,
+	 * see STARPU_SCHED_LOCALITY_LOOKAHEAD */
+	unsigned nskipped;
+
 	/** The value of the footprint that identifies the job may be stored in
 	 * this structure. */
 	uint32_t footprint;
@@ -179,6 +187,11 @@ struct _starpu_job
 	 * so we need a flag to differentiate them from "normal" tasks. */
 	unsigned reduction_task:1;
 
+	/** Whether the driver timed the execution of the task for the fair
+	 * sharing of workers between contexts, which may get enabled while
+	 * the task is running */
+	unsigned fair_share_timed:1;
+
 	/** The implementation associated to the job */
 	unsigned nimpl;
 
@@ -198,6 +211,11 @@ struct _starpu_job
 
 	struct bound_task *bound_task;
 
+	/** The entry of the read-ahead window of the worker that the task was
+	 * pushed to, when its data has to be read from the disk, see
+	 * datawizard/readahead.c. Protected by the read-ahead mutex. */
+	struct _starpu_readahead *readahead;
+
 	/** Parallel workers may have to synchronize before/after the execution of a parallel task. */
 	starpu_pthread_barrier_t before_work_barrier;
 	starpu_pthread_barrier_t after_work_barrier;
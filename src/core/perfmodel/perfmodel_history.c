@@ -55,6 +55,15 @@ static char ignore_devid[STARPU_NARCH];
  * consider that calibration will provide a value good enough for scheduling */
 unsigned _starpu_calibration_minimum;
 
+/* Whether to explore the implementations which are not calibrated enough
+ * according to an optimistic estimation, instead of forcing calibration */
+static unsigned calibration_bandit;
+
+/* With calibration_bandit, how many measurements in a row too far from the
+ * average of a calibrated implementation make us consider that its duration
+ * has drifted, and explore the implementations again */
+#define BANDIT_DRIFT_NERROR 3
+
 struct starpu_perfmodel_history_table
 {
 	UT_hash_handle hh;
@@ -115,6 +124,7 @@ void _starpu_initialize_registered_performance_models(void)
 	current_arch_comb = 0;
 	historymaxerror = starpu_getenv_number_default("STARPU_HISTORY_MAX_ERROR", STARPU_HISTORYMAXERROR);
 	_starpu_calibration_minimum = starpu_getenv_number_default("STARPU_CALIBRATE_MINIMUM", 10);
+	calibration_bandit = starpu_getenv_number_default("STARPU_CALIBRATE_BANDIT", 0);
 
 	for (archtype = 0; archtype < STARPU_NARCH; archtype++)
 	{
@@ -1581,6 +1591,75 @@ void starpu_perfmodel_debugfilepath(struct starpu_perfmodel *model,
 	get_model_debug_path(model, archname, path, maxlen);
 }
 
+/* When an implementation was already measured on this arch for this
+ * footprint, but not enough to be considered calibrated, return an optimistic
+ * estimation of its duration, UCB1-style: the fewer measurements it has
+ * compared to all the implementations on this arch, the smaller the estimation.
+ * The schedulers thus keep running it only as long as it may be better than
+ * the others, and still try it again once in a while, as the other
+ * implementations get run.
+ *
+ * Return NAN if the implementation has to be calibrated the usual way.
+ *
+ * Must be called with model_rwlock held. */
+static double bandit_expected_perf(struct starpu_perfmodel *model, int comb, uint32_t key, struct starpu_perfmodel_history_entry *entry)
+{
+	struct starpu_perfmodel_history_table *elt;
+	unsigned nsample = 0;
+	unsigned impl;
+
+	if (!calibration_bandit || !entry || !entry->nsample || entry->nsample >= _starpu_calibration_minimum)
+		return NAN;
+
+	for (impl = 0; impl < STARPU_MAXIMPLEMENTATIONS; impl++)
+	{
+		if (!model->state->per_arch_is_set[comb] || !model->state->per_arch_is_set[comb][impl])
+			continue;
+		HASH_FIND_UINT32_T(model->state->per_arch[comb][impl].history, &key, elt);
+		if (elt && elt->history_entry)
+			nsample += elt->history_entry->nsample;
+	}
+
+	return entry->mean / (1. + sqrt(2. * log(nsample) / entry->nsample));
+}
+
+/* With STARPU_CALIBRATE_BANDIT, the duration of a calibrated implementation
+ * has drifted: restart its history from the latest measurement, and make the
+ * other implementations on this arch for this footprint look uncalibrated
+ * again, keeping their average, so that they get explored again.
+ *
+ * Must be called with model_rwlock held in write mode. */
+static void bandit_drift(struct starpu_perfmodel *model, int comb, uint32_t key, struct starpu_perfmodel_history_entry *entry, double measured, unsigned number)
+{
+	struct starpu_perfmodel_history_table *elt;
+	unsigned impl;
+
+	entry->sum = measured * number;
+	entry->sum2 = measured*measured * number;
+	entry->nsample = number;
+	entry->nerror = 0;
+	entry->mean = measured;
+	entry->deviation = 0.0;
+
+	for (impl = 0; impl < STARPU_MAXIMPLEMENTATIONS; impl++)
+	{
+		struct starpu_perfmodel_history_entry *other;
+
+		if (!model->state->per_arch_is_set[comb][impl])
+			continue;
+		HASH_FIND_UINT32_T(model->state->per_arch[comb][impl].history, &key, elt);
+		if (!elt || !elt->history_entry || elt->history_entry == entry)
+			continue;
+		other = elt->history_entry;
+		if (other->nsample <= 1)
+			continue;
+		other->sum2 /= other->nsample;
+		other->sum = other->mean;
+		other->nsample = 1;
+		other->nerror = 0;
+	}
+}
+
 double _starpu_regression_based_job_expected_perf(struct starpu_perfmodel *model, struct starpu_perfmodel_arch* arch, struct _starpu_job *j, unsigned nimpl)
 {
 	int comb;
@@ -1607,6 +1686,14 @@ double _starpu_regression_based_job_expected_perf(struct starpu_perfmodel *model
 
 	if (regmodel->valid && size >= regmodel->minx * 0.9 && size <= regmodel->maxx * 1.1)
 		exp = regmodel->alpha*pow((double)size, regmodel->beta);
+	else if (calibration_bandit)
+	{
+		uint32_t key = _starpu_compute_buffers_footprint(model, arch, nimpl, j);
+		struct starpu_perfmodel_history_table *entry;
+
+		HASH_FIND_UINT32_T(model->state->per_arch[comb][nimpl].history, &key, entry);
+		exp = bandit_expected_perf(model, comb, key, entry ? entry->history_entry : NULL);
+	}
 	STARPU_PTHREAD_RWLOCK_UNLOCK(&model->state->model_rwlock);
 
 docal:
@@ -1631,6 +1718,7 @@ double _starpu_non_linear_regression_based_job_expected_perf(struct starpu_perfm
 	size_t size = 0;
 	struct starpu_perfmodel_regression_model *regmodel;
 	struct starpu_perfmodel_history_table *entry = NULL;
+	double bandit = NAN;
 
 	comb = starpu_perfmodel_arch_comb_get(arch->ndevices, arch->devices);
 	if (comb == -1)
@@ -1662,6 +1750,7 @@ double _starpu_non_linear_regression_based_job_expected_perf(struct starpu_perfm
 
 		history = per_arch_model->history;
 		HASH_FIND_UINT32_T(history, &key, entry);
+		bandit = bandit_expected_perf(model, comb, key, entry ? entry->history_entry : NULL);
 		STARPU_PTHREAD_RWLOCK_UNLOCK(&model->state->model_rwlock);
 
 		/* Here helgrind would shout that this is unprotected access.
@@ -1670,6 +1759,8 @@ double _starpu_non_linear_regression_based_job_expected_perf(struct starpu_perfm
 
 		if (entry && entry->history_entry && entry->history_entry->nsample >= _starpu_calibration_minimum)
 			exp = entry->history_entry->mean;
+		else
+			exp = bandit;
 
 docal:
 		STARPU_HG_DISABLE_CHECKING(model->benchmarking);
@@ -1755,6 +1846,7 @@ double __starpu_history_based_job_expected_perf(struct starpu_perfmodel *model,
 	struct starpu_perfmodel_history_table *history, *elt;
 	uint32_t key;
 	double *data;
+	double bandit = NAN;
 
 	comb = starpu_perfmodel_arch_comb_get(arch->ndevices, arch->devices);
 	key = _starpu_compute_buffers_footprint(model, arch, nimpl, j);
@@ -1778,6 +1870,8 @@ double __starpu_history_based_job_expected_perf(struct starpu_perfmodel *model,
 	if (entry)
 		data = (double*) ((char*) entry + offset);
 	STARPU_ASSERT_MSG(!entry || *data >= 0, "entry=%p, entry data=%lf\n", entry, entry?*data:NAN);
+	if (offset == offsetof(struct starpu_perfmodel_history_entry, mean))
+		bandit = bandit_expected_perf(model, comb, key, entry);
 	STARPU_PTHREAD_RWLOCK_UNLOCK(&model->state->model_rwlock);
 
 	/* Here helgrind would shout that this is unprotected access.
@@ -1805,6 +1899,8 @@ double __starpu_history_based_job_expected_perf(struct starpu_perfmodel *model,
 			exp = *data;
 		}
 	}
+	if (isnan(exp))
+		exp = bandit;
 
 docal:
 #ifdef STARPU_SIMGRID
@@ -1959,8 +2055,13 @@ void _starpu_update_perfmodel_history(struct _starpu_job *j, struct starpu_perfm
 				{
 					entry->nerror+=number;
 
+					if (calibration_bandit && entry->nsample >= _starpu_calibration_minimum && entry->nerror >= BANDIT_DRIFT_NERROR)
+					{
+						/* Several measurements in a row far from the average, the duration has most probably drifted */
+						bandit_drift(model, comb, key, entry, measured, number);
+					}
 					/* More errors than measurements, we're most probably completely wrong, we flush out all the entries */
-					if (entry->nerror >= entry->nsample)
+					else if (entry->nerror >= entry->nsample)
 					{
 						char archname[STR_SHORT_LENGTH];
 						starpu_perfmodel_get_arch_name(arch, archname, sizeof(archname), impl);
@@ -1975,6 +2076,9 @@ void _starpu_update_perfmodel_history(struct _starpu_job *j, struct starpu_perfm
 				}
 				else
 				{
+					if (calibration_bandit)
+						/* Only count errors in a row */
+						entry->nerror = 0;
 					entry->sum += measured * number;
 					entry->sum2 += measured*measured * number;
 					entry->nsample += number;
@@ -20,6 +20,8 @@
 #include <core/sched_ctx.h>
 #include <common/utils.h>
 #include <stdarg.h>
+#include <float.h>
+#include <math.h>
 #include <core/task.h>
 #include <core/workers.h>
 
@@ -31,6 +33,12 @@ enum _starpu_ctx_change_op
 };
 static starpu_pthread_mutex_t sched_ctx_manag = STARPU_PTHREAD_MUTEX_INITIALIZER;
 static starpu_pthread_mutex_t finished_submit_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+static starpu_pthread_mutex_t fair_share_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+int _starpu_sched_ctx_fair_share;
+/* Worker time (in us) given to each context at each fair-share round, times its weight */
+static double fair_share_quantum;
+/* Context which was picked last, the round-robin restarts from it */
+static unsigned fair_share_last;
 static struct starpu_task stop_submission_task = STARPU_TASK_INITIALIZER;
 static starpu_pthread_key_t sched_ctx_key;
 static unsigned with_hypervisor = 0;
@@ -545,6 +553,7 @@ struct _starpu_sched_ctx* _starpu_create_sched_ctx(struct starpu_sched_policy *p
 	struct _starpu_sched_ctx *sched_ctx = &config->sched_ctxs[id];
 	STARPU_ASSERT(sched_ctx->do_schedule == 0);
 	sched_ctx->id = id;
+	_starpu_sched_latency_reset_ctx(id);
 
 	int nworkers = config->topology.nworkers;
 	int i;
@@ -595,6 +604,10 @@ struct _starpu_sched_ctx* _starpu_create_sched_ctx(struct starpu_sched_policy *p
 	sched_ctx->sms_end_idx = STARPU_NMAXSMS;
 	sched_ctx->nsms = nsms;
 	sched_ctx->stream_worker = -1;
+	sched_ctx->weight = 1.;
+	sched_ctx->deficit = 0.;
+	sched_ctx->consumed = 0.;
+	sched_ctx->nexecuted = 0;
 	memset(&sched_ctx->lock_write_owner, 0, sizeof(sched_ctx->lock_write_owner));
 	STARPU_PTHREAD_RWLOCK_INIT(&sched_ctx->rwlock, NULL);
 	if(nsms > 0)
@@ -1459,6 +1472,9 @@ void _starpu_init_all_sched_ctxs(struct _starpu_machine_config *config)
 	STARPU_PTHREAD_KEY_CREATE(&sched_ctx_key, NULL);
 	window_size = starpu_getenv_float_default("STARPU_WINDOW_TIME_SIZE", 0.0);
 	nobind = starpu_getenv_number("STARPU_WORKERS_NOBIND");
+	_starpu_sched_ctx_fair_share = starpu_getenv_number_default("STARPU_SCHED_CTX_FAIR_SHARE", 0);
+	fair_share_quantum = starpu_getenv_float_default("STARPU_SCHED_CTX_FAIR_SHARE_QUANTUM", 1000.);
+	fair_share_last = 0;
 
 	unsigned i;
 	for(i = 0; i <= STARPU_NMAX_SCHED_CTXS; i++)
@@ -2017,6 +2033,125 @@ unsigned starpu_sched_ctx_get_inheritor(unsigned sched_ctx_id)
 	return	sched_ctx->inheritor;
 }
 
+void starpu_sched_ctx_set_weight(unsigned sched_ctx_id, double weight)
+{
+	STARPU_ASSERT(sched_ctx_id < STARPU_NMAX_SCHED_CTXS);
+	STARPU_ASSERT_MSG(weight > 0., "the weight of a context must be positive");
+	struct _starpu_sched_ctx *sched_ctx = _starpu_get_sched_ctx_struct(sched_ctx_id);
+	sched_ctx->weight = weight;
+	_starpu_sched_ctx_fair_share = 1;
+}
+
+double starpu_sched_ctx_get_weight(unsigned sched_ctx_id)
+{
+	STARPU_ASSERT(sched_ctx_id < STARPU_NMAX_SCHED_CTXS);
+	struct _starpu_sched_ctx *sched_ctx = _starpu_get_sched_ctx_struct(sched_ctx_id);
+	return sched_ctx->weight;
+}
+
+double starpu_sched_ctx_get_consumed_time(unsigned sched_ctx_id)
+{
+	STARPU_ASSERT(sched_ctx_id < STARPU_NMAX_SCHED_CTXS);
+	struct _starpu_sched_ctx *sched_ctx = _starpu_get_sched_ctx_struct(sched_ctx_id);
+	return sched_ctx->consumed;
+}
+
+unsigned long starpu_sched_ctx_get_nexecuted_tasks(unsigned sched_ctx_id)
+{
+	STARPU_ASSERT(sched_ctx_id < STARPU_NMAX_SCHED_CTXS);
+	struct _starpu_sched_ctx *sched_ctx = _starpu_get_sched_ctx_struct(sched_ctx_id);
+	return sched_ctx->nexecuted;
+}
+
+void _starpu_sched_ctx_account_consumed(unsigned sched_ctx_id, double measured)
+{
+	struct _starpu_sched_ctx *sched_ctx = _starpu_get_sched_ctx_struct(sched_ctx_id);
+	_starpu_perf_counter_update_acc_double(&sched_ctx->consumed, measured);
+	(void) STARPU_ATOMIC_ADDL(&sched_ctx->nexecuted, 1);
+	if (_starpu_sched_ctx_fair_share)
+		_starpu_perf_counter_update_acc_double(&sched_ctx->deficit, -measured);
+}
+
+/* Weighted deficit round-robin: contexts are charged the worker time
+ * consumed by their tasks, and are given quantum * weight more at each
+ * round. We keep popping from the same context as long as it has some
+ * credit left, then switch to the next one which has some. Since the
+ * charge only happens at the end of the tasks, a context may overdraw by
+ * up to one task per worker, which is paid back in the next rounds. */
+struct _starpu_sched_ctx *_starpu_sched_ctx_fair_share_pick(struct _starpu_worker *worker)
+{
+	struct _starpu_sched_ctx *candidates[STARPU_NMAX_SCHED_CTXS];
+	struct _starpu_sched_ctx_list_iterator list_it;
+	struct _starpu_sched_ctx *sched_ctx = NULL;
+	unsigned ncandidates = 0, start = 0;
+	unsigned i;
+
+	_starpu_sched_ctx_list_iterator_init(worker->sched_ctx_list, &list_it);
+	while (_starpu_sched_ctx_list_iterator_has_next(&list_it))
+	{
+		struct _starpu_sched_ctx_elt *e = _starpu_sched_ctx_list_iterator_get_next(&list_it);
+		if (e->task_number > 0)
+			candidates[ncandidates++] = _starpu_get_sched_ctx_struct(e->sched_ctx);
+	}
+
+	if (ncandidates == 0)
+		return NULL;
+	if (ncandidates == 1)
+		/* Nobody to be fair with */
+		return candidates[0];
+
+	STARPU_PTHREAD_MUTEX_LOCK(&fair_share_mutex);
+
+	/* Restart from the context picked last */
+	for (i = 0; i < ncandidates; i++)
+		if (candidates[i]->id >= fair_share_last)
+		{
+			start = i;
+			break;
+		}
+
+	while (!sched_ctx)
+	{
+		double rounds = DBL_MAX;
+
+		for (i = 0; i < ncandidates; i++)
+		{
+			struct _starpu_sched_ctx *c = candidates[(start + i) % ncandidates];
+			if (c->deficit > 0.)
+			{
+				sched_ctx = c;
+				break;
+			}
+		}
+		if (sched_ctx)
+			break;
+
+		/* Nobody has credit left, give them as many rounds as
+		 * needed for at least one of them to have some */
+		for (i = 0; i < ncandidates; i++)
+		{
+			double quantum = fair_share_quantum * candidates[i]->weight;
+			double needed = floor(-candidates[i]->deficit / quantum) + 1.;
+			if (needed < rounds)
+				rounds = needed;
+		}
+		for (i = 0; i < ncandidates; i++)
+		{
+			double quantum = fair_share_quantum * candidates[i]->weight;
+			double credit = rounds * quantum;
+			/* Do not let contexts accumulate more than one quantum */
+			if (candidates[i]->deficit + credit > quantum)
+				credit = quantum - candidates[i]->deficit;
+			_starpu_perf_counter_update_acc_double(&candidates[i]->deficit, credit);
+		}
+	}
+
+	fair_share_last = sched_ctx->id;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&fair_share_mutex);
+
+	return sched_ctx;
+}
+
 unsigned starpu_sched_ctx_get_hierarchy_level(unsigned sched_ctx_id)
 {
 	STARPU_ASSERT(sched_ctx_id < STARPU_NMAX_SCHED_CTXS);
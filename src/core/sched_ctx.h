@@ -166,6 +166,16 @@ struct _starpu_sched_ctx
 
 	starpu_pthread_rwlock_t rwlock;
 	starpu_pthread_t lock_write_owner;
+
+	/** fair-share weight of the context, see starpu_sched_ctx_set_weight() */
+	double weight;
+	/** fair-share deficit: worker time (in us) that the context may still
+	 * consume before the other contexts get their turn */
+	double deficit;
+	/** worker time (in us) consumed by the tasks of the context, and
+	 * number of these tasks */
+	double consumed;
+	unsigned long nexecuted;
 };
 
 /** per-worker list of deferred ctx_change ops */
@@ -239,6 +249,18 @@ int _starpu_workers_able_to_execute_task(struct starpu_task *task, struct _starp
 unsigned _starpu_sched_ctx_allow_hypervisor(unsigned sched_ctx_id);
 
 struct starpu_perfmodel_arch * _starpu_sched_ctx_get_perf_archtype(unsigned sched_ctx);
+
+/** Whether workers shared between contexts pop from them in proportion of
+ * their weights, see STARPU_SCHED_CTX_FAIR_SHARE */
+extern int _starpu_sched_ctx_fair_share;
+
+/** Account \p measured us of worker time to the context \p sched_ctx_id */
+void _starpu_sched_ctx_account_consumed(unsigned sched_ctx_id, double measured);
+
+/** Pick, among the contexts of \p worker which have tasks for it, the one it
+ * should pop from according to the weighted deficit round-robin, or return
+ * NULL if none of them have tasks */
+struct _starpu_sched_ctx *_starpu_sched_ctx_fair_share_pick(struct _starpu_worker *worker);
 #ifdef STARPU_USE_SC_HYPERVISOR
 /** Notifies the hypervisor that a tasks was poped from the workers' list */
 void _starpu_sched_ctx_post_exec_task_cb(int workerid, struct starpu_task *task, size_t data_size, uint32_t footprint);
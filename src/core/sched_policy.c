@@ -22,6 +22,7 @@
 #include <common/utils.h>
 #include <core/sched_policy.h>
 #include <profiling/profiling.h>
+#include <profiling/sched_latency.h>
 #include <datawizard/memory_nodes.h>
 #include <common/barrier.h>
 #include <core/debug.h>
@@ -77,11 +78,15 @@ static struct starpu_sched_policy *predefined_policies[] =
 	&_starpu_sched_modular_heft_policy,
 	&_starpu_sched_modular_heft_prio_policy,
 	&_starpu_sched_modular_heft2_policy,
+	&_starpu_sched_modular_heft_insert_policy,
+	&_starpu_sched_modular_edf_policy,
 	&_starpu_sched_modular_heteroprio_policy,
 	&_starpu_sched_modular_heteroprio_heft_policy,
 	&_starpu_sched_modular_parallel_heft_policy,
 	&_starpu_sched_eager_policy,
 	&_starpu_sched_prio_policy,
+	&_starpu_sched_eager_numa_policy,
+	&_starpu_sched_prio_numa_policy,
 	&_starpu_sched_random_policy,
 	&_starpu_sched_lws_policy,
 	&_starpu_sched_ws_policy,
@@ -97,6 +102,7 @@ static struct starpu_sched_policy *predefined_policies[] =
 	&_starpu_sched_graph_test_policy,
 #ifdef STARPU_HAVE_HWLOC
 	//&_starpu_sched_tree_heft_hierarchical_policy,
+	&_starpu_sched_modular_ws_hierarchical_policy,
 #endif
 	NULL
 };
@@ -595,6 +601,8 @@ int _starpu_repush_task(struct _starpu_job *j)
 	unsigned can_push = _starpu_increment_nready_tasks_of_sched_ctx(task->sched_ctx, task->flops, task);
 	STARPU_ASSERT(task->status == STARPU_TASK_BLOCKED || task->status == STARPU_TASK_BLOCKED_ON_TAG || task->status == STARPU_TASK_BLOCKED_ON_TASK || task->status == STARPU_TASK_BLOCKED_ON_DATA);
 	task->status = STARPU_TASK_READY;
+	if (_starpu_sched_latency_enabled)
+		j->ready_time = starpu_timing_now();
 	const unsigned continuation =
 #ifdef STARPU_OPENMP
 		j->continuation
@@ -820,9 +828,15 @@ int _starpu_push_task_to_workers(struct starpu_task *task)
 					STARPU_PTHREAD_MUTEX_UNLOCK_SCHED(&worker->sched_mutex);
 				}
 				_STARPU_TASK_BREAK_ON(task, push);
+				double push_start = 0.;
+				if (_starpu_sched_latency_enabled)
+					push_start = starpu_timing_now();
 				_STARPU_SCHED_BEGIN;
 				ret = sched_ctx->sched_policy->push_task(task);
 				_STARPU_SCHED_END;
+				/* Note: the task may already have been executed */
+				if (_starpu_sched_latency_enabled)
+					_starpu_sched_latency_record(STARPU_SCHED_LATENCY_PUSH, starpu_worker_get_id(), sched_ctx->id, starpu_timing_now() - push_start);
 				if (worker)
 				{
 					STARPU_PTHREAD_MUTEX_LOCK_SCHED(&worker->sched_mutex);
@@ -965,6 +979,13 @@ struct _starpu_sched_ctx* _get_next_sched_ctx_to_pop_into(struct _starpu_worker
 	struct _starpu_sched_ctx_list_iterator list_it;
 	int found = 0;
 
+	if (_starpu_sched_ctx_fair_share)
+	{
+		struct _starpu_sched_ctx *sched_ctx = _starpu_sched_ctx_fair_share_pick(worker);
+		if (sched_ctx)
+			return sched_ctx;
+	}
+
 	_starpu_sched_ctx_list_iterator_init(worker->sched_ctx_list, &list_it);
 	while (_starpu_sched_ctx_list_iterator_has_next(&list_it))
 	{
@@ -1063,9 +1084,16 @@ pick:
 					 * otherwise when a worker is idle, we'd keep
 					 * pushing/popping a scheduling state here, while what we
 					 * want to see in the trace is a permanent idle state. */
+					double pop_start = 0.;
+					if (_starpu_sched_latency_enabled)
+						pop_start = starpu_timing_now();
 					task = sched_ctx->sched_policy->pop_task(sched_ctx->id);
 					if (task)
+					{
+						if (_starpu_sched_latency_enabled)
+							_starpu_sched_latency_record(STARPU_SCHED_LATENCY_POP, worker->workerid, sched_ctx->id, starpu_timing_now() - pop_start);
 						_STARPU_TASK_BREAK_ON(task, pop);
+					}
 					_starpu_pop_task_end(task);
 				}
 			}
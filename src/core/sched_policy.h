@@ -87,6 +87,8 @@ extern struct starpu_sched_policy _starpu_sched_dmda_ready_policy;
 extern struct starpu_sched_policy _starpu_sched_dmda_sorted_policy;
 extern struct starpu_sched_policy _starpu_sched_dmda_sorted_decision_policy;
 extern struct starpu_sched_policy _starpu_sched_eager_policy;
+extern struct starpu_sched_policy _starpu_sched_eager_numa_policy;
+extern struct starpu_sched_policy _starpu_sched_prio_numa_policy;
 extern struct starpu_sched_policy _starpu_sched_parallel_heft_policy STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 extern struct starpu_sched_policy _starpu_sched_peager_policy;
 extern struct starpu_sched_policy _starpu_sched_heteroprio_policy;
@@ -112,11 +114,14 @@ extern struct starpu_sched_policy _starpu_sched_modular_ws_policy;
 extern struct starpu_sched_policy _starpu_sched_modular_heft_policy;
 extern struct starpu_sched_policy _starpu_sched_modular_heft_prio_policy;
 extern struct starpu_sched_policy _starpu_sched_modular_heft2_policy;
+extern struct starpu_sched_policy _starpu_sched_modular_heft_insert_policy STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
+extern struct starpu_sched_policy _starpu_sched_modular_edf_policy;
 extern struct starpu_sched_policy _starpu_sched_modular_heteroprio_policy;
 extern struct starpu_sched_policy _starpu_sched_modular_heteroprio_heft_policy;
 extern struct starpu_sched_policy _starpu_sched_modular_parallel_heft_policy;
 extern struct starpu_sched_policy _starpu_sched_graph_test_policy;
 extern struct starpu_sched_policy _starpu_sched_tree_heft_hierarchical_policy;
+extern struct starpu_sched_policy _starpu_sched_modular_ws_hierarchical_policy;
 
 extern long _starpu_task_break_on_push;
 extern long _starpu_task_break_on_sched;
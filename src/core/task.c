@@ -244,6 +244,11 @@ static int limit_max_submitted_tasks;
 static int watchdog_crash;
 static int watchdog_delay;
 
+/* Statistics about tasks with a deadline */
+static unsigned long deadline_ntasks;
+static unsigned long deadline_nmissed;
+static unsigned long deadline_nlate;
+
 /*
  * Function to call when watchdog detects that no task has finished for more than STARPU_WATCHDOG_TIMEOUT seconds
  */
@@ -260,6 +265,9 @@ void _starpu_task_init(void)
 	limit_max_submitted_tasks = starpu_getenv_number("STARPU_LIMIT_MAX_SUBMITTED_TASKS");
 	watchdog_crash = starpu_getenv_number_default("STARPU_WATCHDOG_CRASH", 0);
 	watchdog_delay = starpu_getenv_number_default("STARPU_WATCHDOG_DELAY", 0);
+	deadline_ntasks = 0;
+	deadline_nmissed = 0;
+	deadline_nlate = 0;
 }
 
 void _starpu_task_deinit(void)
@@ -1202,6 +1210,8 @@ int _starpu_task_submit_conversion_task(struct starpu_task *task,
 
 	STARPU_ASSERT(task->status == STARPU_TASK_INIT);
 	task->status = STARPU_TASK_READY;
+	if (_starpu_sched_latency_enabled)
+		j->ready_time = starpu_timing_now();
 	_starpu_profiling_set_task_push_start_time(task);
 
 	unsigned node = starpu_worker_get_memory_node(workerid);
@@ -1546,6 +1556,24 @@ int starpu_task_nsubmitted(void)
 	return nsubmitted;
 }
 
+void _starpu_task_deadline_terminated(struct starpu_task *task)
+{
+	(void) STARPU_ATOMIC_ADDL(&deadline_ntasks, 1);
+	if (starpu_timing_now() > task->deadline)
+		(void) STARPU_ATOMIC_ADDL(&deadline_nmissed, 1);
+}
+
+void _starpu_task_deadline_late(struct starpu_task *task STARPU_ATTRIBUTE_UNUSED)
+{
+	(void) STARPU_ATOMIC_ADDL(&deadline_nlate, 1);
+}
+
+void starpu_task_deadline_get_stats(struct starpu_task_deadline_stats *stats)
+{
+	stats->ntasks = deadline_ntasks;
+	stats->nmissed = deadline_nmissed;
+	stats->nlate = deadline_nlate;
+}
 
 int starpu_task_nready(void)
 {
@@ -46,6 +46,12 @@ void _starpu_task_init(void);
 void _starpu_task_deinit(void);
 void _starpu_set_current_task(struct starpu_task *task);
 
+/** Account the termination of \p task, which has a deadline */
+void _starpu_task_deadline_terminated(struct starpu_task *task);
+/** The scheduler could not find a worker which is expected to meet the
+ * deadline of \p task */
+void _starpu_task_deadline_late(struct starpu_task *task);
+
 int _starpu_submit_job(struct _starpu_job *j, int nodeps);
 
 void _starpu_task_declare_deps_array(struct starpu_task *task, unsigned ndeps, struct starpu_task *task_array[], int check);
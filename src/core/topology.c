@@ -217,6 +217,43 @@ static int _starpu_get_logical_close_numa_node_worker(unsigned workerid)
 	}
 }
 
+/* This returns the StarPU NUMA memory node close to a worker */
+int _starpu_get_close_numa_memory_node_worker(unsigned workerid)
+{
+	int node = starpu_memory_nodes_numa_hwloclogid_to_id(_starpu_get_logical_close_numa_node_worker(workerid));
+	if (node == -1)
+		node = STARPU_MAIN_RAM;
+	return node;
+}
+
+/* This returns the StarPU NUMA memory node close to the CPU the calling thread
+ * was last running on */
+int _starpu_get_current_numa_memory_node(void)
+{
+#if defined(STARPU_HAVE_HWLOC)
+	STARPU_ASSERT(numa_enabled != -1);
+	if (numa_enabled && nb_numa_nodes > 1)
+	{
+		struct _starpu_machine_config *config = (struct _starpu_machine_config *)_starpu_get_machine_config();
+		struct _starpu_machine_topology *topology = &config->topology;
+		hwloc_cpuset_t set = hwloc_bitmap_alloc();
+		int node = STARPU_MAIN_RAM;
+
+		if (hwloc_get_last_cpu_location(topology->hwtopology, set, HWLOC_CPUBIND_THREAD) == 0)
+		{
+			hwloc_obj_t obj = hwloc_get_obj_inside_cpuset_by_type(topology->hwtopology, set, HWLOC_OBJ_PU, 0);
+			if (obj)
+				node = starpu_memory_nodes_numa_hwloclogid_to_id(numa_get_logical_id(obj));
+			if (node == -1)
+				node = STARPU_MAIN_RAM;
+		}
+		hwloc_bitmap_free(set);
+		return node;
+	}
+#endif
+	return STARPU_MAIN_RAM;
+}
+
 //TODO change this in an array
 int starpu_memory_nodes_numa_hwloclogid_to_id(int logid)
 {
@@ -284,7 +321,7 @@ int _starpu_task_data_get_node_on_node(struct starpu_task *task, unsigned index,
 			enum starpu_data_access_mode mode = STARPU_TASK_GET_MODE(task, index);
 			if (mode & STARPU_R)
 			{
-				if (mode & STARPU_R && task->handles[index]->per_node[local_node].state != STARPU_INVALID)
+				if (mode & STARPU_R && _starpu_data_peek_replicate(task->handles[index], local_node)->state != STARPU_INVALID)
 				{
 					/* It is here already, rather access it from here */
 					node = local_node;
@@ -327,9 +364,7 @@ int _starpu_task_data_get_node_on_worker(struct starpu_task *task, unsigned inde
 		node = local_node;
 		break;
 	case STARPU_SPECIFIC_NODE_CPU:
-		node = starpu_memory_nodes_numa_hwloclogid_to_id(_starpu_get_logical_close_numa_node_worker(worker));
-		if (node == -1)
-			node = STARPU_MAIN_RAM;
+		node = _starpu_get_close_numa_memory_node_worker(worker);
 		break;
 	case STARPU_SPECIFIC_NODE_SLOW:
 		// TODO: rather leave in DDR
@@ -340,7 +375,7 @@ int _starpu_task_data_get_node_on_worker(struct starpu_task *task, unsigned inde
 			enum starpu_data_access_mode mode = STARPU_TASK_GET_MODE(task, index);
 			if (mode & STARPU_R)
 			{
-				if (task->handles[index]->per_node[local_node].state != STARPU_INVALID)
+				if (_starpu_data_peek_replicate(task->handles[index], local_node)->state != STARPU_INVALID)
 				{
 					/* It is here already, rather access it from here */
 					node = local_node;
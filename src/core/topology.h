@@ -139,6 +139,12 @@ int starpu_memory_nodes_numa_hwloclogid_to_id(int logid);
 /* This returns the exact NUMA node next to a worker */
 int _starpu_get_logical_numa_node_worker(unsigned workerid);
 
+/** returns the StarPU NUMA memory node close to worker \p workerid */
+int _starpu_get_close_numa_memory_node_worker(unsigned workerid);
+
+/** returns the StarPU NUMA memory node close to the CPU the calling thread was last running on */
+int _starpu_get_current_numa_memory_node(void);
+
 /** returns the number of hyperthreads per core */
 unsigned _starpu_get_nhyperthreads() STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
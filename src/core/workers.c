@@ -41,6 +41,8 @@
 #include <profiling/bound.h>
 #include <sched_policies/sched_component.h>
 #include <datawizard/memory_nodes.h>
+#include <datawizard/copy_driver.h>
+#include <datawizard/readahead.h>
 #include <common/knobs.h>
 #include <drivers/mp_common/sink_common.h>
 #include <drivers/mp_common/source_common.h>
@@ -554,7 +556,7 @@ int _starpu_enforce_locality(unsigned workerid, struct starpu_task *task)
 			unsigned node;
 			for (node = 0; node < nnodes; node++)
 			{
-				enum _starpu_cache_state state = handle->per_node[node].state;
+				enum _starpu_cache_state state = _starpu_data_peek_replicate(handle, node)->state;
 				if (state == STARPU_OWNER)
 					owner = node;
 				if (state == STARPU_SHARED)
@@ -562,7 +564,7 @@ int _starpu_enforce_locality(unsigned workerid, struct starpu_task *task)
 			}
 			if (owner != -1 && owner != (int)requested_node)
 				return 0;
-			if (shared != -1 && handle->per_node[requested_node].state != STARPU_SHARED)
+			if (shared != -1 && _starpu_data_peek_replicate(handle, requested_node)->state != STARPU_SHARED)
 				return 0;
 		}
 	return 1;
@@ -1865,6 +1867,7 @@ int starpu_initialize(struct starpu_conf *user_conf, int *argc, char ***argv)
 	}
 
 	_starpu_profiling_init();
+	_starpu_sched_latency_init();
 
 	_starpu_task_init();
 
@@ -1909,6 +1912,8 @@ int starpu_initialize(struct starpu_conf *user_conf, int *argc, char ***argv)
 		_starpu_launch_drivers(&_starpu_config);
 		/* Allocate swap, if any */
 		_starpu_swap_init();
+		_starpu_ram_copy_init();
+		_starpu_readahead_init();
 	}
 
 	_starpu_watchdog_init();
@@ -2137,6 +2142,7 @@ void starpu_display_stats()
 {
 	starpu_profiling_bus_helper_display_summary();
 	starpu_profiling_worker_helper_display_summary();
+	starpu_profiling_sched_latency_helper_display_summary();
 }
 
 void starpu_shutdown(void)
@@ -2179,11 +2185,13 @@ void starpu_shutdown(void)
 	     {
 		  _starpu_display_msi_stats(stderr);
 		  _starpu_display_alloc_cache_stats(stderr);
+		  _starpu_malloc_display_hugepages_stats(stderr);
 	     }
 	}
 
 	starpu_profiling_bus_helper_display_summary();
 	starpu_profiling_worker_helper_display_summary();
+	starpu_profiling_sched_latency_helper_display_summary();
 	starpu_bound_clear();
 
 	_starpu_deinitialize_registered_performance_models();
@@ -2193,6 +2201,9 @@ void starpu_shutdown(void)
 	/* wait for their termination */
 	_starpu_terminate_workers(&_starpu_config);
 
+	_starpu_ram_copy_shutdown();
+	_starpu_malloc_hugepages_shutdown();
+
 	{
 	     int stats = starpu_getenv_number("STARPU_MEMORY_STATS");
 	     if (stats != 0)
@@ -2212,6 +2223,7 @@ void starpu_shutdown(void)
 
 	_starpu_profiling_terminate();
 
+	_starpu_readahead_shutdown();
 	_starpu_disk_unregister();
 #ifdef STARPU_HAVE_HWLOC
 	starpu_tree_free(_starpu_config.topology.tree);
@@ -2235,6 +2247,7 @@ void starpu_shutdown(void)
 #endif
 	_starpu_perf_knob_exit();
 	_starpu_perf_counter_exit();
+	_starpu_sched_latency_deinit();
 	_starpu_close_debug_logfile();
 
 	_starpu_keys_initialized = 0;
@@ -60,6 +60,7 @@
 
 #include <datawizard/datawizard.h>
 #include <datawizard/malloc.h>
+#include <profiling/sched_latency.h>
 
 #pragma GCC visibility push(hidden)
 
@@ -256,6 +257,7 @@ LIST_TYPE(_starpu_worker,
 	unsigned nb_buffers_transferred; /**< number of piece of data already send to worker */
 	unsigned nb_buffers_totransfer; /**< number of piece of data already send to worker */
 	struct starpu_task *task_transferring; /**< The buffers of this task are being sent */
+	struct starpu_task *batch_next; /**< Task popped while gathering a batch of tasks, to be run next */
 
 	  /**
 	   * indicate whether the workers shares tasks lists with other workers
@@ -1215,25 +1217,46 @@ static inline int _starpu_worker_get_relax_state(void)
  *
  * notes:
  * - if the observed worker is not in state_relax_refcnt, the function block until the state is reached */
+/* Lock the scheduling mutex of the worker. When recording scheduling
+ * latencies, return when we started waiting for it, or 0 if it was free */
+static inline double _starpu_worker_sched_mutex_lock(struct _starpu_worker *worker)
+{
+	double start = 0.;
+	if (_starpu_sched_latency_enabled)
+	{
+		if (STARPU_PTHREAD_MUTEX_TRYLOCK_SCHED(&worker->sched_mutex) == 0)
+			return 0.;
+		start = starpu_timing_now();
+	}
+	STARPU_PTHREAD_MUTEX_LOCK_SCHED(&worker->sched_mutex);
+	return start;
+}
+
 static inline void _starpu_worker_lock(int workerid)
 {
 	struct _starpu_worker *worker = _starpu_get_worker_struct(workerid);
 	STARPU_ASSERT(worker != NULL);
 	int cur_workerid = starpu_worker_get_id();
+	double start;
 	if (workerid != cur_workerid)
 	{
 		starpu_worker_relax_on();
 
-		STARPU_PTHREAD_MUTEX_LOCK_SCHED(&worker->sched_mutex);
+		start = _starpu_worker_sched_mutex_lock(worker);
 		while (!worker->state_relax_refcnt)
 		{
+			if (_starpu_sched_latency_enabled && start == 0.)
+				start = starpu_timing_now();
 			STARPU_PTHREAD_COND_WAIT(&worker->sched_cond, &worker->sched_mutex);
 		}
 	}
 	else
 	{
-		STARPU_PTHREAD_MUTEX_LOCK_SCHED(&worker->sched_mutex);
+		start = _starpu_worker_sched_mutex_lock(worker);
 	}
+	if (_starpu_sched_latency_enabled && start != 0.)
+		/* We had to wait */
+		_starpu_sched_latency_record(STARPU_SCHED_LATENCY_LOCK_WAIT, cur_workerid, STARPU_NMAX_SCHED_CTXS, starpu_timing_now() - start);
 }
 #define starpu_worker_lock _starpu_worker_lock
 
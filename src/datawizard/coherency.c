@@ -24,6 +24,7 @@
 #include <datawizard/write_back.h>
 #include <datawizard/memory_nodes.h>
 #include <datawizard/sort_data_handles.h>
+#include <datawizard/readahead.h>
 #include <core/dependencies/data_concurrency.h>
 #include <core/disk.h>
 #include <profiling/profiling.h>
@@ -52,7 +53,7 @@ int _starpu_select_src_node(starpu_data_handle_t handle, unsigned destination)
 
 	for (node = 0; node < nnodes; node++)
 	{
-		if (handle->per_node[node].state != STARPU_INVALID)
+		if (_starpu_data_peek_replicate(handle, node)->state != STARPU_INVALID)
 		{
 			/* we found a copy ! */
 			src_node_mask |= (1<<node);
@@ -104,8 +105,8 @@ int _starpu_select_src_node(starpu_data_handle_t handle, unsigned destination)
 	if (cost && src_node != -1)
 	{
 		/* Could estimate through cost, return that */
-		STARPU_ASSERT(handle->per_node[src_node].allocated || handle->per_node[src_node].mapped != STARPU_UNMAPPED);
-		STARPU_ASSERT(handle->per_node[src_node].initialized);
+		STARPU_ASSERT(_starpu_data_peek_replicate(handle, src_node)->allocated || _starpu_data_peek_replicate(handle, src_node)->mapped != STARPU_UNMAPPED);
+		STARPU_ASSERT(_starpu_data_peek_replicate(handle, src_node)->initialized);
 		return src_node;
 	}
 
@@ -122,14 +123,14 @@ int _starpu_select_src_node(starpu_data_handle_t handle, unsigned destination)
 			/* Avoid transfers which the interface does not want */
 			if (can_copy)
 			{
-				void *src_interface = handle->per_node[i].data_interface;
-				void *dst_interface = handle->per_node[destination].data_interface;
+				void *src_interface = _starpu_data_get_replicate(handle, i)->data_interface;
+				void *dst_interface = _starpu_data_get_replicate(handle, destination)->data_interface;
 				unsigned handling_node;
 
 				if (!link_supports_direct_transfers(handle, i, destination, &handling_node))
 				{
 					/* Avoid through RAM if the interface does not want it */
-					void *ram_interface = handle->per_node[STARPU_MAIN_RAM].data_interface;
+					void *ram_interface = _starpu_data_get_replicate(handle, STARPU_MAIN_RAM)->data_interface;
 					if ((!can_copy(src_interface, i, ram_interface, STARPU_MAIN_RAM, i)
 					  && !can_copy(src_interface, i, ram_interface, STARPU_MAIN_RAM, STARPU_MAIN_RAM))
 					 || (!can_copy(ram_interface, STARPU_MAIN_RAM, dst_interface, destination, STARPU_MAIN_RAM)
@@ -163,11 +164,33 @@ int _starpu_select_src_node(starpu_data_handle_t handle, unsigned destination)
 		src_node = i_disk;
 
 	STARPU_ASSERT(src_node != -1);
-	STARPU_ASSERT(handle->per_node[src_node].allocated || handle->per_node[src_node].mapped != STARPU_UNMAPPED);
-	STARPU_ASSERT(handle->per_node[src_node].initialized);
+	STARPU_ASSERT(_starpu_data_peek_replicate(handle, src_node)->allocated || _starpu_data_peek_replicate(handle, src_node)->mapped != STARPU_UNMAPPED);
+	STARPU_ASSERT(_starpu_data_peek_replicate(handle, src_node)->initialized);
 	return src_node;
 }
 
+/* When a RAM replicate is mapped with the replicate of another NUMA node, they
+ * share the same pages, bring them to the node which gets write access */
+static void _starpu_data_migrate_mapped(starpu_data_handle_t handle, struct _starpu_data_replicate *replicate)
+{
+	unsigned node = replicate->memory_node;
+	unsigned nnodes = starpu_memory_nodes_get_count();
+	unsigned other;
+	int mapped;
+
+	if (starpu_node_get_kind(node) != STARPU_CPU_RAM || !handle->ops->to_pointer)
+		return;
+
+	mapped = replicate->mapped != STARPU_UNMAPPED && starpu_node_get_kind(replicate->mapped) == STARPU_CPU_RAM;
+	for (other = 0; !mapped && other < nnodes; other++)
+		mapped = _starpu_data_peek_replicate(handle, other)->mapped == (int) node
+			&& starpu_node_get_kind(other) == STARPU_CPU_RAM;
+	if (!mapped)
+		return;
+
+	_starpu_malloc_migrate_on_node(node, handle->ops->to_pointer(replicate->data_interface, node), _starpu_data_get_alloc_size(handle));
+}
+
 /* this may be called once the data is fetched with header and STARPU_RW-lock hold */
 void _starpu_update_data_state(starpu_data_handle_t handle,
 			       struct _starpu_data_replicate *requesting_replicate,
@@ -194,24 +217,27 @@ void _starpu_update_data_state(starpu_data_handle_t handle,
 	{
 		/* the requesting node now has the only valid copy */
 		unsigned node;
+
+		if (requesting_replicate->state != STARPU_OWNER && _starpu_malloc_migrate_enabled())
+			_starpu_data_migrate_mapped(handle, requesting_replicate);
 		for (node = 0; node < nnodes; node++)
 		{
 			if (requesting_replicate->mapped == (int) node
 				&& !_starpu_node_needs_map_update(requesting_node))
 				/* The mapped node will be kept up to date */
 				continue;
-			if (handle->per_node[node].mapped == (int) requesting_node
+			if (_starpu_data_peek_replicate(handle, node)->mapped == (int) requesting_node
 				&& !_starpu_node_needs_map_update(node))
 				/* The mapping node will be kept up to date */
 				continue;
-			if (handle->per_node[node].state != STARPU_INVALID)
+			if (_starpu_data_peek_replicate(handle, node)->state != STARPU_INVALID)
 			       _STARPU_TRACE_DATA_STATE_INVALID(handle, node);
-			handle->per_node[node].state = STARPU_INVALID;
+			_starpu_data_get_replicate(handle, node)->state = STARPU_INVALID;
 		}
 		if (requesting_replicate->state != STARPU_OWNER)
 			_STARPU_TRACE_DATA_STATE_OWNER(handle, requesting_node);
 		requesting_replicate->state = STARPU_OWNER;
-		if (handle->home_node != -1 && handle->per_node[handle->home_node].state == STARPU_INVALID)
+		if (handle->home_node != -1 && _starpu_data_peek_replicate(handle, handle->home_node)->state == STARPU_INVALID)
 			/* Notify that this MC is now dirty */
 			_starpu_memchunk_dirty(requesting_replicate->mc, requesting_replicate->memory_node);
 	}
@@ -224,7 +250,7 @@ void _starpu_update_data_state(starpu_data_handle_t handle,
 			unsigned node;
 			for (node = 0; node < nnodes; node++)
 			{
-				struct _starpu_data_replicate *replicate = &handle->per_node[node];
+				struct _starpu_data_replicate *replicate = _starpu_data_get_replicate(handle, node);
 				if (replicate->state != STARPU_INVALID)
 				{
 					if (replicate->state != STARPU_SHARED)
@@ -259,8 +285,8 @@ static int link_supports_direct_transfers(starpu_data_handle_t handle, unsigned
 {
 	STARPU_ASSERT_MSG(handle->ops->copy_methods, "The handle %s does not define a copy_methods\n", handle->ops->name);
 	int (*can_copy)(void *src_interface, unsigned src_node, void *dst_interface, unsigned dst_node, unsigned handling_node) = handle->ops->copy_methods->can_copy;
-	void *src_interface = handle->per_node[src_node].data_interface;
-	void *dst_interface = handle->per_node[dst_node].data_interface;
+	void *src_interface = _starpu_data_get_replicate(handle, src_node)->data_interface;
+	void *dst_interface = _starpu_data_get_replicate(handle, dst_node)->data_interface;
 
 	/* Note: with CUDA, performance seems a bit better when issuing the transfer from the destination (tested without GPUDirect, but GPUDirect probably behave the same) */
 	if (worker_supports_direct_access(src_node, dst_node) && (!can_copy || can_copy(src_interface, src_node, dst_interface, dst_node, dst_node)))
@@ -314,10 +340,13 @@ int _starpu_determine_request_path(starpu_data_handle_t handle,
 	if ((mode & STARPU_R) && src_node >= 0 && dst_node >= 0)
 	{
 
-		struct _starpu_data_replicate *src_replicate = &handle->per_node[src_node];
-		struct _starpu_data_replicate *dst_replicate = &handle->per_node[dst_node];
+		struct _starpu_data_replicate *src_replicate = _starpu_data_get_replicate(handle, src_node);
+		struct _starpu_data_replicate *dst_replicate = _starpu_data_get_replicate(handle, dst_node);
 
-		if (src_replicate->mapped != STARPU_UNMAPPED)
+		/* Data mapped from a disk is plain main memory for the other
+		 * nodes, it does not need to go through the disk */
+		if (src_replicate->mapped != STARPU_UNMAPPED
+			&& (src_replicate->mapped == dst_node || starpu_node_get_kind(src_replicate->mapped) != STARPU_DISK_RAM))
 		{
 			/* Device -> map */
 			STARPU_ASSERT(max_len >= 1);
@@ -335,7 +364,8 @@ int _starpu_determine_request_path(starpu_data_handle_t handle,
 
 			return consumed + 1;
 		}
-		else if (dst_replicate->mapped != STARPU_UNMAPPED)
+		else if (dst_replicate->mapped != STARPU_UNMAPPED
+			&& (dst_replicate->mapped == src_node || starpu_node_get_kind(dst_replicate->mapped) != STARPU_DISK_RAM))
 		{
 			/* Device -> map */
 			int consumed = _starpu_determine_request_path(handle,
@@ -393,8 +423,8 @@ int _starpu_determine_request_path(starpu_data_handle_t handle,
 	if (!link_is_valid)
 	{
 		int (*can_copy)(void *, unsigned, void *, unsigned, unsigned) = handle->ops->copy_methods->can_copy;
-		void *src_interface = handle->per_node[src_node].data_interface;
-		void *dst_interface = handle->per_node[dst_node].data_interface;
+		void *src_interface = _starpu_data_get_replicate(handle, src_node)->data_interface;
+		void *dst_interface = _starpu_data_get_replicate(handle, dst_node)->data_interface;
 
 		/* We need an intermediate hop to implement data staging
 		 * through main memory. */
@@ -561,7 +591,7 @@ struct _starpu_data_request *_starpu_create_request_to_fetch_data(starpu_data_ha
 			for (j = 0; j < nnodes; j++)
 			{
 				struct _starpu_data_request *r;
-				for (r = handle->per_node[i].request[j]; r; r = r->next_same_req)
+				for (r = _starpu_data_peek_replicate(handle, i)->request[j]; r; r = r->next_same_req)
 					nwait++;
 			}
 		/* If the request is not detached (i.e. the caller really wants
@@ -717,8 +747,8 @@ struct _starpu_data_request *_starpu_create_request_to_fetch_data(starpu_data_ha
 		/* Only the first request is independent */
 		unsigned ndeps = (hop == 0)?0:1;
 
-		hop_src_replicate = &handle->per_node[hop_src_node];
-		hop_dst_replicate = (hop != nhops - 1)?&handle->per_node[hop_dst_node]:dst_replicate;
+		hop_src_replicate = _starpu_data_get_replicate(handle, hop_src_node);
+		hop_dst_replicate = (hop != nhops - 1)?_starpu_data_get_replicate(handle, hop_dst_node):dst_replicate;
 
 		/* Try to reuse a request if possible */
 #ifdef STARPU_DEVEL
@@ -796,7 +826,7 @@ struct _starpu_data_request *_starpu_create_request_to_fetch_data(starpu_data_ha
 			for (j = 0; j < nnodes; j++)
 			{
 				struct _starpu_data_request *r2;
-				for (r2 = handle->per_node[i].request[j]; r2; r2 = r2->next_same_req)
+				for (r2 = _starpu_data_peek_replicate(handle, i)->request[j]; r2; r2 = r2->next_same_req)
 				{
 					_starpu_spin_lock(&r2->lock);
 					if (is_prefetch < r2->prefetch)
@@ -846,7 +876,7 @@ int _starpu_fetch_data_on_node(starpu_data_handle_t handle, int node, struct _st
 		unsigned n;
 		for (n = 0; n < nnodes; n++)
 		{
-			if (handle->per_node[n].state != STARPU_INVALID)
+			if (_starpu_data_peek_replicate(handle, n)->state != STARPU_INVALID)
 			{
 				/* we found a copy ! */
 				src_node_mask |= (1<<n);
@@ -871,7 +901,11 @@ int _starpu_fetch_data_on_node(starpu_data_handle_t handle, int node, struct _st
 		{
 			int i;
 			for (i = 0; i < STARPU_MAXNODES; i++)
-				handle->per_node[i].refcnt++;
+				if (_starpu_data_has_replicate(handle, i))
+					_starpu_data_get_replicate(handle, i)->refcnt++;
+#ifdef STARPU_COMPACT_HANDLES
+			handle->lock_all_refcnt++;
+#endif
 		}
 		handle->busy_count++;
 	}
@@ -915,7 +949,7 @@ static int fetch_data(starpu_data_handle_t handle, int node, struct _starpu_data
 
 uint32_t _starpu_get_data_refcnt(starpu_data_handle_t handle, unsigned node)
 {
-	return handle->per_node[node].refcnt;
+	return _starpu_data_peek_replicate(handle, node)->refcnt;
 }
 
 size_t _starpu_data_get_size(starpu_data_handle_t handle)
@@ -1003,6 +1037,10 @@ int _starpu_prefetch_task_input_prio(struct starpu_task *task, int target_node,
 	STARPU_ASSERT_MSG(prefetch != STARPU_PREFETCH || !task->prefetched, "Prefetching was already requested for this task! Did you set 'prefetches' to 1 in the starpu_sched_policy structure?");
 	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
 	unsigned index;
+	/* Whether reading data from the disk is left to the read-ahead
+	 * window of the worker */
+	int readahead = prefetch == STARPU_PREFETCH && target_node < 0 && worker >= 0 && _starpu_readahead_ntasks;
+	size_t readahead_size = 0;
 
 	for (index = 0; index < nbuffers; index++)
 	{
@@ -1021,7 +1059,13 @@ int _starpu_prefetch_task_input_prio(struct starpu_task *task, int target_node,
 		if (node < 0)
 			continue;
 
-		struct _starpu_data_replicate *replicate = &handle->per_node[node];
+		if (readahead && _starpu_readahead_from_disk(handle, node))
+		{
+			readahead_size += _starpu_data_get_size(handle);
+			continue;
+		}
+
+		struct _starpu_data_replicate *replicate = _starpu_data_get_replicate(handle, node);
 		if (prefetch == STARPU_PREFETCH)
 			task_prefetch_data_on_node(handle, node, replicate, mode, task, prio);
 		else
@@ -1031,6 +1075,9 @@ int _starpu_prefetch_task_input_prio(struct starpu_task *task, int target_node,
 	if (prefetch == STARPU_PREFETCH)
 		task->prefetched = 1;
 
+	if (readahead_size)
+		_starpu_readahead_push(task, worker, prio, readahead_size);
+
 	return 0;
 }
 
@@ -1113,7 +1160,7 @@ static struct _starpu_data_replicate *get_replicate(starpu_data_handle_t handle,
 	}
 	else
 		/* That's a "normal" buffer (R/W) */
-		return &handle->per_node[node];
+		return _starpu_data_get_replicate(handle, node);
 }
 
 /* Callback used when a buffer is send asynchronously to the sink */
@@ -1155,6 +1202,9 @@ int _starpu_fetch_task_input(struct starpu_task *task, struct _starpu_job *j, in
 	else
 		_STARPU_TRACE_START_FETCH_INPUT(NULL);
 
+	if (_starpu_readahead_ntasks || _starpu_readahead_stats)
+		_starpu_readahead_task_start(j, worker);
+
 	int profiling = starpu_profiling_status_get();
 	if (profiling && task->profiling_info)
 		_starpu_clock_gettime(&task->profiling_info->acquire_data_start_time);
@@ -1353,6 +1403,9 @@ void _starpu_fetch_task_input_tail(struct starpu_task *task, struct _starpu_job
 
 	_STARPU_TRACE_END_FETCH_INPUT(NULL);
 
+	if (_starpu_readahead_ntasks || _starpu_readahead_stats)
+		_starpu_readahead_task_ready(j, worker);
+
 	_starpu_clear_worker_status(worker, STATUS_INDEX_WAITING, NULL);
 }
 
@@ -1534,7 +1587,7 @@ unsigned starpu_data_is_on_node(starpu_data_handle_t handle, unsigned node)
 // XXX : this is just a hint, so we don't take the lock ...
 //	STARPU_PTHREAD_SPIN_LOCK(&handle->header_lock);
 
-	if (handle->per_node[node].state != STARPU_INVALID)
+	if (_starpu_data_peek_replicate(handle, node)->state != STARPU_INVALID)
 	{
 		ret  = 1;
 	}
@@ -1545,7 +1598,7 @@ unsigned starpu_data_is_on_node(starpu_data_handle_t handle, unsigned node)
 
 		for (i = 0; i < nnodes; i++)
 		{
-			if (handle->per_node[node].request[i])
+			if (_starpu_data_peek_replicate(handle, node)->request[i])
 			{
 				ret = 1;
 				break;
@@ -1562,7 +1615,7 @@ unsigned starpu_data_is_on_node(starpu_data_handle_t handle, unsigned node)
 /* Return true if a data is on memory and is not part of a prefetch */
 unsigned starpu_data_is_on_node_excluding_prefetch(starpu_data_handle_t handle, unsigned node)
 {
-	return handle->per_node[node].state != STARPU_INVALID;
+	return _starpu_data_peek_replicate(handle, node)->state != STARPU_INVALID;
 }
 
 /* Unmap the data from this node, e.g. before partitioning or unregistering */
@@ -1572,9 +1625,9 @@ void _starpu_data_unmap(starpu_data_handle_t handle, unsigned node)
 	STARPU_ASSERT(handle);
 
 	_starpu_spin_lock(&handle->header_lock);
-	if (handle->per_node[node].mapped != STARPU_UNMAPPED)
+	if (_starpu_data_peek_replicate(handle, node)->mapped != STARPU_UNMAPPED)
 	{
-		r = _starpu_create_data_request(handle, &handle->per_node[handle->per_node[node].mapped], &handle->per_node[node], node, STARPU_UNMAP, 0, NULL, STARPU_FETCH, 0, 0, __func__);
+		r = _starpu_create_data_request(handle, _starpu_data_get_replicate(handle, _starpu_data_peek_replicate(handle, node)->mapped), _starpu_data_get_replicate(handle, node), node, STARPU_UNMAP, 0, NULL, STARPU_FETCH, 0, 0, __func__);
 
 		r->refcnt++;
 		_starpu_post_data_request(r);
@@ -210,8 +210,28 @@ struct _starpu_data_state
 	unsigned active_ro:1;
 
 	/** describe the state of the data in term of coherency
-	 * This is execution-time state. */
+	 * This is execution-time state.
+	 * Use _starpu_data_get_replicate() and _starpu_data_peek_replicate()
+	 * to access it. */
+#ifdef STARPU_COMPACT_HANDLES
+	/** Only the replicates for the memory nodes that the handle visits
+	 * are allocated, the others are NULL. */
+	struct _starpu_data_replicate *per_node[STARPU_MAXNODES];
+	/** The data interface that replicates get when they are allocated,
+	 * i.e. the one that register_data_handle sets up for nodes other than
+	 * the home node. NULL if all replicates are allocated upfront. */
+	void *template_interface;
+	/** Whether the interfaces are being set up by register_data_handle or
+	 * a filter, which shall then write to the template */
+	unsigned registering:1;
+	/** Number of references taken on all replicates at once through
+	 * STARPU_ACQUIRE_NO_NODE_LOCK_ALL, which replicates allocated later on
+	 * have to inherit. The handle being then locked, tasks can not be
+	 * allocating replicates concurrently. */
+	int lock_all_refcnt;
+#else
 	struct _starpu_data_replicate per_node[STARPU_MAXNODES];
+#endif
 	struct _starpu_data_replicate *per_worker;
 
 	struct starpu_data_interface_ops *ops;
@@ -347,8 +367,56 @@ struct _starpu_data_state
 	/** A generic pointer to data in the scheduler (could be anything and this
 	 * is managed by the scheduler) */
 	void *sched_data;
+
+	/** When the handle was registered by starpu_data_register_array(), the
+	 * slab it was allocated from, to be freed along its last handle */
+	struct _starpu_data_slab *slab;
 };
 
+#ifdef STARPU_COMPACT_HANDLES
+/** The replicate that stands for all replicates which were not allocated */
+extern const struct _starpu_data_replicate _starpu_unallocated_replicate STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
+struct _starpu_data_replicate *_starpu_data_allocate_replicate(starpu_data_handle_t handle, unsigned node) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
+#endif
+
+/** Return the replicate of \p handle on memory node \p node, allocating it
+ * first in compact mode */
+static inline struct _starpu_data_replicate *_starpu_data_get_replicate(starpu_data_handle_t handle, unsigned node)
+{
+#ifdef STARPU_COMPACT_HANDLES
+	struct _starpu_data_replicate *replicate = handle->per_node[node];
+	if (STARPU_LIKELY(replicate))
+		return replicate;
+	return _starpu_data_allocate_replicate(handle, node);
+#else
+	return &handle->per_node[node];
+#endif
+}
+
+/** Return the replicate of \p handle on memory node \p node, for reading
+ * only. In compact mode, the replicates which were not allocated yet are
+ * represented by an invalid and unallocated replicate, without interface. */
+static inline const struct _starpu_data_replicate *_starpu_data_peek_replicate(starpu_data_handle_t handle, unsigned node)
+{
+#ifdef STARPU_COMPACT_HANDLES
+	const struct _starpu_data_replicate *replicate = handle->per_node[node];
+	return replicate ? replicate : &_starpu_unallocated_replicate;
+#else
+	return &handle->per_node[node];
+#endif
+}
+
+/** Whether the replicate of \p handle on memory node \p node was allocated,
+ * i.e. whether the handle already visited \p node */
+static inline int _starpu_data_has_replicate(starpu_data_handle_t handle STARPU_ATTRIBUTE_UNUSED, unsigned node STARPU_ATTRIBUTE_UNUSED)
+{
+#ifdef STARPU_COMPACT_HANDLES
+	return handle->per_node[node] != NULL;
+#else
+	return 1;
+#endif
+}
+
 /** This does not take a reference on the handle, the caller has to do it,
  * e.g. through _starpu_attempt_to_submit_data_request_from_apps()
  * detached means that the core is allowed to drop the request. The caller
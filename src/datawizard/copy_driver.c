@@ -32,11 +32,17 @@
 #include <datawizard/copy_driver.h>
 #include <datawizard/memalloc.h>
 #include <profiling/profiling.h>
+#include <core/topology.h>
+#include <core/workers.h>
 
 #ifdef STARPU_SIMGRID
 #include <core/simgrid.h>
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 void _starpu_wake_all_blocked_workers_on_node(unsigned nodeid)
 {
 	/* wake up all workers on that memory node */
@@ -307,7 +313,9 @@ int STARPU_ATTRIBUTE_WARN_UNUSED_RESULT _starpu_driver_copy_data_1_to_1(starpu_d
 	 *   updated.
 	 * All in all, any data change will actually trigger both.
 	 */
-	if (!donotread && dst_replicate->mapped != STARPU_UNMAPPED)
+	if (!donotread && dst_replicate->mapped != STARPU_UNMAPPED
+		/* Data mapped from a disk is plain main memory for the other nodes */
+		&& (dst_replicate->mapped == (int) src_node || starpu_node_get_kind(dst_replicate->mapped) != STARPU_DISK_RAM))
 	{
 		STARPU_ASSERT(src_replicate->memory_node == dst_replicate->mapped);
 		if (_starpu_node_needs_map_update(dst_node))
@@ -323,7 +331,8 @@ int STARPU_ATTRIBUTE_WARN_UNUSED_RESULT _starpu_driver_copy_data_1_to_1(starpu_d
 		dst_replicate->initialized = 1;
 	}
 
-	else if (!donotread && src_replicate->mapped != STARPU_UNMAPPED)
+	else if (!donotread && src_replicate->mapped != STARPU_UNMAPPED
+		&& (src_replicate->mapped == (int) dst_node || starpu_node_get_kind(src_replicate->mapped) != STARPU_DISK_RAM))
 	{
 		STARPU_ASSERT(dst_replicate->memory_node == src_replicate->mapped);
 		if (_starpu_node_needs_map_update(src_node))
@@ -834,3 +843,307 @@ unsigned _starpu_driver_test_request_completion(struct _starpu_async_channel *as
 	}
 #endif /* !SIMGRID */
 }
+
+/*
+ * RAM copy engine
+ *
+ * Large RAM-to-RAM copies are split into pieces which are copied in parallel
+ * by the requesting thread and a few helper threads bound on the cores of the
+ * destination NUMA node, so that the destination pages get written from
+ * there.
+ */
+
+/* Size of the pieces copies are split into */
+#define RAM_COPY_PIECE_SIZE (1UL<<20)
+
+LIST_TYPE(_starpu_ram_copy_job,
+	char *dst;
+	const char *src;
+	size_t blocksize;
+	size_t numblocks;
+	size_t ld_src;
+	size_t ld_dst;
+	/* Number of blocks copied at a time */
+	size_t piece_blocks;
+	/* Next block to be copied */
+	size_t next_block;
+	/* Number of pieces being copied */
+	unsigned running;
+	/* Whether the job is still in the queue */
+	unsigned queued;
+);
+
+struct _starpu_ram_copy_pool;
+
+struct _starpu_ram_copy_helper
+{
+	struct _starpu_ram_copy_pool *pool;
+	/* Logical index of the CPU to bind the helper on */
+	int cpuid;
+	starpu_pthread_t thread;
+};
+
+struct _starpu_ram_copy_pool
+{
+	starpu_pthread_mutex_t mutex;
+	starpu_pthread_cond_t work_cond;
+	starpu_pthread_cond_t done_cond;
+	/* Jobs which still have pieces to be copied */
+	struct _starpu_ram_copy_job_list jobs;
+	unsigned stop;
+	struct _starpu_ram_copy_helper *helpers;
+};
+
+static struct _starpu_ram_copy_pool ram_copy_pools[STARPU_MAXNUMANODES];
+static unsigned ram_copy_npools;
+static unsigned ram_copy_nthreads;
+static size_t ram_copy_min_size;
+static int ram_copy_nt;
+
+/* Copy a contiguous piece, possibly bypassing the cache */
+static void _starpu_ram_copy_block(char *dst, const char *src, size_t size)
+{
+#ifdef __SSE2__
+	if (ram_copy_nt)
+	{
+		/* Align the destination */
+		size_t head = (-(uintptr_t) dst) & 15;
+		if (head > size)
+			head = size;
+		memcpy(dst, src, head);
+		dst += head;
+		src += head;
+		size -= head;
+
+		while (size >= 64)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i *) src);
+			__m128i b = _mm_loadu_si128((const __m128i *) (src + 16));
+			__m128i c = _mm_loadu_si128((const __m128i *) (src + 32));
+			__m128i d = _mm_loadu_si128((const __m128i *) (src + 48));
+			_mm_stream_si128((__m128i *) dst, a);
+			_mm_stream_si128((__m128i *) (dst + 16), b);
+			_mm_stream_si128((__m128i *) (dst + 32), c);
+			_mm_stream_si128((__m128i *) (dst + 48), d);
+			dst += 64;
+			src += 64;
+			size -= 64;
+		}
+		_mm_sfence();
+	}
+#endif
+	memcpy(dst, src, size);
+}
+
+static void _starpu_ram_copy_blocks(struct _starpu_ram_copy_job *job, size_t first, size_t n)
+{
+	char *dst = job->dst + first * job->ld_dst;
+	const char *src = job->src + first * job->ld_src;
+	size_t i;
+
+	if (job->ld_src == job->blocksize && job->ld_dst == job->blocksize)
+	{
+		_starpu_ram_copy_block(dst, src, n * job->blocksize);
+		return;
+	}
+
+	for (i = 0; i < n; i++)
+		_starpu_ram_copy_block(dst + i * job->ld_dst, src + i * job->ld_src, job->blocksize);
+}
+
+/* Take the next piece of the job, called with the pool mutex held */
+static int _starpu_ram_copy_get_piece(struct _starpu_ram_copy_pool *pool, struct _starpu_ram_copy_job *job, size_t *first, size_t *n)
+{
+	if (job->next_block == job->numblocks)
+		return 0;
+
+	*first = job->next_block;
+	*n = STARPU_MIN(job->piece_blocks, job->numblocks - job->next_block);
+	job->next_block += *n;
+	job->running++;
+
+	if (job->next_block == job->numblocks)
+	{
+		/* Nothing left for the other threads */
+		_starpu_ram_copy_job_list_erase(&pool->jobs, job);
+		job->queued = 0;
+	}
+	return 1;
+}
+
+/* Copy a piece of the job, called with the pool mutex held */
+static void _starpu_ram_copy_do_piece(struct _starpu_ram_copy_pool *pool, struct _starpu_ram_copy_job *job, size_t first, size_t n)
+{
+	STARPU_PTHREAD_MUTEX_UNLOCK(&pool->mutex);
+	_starpu_ram_copy_blocks(job, first, n);
+	STARPU_PTHREAD_MUTEX_LOCK(&pool->mutex);
+
+	if (--job->running == 0 && job->next_block == job->numblocks)
+		STARPU_PTHREAD_COND_BROADCAST(&pool->done_cond);
+}
+
+static void *_starpu_ram_copy_helper(void *arg)
+{
+	struct _starpu_ram_copy_helper *helper = arg;
+	struct _starpu_ram_copy_pool *pool = helper->pool;
+
+	_starpu_bind_thread_on_cpu(helper->cpuid, STARPU_NOWORKERID, NULL);
+	starpu_pthread_setname("ram copy");
+
+	STARPU_PTHREAD_MUTEX_LOCK(&pool->mutex);
+	while (1)
+	{
+		struct _starpu_ram_copy_job *job;
+		size_t first, n;
+
+		if (_starpu_ram_copy_job_list_empty(&pool->jobs))
+		{
+			if (pool->stop)
+				break;
+			STARPU_PTHREAD_COND_WAIT(&pool->work_cond, &pool->mutex);
+			continue;
+		}
+
+		job = _starpu_ram_copy_job_list_front(&pool->jobs);
+		if (_starpu_ram_copy_get_piece(pool, job, &first, &n))
+			_starpu_ram_copy_do_piece(pool, job, first, n);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&pool->mutex);
+
+	return NULL;
+}
+
+void _starpu_ram_copy_init(void)
+{
+#ifndef STARPU_SIMGRID
+	struct _starpu_machine_config *config = _starpu_get_machine_config();
+	unsigned nnuma = starpu_memory_nodes_get_numa_count();
+	unsigned numa, i;
+
+	ram_copy_nthreads = starpu_getenv_number_default("STARPU_RAM_COPY_NTHREADS", nnuma > 1 ? 2 : 0);
+	ram_copy_min_size = (size_t) starpu_getenv_number_default("STARPU_RAM_COPY_MIN_SIZE", 4096) << 10;
+	ram_copy_nt = starpu_getenv_number_default("STARPU_RAM_COPY_NT", 0);
+
+	if (!ram_copy_nthreads)
+		return;
+
+	for (numa = 0; numa < nnuma; numa++)
+	{
+		struct _starpu_ram_copy_pool *pool = &ram_copy_pools[numa];
+		unsigned logid = starpu_memory_nodes_numa_id_to_hwloclogid(numa);
+		unsigned cores[STARPU_MAXCPUS];
+		unsigned ncores = _starpu_topology_get_numa_core_binding(config, &logid, 1, cores, STARPU_MAXCPUS);
+
+		STARPU_PTHREAD_MUTEX_INIT(&pool->mutex, NULL);
+		STARPU_PTHREAD_COND_INIT(&pool->work_cond, NULL);
+		STARPU_PTHREAD_COND_INIT(&pool->done_cond, NULL);
+		_starpu_ram_copy_job_list_init(&pool->jobs);
+		pool->stop = 0;
+
+		_STARPU_MALLOC(pool->helpers, ram_copy_nthreads * sizeof(*pool->helpers));
+		for (i = 0; i < ram_copy_nthreads; i++)
+		{
+			struct _starpu_ram_copy_helper *helper = &pool->helpers[i];
+			helper->pool = pool;
+			/* Start from the last cores, the first ones are more
+			 * often used for the main thread */
+			helper->cpuid = ncores ? (int) (cores[ncores - 1 - i % ncores] * _starpu_get_nhyperthreads()) : -1;
+			STARPU_PTHREAD_CREATE(&helper->thread, NULL, _starpu_ram_copy_helper, helper);
+		}
+	}
+	ram_copy_npools = nnuma;
+#endif
+}
+
+void _starpu_ram_copy_shutdown(void)
+{
+	unsigned numa, i;
+
+	for (numa = 0; numa < ram_copy_npools; numa++)
+	{
+		struct _starpu_ram_copy_pool *pool = &ram_copy_pools[numa];
+
+		STARPU_PTHREAD_MUTEX_LOCK(&pool->mutex);
+		pool->stop = 1;
+		STARPU_PTHREAD_COND_BROADCAST(&pool->work_cond);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&pool->mutex);
+
+		for (i = 0; i < ram_copy_nthreads; i++)
+			STARPU_PTHREAD_JOIN(pool->helpers[i].thread, NULL);
+
+		free(pool->helpers);
+		STARPU_PTHREAD_COND_DESTROY(&pool->done_cond);
+		STARPU_PTHREAD_COND_DESTROY(&pool->work_cond);
+		STARPU_PTHREAD_MUTEX_DESTROY(&pool->mutex);
+	}
+	ram_copy_npools = 0;
+}
+
+void _starpu_ram_copy2d(void *dst, const void *src, size_t blocksize, size_t numblocks, size_t ld_src, size_t ld_dst, unsigned dst_node)
+{
+	struct _starpu_ram_copy_job job =
+	{
+		.dst = dst,
+		.src = src,
+		.blocksize = blocksize,
+		.numblocks = numblocks,
+		.ld_src = ld_src,
+		.ld_dst = ld_dst,
+	};
+	struct _starpu_ram_copy_pool *pool;
+	size_t first, n;
+
+	if (blocksize * numblocks < ram_copy_min_size)
+	{
+		/* Not worth bypassing the cache or waking helpers */
+		size_t i;
+		for (i = 0; i < numblocks; i++)
+			memcpy((char *) dst + i * ld_dst, (const char *) src + i * ld_src, blocksize);
+		return;
+	}
+
+	if (!numblocks)
+		return;
+
+	if (dst_node >= ram_copy_npools)
+	{
+		_starpu_ram_copy_blocks(&job, 0, numblocks);
+		return;
+	}
+
+	job.piece_blocks = STARPU_MAX(RAM_COPY_PIECE_SIZE / blocksize, 1);
+	pool = &ram_copy_pools[dst_node];
+
+	STARPU_PTHREAD_MUTEX_LOCK(&pool->mutex);
+	_starpu_ram_copy_job_list_push_back(&pool->jobs, &job);
+	job.queued = 1;
+	STARPU_PTHREAD_COND_BROADCAST(&pool->work_cond);
+
+	/* Contribute to our own copy */
+	while (_starpu_ram_copy_get_piece(pool, &job, &first, &n))
+		_starpu_ram_copy_do_piece(pool, &job, first, n);
+
+	/* And wait for the helpers to finish their pieces */
+	while (job.running)
+		STARPU_PTHREAD_COND_WAIT(&pool->done_cond, &pool->mutex);
+	STARPU_ASSERT(!job.queued);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&pool->mutex);
+}
+
+void _starpu_ram_copy(void *dst, const void *src, size_t size, unsigned dst_node)
+{
+	size_t piece = RAM_COPY_PIECE_SIZE;
+	size_t numblocks = size / piece;
+	size_t tail = size - numblocks * piece;
+
+	if (size < ram_copy_min_size)
+	{
+		memcpy(dst, src, size);
+		return;
+	}
+
+	/* Split the copy into pieces */
+	if (tail)
+		_starpu_ram_copy_block((char *) dst + numblocks * piece, (const char *) src + numblocks * piece, tail);
+	_starpu_ram_copy2d(dst, src, piece, numblocks, piece, piece, dst_node);
+}
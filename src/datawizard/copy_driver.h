@@ -94,6 +94,16 @@ int _starpu_copy_interface_any_to_any(starpu_data_handle_t handle, void *src_int
 unsigned _starpu_driver_test_request_completion(struct _starpu_async_channel *async_channel);
 void _starpu_driver_wait_request_completion(struct _starpu_async_channel *async_channel);
 
+/** Start the helper threads of the RAM copy engine, see STARPU_RAM_COPY_NTHREADS */
+void _starpu_ram_copy_init(void);
+void _starpu_ram_copy_shutdown(void);
+
+/** Copy \p size bytes between RAM buffers, large copies being split among
+ * the helper threads of the destination memory node \p dst_node */
+void _starpu_ram_copy(void *dst, const void *src, size_t size, unsigned dst_node);
+/** Same as _starpu_ram_copy() for \p numblocks blocks of \p blocksize bytes */
+void _starpu_ram_copy2d(void *dst, const void *src, size_t blocksize, size_t numblocks, size_t ld_src, size_t ld_dst, unsigned dst_node);
+
 #ifdef __cplusplus
 }
 #endif
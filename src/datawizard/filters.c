@@ -202,9 +202,9 @@ static void _starpu_data_partition(starpu_data_handle_t initial_handle, starpu_d
 
 	for (node = 0; node < STARPU_MAXNODES; node++)
 	{
-		if (initial_handle->per_node[node].state != STARPU_INVALID)
+		if (_starpu_data_peek_replicate(initial_handle, node)->state != STARPU_INVALID)
 			found = node;
-		STARPU_ASSERT(initial_handle->per_node[node].mapped == STARPU_UNMAPPED);
+		STARPU_ASSERT(_starpu_data_peek_replicate(initial_handle, node)->mapped == STARPU_UNMAPPED);
 	}
 	if (found == STARPU_MAXNODES)
 	{
@@ -214,7 +214,7 @@ static void _starpu_data_partition(starpu_data_handle_t initial_handle, starpu_d
 		int home_node = initial_handle->home_node;
 		if (home_node < 0 || (starpu_node_get_kind(home_node) != STARPU_CPU_RAM))
 			home_node = STARPU_MAIN_RAM;
-		int ret = _starpu_allocate_memory_on_node(initial_handle, &initial_handle->per_node[home_node], STARPU_FETCH, 0);
+		int ret = _starpu_allocate_memory_on_node(initial_handle, _starpu_data_get_replicate(initial_handle, home_node), STARPU_FETCH, 0);
 #ifdef STARPU_DEVEL
 #warning we should reclaim memory if allocation failed
 #endif
@@ -289,8 +289,15 @@ static void _starpu_data_partition(starpu_data_handle_t initial_handle, starpu_d
 			struct _starpu_data_replicate *initial_replicate;
 			struct _starpu_data_replicate *child_replicate;
 
-			initial_replicate = &initial_handle->per_node[node];
-			child_replicate = &child->per_node[node];
+#ifdef STARPU_COMPACT_HANDLES
+			if (child->template_interface && initial_handle->template_interface
+			    && !_starpu_data_has_replicate(initial_handle, node))
+				/* The child does not need it either, it will
+				 * be filtered from the templates below */
+				continue;
+#endif
+			initial_replicate = _starpu_data_get_replicate(initial_handle, node);
+			child_replicate = _starpu_data_get_replicate(child, node);
 
 			if (inherit_state)
 				child_replicate->state = initial_replicate->state;
@@ -324,11 +331,28 @@ static void _starpu_data_partition(starpu_data_handle_t initial_handle, starpu_d
 			f->filter_func(initial_interface, child_interface, f, i, nparts);
 		}
 
+#ifdef STARPU_COMPACT_HANDLES
+		if (child->template_interface)
+		{
+			if (initial_handle->template_interface)
+				f->filter_func(initial_handle->template_interface, child->template_interface, f, i, nparts);
+			else
+			{
+				/* All replicates were allocated above */
+				free(child->template_interface);
+				child->template_interface = NULL;
+			}
+		}
+#endif
+
 		/* We compute the size and the footprint of the child once and
 		 * store it in the handle */
 		child->footprint = _starpu_compute_data_footprint(child);
 
 		_STARPU_TRACE_HANDLE_DATA_REGISTER(child);
+#ifdef STARPU_COMPACT_HANDLES
+		child->registering = 0;
+#endif
 	}
 	/* now let the header */
 	_starpu_spin_unlock(&initial_handle->header_lock);
@@ -468,7 +492,12 @@ void starpu_data_unpartition(starpu_data_handle_t root_handle, unsigned gatherin
 		for (child = 0; child < root_handle->nchildren; child++)
 		{
 			starpu_data_handle_t child_handle = starpu_data_get_child(root_handle, child);
-			local = &child_handle->per_node[node];
+			if (!_starpu_data_has_replicate(child_handle, node))
+			{
+				isvalid = 0;
+				continue;
+			}
+			local = _starpu_data_get_replicate(child_handle, node);
 
 			if (local->state == STARPU_INVALID || local->automatically_allocated == 1)
 			{
@@ -481,7 +510,14 @@ void starpu_data_unpartition(starpu_data_handle_t root_handle, unsigned gatherin
 				_starpu_request_mem_chunk_removal(child_handle, local, node, sizes[child]);
 		}
 
-		local = &root_handle->per_node[node];
+		if (!_starpu_data_has_replicate(root_handle, node))
+		{
+			/* The data never went there */
+			still_valid[node] = 0;
+			continue;
+		}
+
+		local = _starpu_data_get_replicate(root_handle, node);
 
 		if (!local->allocated)
 			/* Even if we have all the bits, if we don't have the
@@ -505,7 +541,8 @@ void starpu_data_unpartition(starpu_data_handle_t root_handle, unsigned gatherin
 
 	for (node = 0; node < STARPU_MAXNODES; node++)
 	{
-		root_handle->per_node[node].state = still_valid[node]?newstate:STARPU_INVALID;
+		if (_starpu_data_has_replicate(root_handle, node))
+			_starpu_data_get_replicate(root_handle, node)->state = still_valid[node]?newstate:STARPU_INVALID;
 	}
 
 	for (child = 0; child < root_handle->nchildren; child++)
@@ -530,7 +567,9 @@ void starpu_data_unpartition(starpu_data_handle_t root_handle, unsigned gatherin
 		{
 			struct _starpu_data_replicate *root_replicate;
 
-			root_replicate = &root_handle->per_node[node];
+			if (!_starpu_data_has_replicate(root_handle, node))
+				continue;
+			root_replicate = _starpu_data_get_replicate(root_handle, node);
 			root_replicate->initialized = still_valid[node];
 		}
 	}
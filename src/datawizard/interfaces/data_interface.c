@@ -35,6 +35,9 @@ static unsigned _id_to_ops_array_size;
 
 /* Hash table mapping host pointers to data handles.  */
 static int32_t nregistered, maxnregistered;
+#ifdef STARPU_COMPACT_HANDLES
+static int32_t nreplicates, maxnreplicates;
+#endif
 static int _data_interface_number = STARPU_MAX_INTERFACE_ID;
 starpu_arbiter_t _starpu_global_arbiter;
 static int max_memory_use;
@@ -57,9 +60,58 @@ void _starpu_data_interface_init(void)
 void _starpu_data_interface_fini(void)
 {
 	if (max_memory_use)
+	{
 		_STARPU_DISP("Memory used for %d data handles: %lu MiB\n", maxnregistered, (unsigned long) (maxnregistered * sizeof(struct _starpu_data_state)) >> 20);
+#ifdef STARPU_COMPACT_HANDLES
+		_STARPU_DISP("Memory used for %d data replicates: %lu MiB (without interfaces)\n", maxnreplicates, (unsigned long) (maxnreplicates * sizeof(struct _starpu_data_replicate)) >> 20);
+#endif
+	}
 }
 
+#ifdef STARPU_COMPACT_HANDLES
+const struct _starpu_data_replicate _starpu_unallocated_replicate =
+{
+	.state = STARPU_INVALID,
+	.mapped = STARPU_UNMAPPED,
+};
+
+/* Allocate the replicate of the handle on the given node, with its interface
+ * copied from the template. This may race with other threads doing the same,
+ * only one of them wins. */
+struct _starpu_data_replicate *_starpu_data_allocate_replicate(starpu_data_handle_t handle, unsigned node)
+{
+	struct _starpu_data_replicate *replicate;
+	size_t interfacesize = handle->ops->interface_size;
+
+	/* The interface is allocated along the replicate */
+	_STARPU_CALLOC(replicate, 1, sizeof(*replicate) + interfacesize);
+	replicate->handle = handle;
+	replicate->memory_node = node;
+	replicate->state = STARPU_INVALID;
+	replicate->mapped = STARPU_UNMAPPED;
+	replicate->data_interface = replicate + 1;
+	replicate->refcnt = handle->lock_all_refcnt;
+	if (handle->template_interface && !handle->registering)
+		memcpy(replicate->data_interface, handle->template_interface, interfacesize);
+	else if (handle->ops->init)
+		handle->ops->init(replicate->data_interface);
+
+	if (!STARPU_BOOL_COMPARE_AND_SWAP_PTR(&handle->per_node[node], NULL, replicate))
+	{
+		/* Somebody else allocated it in the meanwhile */
+		free(replicate);
+		return handle->per_node[node];
+	}
+
+	if (max_memory_use)
+	{
+		(void)STARPU_ATOMIC_ADD(&nreplicates, 1);
+		_starpu_perf_counter_update_max_int32(&maxnreplicates, nreplicates);
+	}
+	return replicate;
+}
+#endif
+
 void _starpu_data_interface_shutdown()
 {
 	free(_id_to_ops_array);
@@ -168,7 +220,10 @@ static void _starpu_register_new_data(starpu_data_handle_t handle, int home_node
 	for (node = 0; node < STARPU_MAXNODES; node++)
 	{
 		struct _starpu_data_replicate *replicate;
-		replicate = &handle->per_node[node];
+		if ((int) node != home_node && !_starpu_data_has_replicate(handle, node))
+			/* Not allocated yet, thus invalid */
+			continue;
+		replicate = _starpu_data_get_replicate(handle, node);
 
 		replicate->memory_node = node;
 		//replicate->relaxed_coherency = 0;
@@ -194,6 +249,10 @@ static void _starpu_register_new_data(starpu_data_handle_t handle, int home_node
 		replicate->mapped = STARPU_UNMAPPED;
 	}
 
+#ifdef STARPU_COMPACT_HANDLES
+	handle->registering = 0;
+#endif
+
 	/* now the data is available ! */
 	_starpu_spin_unlock(&handle->header_lock);
 	(void)STARPU_ATOMIC_ADD(&nregistered, 1);
@@ -238,13 +297,13 @@ void _starpu_data_initialize_per_worker(starpu_data_handle_t handle)
 
 		_STARPU_CALLOC(replicate->data_interface, 1, interfacesize);
 		/* duplicate  the content of the interface on node 0 */
-		memcpy(replicate->data_interface, handle->per_node[STARPU_MAIN_RAM].data_interface, interfacesize);
+		memcpy(replicate->data_interface, starpu_data_get_interface_on_node(handle, STARPU_MAIN_RAM), interfacesize);
 	}
 }
 
 void starpu_data_ptr_register(starpu_data_handle_t handle, unsigned node)
 {
-	struct _starpu_data_replicate *replicate = &handle->per_node[node];
+	struct _starpu_data_replicate *replicate = _starpu_data_get_replicate(handle, node);
 
 	_starpu_spin_lock(&handle->header_lock);
 	STARPU_ASSERT_MSG(replicate->allocated == 0, "starpu_data_ptr_register must be called right after starpu_data_register");
@@ -308,10 +367,26 @@ int _starpu_data_handle_init(starpu_data_handle_t handle, struct starpu_data_int
 	handle->ops = interface_ops;
 	size_t interfacesize = interface_ops->interface_size;
 
+#ifdef STARPU_COMPACT_HANDLES
+	/* Interfaces which need to release per-node data on unregistration
+	 * can not share a template, allocate all their replicates upfront */
+	unsigned compact = !interface_ops->unregister_data_handle;
+	if (compact)
+	{
+		_STARPU_CALLOC(handle->template_interface, 1, interfacesize);
+		if (handle->ops->init) handle->ops->init(handle->template_interface);
+		handle->registering = 1;
+	}
+#endif
+
 	for (node = 0; node < STARPU_MAXNODES; node++)
 	{
 		_starpu_memory_stats_init_per_node(handle, node);
 
+#ifdef STARPU_COMPACT_HANDLES
+		if (!compact)
+			_starpu_data_allocate_replicate(handle, node);
+#else
 		struct _starpu_data_replicate *replicate;
 		replicate = &handle->per_node[node];
 		/* relaxed_coherency = 0 */
@@ -320,6 +395,7 @@ int _starpu_data_handle_init(starpu_data_handle_t handle, struct starpu_data_int
 
 		_STARPU_CALLOC(replicate->data_interface, 1, interfacesize);
 		if (handle->ops->init) handle->ops->init(replicate->data_interface);
+#endif
 	}
 
 	//handle->per_worker = NULL;
@@ -452,6 +528,11 @@ void starpu_data_register(starpu_data_handle_t *handleptr, int home_node, void *
 
 	/* fill the interface fields with the appropriate method */
 	STARPU_ASSERT(ops->register_data_handle);
+#ifdef STARPU_COMPACT_HANDLES
+	/* So that starpu_data_get_interface_on_node knows which replicate to
+	 * allocate */
+	handle->home_node = home_node;
+#endif
 	ops->register_data_handle(handle, home_node, data_interface);
 
 	_starpu_data_register_ops(ops);
@@ -460,6 +541,71 @@ void starpu_data_register(starpu_data_handle_t *handleptr, int home_node, void *
 	_STARPU_TRACE_HANDLE_DATA_REGISTER(handle);
 }
 
+/* Handles registered together by starpu_data_register_array */
+struct _starpu_data_slab
+{
+	/* Number of handles which are not unregistered yet */
+	int nhandles;
+	struct _starpu_data_state handles[];
+};
+
+void starpu_data_register_array(starpu_data_handle_t *handleptrs, unsigned nhandles, int home_node, void *data_interfaces, struct starpu_data_interface_ops *ops)
+{
+	STARPU_ASSERT_MSG(home_node >= -1 && home_node < (int)starpu_memory_nodes_get_count(), "Invalid memory node number");
+	STARPU_ASSERT(handleptrs);
+	STARPU_ASSERT(ops->register_data_handle);
+
+	if (!nhandles)
+		return;
+
+	/* Allocate all the handles at once, already zeroed */
+	struct _starpu_data_slab *slab;
+	_STARPU_CALLOC(slab, 1, sizeof(*slab) + nhandles * sizeof(struct _starpu_data_state));
+	slab->nhandles = nhandles;
+
+	/* The interface operations only need to be set up once */
+	if (ops->interfaceid == STARPU_UNKNOWN_INTERFACE_ID)
+		ops->interfaceid = starpu_data_interface_get_next_id();
+	_starpu_data_register_ops(ops);
+
+	unsigned i;
+	/* Only the allocation is shared, each handle still gets its own
+	 * header and per-node interfaces */
+	for (i = 0; i < nhandles; i++)
+	{
+		starpu_data_handle_t handle = &slab->handles[i];
+		void *data_interface = (char *) data_interfaces + i * ops->interface_size;
+
+		_starpu_data_handle_init(handle, ops, home_node);
+		handle->slab = slab;
+		handleptrs[i] = handle;
+
+#ifdef STARPU_COMPACT_HANDLES
+		handle->home_node = home_node;
+#endif
+		ops->register_data_handle(handle, home_node, data_interface);
+
+		_starpu_register_new_data(handle, home_node, 0);
+		_STARPU_TRACE_HANDLE_DATA_REGISTER(handle);
+	}
+}
+
+/* Free the handle structure itself, or its slab once all of its handles are
+ * unregistered */
+static void _starpu_data_handle_free(starpu_data_handle_t handle)
+{
+	struct _starpu_data_slab *slab = handle->slab;
+
+	if (!slab)
+	{
+		free(handle);
+		return;
+	}
+
+	if (STARPU_ATOMIC_ADD(&slab->nhandles, -1) == 0)
+		free(slab);
+}
+
 void starpu_data_register_same(starpu_data_handle_t *handledst, starpu_data_handle_t handlesrc)
 {
 	void *local_interface = starpu_data_get_interface_on_node(handlesrc, STARPU_MAIN_RAM);
@@ -504,8 +650,23 @@ void _starpu_data_free_interfaces(starpu_data_handle_t handle)
 	if (handle->ops->unregister_data_handle)
 		handle->ops->unregister_data_handle(handle);
 
+#ifdef STARPU_COMPACT_HANDLES
+	for (node = 0; node < STARPU_MAXNODES; node++)
+	{
+		if (!handle->per_node[node])
+			continue;
+		/* The interface was allocated along the replicate */
+		free(handle->per_node[node]);
+		handle->per_node[node] = NULL;
+		if (max_memory_use)
+			(void)STARPU_ATOMIC_ADD(&nreplicates, -1);
+	}
+	free(handle->template_interface);
+	handle->template_interface = NULL;
+#else
 	for (node = 0; node < STARPU_MAXNODES; node++)
 		free(handle->per_node[node].data_interface);
+#endif
 
 	if (handle->per_worker)
 	{
@@ -572,7 +733,7 @@ void _starpu_check_if_valid_and_fetch_data_on_node(starpu_data_handle_t handle,
 	_starpu_spin_lock(&handle->header_lock);
 	for (node = 0; node < nnodes; node++)
 	{
-		if (handle->per_node[node].state != STARPU_INVALID)
+		if (_starpu_data_peek_replicate(handle, node)->state != STARPU_INVALID)
 		{
 			/* we found a copy ! */
 			valid = 1;
@@ -602,7 +763,7 @@ static void _starpu_data_unregister_fetch_data_callback(void *_arg)
 
 	STARPU_ASSERT(handle);
 
-	struct _starpu_data_replicate *replicate = &handle->per_node[arg->memory_node];
+	struct _starpu_data_replicate *replicate = _starpu_data_get_replicate(handle, arg->memory_node);
 
 	_starpu_check_if_valid_and_fetch_data_on_node(handle, replicate, "_starpu_data_unregister_fetch_data_callback");
 
@@ -703,7 +864,7 @@ static void _starpu_data_unregister(starpu_data_handle_t handle, unsigned cohere
 					_starpu_data_unregister_fetch_data_callback, &arg))
 			{
 				/* no one has locked this data yet, so we proceed immediately */
-				struct _starpu_data_replicate *home_replicate = &handle->per_node[home_node];
+				struct _starpu_data_replicate *home_replicate = _starpu_data_get_replicate(handle, home_node);
 				_starpu_check_if_valid_and_fetch_data_on_node(handle, home_replicate, "_starpu_data_unregister");
 			}
 			else
@@ -832,7 +993,9 @@ retry_busy:
 	/* Destroy the data now */
 	for (node = 0; node < STARPU_MAXNODES; node++)
 	{
-		struct _starpu_data_replicate *local = &handle->per_node[node];
+		if (!_starpu_data_has_replicate(handle, node))
+			continue;
+		struct _starpu_data_replicate *local = _starpu_data_get_replicate(handle, node);
 		STARPU_ASSERT(!local->refcnt);
 		if (local->allocated)
 		{
@@ -884,7 +1047,7 @@ retry_busy:
 		free(handle->switch_cl);
 	}
 	_STARPU_TRACE_HANDLE_DATA_UNREGISTER(handle);
-	free(handle);
+	_starpu_data_handle_free(handle);
 	(void)STARPU_ATOMIC_ADD(&nregistered, -1);
 }
 
@@ -930,6 +1093,117 @@ void starpu_data_unregister_submit(starpu_data_handle_t handle)
 	starpu_data_acquire_on_node_cb(handle, STARPU_ACQUIRE_NO_NODE_LOCK_ALL, handle->initialized?STARPU_RW:STARPU_W, _starpu_data_unregister_submit_cb, handle);
 }
 
+/* Maximum number of handles unregistered by a single sweep task */
+#define UNREGISTER_SWEEP_NHANDLES 256
+
+static struct starpu_codelet _starpu_data_unregister_sweep_cl =
+{
+	.where = STARPU_NOWHERE,
+	.nbuffers = STARPU_VARIABLE_NBUFFERS,
+	.name = "unregister_sweep",
+};
+
+/* Called while the sweep task still holds its handles: they will get
+ * unregistered as soon as the task releases them */
+static void _starpu_data_unregister_sweep_cb(void *arg)
+{
+	struct starpu_task *task = arg;
+	unsigned i;
+
+	for (i = 0; i < (unsigned) task->nbuffers; i++)
+	{
+		starpu_data_handle_t handle = task->dyn_handles[i];
+		_starpu_spin_lock(&handle->header_lock);
+		handle->lazy_unregister = 1;
+		STARPU_ASSERT(handle->busy_count);
+		_starpu_spin_unlock(&handle->header_lock);
+	}
+}
+
+static void _starpu_data_unregister_sweep_submit(starpu_data_handle_t *handles, enum starpu_data_access_mode *modes, unsigned nhandles)
+{
+	struct starpu_task *task = starpu_task_create();
+	task->name = "unregister_sweep";
+	task->cl = &_starpu_data_unregister_sweep_cl;
+	task->nbuffers = nhandles;
+	task->dyn_handles = handles;
+	task->dyn_modes = modes;
+	task->epilogue_callback_func = _starpu_data_unregister_sweep_cb;
+	task->epilogue_callback_arg = task;
+	int ret = _starpu_task_submit_internally(task);
+	STARPU_ASSERT(!ret);
+}
+
+#ifndef STARPU_NO_ASSERT
+static int _starpu_data_handle_ptr_cmp(const void *a, const void *b)
+{
+	uintptr_t ha = (uintptr_t) *(const starpu_data_handle_t *) a;
+	uintptr_t hb = (uintptr_t) *(const starpu_data_handle_t *) b;
+	return ha < hb ? -1 : ha > hb;
+}
+
+/* A handle may only appear once in the array, or once per alias */
+static void _starpu_data_check_unique_handles(starpu_data_handle_t *handles, unsigned nhandles)
+{
+	starpu_data_handle_t *sorted;
+	unsigned i, n;
+
+	_STARPU_MALLOC(sorted, nhandles * sizeof(*sorted));
+	memcpy(sorted, handles, nhandles * sizeof(*sorted));
+	qsort(sorted, nhandles, sizeof(*sorted), _starpu_data_handle_ptr_cmp);
+	for (i = 0; i < nhandles; i += n)
+	{
+		for (n = 1; i + n < nhandles && sorted[i + n] == sorted[i]; n++)
+			;
+		STARPU_ASSERT_MSG(n <= (unsigned) sorted[i]->aliases + 1, "data %p appears %u times in the array, it can not be unregistered twice", sorted[i], n);
+	}
+	free(sorted);
+}
+#endif
+
+void starpu_data_unregister_submit_array(starpu_data_handle_t *handles, unsigned nhandles)
+{
+	starpu_data_handle_t *sweep_handles = NULL;
+	enum starpu_data_access_mode *sweep_modes = NULL;
+	unsigned nsweep = 0;
+	unsigned i;
+
+#ifndef STARPU_NO_ASSERT
+	_starpu_data_check_unique_handles(handles, nhandles);
+#endif
+
+	for (i = 0; i < nhandles; i++)
+	{
+		starpu_data_handle_t handle = handles[i];
+		STARPU_ASSERT_MSG(handle->magic == 42, "data %p is invalid (was it already registered?)", handle);
+		STARPU_ASSERT_MSG(!handle->lazy_unregister, "data %p can not be unregistered twice", handle);
+
+		if (!_starpu_ro_data_detach(handle))
+			continue;
+
+		if (!sweep_handles)
+		{
+			_STARPU_MALLOC(sweep_handles, UNREGISTER_SWEEP_NHANDLES * sizeof(*sweep_handles));
+			_STARPU_MALLOC(sweep_modes, UNREGISTER_SWEEP_NHANDLES * sizeof(*sweep_modes));
+		}
+		sweep_handles[nsweep] = handle;
+		sweep_modes[nsweep] = handle->initialized?STARPU_RW:STARPU_W;
+		nsweep++;
+
+		if (nsweep == UNREGISTER_SWEEP_NHANDLES)
+		{
+			/* The task will free the arrays */
+			_starpu_data_unregister_sweep_submit(sweep_handles, sweep_modes, nsweep);
+			sweep_handles = NULL;
+			sweep_modes = NULL;
+			nsweep = 0;
+		}
+	}
+
+	if (nsweep)
+		_starpu_data_unregister_sweep_submit(sweep_handles, sweep_modes, nsweep);
+}
+
 static void _starpu_data_invalidate(void *data)
 {
 	starpu_data_handle_t handle = data;
@@ -944,7 +1218,7 @@ static void _starpu_data_invalidate(void *data)
 		unsigned i, j, nnodes = starpu_memory_nodes_get_count();
 		for (i = 0; i < nnodes; i++)
 			for (j = 0; j < nnodes; j++)
-				STARPU_ASSERT_MSG(!handle->per_node[i].request[j], "request for handle %p pending from %u to %u while invalidating data!", handle, j, i);
+				STARPU_ASSERT_MSG(!_starpu_data_peek_replicate(handle, i)->request[j], "request for handle %p pending from %u to %u while invalidating data!", handle, j, i);
 	}
 #endif
 
@@ -952,13 +1226,15 @@ static void _starpu_data_invalidate(void *data)
 
 	for (node = 0; node < STARPU_MAXNODES; node++)
 	{
-		struct _starpu_data_replicate *local = &handle->per_node[node];
+		if (!_starpu_data_has_replicate(handle, node))
+			continue;
+		struct _starpu_data_replicate *local = _starpu_data_get_replicate(handle, node);
 
 		if (local->mc && local->allocated && local->automatically_allocated)
 		{
 			unsigned mapping;
 			for (mapping = 0; mapping < STARPU_MAXNODES; mapping++)
-				if (handle->per_node[mapping].mapped == (int) node)
+				if (_starpu_data_peek_replicate(handle, mapping)->mapped == (int) node)
 					break;
 
 			if (mapping == STARPU_MAXNODES)
@@ -1031,7 +1307,13 @@ enum starpu_data_interface_id starpu_data_get_interface_id(starpu_data_handle_t
 
 void *starpu_data_get_interface_on_node(starpu_data_handle_t handle, unsigned memory_node)
 {
-	return handle->per_node[memory_node].data_interface;
+#ifdef STARPU_COMPACT_HANDLES
+	if (STARPU_UNLIKELY(handle->registering) && !handle->per_node[memory_node] && (int) memory_node != handle->home_node)
+		/* The handle is being set up, the interface of the replicates
+		 * which are not allocated is the template */
+		return handle->template_interface;
+#endif
+	return _starpu_data_get_replicate(handle, memory_node)->data_interface;
 }
 
 int starpu_data_interface_get_next_id(void)
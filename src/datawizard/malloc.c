@@ -29,9 +29,13 @@
 #include <datawizard/malloc.h>
 #include <core/simgrid.h>
 #include <core/task.h>
+#include <common/uthash.h>
 
-#ifdef STARPU_SIMGRID
+#if defined(STARPU_SIMGRID) || defined(HAVE_MMAP)
 #include <sys/mman.h>
+#endif
+
+#ifdef STARPU_SIMGRID
 #include <fcntl.h>
 #include <smpi/smpi.h>
 #endif
@@ -57,13 +61,55 @@
 static size_t _malloc_align = sizeof(void*);
 static int disable_pinning;
 static int enable_suballocator;
+static int numa_migrate;
+
+/* Huge page backend: 0 disabled, 1 transparent huge pages, 2 hugetlbfs pages
+ * with fallback to transparent huge pages */
+static int hugepages;
+static size_t hugepages_size;
+static unsigned hugepages_shift;
+static size_t hugepages_min_size;
+static size_t hugepages_cache_max;
+static int hugepages_shutdown;
+static starpu_pthread_mutex_t hugepages_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+
+/* A memory area allocated with huge pages */
+LIST_TYPE(_starpu_hugepages_area,
+	void *addr;
+	unsigned node;
+	/* Size of the mapping, i.e. rounded up to the size class */
+	size_t size;
+	/* Backed by hugetlbfs pages, otherwise only advised for transparent huge pages */
+	int hugetlb;
+	int pinned;
+	/* Kept in the cache while still accounted with STARPU_MALLOC_COUNT */
+	int counted;
+	UT_hash_handle hh;
+)
+
+/* Areas in use, by address */
+static struct _starpu_hugepages_area *hugepages_used;
+/* Areas freed by the application, kept for reuse within the same size class */
+static struct _starpu_hugepages_area_list hugepages_cache[STARPU_MAXNODES];
+static size_t hugepages_cached[STARPU_MAXNODES];
+
+static struct
+{
+	unsigned long nalloc_hugetlb;
+	unsigned long nalloc_thp;
+	unsigned long nalloc_small;
+	unsigned long nfallback;
+	unsigned long nreuse;
+	size_t bytes_hugetlb;
+	size_t bytes_thp;
+	size_t bytes_small;
+} hugepages_stats[STARPU_MAXNODES];
 
 /* This file is used for implementing "folded" allocation */
 #ifdef STARPU_SIMGRID
 static int bogusfile = -1;
 static unsigned long _starpu_malloc_simulation_fold;
 /* Table to control unique simulation mallocs */
-#include <common/uthash.h>
 struct unique_shared_alloc
 {
         size_t id;
@@ -185,9 +231,334 @@ int _starpu_malloc_willpin_on_node(unsigned dst_node)
 			));
 }
 
+/* Bind the area \p A on the NUMA node \p dst_node, possibly moving the pages already there */
+static int _starpu_malloc_membind(unsigned dst_node STARPU_ATTRIBUTE_UNUSED, void *A STARPU_ATTRIBUTE_UNUSED, size_t dim STARPU_ATTRIBUTE_UNUSED, int migrate STARPU_ATTRIBUTE_UNUSED)
+{
+#if defined(STARPU_HAVE_HWLOC) && !defined(STARPU_SIMGRID)
+	struct _starpu_machine_config *config = _starpu_get_machine_config();
+	hwloc_topology_t hwtopology = config->topology.hwtopology;
+	hwloc_obj_t numa_node_obj = hwloc_get_obj_by_type(hwtopology, HWLOC_OBJ_NUMANODE, starpu_memory_nodes_numa_id_to_hwloclogid(dst_node));
+	int flags = HWLOC_MEMBIND_NOCPUBIND;
+
+	if (!numa_node_obj)
+		return -1;
+	if (migrate)
+		flags |= HWLOC_MEMBIND_MIGRATE;
+#if HWLOC_API_VERSION >= 0x00020000
+	return hwloc_set_area_membind(hwtopology, A, dim, numa_node_obj->nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET | flags);
+#else
+	return hwloc_set_area_membind_nodeset(hwtopology, A, dim, numa_node_obj->nodeset, HWLOC_MEMBIND_BIND, flags);
+#endif
+#else
+	return 0;
+#endif
+}
+
+/* Return whether this allocation should be backed by huge pages */
+static int _starpu_malloc_should_hugepage(unsigned dst_node, size_t dim, int flags STARPU_ATTRIBUTE_UNUSED)
+{
+	if (!hugepages || hugepages_shutdown || dim < hugepages_min_size
+	    || starpu_node_get_kind(dst_node) != STARPU_CPU_RAM)
+		return 0;
+#if defined(STARPU_USE_CUDA) && !defined(STARPU_HAVE_CUDA_MEMCPY_PEER)
+	/* Without peer support, we can not pin from any thread */
+	if (_starpu_malloc_should_pin(flags) && _starpu_can_submit_cuda_task())
+		return 0;
+#endif
+	return 1;
+}
+
+/* Round up an allocation size to its size class. Beyond 4 huge pages, classes
+ * are spaced by a quarter of the power of two below, so that areas can be
+ * reused for similar sizes while wasting at most 25% of the memory */
+static size_t _starpu_hugepages_class(size_t dim)
+{
+	size_t npages = (dim + hugepages_size - 1) / hugepages_size;
+
+	if (npages > 4)
+	{
+		unsigned log2 = 0;
+		size_t step;
+
+		while (npages >> (log2+1))
+			log2++;
+		step = (size_t) 1 << (log2 - 2);
+		npages = (npages + step - 1) / step * step;
+	}
+	return npages * hugepages_size;
+}
+
+/* Map a new area of \p size bytes with huge pages */
+static void *_starpu_hugepages_map(unsigned dst_node, size_t size, int *hugetlb)
+{
+#if defined(HAVE_MMAP) && !defined(STARPU_SIMGRID)
+	void *addr = MAP_FAILED;
+
+	*hugetlb = 0;
+#ifdef MAP_HUGETLB
+	if (hugepages == 2)
+	{
+		int mflags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+		mflags |= hugepages_shift << MAP_HUGE_SHIFT;
+#endif
+		addr = mmap(NULL, size, PROT_READ | PROT_WRITE, mflags, -1, 0);
+		if (addr != MAP_FAILED)
+			*hugetlb = 1;
+		else
+			/* No huge pages reserved, or none left */
+			hugepages_stats[dst_node].nfallback++;
+	}
+#endif
+	if (addr == MAP_FAILED)
+	{
+		/* Over-allocate to align the area on the huge page size, so
+		 * that it can be completely backed by transparent huge pages */
+		size_t len = size + hugepages_size;
+		char *raw = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		char *aligned;
+
+		if (raw == MAP_FAILED)
+			return NULL;
+		aligned = (char *) (((uintptr_t) raw + hugepages_size - 1) & ~(uintptr_t) (hugepages_size - 1));
+		if (aligned != raw)
+			munmap(raw, aligned - raw);
+		munmap(aligned + size, raw + len - (aligned + size));
+		addr = aligned;
+#ifdef MADV_HUGEPAGE
+		madvise(addr, size, MADV_HUGEPAGE);
+#endif
+	}
+
+	/* Bind before the pages get touched */
+	if (starpu_memory_nodes_get_numa_count() > 1)
+		_starpu_malloc_membind(dst_node, addr, size, 0);
+	return addr;
+#else
+	(void) dst_node;
+	(void) size;
+	(void) hugetlb;
+	return NULL;
+#endif
+}
+
+static void _starpu_hugepages_unmap(struct _starpu_hugepages_area *area)
+{
+	if (area->pinned)
+		starpu_memory_unpin(area->addr, area->size);
+#if defined(HAVE_MMAP) && !defined(STARPU_SIMGRID)
+	munmap(area->addr, area->size);
+#endif
+	_starpu_hugepages_area_delete(area);
+}
+
+/* Release the areas kept for reuse on \p dst_node. Called with hugepages_mutex held */
+static size_t _starpu_hugepages_flush(unsigned dst_node)
+{
+	size_t freed = hugepages_cached[dst_node];
+
+	while (!_starpu_hugepages_area_list_empty(&hugepages_cache[dst_node]))
+	{
+		struct _starpu_hugepages_area *area = _starpu_hugepages_area_list_pop_front(&hugepages_cache[dst_node]);
+		if (area->counted)
+			starpu_memory_deallocate(dst_node, area->size);
+		_starpu_hugepages_unmap(area);
+	}
+	hugepages_cached[dst_node] = 0;
+	return freed;
+}
+
+size_t _starpu_malloc_hugepages_reclaim(unsigned dst_node)
+{
+	size_t freed;
+
+	if (!hugepages)
+		return 0;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&hugepages_mutex);
+	freed = _starpu_hugepages_flush(dst_node);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&hugepages_mutex);
+	return freed;
+}
+
+/* Allocate \p dim bytes with huge pages, reusing a free area of the same size class if possible */
+static int _starpu_malloc_hugepages(unsigned dst_node, void **A, size_t dim, int flags)
+{
+	size_t size = _starpu_hugepages_class(dim);
+	int pin = _starpu_malloc_should_pin(flags);
+	struct _starpu_hugepages_area *area;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&hugepages_mutex);
+	for (area = _starpu_hugepages_area_list_begin(&hugepages_cache[dst_node]);
+	     area != _starpu_hugepages_area_list_end(&hugepages_cache[dst_node]);
+	     area = _starpu_hugepages_area_list_next(area))
+		if (area->size == size)
+			break;
+
+	if (area != _starpu_hugepages_area_list_end(&hugepages_cache[dst_node]))
+	{
+		_starpu_hugepages_area_list_erase(&hugepages_cache[dst_node], area);
+		hugepages_cached[dst_node] -= size;
+		hugepages_stats[dst_node].nreuse++;
+		if (area->counted)
+		{
+			/* The new allocation accounts for it by itself */
+			starpu_memory_deallocate(dst_node, size);
+			area->counted = 0;
+		}
+	}
+	else
+	{
+		int hugetlb;
+		void *addr = _starpu_hugepages_map(dst_node, size, &hugetlb);
+
+		if (!addr && hugepages_cached[dst_node])
+		{
+			/* Give the cached areas back to the system and retry */
+			_starpu_hugepages_flush(dst_node);
+			addr = _starpu_hugepages_map(dst_node, size, &hugetlb);
+		}
+		if (!addr)
+		{
+			STARPU_PTHREAD_MUTEX_UNLOCK(&hugepages_mutex);
+			return -ENOMEM;
+		}
+		area = _starpu_hugepages_area_new();
+		area->addr = addr;
+		area->node = dst_node;
+		area->size = size;
+		area->hugetlb = hugetlb;
+		area->pinned = 0;
+		area->counted = 0;
+	}
+
+	if (area->hugetlb)
+	{
+		hugepages_stats[dst_node].nalloc_hugetlb++;
+		hugepages_stats[dst_node].bytes_hugetlb += dim;
+	}
+	else
+	{
+		hugepages_stats[dst_node].nalloc_thp++;
+		hugepages_stats[dst_node].bytes_thp += dim;
+	}
+	HASH_ADD_PTR(hugepages_used, addr, area);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&hugepages_mutex);
+
+	if (pin && !area->pinned)
+	{
+		if (starpu_memory_pin(area->addr, area->size))
+		{
+			/* Let the normal pinned allocation do its job */
+			STARPU_PTHREAD_MUTEX_LOCK(&hugepages_mutex);
+			HASH_DEL(hugepages_used, area);
+			STARPU_PTHREAD_MUTEX_UNLOCK(&hugepages_mutex);
+			_starpu_hugepages_unmap(area);
+			return -EINVAL;
+		}
+		area->pinned = 1;
+	}
+
+	*A = area->addr;
+	return 0;
+}
+
+/* Free \p A if it was allocated with huge pages, and return 0, otherwise return
+ * -ENOENT. The allocation accounted for the whole size class, which is given
+ * back here, or kept accounted while the area stays in the cache. */
+static int _starpu_free_hugepages(void *A, int flags)
+{
+	struct _starpu_hugepages_area *area;
+	unsigned dst_node;
+
+	if (!hugepages_used)
+		return -ENOENT;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&hugepages_mutex);
+	HASH_FIND_PTR(hugepages_used, &A, area);
+	if (!area)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&hugepages_mutex);
+		return -ENOENT;
+	}
+	HASH_DEL(hugepages_used, area);
+	dst_node = area->node;
+
+	if (!hugepages_shutdown && hugepages_cached[dst_node] + area->size <= hugepages_cache_max)
+	{
+		/* Keep it for later allocations, avoiding the cost of
+		 * faulting the huge pages again */
+		_starpu_hugepages_area_list_push_front(&hugepages_cache[dst_node], area);
+		hugepages_cached[dst_node] += area->size;
+		area->counted = !!(flags & STARPU_MALLOC_COUNT);
+		area = NULL;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&hugepages_mutex);
+
+	if (area)
+	{
+		if (flags & STARPU_MALLOC_COUNT)
+			starpu_memory_deallocate(dst_node, area->size);
+		_starpu_hugepages_unmap(area);
+	}
+	return 0;
+}
+
+void _starpu_malloc_hugepages_shutdown(void)
+{
+	unsigned node;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&hugepages_mutex);
+	/* Areas still in use will be unmapped when the application frees them */
+	hugepages_shutdown = 1;
+	for (node = 0; node < STARPU_MAXNODES; node++)
+		if (hugepages_cached[node])
+			_starpu_hugepages_flush(node);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&hugepages_mutex);
+}
+
+void _starpu_malloc_display_hugepages_stats(FILE *stream)
+{
+	unsigned node;
+
+	if (!hugepages)
+		return;
+
+	fprintf(stream, "\n#---------------------\n");
+	fprintf(stream, "Huge page allocation stats:\n");
+	STARPU_PTHREAD_MUTEX_LOCK(&hugepages_mutex);
+	for (node = 0; node < STARPU_MAXNODES; node++)
+	{
+		unsigned long nalloc = hugepages_stats[node].nalloc_hugetlb + hugepages_stats[node].nalloc_thp + hugepages_stats[node].nalloc_small;
+		size_t bytes = hugepages_stats[node].bytes_hugetlb + hugepages_stats[node].bytes_thp + hugepages_stats[node].bytes_small;
+		char name[128];
+
+		if (!nalloc)
+			continue;
+		starpu_memory_node_get_name(node, name, sizeof(name));
+		fprintf(stream, "memory node %s\n", name);
+		fprintf(stream, "\thugetlb pages: %lu alloc (%2.2f %%) %lu MiB (%2.2f %%)\n",
+			hugepages_stats[node].nalloc_hugetlb, (100.*hugepages_stats[node].nalloc_hugetlb)/nalloc,
+			(unsigned long) (hugepages_stats[node].bytes_hugetlb >> 20), (100.*hugepages_stats[node].bytes_hugetlb)/bytes);
+		fprintf(stream, "\ttransparent huge pages: %lu alloc (%2.2f %%) %lu MiB (%2.2f %%)\n",
+			hugepages_stats[node].nalloc_thp, (100.*hugepages_stats[node].nalloc_thp)/nalloc,
+			(unsigned long) (hugepages_stats[node].bytes_thp >> 20), (100.*hugepages_stats[node].bytes_thp)/bytes);
+		fprintf(stream, "\tsmall pages: %lu alloc (%2.2f %%) %lu MiB (%2.2f %%)\n",
+			hugepages_stats[node].nalloc_small, (100.*hugepages_stats[node].nalloc_small)/nalloc,
+			(unsigned long) (hugepages_stats[node].bytes_small >> 20), (100.*hugepages_stats[node].bytes_small)/bytes);
+		fprintf(stream, "\treused areas: %lu, hugetlb fallbacks: %lu\n",
+			hugepages_stats[node].nreuse, hugepages_stats[node].nfallback);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&hugepages_mutex);
+	fprintf(stream, "#---------------------\n");
+}
+
 int _starpu_malloc_flags_on_node(unsigned dst_node, void **A, size_t dim, int flags)
 {
 	int ret=0;
+	int hugepage;
+	int counted = 0;
+	size_t count_dim;
 
 	STARPU_ASSERT_MSG(A, "starpu_malloc needs to be passed the address of the pointer to be filled");
 	if (!starpu_is_initialized())
@@ -197,18 +568,35 @@ int _starpu_malloc_flags_on_node(unsigned dst_node, void **A, size_t dim, int fl
 		/* Make sure we succeed */
 		dim = 1;
 
-	if (flags & STARPU_MALLOC_COUNT)
+	/* Huge page areas take their whole size class */
+	hugepage = !malloc_hook && _starpu_malloc_should_hugepage(dst_node, dim, flags);
+	count_dim = hugepage ? _starpu_hugepages_class(dim) : dim;
+
+	if ((flags & STARPU_MALLOC_COUNT) && hugepage)
+	{
+		if (starpu_memory_allocate(dst_node, count_dim, flags & ~STARPU_MEMORY_WAIT) == 0)
+			counted = 1;
+		else
+		{
+			/* Rather use small pages than reclaim memory for the
+			 * rounding up */
+			hugepage = 0;
+			count_dim = dim;
+		}
+	}
+
+	if ((flags & STARPU_MALLOC_COUNT) && !counted)
 	{
 		if (!(flags & STARPU_MALLOC_NORECLAIM))
-			while (starpu_memory_allocate(dst_node, dim, flags) != 0)
+			while (starpu_memory_allocate(dst_node, count_dim, flags) != 0)
 			{
 				size_t freed;
-				size_t reclaim = 2 * dim;
+				size_t reclaim = 2 * count_dim;
 				_STARPU_DEBUG("There is not enough memory left, we are going to reclaim %ld\n", (long)reclaim);
 				_STARPU_TRACE_START_MEMRECLAIM(dst_node,0);
 				freed = _starpu_memory_reclaim_generic(dst_node, 0, reclaim, STARPU_FETCH);
 				_STARPU_TRACE_END_MEMRECLAIM(dst_node,0);
-				if (freed < dim && !(flags & STARPU_MEMORY_WAIT))
+				if (freed < count_dim && !(flags & STARPU_MEMORY_WAIT))
 				{
 					// We could not reclaim enough memory
 					*A = NULL;
@@ -216,9 +604,9 @@ int _starpu_malloc_flags_on_node(unsigned dst_node, void **A, size_t dim, int fl
 				}
 			}
 		else if (flags & STARPU_MEMORY_WAIT)
-			starpu_memory_allocate(dst_node, dim, flags);
+			starpu_memory_allocate(dst_node, count_dim, flags);
 		else
-			starpu_memory_allocate(dst_node, dim, flags | STARPU_MEMORY_OVERFLOW);
+			starpu_memory_allocate(dst_node, count_dim, flags | STARPU_MEMORY_OVERFLOW);
 	}
 
 	if (malloc_hook)
@@ -227,6 +615,25 @@ int _starpu_malloc_flags_on_node(unsigned dst_node, void **A, size_t dim, int fl
 		goto end;
 	}
 
+	if (hugepage)
+	{
+		ret = _starpu_malloc_hugepages(dst_node, A, dim, flags);
+		if (ret == 0)
+			goto end;
+		/* Fallback to the normal allocation */
+		ret = 0;
+		if (flags & STARPU_MALLOC_COUNT)
+			starpu_memory_deallocate(dst_node, count_dim - dim);
+		count_dim = dim;
+	}
+	if (hugepages && starpu_node_get_kind(dst_node) == STARPU_CPU_RAM)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&hugepages_mutex);
+		hugepages_stats[dst_node].nalloc_small++;
+		hugepages_stats[dst_node].bytes_small += dim;
+		STARPU_PTHREAD_MUTEX_UNLOCK(&hugepages_mutex);
+	}
+
 	/* Note: synchronize this test with _starpu_malloc_willpin_on_node */
 	if (_starpu_malloc_should_pin(flags) && STARPU_RUNNING_ON_VALGRIND == 0)
 	{
@@ -526,12 +933,31 @@ end:
 	}
 	else if (flags & STARPU_MALLOC_COUNT)
 	{
-		starpu_memory_deallocate(dst_node, dim);
+		starpu_memory_deallocate(dst_node, count_dim);
 	}
 
 	return ret;
 }
 
+int _starpu_malloc_migrate_enabled(void)
+{
+	return numa_migrate > 0 && starpu_memory_nodes_get_numa_count() > 1;
+}
+
+void _starpu_malloc_migrate_on_node(unsigned dst_node, void *A, size_t dim)
+{
+	uintptr_t page_size = getpagesize();
+	uintptr_t start = (uintptr_t) A & ~(page_size - 1);
+
+	if (!A)
+		return;
+
+	/* The kernel only migrates whole pages */
+	dim += (uintptr_t) A - start;
+	if (_starpu_malloc_membind(dst_node, (void *) start, dim, 1))
+		_STARPU_DEBUG("could not migrate %lu bytes to node %u: %s\n", (unsigned long) dim, dst_node, strerror(errno));
+}
+
 int starpu_malloc(void **A, size_t dim)
 {
 	return starpu_malloc_flags(A, dim, STARPU_MALLOC_PINNED);
@@ -595,6 +1021,10 @@ int _starpu_free_flags_on_node(unsigned dst_node, void *A, size_t dim, int flags
 		goto out;
 	}
 
+	if (_starpu_free_hugepages(A, flags) == 0)
+		/* Accounted by itself */
+		return 0;
+
 	if (_starpu_malloc_should_pin(flags) && STARPU_RUNNING_ON_VALGRIND == 0)
 	{
 		if (_starpu_can_submit_cuda_task())
@@ -852,6 +1282,17 @@ _starpu_malloc_init(unsigned dst_node)
 	STARPU_PTHREAD_MUTEX_INIT(&node_struct->chunk_mutex, NULL);
 	disable_pinning = starpu_getenv_number("STARPU_DISABLE_PINNING");
 	enable_suballocator = starpu_getenv_number_default("STARPU_SUBALLOCATOR", 1);
+	numa_migrate = starpu_getenv_number_default("STARPU_NUMA_MIGRATE", 0);
+	hugepages = starpu_getenv_number_default("STARPU_HUGEPAGES", 0);
+	hugepages_size = (size_t) starpu_getenv_number_default("STARPU_HUGEPAGES_SIZE", 2048) << 10;
+	STARPU_ASSERT_MSG(hugepages_size && !(hugepages_size & (hugepages_size - 1)), "STARPU_HUGEPAGES_SIZE must be a power of two");
+	for (hugepages_shift = 0; ((size_t) 1 << hugepages_shift) < hugepages_size; hugepages_shift++)
+		;
+	hugepages_min_size = (size_t) starpu_getenv_number_default("STARPU_HUGEPAGES_MIN_SIZE", hugepages_size >> 10) << 10;
+	hugepages_cache_max = (size_t) starpu_getenv_number_default("STARPU_HUGEPAGES_CACHE", 256) << 20;
+	hugepages_shutdown = 0;
+	_starpu_hugepages_area_list_init(&hugepages_cache[dst_node]);
+	memset(&hugepages_stats[dst_node], 0, sizeof(hugepages_stats[dst_node]));
 	node_struct->malloc_on_node_default_flags = STARPU_MALLOC_PINNED | STARPU_MALLOC_COUNT;
 #ifdef STARPU_SIMGRID
 	/* Reasonably "costless" */
@@ -34,6 +34,34 @@ int _starpu_free_flags_on_node(unsigned dst_node, void *A, size_t dim, int flags
  */
 int _starpu_malloc_willpin_on_node(unsigned dst_node);
 
+/**
+ * Returns whether the pages of data mapped between NUMA nodes should be
+ * migrated to the node which gets write access, see STARPU_NUMA_MIGRATE
+ */
+int _starpu_malloc_migrate_enabled(void);
+
+/**
+ * Migrate the pages of the RAM area \p A of size \p dim to the NUMA node
+ * \p dst_node
+ */
+void _starpu_malloc_migrate_on_node(unsigned dst_node, void *A, size_t dim);
+
+/**
+ * Release the huge page areas kept for reuse, see STARPU_HUGEPAGES
+ */
+void _starpu_malloc_hugepages_shutdown(void);
+
+/**
+ * Release the huge page areas kept for reuse on \p dst_node, when the memory
+ * manager needs room. Return the number of bytes released.
+ */
+size_t _starpu_malloc_hugepages_reclaim(unsigned dst_node);
+
+/**
+ * Display how much of the RAM allocations were backed by huge pages
+ */
+void _starpu_malloc_display_hugepages_stats(FILE *stream);
+
 /**
  * On CUDA which has very expensive malloc, for small sizes, allocate big
  * chunks divided in blocks, and we actually allocate segments of consecutive
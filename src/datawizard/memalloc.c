@@ -18,6 +18,7 @@
 #include <datawizard/memory_manager.h>
 #include <datawizard/memory_nodes.h>
 #include <datawizard/memalloc.h>
+#include <datawizard/malloc.h>
 #include <datawizard/footprint.h>
 #include <core/disk.h>
 #include <core/topology.h>
@@ -242,7 +243,7 @@ static int lock_all_subtree(starpu_data_handle_t handle)
 
 static unsigned may_free_handle(starpu_data_handle_t handle, unsigned node)
 {
-	STARPU_ASSERT(handle->per_node[node].mapped == STARPU_UNMAPPED);
+	STARPU_ASSERT(_starpu_data_peek_replicate(handle, node)->mapped == STARPU_UNMAPPED);
 
 	/* we only free if no one refers to the leaf */
 	uint32_t refcnt = _starpu_get_data_refcnt(handle, node);
@@ -295,8 +296,8 @@ static int STARPU_ATTRIBUTE_WARN_UNUSED_RESULT transfer_subtree_to_node(starpu_d
 
 	if (handle->nchildren == 0)
 	{
-		struct _starpu_data_replicate *src_replicate = &handle->per_node[src_node];
-		struct _starpu_data_replicate *dst_replicate = &handle->per_node[dst_node];
+		struct _starpu_data_replicate *src_replicate = _starpu_data_get_replicate(handle, src_node);
+		struct _starpu_data_replicate *dst_replicate = _starpu_data_get_replicate(handle, dst_node);
 
 		STARPU_ASSERT(src_replicate->mapped == STARPU_UNMAPPED);
 		STARPU_ASSERT(dst_replicate->mapped == STARPU_UNMAPPED);
@@ -341,7 +342,7 @@ static int STARPU_ATTRIBUTE_WARN_UNUSED_RESULT transfer_subtree_to_node(starpu_d
 			/* count the number of copies */
 			for (i = 0; i < STARPU_MAXNODES; i++)
 			{
-				if (handle->per_node[i].state == STARPU_SHARED)
+				if (_starpu_data_peek_replicate(handle, i)->state == STARPU_SHARED)
 				{
 					cnt++;
 					last = i;
@@ -351,9 +352,9 @@ static int STARPU_ATTRIBUTE_WARN_UNUSED_RESULT transfer_subtree_to_node(starpu_d
 
 			if (cnt == 1)
 			{
-				if (handle->per_node[last].state != STARPU_OWNER)
+				if (_starpu_data_peek_replicate(handle, last)->state != STARPU_OWNER)
 					_STARPU_TRACE_DATA_STATE_OWNER(handle, last);
-				handle->per_node[last].state = STARPU_OWNER;
+				_starpu_data_get_replicate(handle, last)->state = STARPU_OWNER;
 			}
 
 		}
@@ -393,7 +394,7 @@ static void notify_handle_children(starpu_data_handle_t handle, struct _starpu_d
 	{
 		/* Notify children that their buffer has been deallocated too */
 		starpu_data_handle_t child_handle = starpu_data_get_child(handle, child);
-		notify_handle_children(child_handle, &child_handle->per_node[node], node);
+		notify_handle_children(child_handle, _starpu_data_get_replicate(child_handle, node), node);
 	}
 }
 
@@ -540,7 +541,7 @@ int starpu_data_can_evict(starpu_data_handle_t handle, unsigned node, enum starp
 
 	unsigned mapnode;
 	for (mapnode = 0; mapnode < STARPU_MAXNODES; mapnode++)
-		if (handle->per_node[mapnode].mapped == (int) node)
+		if (_starpu_data_peek_replicate(handle, mapnode)->mapped == (int) node)
 			/* This is mapped, we can't evict it */
 			/* TODO: rather check if that can be evicted as well, and if so unmap it before evicting this */
 			return 0;
@@ -550,7 +551,7 @@ int starpu_data_can_evict(starpu_data_handle_t handle, unsigned node, enum starp
 		&& starpu_memory_nodes_get_numa_count() == 1)
 		return 0;
 
-	if (is_prefetch >= STARPU_TASK_PREFETCH && handle->per_node[node].nb_tasks_prefetch)
+	if (is_prefetch >= STARPU_TASK_PREFETCH && _starpu_data_peek_replicate(handle, node)->nb_tasks_prefetch)
 		/* We have not finished executing the tasks this was prefetched for */
 		return 0;
 
@@ -625,7 +626,7 @@ static size_t try_to_throw_mem_chunk(struct _starpu_mem_chunk *mc, unsigned node
 	else if (lock_all_subtree(handle))
 	/* try to lock all the subtree */
 	{
-	    if (!(replicate && handle->per_node[node].state == STARPU_OWNER))
+	    if (!(replicate && _starpu_data_peek_replicate(handle, node)->state == STARPU_OWNER))
 	    {
 		/* check if they are all "free" */
 		if (may_free_subtree(handle, node))
@@ -634,7 +635,7 @@ static size_t try_to_throw_mem_chunk(struct _starpu_mem_chunk *mc, unsigned node
 
 			/* XXX Considering only owner to invalidate */
 
-			STARPU_ASSERT(handle->per_node[node].refcnt == 0);
+			STARPU_ASSERT(_starpu_data_peek_replicate(handle, node)->refcnt == 0);
 
 			/* in case there was nobody using that buffer, throw it
 			 * away after writing it back to main memory */
@@ -648,7 +649,7 @@ static size_t try_to_throw_mem_chunk(struct _starpu_mem_chunk *mc, unsigned node
 				 * If there are none, we prefer to let generic eviction
 				 * perhaps find other kinds of memchunks which will be
 				 * earlier in LRU, and easier to throw away. */
-				!(replicate && handle->per_node[node].state == STARPU_OWNER))
+				!(replicate && _starpu_data_peek_replicate(handle, node)->state == STARPU_OWNER))
 			{
 				int res;
 				/* Should have been avoided in our caller */
@@ -656,7 +657,7 @@ static size_t try_to_throw_mem_chunk(struct _starpu_mem_chunk *mc, unsigned node
 				mc->remove_notify = &mc;
 				_starpu_spin_unlock(&_starpu_get_node_struct(node)->mc_lock);
 #ifdef STARPU_MEMORY_STATS
-				if (handle->per_node[node].state == STARPU_OWNER)
+				if (_starpu_data_peek_replicate(handle, node)->state == STARPU_OWNER)
 					_starpu_memory_handle_stats_invalidated(handle, node);
 #endif
 			       _STARPU_TRACE_START_WRITEBACK(node, handle);
@@ -695,7 +696,7 @@ static size_t try_to_throw_mem_chunk(struct _starpu_mem_chunk *mc, unsigned node
 						 * handle, now free it.
 						 */
 
-						if (handle->per_node[node].refcnt == 0)
+						if (_starpu_data_peek_replicate(handle, node)->refcnt == 0)
 						{
 							/* And still nobody on it, now the actual buffer may be reused or freed */
 							if (replicate)
@@ -761,7 +762,7 @@ static struct _starpu_mem_chunk *_starpu_memchunk_cache_lookup_locked(unsigned n
 	     mc = _starpu_mem_chunk_list_next(mc))
 	{
 		/* Is that a false hit ? (this is _very_ unlikely) */
-		if (_starpu_data_interface_compare(handle->per_node[node].data_interface, handle->ops, mc->chunk_interface, mc->ops) != 1)
+		if (_starpu_data_interface_compare(_starpu_data_get_replicate(handle, node)->data_interface, handle->ops, mc->chunk_interface, mc->ops) != 1)
 			continue;
 
 		/* Cache hit */
@@ -825,7 +826,7 @@ restart:
 		if (!mc->data->is_not_important)
 			/* Important data, skip */
 			continue;
-		if (mc->footprint != footprint || _starpu_data_interface_compare(data->per_node[node].data_interface, data->ops, mc->data->per_node[node].data_interface, mc->ops) != 1)
+		if (mc->footprint != footprint || _starpu_data_interface_compare(_starpu_data_get_replicate(data, node)->data_interface, data->ops, _starpu_data_get_replicate(mc->data, node)->data_interface, mc->ops) != 1)
 			/* Not the right type of interface, skip */
 			continue;
 		if (next_mc)
@@ -926,7 +927,7 @@ restart:
 		if (victim && mc->data != victim)
 			/* We were advised some precise data */
 			continue;
-		if (mc->footprint != footprint || _starpu_data_interface_compare(handle->per_node[node].data_interface, handle->ops, mc->data->per_node[node].data_interface, mc->ops) != 1)
+		if (mc->footprint != footprint || _starpu_data_interface_compare(_starpu_data_get_replicate(handle, node)->data_interface, handle->ops, _starpu_data_get_replicate(mc->data, node)->data_interface, mc->ops) != 1)
 			/* Not the right type of interface, skip */
 			continue;
 		if (next_mc)
@@ -1148,6 +1149,9 @@ size_t _starpu_memory_reclaim_generic(unsigned node, unsigned force, size_t recl
 		}
 	}
 
+	/* drop the huge page areas kept for reuse */
+	freed += _starpu_malloc_hugepages_reclaim(node);
+
 	/* remove all buffers for which there was a removal request */
 	freed += flush_memchunk_cache(node, reclaim);
 
@@ -1176,7 +1180,7 @@ int starpu_data_evict_from_node(starpu_data_handle_t handle, unsigned node)
 	if (handle->per_worker)
 		replicate = &handle->per_worker[node];
 	else
-		replicate = &handle->per_node[node];
+		replicate = _starpu_data_get_replicate(handle, node);
 
 	_starpu_spin_lock(&handle->header_lock);
 
@@ -1304,7 +1308,7 @@ void starpu_memchunk_tidy(unsigned node)
 			}
 
 			if (handle->home_node != -1 &&
-				(handle->per_node[handle->home_node].state != STARPU_INVALID
+				(_starpu_data_peek_replicate(handle, handle->home_node)->state != STARPU_INVALID
 				 || mc->relaxed_coherency == 1))
 			{
 				/* It's available in the home node, this should have been marked as clean already */
@@ -1343,7 +1347,7 @@ void starpu_memchunk_tidy(unsigned node)
 			}
 
 			_starpu_spin_unlock(&node_struct->mc_lock);
-			if (!_starpu_create_request_to_fetch_data(handle, &handle->per_node[target_node], STARPU_R, NULL, STARPU_IDLEFETCH, 1, NULL, NULL, 0, "starpu_memchunk_tidy"))
+			if (!_starpu_create_request_to_fetch_data(handle, _starpu_data_get_replicate(handle, target_node), STARPU_R, NULL, STARPU_IDLEFETCH, 1, NULL, NULL, 0, "starpu_memchunk_tidy"))
 			{
 				/* No request was actually needed??
 				 * Odd, but cope with it.  */
@@ -1768,13 +1772,13 @@ int _starpu_allocate_memory_on_node(starpu_data_handle_t handle, struct _starpu_
 
 unsigned starpu_data_test_if_allocated_on_node(starpu_data_handle_t handle, unsigned memory_node)
 {
-	return handle->per_node[memory_node].allocated || handle->per_node[memory_node].mapped != STARPU_UNMAPPED;
+	return _starpu_data_peek_replicate(handle, memory_node)->allocated || _starpu_data_peek_replicate(handle, memory_node)->mapped != STARPU_UNMAPPED;
 }
 
 unsigned starpu_data_test_if_mapped_on_node(starpu_data_handle_t handle, unsigned memory_node)
 {
 	STARPU_ASSERT(memory_node < STARPU_MAXNODES);
-	return handle->per_node[memory_node].allocated;
+	return _starpu_data_peek_replicate(handle, memory_node)->allocated;
 }
 
 /* This memchunk has been recently used, put it last on the mc_list, so we will
@@ -1913,7 +1917,7 @@ get_better_disk_can_accept_size(starpu_data_handle_t handle, unsigned node)
 	for (i = 0; i < nnodes; i++)
 	{
 		if (starpu_node_get_kind(i) == STARPU_DISK_RAM && i != node &&
-		    (handle->per_node[i].allocated ||
+		    (_starpu_data_peek_replicate(handle, i)->allocated ||
 		     _starpu_memory_manager_test_allocate_size(i, _starpu_data_get_alloc_size(handle)) == 1))
 		{
 			/* if we can write on the disk */
@@ -1955,7 +1959,7 @@ choose_target(starpu_data_handle_t handle, unsigned node)
 			unsigned nb_numa_nodes = starpu_memory_nodes_get_numa_count();
 			for (i=0; i<nb_numa_nodes; i++)
 			{
-				if (handle->per_node[i].allocated ||
+				if (_starpu_data_peek_replicate(handle, i)->allocated ||
 				    _starpu_memory_manager_test_allocate_size(i, size_handle) == 1)
 				{
 					target = i;
@@ -1987,7 +1991,7 @@ choose_target(starpu_data_handle_t handle, unsigned node)
 			unsigned nb_numa_nodes = starpu_memory_nodes_get_numa_count();
 			for (i=0; i<nb_numa_nodes; i++)
 			{
-				if (handle->per_node[i].allocated ||
+				if (_starpu_data_peek_replicate(handle, i)->allocated ||
 				    _starpu_memory_manager_test_allocate_size(i, size_handle) == 1)
 				{
 					target = i;
@@ -0,0 +1,375 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <common/config.h>
+#include <common/list.h>
+#include <common/utils.h>
+#include <core/disk.h>
+#include <core/jobs.h>
+#include <core/workers.h>
+#include <datawizard/coherency.h>
+#include <datawizard/memalloc.h>
+#include <datawizard/readahead.h>
+
+/*
+ * Each worker has a window of the tasks which were pushed to it and whose
+ * prefetch from the disk was deferred, in push order. The prefetches of the
+ * first _starpu_readahead_ntasks entries are issued, as long as the amount of
+ * data being read ahead into the memory node of the worker stays within the
+ * budget. When the budget tightens, e.g. because the application allocated
+ * memory meanwhile, the prefetches of the last entries are cancelled: their
+ * data is marked as the first to be evicted. Requests still in flight can not
+ * be cancelled, they will just complete.
+ */
+
+LIST_TYPE(_starpu_readahead,
+	struct starpu_task *task;
+	int workerid;
+	int prio;
+	/** Amount of data to be read from the disk */
+	size_t size;
+	/** Whether the prefetches were issued */
+	unsigned issued;
+);
+
+unsigned _starpu_readahead_ntasks;
+int _starpu_readahead_stats;
+
+/* Protects the windows and the budgets */
+static starpu_pthread_mutex_t readahead_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+static struct _starpu_readahead_list windows[STARPU_NMAXWORKERS];
+/* Amount of data being read ahead into each memory node */
+static size_t inflight[STARPU_MAXNODES];
+/* Configured budget for each memory node, 0 when not computed yet */
+static size_t budget[STARPU_MAXNODES];
+static long readahead_mem;
+
+/* Set in the job when the task already started fetching its data, in case the
+ * scheduler records the prefetch after the worker popped the task */
+static struct _starpu_readahead started;
+#define READAHEAD_STARTED (&started)
+
+static unsigned long nissued, ncancelled;
+static size_t bytes_issued, bytes_cancelled;
+
+/* Time spent by workers waiting for their data, only updated by the worker itself */
+static double wait_start[STARPU_NMAXWORKERS];
+static double wait_time[STARPU_NMAXWORKERS];
+
+void _starpu_readahead_init(void)
+{
+	unsigned worker;
+
+	_starpu_readahead_ntasks = starpu_getenv_number_default("STARPU_DISK_READAHEAD", 0);
+	_starpu_readahead_stats = starpu_getenv_number_default("STARPU_DISK_READAHEAD_STATS", 0);
+	readahead_mem = starpu_getenv_number_default("STARPU_DISK_READAHEAD_MEM", -1);
+
+	for (worker = 0; worker < STARPU_NMAXWORKERS; worker++)
+	{
+		_starpu_readahead_list_init(&windows[worker]);
+		wait_time[worker] = 0.;
+		wait_start[worker] = 0.;
+	}
+	memset(inflight, 0, sizeof(inflight));
+	memset(budget, 0, sizeof(budget));
+	nissued = ncancelled = 0;
+	bytes_issued = bytes_cancelled = 0;
+}
+
+int _starpu_readahead_from_disk(starpu_data_handle_t handle, unsigned node)
+{
+	unsigned nnodes = starpu_memory_nodes_get_count();
+	unsigned i;
+	int on_disk = 0;
+
+	if (starpu_node_get_kind(node) != STARPU_CPU_RAM)
+		return 0;
+
+	/* This is only a hint, no need to take the header lock */
+	if (_starpu_data_peek_replicate(handle, node)->state != STARPU_INVALID)
+		return 0;
+
+	for (i = 0; i < nnodes; i++)
+	{
+		if (_starpu_data_peek_replicate(handle, i)->state == STARPU_INVALID)
+			continue;
+		if (starpu_node_get_kind(i) != STARPU_DISK_RAM)
+			/* Can be fetched from another memory node */
+			return 0;
+		on_disk = 1;
+	}
+	return on_disk;
+}
+
+/* Budget for the data being read ahead into memory node \p node */
+static size_t effective_budget(unsigned node)
+{
+	starpu_ssize_t available;
+	size_t max;
+
+	if (!budget[node])
+	{
+		if (readahead_mem >= 0)
+			budget[node] = (size_t) readahead_mem * 1024 * 1024;
+		else
+		{
+			starpu_ssize_t total = starpu_memory_get_total(node);
+			if (total > 0)
+				budget[node] = total / 8;
+			else
+				budget[node] = 256 * 1024 * 1024;
+		}
+	}
+
+	available = starpu_memory_get_available(node);
+	if (available < 0)
+		return budget[node];
+
+	/* Do not use more than half of the memory that the rest of the
+	 * application does not use */
+	max = ((size_t) available + inflight[node]) / 2;
+	return STARPU_MIN(budget[node], max);
+}
+
+static void issue(struct _starpu_readahead *r)
+{
+	struct starpu_task *task = r->task;
+	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
+	unsigned index;
+
+	for (index = 0; index < nbuffers; index++)
+	{
+		starpu_data_handle_t handle = STARPU_TASK_GET_HANDLE(task, index);
+		enum starpu_data_access_mode mode = STARPU_TASK_GET_MODE(task, index);
+
+		if (mode & (STARPU_SCRATCH|STARPU_REDUX))
+			continue;
+
+		int node = _starpu_task_data_get_node_on_worker(task, index, r->workerid);
+		if (node < 0 || !_starpu_readahead_from_disk(handle, node))
+			continue;
+
+		struct _starpu_data_replicate *replicate = _starpu_data_get_replicate(handle, node);
+		_starpu_fetch_data_on_node(handle, node, replicate, mode, 1, task, STARPU_TASK_PREFETCH, 1, NULL, NULL, r->prio, "_starpu_readahead_issue");
+	}
+}
+
+/* Release the data which was read ahead for \p r, so it gets evicted first */
+static void cancel(struct _starpu_readahead *r)
+{
+	struct starpu_task *task = r->task;
+	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
+	unsigned nnodes = starpu_memory_nodes_get_count();
+	unsigned index, i;
+
+	for (index = 0; index < nbuffers; index++)
+	{
+		starpu_data_handle_t handle = STARPU_TASK_GET_HANDLE(task, index);
+		enum starpu_data_access_mode mode = STARPU_TASK_GET_MODE(task, index);
+
+		if (mode & (STARPU_SCRATCH|STARPU_REDUX))
+			continue;
+
+		int node = _starpu_task_data_get_node_on_worker(task, index, r->workerid);
+		if (node < 0 || starpu_node_get_kind(node) != STARPU_CPU_RAM)
+			continue;
+
+		_starpu_spin_lock(&handle->header_lock);
+		if (_starpu_data_has_replicate(handle, node))
+		{
+			struct _starpu_data_replicate *local = _starpu_data_get_replicate(handle, node);
+			int on_disk = 0;
+
+			for (i = 0; i < nnodes; i++)
+				if (starpu_node_get_kind(i) == STARPU_DISK_RAM &&
+					_starpu_data_peek_replicate(handle, i)->state != STARPU_INVALID)
+					on_disk = 1;
+
+			/* Only drop data which did arrive and can be read
+			 * again from the disk */
+			if (on_disk && local->state != STARPU_INVALID && local->nb_tasks_prefetch > 0)
+			{
+				local->nb_tasks_prefetch--;
+				if (local->allocated && local->automatically_allocated && !local->refcnt)
+					_starpu_memchunk_wont_use(local->mc, node);
+			}
+		}
+		_starpu_spin_unlock(&handle->header_lock);
+	}
+}
+
+/* Issue the prefetches of the window of \p workerid, and cancel the last
+ * ones if the budget got exceeded. Called with readahead_mutex held */
+static void progress(int workerid)
+{
+	unsigned node = starpu_worker_get_memory_node(workerid);
+	struct _starpu_readahead_list *window = &windows[workerid];
+	struct _starpu_readahead *r;
+	size_t max = effective_budget(node);
+	unsigned n = 0;
+
+	for (r = _starpu_readahead_list_begin(window);
+	     r != _starpu_readahead_list_end(window) && n < _starpu_readahead_ntasks;
+	     r = _starpu_readahead_list_next(r), n++)
+	{
+		if (r->issued)
+			continue;
+		/* Always let the head of the window go, it will be needed soon anyway */
+		if (n > 0 && inflight[node] + r->size > max)
+			break;
+		r->issued = 1;
+		inflight[node] += r->size;
+		nissued++;
+		bytes_issued += r->size;
+		issue(r);
+	}
+
+	if (inflight[node] <= max)
+		return;
+
+	/* The budget tightened, cancel from the end of the window */
+	for (r = _starpu_readahead_list_last(window);
+	     r != _starpu_readahead_list_alpha(window) && inflight[node] > max;
+	     r = _starpu_readahead_list_prev(r))
+	{
+		if (!r->issued || r == _starpu_readahead_list_front(window))
+			continue;
+		r->issued = 0;
+		inflight[node] -= r->size;
+		ncancelled++;
+		bytes_cancelled += r->size;
+		cancel(r);
+	}
+}
+
+void _starpu_readahead_push(struct starpu_task *task, int workerid, int prio, size_t size)
+{
+	struct _starpu_job *j = _starpu_get_job_associated_to_task(task);
+	struct _starpu_readahead *r = _starpu_readahead_new();
+
+	r->task = task;
+	r->workerid = workerid;
+	r->prio = prio;
+	r->size = size;
+	r->issued = 0;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&readahead_mutex);
+	if (j->readahead == READAHEAD_STARTED)
+	{
+		/* Too late, the worker is already fetching the data */
+		STARPU_PTHREAD_MUTEX_UNLOCK(&readahead_mutex);
+		_starpu_readahead_delete(r);
+		return;
+	}
+	STARPU_ASSERT(!j->readahead);
+	j->readahead = r;
+	_starpu_readahead_list_push_back(&windows[workerid], r);
+	progress(workerid);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&readahead_mutex);
+}
+
+void _starpu_readahead_task_start(struct _starpu_job *j, struct _starpu_worker *worker)
+{
+	if (_starpu_readahead_stats)
+	{
+		if (worker->ntasks <= 1)
+			wait_start[worker->workerid] = starpu_timing_now();
+		else
+			/* The worker is still busy with another task */
+			wait_start[worker->workerid] = 0.;
+	}
+
+	if (!_starpu_readahead_ntasks)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&readahead_mutex);
+	struct _starpu_readahead *r = j->readahead;
+	j->readahead = READAHEAD_STARTED;
+	if (!r)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&readahead_mutex);
+		return;
+	}
+	int workerid = r->workerid;
+
+	_starpu_readahead_list_erase(&windows[workerid], r);
+	if (r->issued)
+		inflight[starpu_worker_get_memory_node(workerid)] -= r->size;
+	_starpu_readahead_delete(r);
+
+	/* Let the next task enter the window */
+	progress(workerid);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&readahead_mutex);
+}
+
+void _starpu_readahead_task_ready(struct _starpu_job *j, struct _starpu_worker *worker)
+{
+	if (_starpu_readahead_stats && wait_start[worker->workerid] != 0.)
+		wait_time[worker->workerid] += starpu_timing_now() - wait_start[worker->workerid];
+
+	if (_starpu_readahead_ntasks)
+	{
+		/* The task may get submitted again */
+		STARPU_PTHREAD_MUTEX_LOCK(&readahead_mutex);
+		j->readahead = NULL;
+		STARPU_PTHREAD_MUTEX_UNLOCK(&readahead_mutex);
+	}
+}
+
+void _starpu_readahead_shutdown(void)
+{
+	unsigned worker;
+
+	if (_starpu_readahead_stats)
+	{
+		unsigned nnodes = starpu_memory_nodes_get_count();
+		unsigned nworkers = starpu_worker_get_count();
+		unsigned node;
+		double wait = 0.;
+
+		for (worker = 0; worker < nworkers; worker++)
+			wait += wait_time[worker];
+
+		fprintf(stderr, "\n#---------------------\n");
+		fprintf(stderr, "Disk read-ahead stats (%u tasks per worker):\n", _starpu_readahead_ntasks);
+		fprintf(stderr, "\t%lu tasks read ahead (%.2f MiB), %lu cancelled (%.2f MiB)\n",
+			nissued, (double) bytes_issued / (1024*1024),
+			ncancelled, (double) bytes_cancelled / (1024*1024));
+		for (node = 0; node < nnodes; node++)
+		{
+			double busy, elapsed;
+
+			if (starpu_node_get_kind(node) != STARPU_DISK_RAM)
+				continue;
+			_starpu_disk_get_busy_time(starpu_memory_node_get_devid(node), &busy, &elapsed);
+			fprintf(stderr, "\tdisk node %u idle %.3f s out of %.3f s\n",
+				node, (elapsed - busy) / 1000000., elapsed / 1000000.);
+		}
+		fprintf(stderr, "\tworkers idle waiting for data %.3f s (%.3f s per worker)\n",
+			wait / 1000000., nworkers ? wait / 1000000. / nworkers : 0.);
+		fprintf(stderr, "#---------------------\n");
+	}
+
+	for (worker = 0; worker < STARPU_NMAXWORKERS; worker++)
+	{
+		while (!_starpu_readahead_list_empty(&windows[worker]))
+		{
+			/* Tasks which were never executed */
+			struct _starpu_readahead *r = _starpu_readahead_list_pop_front(&windows[worker]);
+			_starpu_readahead_delete(r);
+		}
+	}
+}
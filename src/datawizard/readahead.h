@@ -0,0 +1,63 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __READAHEAD_H__
+#define __READAHEAD_H__
+
+/** @file */
+
+/* Read-ahead of data from disk memory nodes: instead of prefetching from the
+ * disk the input of all the tasks queued on a worker as soon as they are
+ * scheduled, only the next STARPU_DISK_READAHEAD tasks of each worker get
+ * their data read, within a bounded amount of memory. */
+
+#include <starpu.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+struct _starpu_job;
+struct _starpu_worker;
+
+/** Number of tasks per worker whose data is read ahead from the disk, 0 when
+ * read-ahead is disabled */
+extern unsigned _starpu_readahead_ntasks;
+/** Whether time spent waiting for data should be accounted */
+extern int _starpu_readahead_stats;
+
+void _starpu_readahead_init(void);
+/** Display statistics if requested, and drop the remaining windows. This
+ * has to be called before unregistering disks. */
+void _starpu_readahead_shutdown(void);
+
+/** Return whether the data for \p handle is to be read from the disk to make
+ * it available on \p node, i.e. it is only valid on disk nodes */
+int _starpu_readahead_from_disk(starpu_data_handle_t handle, unsigned node);
+
+/** Record that the prefetch of the data of \p task which is read from disk was
+ * deferred, \p size being the amount of such data, so that it gets issued
+ * once the task enters the read-ahead window of \p worker */
+void _starpu_readahead_push(struct starpu_task *task, int workerid, int prio, size_t size);
+
+/** \p j is starting to fetch its data on worker \p worker, its data does
+ * not need to be read ahead any more */
+void _starpu_readahead_task_start(struct _starpu_job *j, struct _starpu_worker *worker);
+/** \p worker is done fetching the data of \p j */
+void _starpu_readahead_task_ready(struct _starpu_job *j, struct _starpu_worker *worker);
+
+#pragma GCC visibility pop
+
+#endif // __READAHEAD_H__
@@ -216,7 +216,7 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle, int priority)
 
 	for (node = 0; node < STARPU_MAXNODES; node++)
 	{
-		if (handle->per_node[node].state != STARPU_INVALID)
+		if (_starpu_data_peek_replicate(handle, node)->state != STARPU_INVALID)
 			break;
 	}
 	empty = node == STARPU_MAXNODES;
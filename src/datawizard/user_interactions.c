@@ -54,7 +54,7 @@ int starpu_data_request_allocation(starpu_data_handle_t handle, unsigned node)
 
 	_starpu_spin_lock(&handle->header_lock);
 
-	r = _starpu_create_data_request(handle, NULL, &handle->per_node[node], node, STARPU_NONE, 0, NULL, STARPU_PREFETCH, 0, 0, "starpu_data_request_allocation");
+	r = _starpu_create_data_request(handle, NULL, _starpu_data_get_replicate(handle, node), node, STARPU_NONE, 0, NULL, STARPU_PREFETCH, 0, 0, "starpu_data_request_allocation");
 
 	/* we do not increase the refcnt associated to the request since we are
 	 * not waiting for its termination */
@@ -125,7 +125,7 @@ static inline void _starpu_data_acquire_launch_fetch(struct user_interaction_wra
 {
 	int node = wrapper->node;
 	starpu_data_handle_t handle = wrapper->handle;
-	struct _starpu_data_replicate *replicate = node >= 0 ? &handle->per_node[node] : NULL;
+	struct _starpu_data_replicate *replicate = node >= 0 ? _starpu_data_get_replicate(handle, node) : NULL;
 
 	int ret = _starpu_fetch_data_on_node(handle, node, replicate, wrapper->mode, wrapper->detached, NULL, wrapper->prefetch, async, callback, callback_arg, wrapper->prio, "_starpu_data_acquire_launch_fetch");
 	STARPU_ASSERT(!ret);
@@ -516,7 +516,7 @@ void starpu_data_release_to_on_node(starpu_data_handle_t handle, enum starpu_dat
 
 	/* The application can now release the rw-lock */
 	if (node >= 0)
-		_starpu_release_data_on_node(handle, 0, mode, &handle->per_node[node]);
+		_starpu_release_data_on_node(handle, 0, mode, _starpu_data_get_replicate(handle, node));
 	else
 	{
 		_starpu_spin_lock(&handle->header_lock);
@@ -524,7 +524,11 @@ void starpu_data_release_to_on_node(starpu_data_handle_t handle, enum starpu_dat
 		{
 			int i;
 			for (i = 0; i < STARPU_MAXNODES; i++)
-				handle->per_node[i].refcnt--;
+				if (_starpu_data_has_replicate(handle, i))
+					_starpu_data_get_replicate(handle, i)->refcnt--;
+#ifdef STARPU_COMPACT_HANDLES
+			handle->lock_all_refcnt--;
+#endif
 		}
 		handle->busy_count--;
 		if (!_starpu_notify_data_dependencies(handle, mode))
@@ -591,7 +595,7 @@ int _starpu_prefetch_data_on_node_with_mode(starpu_data_handle_t handle, unsigne
 	if (!_starpu_attempt_to_submit_data_request_from_apps(handle, mode, _prefetch_data_on_node, wrapper))
 	{
 		/* we can immediately proceed */
-		struct _starpu_data_replicate *replicate = &handle->per_node[node];
+		struct _starpu_data_replicate *replicate = _starpu_data_get_replicate(handle, node);
 		_starpu_data_acquire_launch_fetch(wrapper, async, NULL, NULL);
 
 		_starpu_data_acquire_wrapper_fini(wrapper);
@@ -661,7 +665,9 @@ static void _starpu_data_wont_use(void *data)
 	_starpu_spin_lock(&handle->header_lock);
 	for (node = 0; node < STARPU_MAXNODES; node++)
 	{
-		struct _starpu_data_replicate *local = &handle->per_node[node];
+		if (!_starpu_data_has_replicate(handle, node))
+			continue;
+		struct _starpu_data_replicate *local = _starpu_data_get_replicate(handle, node);
 		if (local->allocated && local->automatically_allocated)
 			_starpu_memchunk_wont_use(local->mc, node);
 	}
@@ -817,13 +823,13 @@ void starpu_data_query_status2(starpu_data_handle_t handle, int memory_node, int
 //	_starpu_spin_lock(&handle->header_lock);
 
 	if (is_allocated)
-		*is_allocated = handle->per_node[memory_node].allocated || handle->per_node[memory_node].mapped != STARPU_UNMAPPED;
+		*is_allocated = _starpu_data_peek_replicate(handle, memory_node)->allocated || _starpu_data_peek_replicate(handle, memory_node)->mapped != STARPU_UNMAPPED;
 
 	if (is_valid)
-		*is_valid = (handle->per_node[memory_node].state != STARPU_INVALID);
+		*is_valid = (_starpu_data_peek_replicate(handle, memory_node)->state != STARPU_INVALID);
 
 	if (is_loading)
-		*is_loading = handle->per_node[memory_node].load_request != NULL;
+		*is_loading = _starpu_data_peek_replicate(handle, memory_node)->load_request != NULL;
 
 	if (is_requested)
 	{
@@ -832,7 +838,7 @@ void starpu_data_query_status2(starpu_data_handle_t handle, int memory_node, int
 		unsigned node;
 		for (node = 0; node < STARPU_MAXNODES; node++)
 		{
-			if (handle->per_node[memory_node].request[node])
+			if (_starpu_data_peek_replicate(handle, memory_node)->request[node])
 			{
 				requested = 1;
 				break;
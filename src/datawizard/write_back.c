@@ -64,7 +64,7 @@ void _starpu_write_through_data(starpu_data_handle_t handle, unsigned requesting
 				handle->current_mode = STARPU_R;
 
 				struct _starpu_data_request *r;
-				r = _starpu_create_request_to_fetch_data(handle, &handle->per_node[node],
+				r = _starpu_create_request_to_fetch_data(handle, _starpu_data_get_replicate(handle, node),
 									 STARPU_R, NULL, STARPU_IDLEFETCH, 1, wt_callback, handle, 0, "_starpu_write_through_data");
 
 			        /* If no request was created, the handle was already up-to-date on the
@@ -33,7 +33,7 @@ void _starpu_benchmark_ping_pong(starpu_data_handle_t handle,
 		handle->busy_count++;
 		_starpu_spin_unlock(&handle->header_lock);
 
-		struct _starpu_data_replicate *replicate_0 = &handle->per_node[node0];
+		struct _starpu_data_replicate *replicate_0 = _starpu_data_get_replicate(handle, node0);
 		ret = _starpu_fetch_data_on_node(handle, node0, replicate_0, STARPU_RW, 0, NULL, STARPU_FETCH, 0, NULL, NULL, 0, "_starpu_benchmark_ping_pong");
 		STARPU_ASSERT(!ret);
 		_starpu_release_data_on_node(handle, 0, STARPU_NONE, replicate_0);
@@ -43,7 +43,7 @@ void _starpu_benchmark_ping_pong(starpu_data_handle_t handle,
 		handle->busy_count++;
 		_starpu_spin_unlock(&handle->header_lock);
 
-		struct _starpu_data_replicate *replicate_1 = &handle->per_node[node1];
+		struct _starpu_data_replicate *replicate_1 = _starpu_data_get_replicate(handle, node1);
 		ret = _starpu_fetch_data_on_node(handle, node1, replicate_1, STARPU_RW, 0, NULL, STARPU_FETCH, 0, NULL, NULL, 0, "_starpu_benchmark_ping_pong");
 		STARPU_ASSERT(!ret);
 		_starpu_release_data_on_node(handle, 0, STARPU_NONE, replicate_1);
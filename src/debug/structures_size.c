@@ -29,6 +29,8 @@ void _starpu_debug_display_structures_size(FILE *stream)
 			(unsigned) sizeof(struct _starpu_job), (unsigned) sizeof(struct _starpu_job));
 	fprintf(stream, "struct _starpu_data_state\t%u bytes\t(%x)\n",
 			(unsigned) sizeof(struct _starpu_data_state), (unsigned) sizeof(struct _starpu_data_state));
+	fprintf(stream, "struct _starpu_data_replicate\t%u bytes\t(%x)\n",
+			(unsigned) sizeof(struct _starpu_data_replicate), (unsigned) sizeof(struct _starpu_data_replicate));
 	fprintf(stream, "struct _starpu_tag\t\t%u bytes\t(%x)\n",
 			(unsigned) sizeof(struct _starpu_tag), (unsigned) sizeof(struct _starpu_tag));
 	fprintf(stream, "struct _starpu_cg\t\t%u bytes\t(%x)\n",
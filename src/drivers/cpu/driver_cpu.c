@@ -42,6 +42,7 @@
 #include <datawizard/memory_nodes.h>
 #include <datawizard/malloc.h>
 #include <datawizard/datawizard.h>
+#include <datawizard/copy_driver.h>
 #include <core/simgrid.h>
 #include <core/task.h>
 #include <core/disk.h>
@@ -64,6 +65,14 @@
 
 static unsigned already_busy_cpus;
 
+#ifdef STARPU_USE_CPU
+/* Maximum number of tasks run as a batch, see STARPU_CPU_BATCH */
+#define CPU_BATCH_MAX 64
+static unsigned cpu_batch_max;
+/* Maximum expected duration of batched tasks, in us */
+static double cpu_batch_length;
+#endif
+
 static struct _starpu_driver_info driver_info =
 {
 	.name_upper = "CPU",
@@ -176,6 +185,13 @@ int _starpu_cpu_driver_init(struct _starpu_worker *cpu_worker)
 #endif
 
 	_starpu_driver_start(cpu_worker, STARPU_CPU_WORKER, 1);
+	cpu_worker->batch_next = NULL;
+#ifndef STARPU_SIMGRID
+	cpu_batch_max = starpu_getenv_number_default("STARPU_CPU_BATCH", 0);
+	if (cpu_batch_max > CPU_BATCH_MAX)
+		cpu_batch_max = CPU_BATCH_MAX;
+	cpu_batch_length = starpu_getenv_float_default("STARPU_CPU_BATCH_LENGTH", 10.);
+#endif
 	snprintf(cpu_worker->name, sizeof(cpu_worker->name), "CPU %d", devid);
 	snprintf(cpu_worker->short_name, sizeof(cpu_worker->short_name), "CPU %d", devid);
 	starpu_pthread_setname(cpu_worker->short_name);
@@ -279,7 +295,16 @@ int _starpu_cpu_copy_data(uintptr_t src, size_t src_offset, int src_dev, uintptr
 	(void) src_dev;
 	(void) dst_dev;
 
-	memcpy((void *) (dst + dst_offset), (void *) (src + src_offset), size);
+	_starpu_ram_copy((void *) (dst + dst_offset), (void *) (src + src_offset), size, starpu_memory_devid_find_node(dst_dev, STARPU_CPU_RAM));
+	return 0;
+}
+
+int _starpu_cpu_copy2d_data(uintptr_t src, size_t src_offset, int src_dev, uintptr_t dst, size_t dst_offset, int dst_dev, size_t blocksize, size_t numblocks, size_t ld_src, size_t ld_dst, struct _starpu_async_channel *async_channel)
+{
+	(void) async_channel;
+	(void) src_dev;
+
+	_starpu_ram_copy2d((void *) (dst + dst_offset), (void *) (src + src_offset), blocksize, numblocks, ld_src, ld_dst, starpu_memory_devid_find_node(dst_dev, STARPU_CPU_RAM));
 	return 0;
 }
 
@@ -568,6 +593,215 @@ static int _starpu_cpu_driver_execute_task(struct _starpu_worker *cpu_worker, st
 	return 0;
 }
 
+/* Whether the performance model says that this task is small enough to be
+ * batched. Longer tasks would better be left to other workers. */
+static int cpu_batch_tiny(struct _starpu_worker *cpu_worker, struct _starpu_job *j)
+{
+	double length = starpu_task_expected_length(j->task, &cpu_worker->perf_arch, j->nimpl);
+	return !isnan(length) && length <= cpu_batch_length;
+}
+
+/* Whether this task may start a batch of tasks, see STARPU_CPU_BATCH */
+static int cpu_batchable(struct _starpu_worker *cpu_worker, struct _starpu_job *j)
+{
+	struct starpu_codelet *cl = j->task->cl;
+
+	if (cpu_batch_max <= 1 || j->task_size > 1 || cl->type != STARPU_SEQ || !cl->model)
+		return 0;
+#ifdef STARPU_OPENMP
+	if (j->discontinuous)
+		return 0;
+#endif
+	struct _starpu_sched_ctx *sched_ctx = _starpu_sched_ctx_get_sched_ctx_for_worker_and_job(cpu_worker, j);
+	if (!sched_ctx || !sched_ctx->sched_policy)
+		return 0;
+	return cpu_batch_tiny(cpu_worker, j);
+}
+
+/* Whether task \p nj can be run in the same batch as \p j, i.e. it uses the
+ * same implementation of the same codelet, it is small too, and all its
+ * buffers are already allocated and valid on the worker, so that fetching its
+ * input neither allocates nor transfers anything */
+static int cpu_batch_compatible(struct _starpu_worker *cpu_worker, struct _starpu_job *j, struct _starpu_job *nj)
+{
+	struct starpu_task *task = nj->task;
+	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
+	unsigned i;
+
+	if (task->cl != j->task->cl || nj->nimpl != j->nimpl || nj->task_size > 1)
+		return 0;
+#ifdef STARPU_OPENMP
+	if (nj->discontinuous)
+		return 0;
+#endif
+	if (_starpu_sched_ctx_get_sched_ctx_for_worker_and_job(cpu_worker, nj) != _starpu_sched_ctx_get_sched_ctx_for_worker_and_job(cpu_worker, j))
+		return 0;
+	if (!cpu_batch_tiny(cpu_worker, nj))
+		return 0;
+
+	for (i = 0; i < nbuffers; i++)
+	{
+		starpu_data_handle_t handle = STARPU_TASK_GET_HANDLE(task, i);
+		enum starpu_data_access_mode mode = STARPU_TASK_GET_MODE(task, i);
+		const struct _starpu_data_replicate *replicate;
+		int node;
+
+		node = _starpu_task_data_get_node_on_worker(task, i, cpu_worker->workerid);
+		if (node < 0)
+			continue;
+		if (mode & (STARPU_SCRATCH|STARPU_REDUX))
+		{
+			/* Per-worker buffer */
+			if (!handle->per_worker || !handle->per_worker[cpu_worker->workerid].allocated)
+				return 0;
+			continue;
+		}
+		replicate = _starpu_data_peek_replicate(handle, node);
+		if (!replicate->allocated || replicate->state == STARPU_INVALID)
+			return 0;
+	}
+	return 1;
+}
+
+/* Run \p task, whose input was fetched, along with the next tasks of the same
+ * codelet that the scheduler gives us, as long as their data is ready. The
+ * first task which can not be part of the batch is kept in batch_next for the
+ * next iteration of the driver loop, or left as task_transferring if its data
+ * went away meanwhile, so that it goes through the usual asynchronous fetch. */
+static int _starpu_cpu_driver_execute_batch(struct _starpu_worker *cpu_worker, struct starpu_task *task, struct _starpu_job *j)
+{
+	struct starpu_codelet *cl = task->cl;
+	struct starpu_task *tasks[CPU_BATCH_MAX];
+	struct _starpu_job *jobs[CPU_BATCH_MAX];
+	unsigned ntasks = 1, i;
+	int workerid = cpu_worker->workerid;
+	int profiling = starpu_profiling_status_get();
+	starpu_cpu_batch_func_t batch_func = cl->cpu_batch_func;
+#ifdef STARPU_PROF_TOOL
+	struct starpu_prof_tool_info pi;
+#endif
+
+	tasks[0] = task;
+	jobs[0] = j;
+
+	/* Keep the worker awake while we look for more tasks */
+	cpu_worker->current_task = task;
+	while (ntasks < cpu_batch_max)
+	{
+		struct starpu_task *next = _starpu_get_worker_task(cpu_worker, workerid, cpu_worker->memory_node);
+		struct _starpu_job *nj;
+		int res;
+
+		if (!next)
+			break;
+		nj = _starpu_get_job_associated_to_task(next);
+		if (!_STARPU_MAY_PERFORM(nj, CPU) || !cpu_batch_compatible(cpu_worker, j, nj))
+		{
+			cpu_worker->batch_next = next;
+			break;
+		}
+		/* Its data is there, so this completes right away */
+		res = _starpu_fetch_task_input(next, nj, 1);
+		STARPU_ASSERT(res == 0);
+		if (cpu_worker->nb_buffers_transferred != cpu_worker->nb_buffers_totransfer)
+			/* Unless it got evicted in between, let the driver
+			 * loop wait for the transfers */
+			break;
+		_starpu_fetch_task_input_tail(next, nj, cpu_worker);
+		cpu_worker->task_transferring = NULL;
+		tasks[ntasks] = next;
+		jobs[ntasks] = nj;
+		ntasks++;
+	}
+	cpu_worker->current_task = NULL;
+
+	if (ntasks == 1 || !batch_func)
+	{
+		for (i = 0; i < ntasks; i++)
+			_starpu_cpu_driver_execute_task(cpu_worker, tasks[i], jobs[i]);
+		return 0;
+	}
+
+	void **buffers[ntasks];
+	void *cl_args[ntasks];
+	struct starpu_perfmodel_arch *perf_arch = &cpu_worker->perf_arch;
+	struct timespec start = { 0, 0 }, end, step = { 0, 0 };
+
+	for (i = 0; i < ntasks; i++)
+	{
+		buffers[i] = _STARPU_TASK_GET_INTERFACES(tasks[i]);
+		cl_args[i] = tasks[i]->cl_arg;
+	}
+
+	cpu_worker->combined_workerid = workerid;
+	cpu_worker->worker_size = 1;
+	cpu_worker->current_rank = 0;
+
+	for (i = 0; i < ntasks; i++)
+	{
+		struct _starpu_job *bj = jobs[i];
+		struct starpu_task *btask = tasks[i];
+
+		_starpu_set_current_task(btask);
+		cpu_worker->current_task = btask;
+		bj->workerid = workerid;
+
+		_starpu_driver_start_job(cpu_worker, bj, perf_arch, 0, profiling);
+		if (_starpu_get_disable_kernels() <= 0)
+		{
+			_STARPU_TRACE_START_EXECUTING(bj);
+#ifdef STARPU_PROF_TOOL
+			pi = _starpu_prof_tool_get_info(starpu_prof_tool_event_start_cpu_exec, cpu_worker->devid, workerid, starpu_prof_tool_driver_cpu, -1, (void*)batch_func);
+			pi.model_name = _starpu_job_get_model_name(bj);
+			pi.task_name = _starpu_job_get_task_name(bj);
+			starpu_prof_tool_callbacks.starpu_prof_tool_event_start_cpu_exec(&pi, NULL, NULL);
+#endif
+		}
+		if (i == 0)
+		{
+			/* Run the whole batch within the first task */
+			_starpu_clock_gettime(&start);
+			if (_starpu_get_disable_kernels() <= 0)
+				batch_func(ntasks, buffers, cl_args);
+			_starpu_clock_gettime(&end);
+			starpu_timespec_sub(&end, &start, &step);
+			double slice = starpu_timing_timespec_to_us(&step) / ntasks;
+			step.tv_sec = slice / 1000000;
+			step.tv_nsec = fmod(slice, 1000000.) * 1000;
+		}
+		if (_starpu_get_disable_kernels() <= 0)
+		{
+#ifdef STARPU_PROF_TOOL
+			pi = _starpu_prof_tool_get_info(starpu_prof_tool_event_end_cpu_exec, cpu_worker->devid, workerid, starpu_prof_tool_driver_cpu, -1, (void*)batch_func);
+			pi.model_name = _starpu_job_get_model_name(bj);
+			pi.task_name = _starpu_job_get_task_name(bj);
+			starpu_prof_tool_callbacks.starpu_prof_tool_event_end_cpu_exec(&pi, NULL, NULL);
+#endif
+			_STARPU_TRACE_END_EXECUTING(bj);
+		}
+		_starpu_driver_end_job(cpu_worker, bj, perf_arch, 0, profiling);
+
+		/* Give each task an equal share of the batch duration */
+		cpu_worker->cl_start = start;
+		starpu_timespec_accumulate(&start, &step);
+		cpu_worker->cl_end = start;
+		if (profiling && btask->profiling_info)
+			btask->profiling_info->start_time = cpu_worker->cl_start;
+
+		_starpu_driver_update_job_feedback(bj, cpu_worker, perf_arch, profiling);
+		_starpu_push_task_output(bj);
+
+		_starpu_set_current_task(NULL);
+		cpu_worker->current_task = NULL;
+	}
+
+	/* And release all dependencies at once */
+	for (i = 0; i < ntasks; i++)
+		_starpu_handle_job_termination(jobs[i]);
+
+	return 0;
+}
+
 /* One iteration of the main driver loop */
 int _starpu_cpu_driver_run_once(struct _starpu_worker *cpu_worker)
 {
@@ -602,7 +836,10 @@ int _starpu_cpu_driver_run_once(struct _starpu_worker *cpu_worker)
 		/* Reset it */
 		cpu_worker->task_transferring = NULL;
 
-		ret = _starpu_cpu_driver_execute_task(cpu_worker, pending_task, j);
+		if (cpu_batchable(cpu_worker, j))
+			ret = _starpu_cpu_driver_execute_batch(cpu_worker, pending_task, j);
+		else
+			ret = _starpu_cpu_driver_execute_task(cpu_worker, pending_task, j);
 		_STARPU_TRACE_START_PROGRESS(memnode);
 #ifdef STARPU_PROF_TOOL
 		pi = _starpu_prof_tool_get_info_d(starpu_prof_tool_event_start_transfer, workerid, workerid, starpu_prof_tool_driver_cpu, memnode, cpu_worker->nb_buffers_totransfer, cpu_worker->nb_buffers_transferred);
@@ -614,7 +851,14 @@ int _starpu_cpu_driver_run_once(struct _starpu_worker *cpu_worker)
 	res = __starpu_datawizard_progress(_STARPU_DATAWIZARD_DO_ALLOC, 1);
 
 	if (!pending_task)
-		task = _starpu_get_worker_task(cpu_worker, workerid, memnode);
+	{
+		task = cpu_worker->batch_next;
+		if (task)
+			/* Left over from gathering a batch */
+			cpu_worker->batch_next = NULL;
+		else
+			task = _starpu_get_worker_task(cpu_worker, workerid, memnode);
+	}
 
 #ifdef STARPU_SIMGRID
 #ifndef STARPU_OPENMP
@@ -780,8 +1024,12 @@ struct _starpu_node_ops _starpu_driver_cpu_node_ops =
 	.copy_interface_to[STARPU_CPU_RAM] = _starpu_cpu_copy_interface,
 
 	.copy_data_to[STARPU_CPU_RAM] = _starpu_cpu_copy_data,
+	.copy2d_data_to[STARPU_CPU_RAM] = _starpu_cpu_copy2d_data,
 
 	.map[STARPU_CPU_RAM] = _starpu_cpu_map,
+	.map[STARPU_DISK_RAM] = _starpu_disk_map_to_cpu,
 	.unmap[STARPU_CPU_RAM] = _starpu_cpu_unmap,
+	.unmap[STARPU_DISK_RAM] = _starpu_disk_unmap_from_cpu,
 	.update_map[STARPU_CPU_RAM] = _starpu_cpu_update_map,
+	.update_map[STARPU_DISK_RAM] = _starpu_disk_update_map,
 };
@@ -64,6 +64,50 @@ int _starpu_disk_copy_disk_to_disk(void * src, size_t src_offset, int src_dev, v
 	return _starpu_disk_copy(src_dev, src, src_offset, dst_dev, dst, dst_offset, size, async_channel);
 }
 
+uintptr_t _starpu_disk_map_to_cpu(uintptr_t src, size_t src_offset, unsigned src_node, unsigned dst_node, size_t size, int *ret)
+{
+	(void) dst_node;
+	void *addr;
+
+	if (!src)
+	{
+		*ret = -EIO;
+		return 0;
+	}
+
+	addr = _starpu_disk_map(starpu_memory_node_get_devid(src_node), (void *) src, src_offset, size);
+	if (!addr)
+	{
+		/* The backend can not map, the data will be read instead */
+		*ret = -EIO;
+		return 0;
+	}
+	*ret = 0;
+	return (uintptr_t) addr;
+}
+
+int _starpu_disk_unmap_from_cpu(uintptr_t src, size_t src_offset, unsigned src_node, uintptr_t dst, unsigned dst_node, size_t size)
+{
+	(void) dst_node;
+
+	_starpu_disk_unmap(starpu_memory_node_get_devid(src_node), (void *) src, (void *) dst, src_offset, size);
+	return 0;
+}
+
+int _starpu_disk_update_map(uintptr_t src, size_t src_offset, unsigned src_node, uintptr_t dst, size_t dst_offset, unsigned dst_node, size_t size)
+{
+	(void) src;
+	(void) src_offset;
+	(void) src_node;
+	(void) dst;
+	(void) dst_offset;
+	(void) dst_node;
+	(void) size;
+
+	/* Shared file mappings are coherent with the page cache */
+	return 0;
+}
+
 unsigned _starpu_disk_test_request_completion(struct _starpu_async_channel *async_channel)
 {
 	struct _starpu_disk_event *disk_event = _starpu_disk_get_event(&async_channel->event);
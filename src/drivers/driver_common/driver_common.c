@@ -67,9 +67,10 @@ void _starpu_driver_start_job(struct _starpu_worker *worker, struct _starpu_job
 		_starpu_sched_pre_exec_hook(task);
 
 	struct timespec start;
+	unsigned fair_share = _starpu_sched_ctx_fair_share;
 
 	struct starpu_profiling_task_info *profiling_info = task->profiling_info;
-	if ((profiling && profiling_info) || (rank == 0 && (calibrate_model || !_starpu_perf_counter_paused())))
+	if ((profiling && profiling_info) || (rank == 0 && (calibrate_model || fair_share || !_starpu_perf_counter_paused())))
 		_starpu_clock_gettime(&start);
 	_starpu_add_worker_status(worker, STATUS_INDEX_EXECUTING, &start);
 
@@ -86,12 +87,15 @@ void _starpu_driver_start_job(struct _starpu_worker *worker, struct _starpu_job
 			}
 		}
 		task->status = STARPU_TASK_RUNNING;
+		if (_starpu_sched_latency_enabled && j->ready_time)
+			_starpu_sched_latency_record(STARPU_SCHED_LATENCY_READY_TO_START, workerid, task->sched_ctx, starpu_timing_now() - j->ready_time);
 
 		STARPU_AYU_RUNTASK(j->job_id);
 		if (_starpu_codelet_profiling)
 			cl->per_worker_stats[workerid]++;
 
-		if ((profiling && profiling_info) || calibrate_model || !_starpu_perf_counter_paused())
+		j->fair_share_timed = fair_share;
+		if ((profiling && profiling_info) || calibrate_model || fair_share || !_starpu_perf_counter_paused())
 		{
 			worker->cl_start = start;
 			if (profiling && profiling_info)
@@ -188,13 +192,13 @@ void _starpu_driver_end_job(struct _starpu_worker *worker, struct _starpu_job *j
 
 	struct timespec end;
 	struct starpu_profiling_task_info *profiling_info = task->profiling_info;
-	if ((profiling && profiling_info) || (rank == 0 && (calibrate_model || !_starpu_perf_counter_paused())))
+	if ((profiling && profiling_info) || (rank == 0 && (calibrate_model || j->fair_share_timed || !_starpu_perf_counter_paused())))
 		_starpu_clock_gettime(&end);
 	_starpu_clear_worker_status(worker, STATUS_INDEX_EXECUTING, &end);
 
 	if (rank == 0)
 	{
-		if ((profiling && profiling_info) || calibrate_model || !_starpu_perf_counter_paused())
+		if ((profiling && profiling_info) || calibrate_model || j->fair_share_timed || !_starpu_perf_counter_paused())
 			worker->cl_end = end;
 		STARPU_AYU_POSTRUNTASK(j->job_id);
 	}
@@ -239,13 +243,17 @@ void _starpu_driver_update_job_feedback(struct _starpu_job *j, struct _starpu_wo
 		calibrate_model = 1;
 #endif
 
-	if ((profiling && profiling_info) || calibrate_model || !_starpu_perf_counter_paused())
+	if ((profiling && profiling_info) || calibrate_model || j->fair_share_timed || !_starpu_perf_counter_paused())
 	{
 		starpu_timespec_sub(&worker->cl_end, &worker->cl_start, &measured_ts);
 		double measured = starpu_timing_timespec_to_us(&measured_ts);
 
 		STARPU_ASSERT_MSG(measured >= 0, "measured=%lf\n", measured);
 
+		/* Only charge tasks whose start was timed */
+		if ((profiling && profiling_info) || j->fair_share_timed)
+			_starpu_sched_ctx_account_consumed(j->task->sched_ctx, measured);
+
 		if (!_starpu_perf_counter_paused())
 		{
 			worker->__w_total_executed__value++;
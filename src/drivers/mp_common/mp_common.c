@@ -65,6 +65,10 @@ const char *_starpu_mp_common_command_to_string(const enum _starpu_mp_command co
 			return "RECV_FROM_SINK";
 		case STARPU_MP_COMMAND_SEND_TO_SINK:
 			return "SEND_TO_SINK";
+		case STARPU_MP_COMMAND_RECV_FROM_HOST_COMPRESSED:
+			return "RECV_FROM_HOST_COMPRESSED";
+		case STARPU_MP_COMMAND_SEND_TO_HOST_COMPRESSED:
+			return "SEND_TO_HOST_COMPRESSED";
 
 		/* Note: Asynchronous send */
 		case STARPU_MP_COMMAND_RECV_FROM_HOST_ASYNC:
@@ -101,6 +105,8 @@ const char *_starpu_mp_common_command_to_string(const enum _starpu_mp_command co
 			return "ANSWER_EXECUTION_SUBMITTED";
 		case STARPU_MP_COMMAND_ANSWER_EXECUTION_DETACHED_SUBMITTED:
 			return "ANSWER_EXECUTION_DETACHED_SUBMITTED";
+		case STARPU_MP_COMMAND_ANSWER_SEND_TO_HOST_COMPRESSED:
+			return "ANSWER_SEND_TO_HOST_COMPRESSED";
 
 		/* Asynchronous notifications from slave to master */
 		case STARPU_MP_COMMAND_NOTIF_RECV_FROM_HOST_ASYNC_COMPLETED:
@@ -327,6 +333,20 @@ _starpu_mp_common_node_create(enum _starpu_mp_node_kind node_kind,
 	 * a command, an argument and the argument size */
 	_STARPU_MALLOC(node->buffer, BUFFER_SIZE);
 
+	node->compress = 0;
+	node->compress_min_size = 0;
+	STARPU_PTHREAD_MUTEX_INIT(&node->compress_mutex, NULL);
+	node->compress_ratio = -1.;
+	node->compress_speed = -1.;
+	node->decompress_speed = -1.;
+	node->compress_skipped = 0;
+	node->compress_ntransfers = 0;
+	node->compress_ncompressed = 0;
+	node->compress_bytes_raw = 0;
+	node->compress_bytes_sent = 0;
+	node->compress_buffer = NULL;
+	node->compress_buffer_size = 0;
+
 	if (node->init)
 		node->init(node);
 
@@ -389,10 +409,26 @@ void _starpu_mp_common_node_destroy(struct _starpu_mp_node *node)
 		STARPU_PTHREAD_BARRIER_DESTROY(&node->init_completed_barrier);
 	}
 
+	STARPU_PTHREAD_MUTEX_DESTROY(&node->compress_mutex);
+	free(node->compress_buffer);
 	free(node->buffer);
 	free(node);
 }
 
+/* Return a buffer of at least SIZE bytes for compressed data, which is kept
+ * for the next transfers. The caller must make sure that no other transfer
+ * uses it meanwhile. */
+void *_starpu_mp_common_compress_buffer(struct _starpu_mp_node *node, size_t size)
+{
+	if (node->compress_buffer_size < size)
+	{
+		free(node->compress_buffer);
+		_STARPU_MALLOC(node->compress_buffer, size);
+		node->compress_buffer_size = size;
+	}
+	return node->compress_buffer;
+}
+
 /* Send COMMAND to RECIPIENT, along with ARG if ARG_SIZE is non-zero */
 static void __starpu_mp_common_send_command(const struct _starpu_mp_node *node, const enum _starpu_mp_command command, void *arg, int arg_size, int notif)
 {
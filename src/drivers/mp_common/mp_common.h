@@ -61,6 +61,9 @@ enum _starpu_mp_command
 	STARPU_MP_COMMAND_SEND_TO_HOST,
 	STARPU_MP_COMMAND_RECV_FROM_SINK,
 	STARPU_MP_COMMAND_SEND_TO_SINK,
+	/* Note: synchronous send of compressed data */
+	STARPU_MP_COMMAND_RECV_FROM_HOST_COMPRESSED,
+	STARPU_MP_COMMAND_SEND_TO_HOST_COMPRESSED,
 
 	/* Note: Asynchronous send */
 	STARPU_MP_COMMAND_RECV_FROM_HOST_ASYNC,
@@ -81,6 +84,7 @@ enum _starpu_mp_command
 	STARPU_MP_COMMAND_ANSWER_SINK_NBCORES,
 	STARPU_MP_COMMAND_ANSWER_EXECUTION_SUBMITTED,
 	STARPU_MP_COMMAND_ANSWER_EXECUTION_DETACHED_SUBMITTED,
+	STARPU_MP_COMMAND_ANSWER_SEND_TO_HOST_COMPRESSED,
 
 	/* Asynchronous notifications from slave to master */
 	STARPU_MP_COMMAND_NOTIF_RECV_FROM_HOST_ASYNC_COMPLETED,
@@ -125,6 +129,15 @@ struct _starpu_mp_transfer_command
 	void *event;
 };
 
+/** Transfer of SIZE bytes at ADDR, sent as COMPRESSED_SIZE bytes of
+ * compressed data */
+struct _starpu_mp_transfer_compressed_command
+{
+	size_t size;
+	void *addr;
+	size_t compressed_size;
+};
+
 struct _starpu_mp_transfer_command_to_device
 {
 	size_t size;
@@ -239,6 +252,31 @@ struct _starpu_mp_node
 	struct mp_barrier_list barrier_list;
 	starpu_pthread_mutex_t barrier_mutex;
 
+	/** Compression of host <-> sink data transfers, only used by the
+	 * source: 0 disabled, 1 adaptive, 2 always (see STARPU_TCPIP_MS_COMPRESS) */
+	int compress;
+	/** Transfers smaller than this are always sent raw */
+	size_t compress_min_size;
+	/** Protects the estimates and statistics below */
+	starpu_pthread_mutex_t compress_mutex;
+	/** Running estimates of the compressed/raw size ratio and of the
+	 * compression and decompression throughputs (in bytes/us), negative
+	 * until the first measurement */
+	double compress_ratio;
+	double compress_speed;
+	double decompress_speed;
+	/** Number of transfers sent raw since the last compression attempt */
+	unsigned compress_skipped;
+	/** Statistics */
+	unsigned long compress_ntransfers;
+	unsigned long compress_ncompressed;
+	size_t compress_bytes_raw;
+	size_t compress_bytes_sent;
+	/** Buffer for the compressed data, kept from a transfer to another,
+	 * used with the connection mutex held on the source */
+	void *compress_buffer;
+	size_t compress_buffer_size;
+
 	/*table where worker comme pick task*/
 	struct mp_task ** run_table;
 	struct mp_task ** run_table_detached;
@@ -288,6 +326,8 @@ struct _starpu_mp_node * _starpu_mp_common_node_create(enum _starpu_mp_node_kind
 
 void _starpu_mp_common_node_destroy(struct _starpu_mp_node *node);
 
+void *_starpu_mp_common_compress_buffer(struct _starpu_mp_node *node, size_t size);
+
 void _starpu_mp_common_send_command(const struct _starpu_mp_node *node,
 				    const enum _starpu_mp_command command,
 				    void *arg, int arg_size);
@@ -28,6 +28,7 @@
 #include <common/barrier.h>
 #include <core/workers.h>
 #include <common/barrier_counter.h>
+#include <common/compress.h>
 
 #include "sink_common.h"
 
@@ -214,6 +215,51 @@ static void _starpu_sink_common_copy_to_host_async(struct _starpu_mp_node *mp_no
 	_starpu_mp_event_list_push_back(&mp_node->event_list, sink_event);
 }
 
+static void _starpu_sink_common_copy_from_host_compressed(struct _starpu_mp_node *mp_node, void *arg, int arg_size)
+{
+	STARPU_ASSERT(arg_size == sizeof(struct _starpu_mp_transfer_compressed_command));
+
+	struct _starpu_mp_transfer_compressed_command *cmd = (struct _starpu_mp_transfer_compressed_command *)arg;
+
+	/* Save values before receiving data to prevent the overwriting */
+	size_t size = cmd->size;
+	void * addr = cmd->addr;
+	size_t compressed_size = cmd->compressed_size;
+
+	/* Only this thread handles the transfers of the sink */
+	void *buffer = _starpu_mp_common_compress_buffer(mp_node, compressed_size);
+	mp_node->dt_recv(mp_node, buffer, compressed_size, NULL);
+
+	int ret = _starpu_decompress(buffer, compressed_size, addr, size);
+	STARPU_ASSERT_MSG(ret == 0, "corrupted compressed data received from the host");
+}
+
+static void _starpu_sink_common_copy_to_host_compressed(struct _starpu_mp_node *mp_node, void *arg, int arg_size)
+{
+	STARPU_ASSERT(arg_size == sizeof(struct _starpu_mp_transfer_command));
+
+	struct _starpu_mp_transfer_command *cmd = (struct _starpu_mp_transfer_command *)arg;
+
+	/* Save values before sending command to prevent the overwriting */
+	size_t size = cmd->size;
+	void * addr = cmd->addr;
+
+	/* No need to go beyond the raw size */
+	size_t compressed_size = size;
+	/* Only this thread handles the transfers of the sink */
+	void *buffer = _starpu_mp_common_compress_buffer(mp_node, compressed_size);
+	if (_starpu_compress(addr, size, buffer, &compressed_size) != 0)
+		/* Tell the host that we send it raw */
+		compressed_size = 0;
+
+	_starpu_mp_common_send_command(mp_node, STARPU_MP_COMMAND_ANSWER_SEND_TO_HOST_COMPRESSED, &compressed_size, sizeof(compressed_size));
+
+	if (compressed_size)
+		mp_node->dt_send(mp_node, buffer, compressed_size, NULL);
+	else
+		mp_node->dt_send(mp_node, addr, size, NULL);
+}
+
 static void _starpu_sink_common_copy_from_sink_sync(const struct _starpu_mp_node *mp_node, void *arg, int arg_size)
 {
 	STARPU_ASSERT(arg_size == offsetof(struct _starpu_mp_transfer_command_to_device, end));
@@ -432,6 +478,14 @@ void _starpu_sink_common_worker(void)
 					_starpu_sink_common_copy_to_sink_sync(node, arg, arg_size);
 					break;
 
+				case STARPU_MP_COMMAND_RECV_FROM_HOST_COMPRESSED:
+					_starpu_sink_common_copy_from_host_compressed(node, arg, arg_size);
+					break;
+
+				case STARPU_MP_COMMAND_SEND_TO_HOST_COMPRESSED:
+					_starpu_sink_common_copy_to_host_compressed(node, arg, arg_size);
+					break;
+
 				case STARPU_MP_COMMAND_RECV_FROM_HOST_ASYNC:
 					_starpu_sink_common_copy_from_host_async(node, arg, arg_size);
 					break;
@@ -29,6 +29,7 @@
 #include <drivers/mp_common/mp_common.h>
 #include <drivers/mp_common/source_common.h>
 #include <common/knobs.h>
+#include <common/compress.h>
 
 struct starpu_save_thread_env
 {
@@ -834,6 +835,163 @@ void _starpu_src_common_unmap(unsigned dst_node, uintptr_t addr, size_t size)
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->connection_mutex);
 }
 
+/* Compressed transfers are sent raw again if the estimated compression ratio
+ * gets over this */
+#define COMPRESS_RATIO_MAX 0.9
+/* Weight of the latest measurement in the running estimates */
+#define COMPRESS_ALPHA 0.25
+/* While compression does not pay off, still try it once every that many
+ * transfers, in case the data got more compressible */
+#define COMPRESS_PROBE_PERIOD 32
+
+/* Decide whether a transfer of SIZE bytes between the host and the sink of
+ * MP_NODE is worth compressing. The data has to be compressed on one side and
+ * decompressed on the other, which has to take less time than sending the
+ * bytes it saves over the link, whose bandwidth we get from the bus perfmodel.
+ */
+static int _starpu_src_common_compress_pays_off(struct _starpu_mp_node *mp_node, size_t size)
+{
+	if (!mp_node->compress || size < mp_node->compress_min_size)
+		return 0;
+	if (mp_node->compress == 2)
+		return 1;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mp_node->compress_mutex);
+	double ratio = mp_node->compress_ratio;
+	double compress_speed = mp_node->compress_speed;
+	double decompress_speed = mp_node->decompress_speed;
+	unsigned skipped = mp_node->compress_skipped;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->compress_mutex);
+
+	/* Nothing measured yet, try */
+	if (ratio < 0.)
+		return 1;
+
+	/* We measure each side in only one direction, use it for the other
+	 * side until that one gets measured */
+	if (compress_speed <= 0.)
+		compress_speed = decompress_speed;
+	if (decompress_speed <= 0.)
+		decompress_speed = compress_speed;
+
+	int pays_off;
+	double bandwidth = starpu_transfer_bandwidth(STARPU_MAIN_RAM, mp_node_memory_node(mp_node));
+	if (compress_speed <= 0. || isnan(bandwidth) || bandwidth <= 0.)
+		/* Bus not calibrated, only rely on the ratio */
+		pays_off = ratio < COMPRESS_RATIO_MAX;
+	else
+	{
+		/* All in us, the bandwidth is in MB/s, i.e. bytes/us */
+		double raw_time = size / bandwidth;
+		double compressed_time = size / compress_speed + size / decompress_speed
+			+ size * ratio / bandwidth;
+		pays_off = compressed_time < raw_time && ratio < COMPRESS_RATIO_MAX;
+	}
+
+	if (!pays_off && skipped + 1 >= COMPRESS_PROBE_PERIOD)
+		return 1;
+	return pays_off;
+}
+
+/* Fold SAMPLE into the running estimate ESTIMATE */
+static void _starpu_src_common_compress_estimate(double *estimate, double sample)
+{
+	if (*estimate < 0.)
+		*estimate = sample;
+	else
+		*estimate = (1. - COMPRESS_ALPHA) * *estimate + COMPRESS_ALPHA * sample;
+}
+
+/* Record the outcome of a compression: SIZE bytes became COMPRESSED_SIZE
+ * bytes, compressing took COMPRESS_TIME us and decompressing took
+ * DECOMPRESS_TIME us (negative if not measured).
+ */
+static void _starpu_src_common_compress_update(struct _starpu_mp_node *mp_node, size_t size, size_t compressed_size, double compress_time, double decompress_time)
+{
+	STARPU_PTHREAD_MUTEX_LOCK(&mp_node->compress_mutex);
+
+	mp_node->compress_skipped = 0;
+
+	_starpu_src_common_compress_estimate(&mp_node->compress_ratio, (double) compressed_size / size);
+	if (compress_time > 0.)
+		_starpu_src_common_compress_estimate(&mp_node->compress_speed, size / compress_time);
+	if (decompress_time > 0.)
+		_starpu_src_common_compress_estimate(&mp_node->decompress_speed, size / decompress_time);
+
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->compress_mutex);
+}
+
+/* Account a transfer of SIZE bytes which was sent as SENT bytes over the link.
+ */
+static void _starpu_src_common_compress_account(struct _starpu_mp_node *mp_node, size_t size, size_t sent)
+{
+	if (!mp_node->compress)
+		return;
+	STARPU_PTHREAD_MUTEX_LOCK(&mp_node->compress_mutex);
+	mp_node->compress_ntransfers++;
+	if (sent < size)
+		mp_node->compress_ncompressed++;
+	else if (size >= mp_node->compress_min_size)
+		mp_node->compress_skipped++;
+	mp_node->compress_bytes_raw += size;
+	mp_node->compress_bytes_sent += sent;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->compress_mutex);
+}
+
+void _starpu_src_common_compress_display_stats(struct _starpu_mp_node *mp_node)
+{
+	if (!mp_node->compress || !mp_node->compress_ntransfers)
+		return;
+
+	_STARPU_DISP("Transfers with %s device %d: %lu compressed out of %lu, %.2f MiB sent for %.2f MiB of data (ratio estimate %.3f, %s compression %.2f MB/s, decompression %.2f MB/s)\n",
+		     _starpu_mp_common_node_kind_to_string(mp_node->kind), mp_node->peer_id,
+		     mp_node->compress_ncompressed, mp_node->compress_ntransfers,
+		     (double) mp_node->compress_bytes_sent / (1024*1024),
+		     (double) mp_node->compress_bytes_raw / (1024*1024),
+		     mp_node->compress_ratio, _starpu_compress_codec_name(), mp_node->compress_speed, mp_node->decompress_speed);
+}
+
+/* Send SIZE bytes pointed by SRC to DST on the sink linked to the MP_NODE in
+ * compressed form, synchronously.
+ * Return -1 if it is not worth it, the data should then be sent raw.
+ */
+static int _starpu_src_common_copy_host_to_sink_compressed(struct _starpu_mp_node *mp_node, void *src, void *dst, size_t size)
+{
+	if (!_starpu_src_common_compress_pays_off(mp_node, size))
+		return -1;
+
+	/* The compression buffer is protected by the connection mutex */
+	STARPU_PTHREAD_MUTEX_LOCK(&mp_node->connection_mutex);
+
+	/* No need to go beyond the raw size */
+	size_t compressed_size = size;
+	void *buffer = _starpu_mp_common_compress_buffer(mp_node, compressed_size);
+
+	double start = starpu_timing_now();
+	int ret = _starpu_compress(src, size, buffer, &compressed_size);
+	double end = starpu_timing_now();
+
+	/* We can only measure the compression side here */
+	_starpu_src_common_compress_update(mp_node, size, ret ? size : compressed_size, end - start, -1.);
+	if (ret)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->connection_mutex);
+		return -1;
+	}
+
+	struct _starpu_mp_transfer_compressed_command cmd = {.size = size, .addr = dst, .compressed_size = compressed_size};
+
+	_starpu_mp_common_send_command(mp_node, STARPU_MP_COMMAND_RECV_FROM_HOST_COMPRESSED, &cmd, sizeof(cmd));
+
+	mp_node->dt_send(mp_node, buffer, compressed_size, NULL);
+
+	_starpu_src_common_compress_account(mp_node, size, compressed_size);
+
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->connection_mutex);
+
+	return 0;
+}
+
 /* Send SIZE bytes pointed by SRC to DST on the sink linked to the MP_NODE with a
  * synchronous mode.
  */
@@ -847,6 +1005,8 @@ static int _starpu_src_common_copy_host_to_sink_sync(struct _starpu_mp_node *mp_
 
 	mp_node->dt_send(mp_node, src, size, NULL);
 
+	_starpu_src_common_compress_account(mp_node, size, size);
+
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->connection_mutex);
 
 	return 0;
@@ -871,6 +1031,8 @@ static int _starpu_src_common_copy_host_to_sink_async(struct _starpu_mp_node *mp
 
 	mp_node->dt_send(mp_node, src, size, event);
 
+	_starpu_src_common_compress_account(mp_node, size, size);
+
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->connection_mutex);
 
 	return -EAGAIN;
@@ -883,6 +1045,13 @@ int _starpu_src_common_copy_data_host_to_sink(uintptr_t src, size_t src_offset,
 	(void) src_devid;
 	struct _starpu_mp_node *mp_node = _starpu_src_common_get_mp_node_from_devid(dst_archtype, dst_devid);
 
+	if (mp_node->compress && _starpu_src_common_copy_host_to_sink_compressed(mp_node,
+						(void*) (src + src_offset),
+						(void*) (dst + dst_offset),
+						size) == 0)
+		/* Compressed transfers are always synchronous */
+		return 0;
+
 	if (async_channel)
 		return _starpu_src_common_copy_host_to_sink_async(mp_node,
 						(void*) (src + src_offset),
@@ -895,6 +1064,59 @@ int _starpu_src_common_copy_data_host_to_sink(uintptr_t src, size_t src_offset,
 						size);
 }
 
+/* Receive SIZE bytes pointed by SRC on the sink linked to the MP_NODE in
+ * compressed form and store them in DST, synchronously.
+ * Return -1 if it is not worth it, the data should then be received raw.
+ */
+static int _starpu_src_common_copy_sink_to_host_compressed(struct _starpu_mp_node *mp_node, void *src, void *dst, size_t size)
+{
+	enum _starpu_mp_command answer;
+	void *arg;
+	int arg_size;
+	struct _starpu_mp_transfer_command cmd = {.size = size, .addr = src, .event = NULL};
+
+	if (!_starpu_src_common_compress_pays_off(mp_node, size))
+		return -1;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mp_node->connection_mutex);
+
+	_starpu_mp_common_send_command(mp_node, STARPU_MP_COMMAND_SEND_TO_HOST_COMPRESSED, &cmd, sizeof(cmd));
+
+	answer = _starpu_src_common_wait_command_sync(mp_node, &arg, &arg_size);
+
+	STARPU_ASSERT(answer == STARPU_MP_COMMAND_ANSWER_SEND_TO_HOST_COMPRESSED);
+	STARPU_ASSERT(arg_size == sizeof(size_t));
+
+	/* The sink tells us how much it managed to compress, 0 means that it
+	 * sends the data raw */
+	size_t compressed_size = *(size_t *) arg;
+
+	if (!compressed_size)
+	{
+		mp_node->dt_recv(mp_node, dst, size, NULL);
+		_starpu_src_common_compress_update(mp_node, size, size, -1., -1.);
+		_starpu_src_common_compress_account(mp_node, size, size);
+	}
+	else
+	{
+		void *buffer = _starpu_mp_common_compress_buffer(mp_node, compressed_size);
+		mp_node->dt_recv(mp_node, buffer, compressed_size, NULL);
+
+		/* We can only measure the decompression side here */
+		double start = starpu_timing_now();
+		int ret = _starpu_decompress(buffer, compressed_size, dst, size);
+		double end = starpu_timing_now();
+		STARPU_ASSERT_MSG(ret == 0, "corrupted compressed data received from %s device %d", _starpu_mp_common_node_kind_to_string(mp_node->kind), mp_node->peer_id);
+
+		_starpu_src_common_compress_update(mp_node, size, compressed_size, -1., end - start);
+		_starpu_src_common_compress_account(mp_node, size, compressed_size);
+	}
+
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->connection_mutex);
+
+	return 0;
+}
+
 /* Receive SIZE bytes pointed by SRC on the sink linked to the MP_NODE and store them in DST
  * with a synchronous mode.
  */
@@ -915,6 +1137,8 @@ static int _starpu_src_common_copy_sink_to_host_sync(struct _starpu_mp_node *mp_
 
 	mp_node->dt_recv(mp_node, dst, size, NULL);
 
+	_starpu_src_common_compress_account(mp_node, size, size);
+
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->connection_mutex);
 
 	return 0;
@@ -939,6 +1163,8 @@ static int _starpu_src_common_copy_sink_to_host_async(struct _starpu_mp_node *mp
 
 	mp_node->dt_recv(mp_node, dst, size, event);
 
+	_starpu_src_common_compress_account(mp_node, size, size);
+
 	STARPU_PTHREAD_MUTEX_UNLOCK(&mp_node->connection_mutex);
 
 	return -EAGAIN;
@@ -951,6 +1177,13 @@ int _starpu_src_common_copy_data_sink_to_host(uintptr_t src, size_t src_offset,
 	(void) dst_devid;
 	struct _starpu_mp_node *mp_node = _starpu_src_common_get_mp_node_from_devid(src_archtype, src_devid);
 
+	if (mp_node->compress && _starpu_src_common_copy_sink_to_host_compressed(mp_node,
+						(void*) (src + src_offset),
+						(void*) (dst + dst_offset),
+						size) == 0)
+		/* Compressed transfers are always synchronous */
+		return 0;
+
 	if (async_channel)
 		return _starpu_src_common_copy_sink_to_host_async(mp_node,
 						(void*) (src + src_offset),
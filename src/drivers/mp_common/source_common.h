@@ -76,6 +76,8 @@ int _starpu_src_common_copy_data_sink_to_sink(uintptr_t src, size_t src_offset,
 					      uintptr_t dst, size_t dst_offset, enum starpu_worker_archtype dst_archtype, int dst_devid,
 					      size_t size, struct _starpu_async_channel *async_channel);
 
+void _starpu_src_common_compress_display_stats(struct _starpu_mp_node *mp_node);
+
 void _starpu_src_common_init_switch_env(unsigned this);
 void _starpu_src_common_workers_set(struct _starpu_worker_set * worker_set, int ndevices, struct _starpu_mp_node ** mp_node);
 
@@ -24,6 +24,7 @@
 
 #include <drivers/driver_common/driver_common.h>
 #include <drivers/mp_common/source_common.h>
+#include <common/compress.h>
 
 #ifdef STARPU_USE_TCPIP_MASTER_SLAVE
 static unsigned tcpip_bindid_init[STARPU_MAXTCPIPDEVS] = { };
@@ -239,13 +240,28 @@ void _starpu_deinit_tcpip_config(struct _starpu_machine_config *config)
 void _starpu_tcpip_source_init(struct _starpu_mp_node *node)
 {
 	_starpu_tcpip_common_mp_initialize_src_sink(node);
-	//TODO
+
+	node->compress = starpu_getenv_number_default("STARPU_TCPIP_MS_COMPRESS", 0);
+	node->compress_min_size = starpu_getenv_number_default("STARPU_TCPIP_MS_COMPRESS_MIN_SIZE", 64*1024);
+#ifndef STARPU_HAVE_COMPRESSION
+	if (node->compress)
+	{
+		static int warned;
+		if (!warned)
+		{
+			_STARPU_DISP("Warning: STARPU_TCPIP_MS_COMPRESS is set, but StarPU was built without lz4 or zlib, transfers will not be compressed\n");
+			warned = 1;
+		}
+		node->compress = 0;
+	}
+#endif
 }
 
 
-void _starpu_tcpip_source_deinit(struct _starpu_mp_node *node STARPU_ATTRIBUTE_UNUSED)
+void _starpu_tcpip_source_deinit(struct _starpu_mp_node *node)
 {
-
+	if (starpu_getenv_number_default("STARPU_TCPIP_MS_COMPRESS_STATS", 0))
+		_starpu_src_common_compress_display_stats(node);
 }
 
 unsigned _starpu_tcpip_src_get_device_count()
@@ -0,0 +1,425 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/* Histograms of the scheduling latencies: how long it takes to push a task to
+ * the scheduler, to pop a task from it, how long a task stays ready before
+ * starting, and how long we wait for the scheduling mutex of a worker.
+ *
+ * The histograms have log-linear buckets: values are in nanoseconds, and each
+ * power of two is split into 2^SUB_BITS buckets, so that percentiles are
+ * precise within 1/2^SUB_BITS, whatever the order of magnitude.
+ *
+ * Each worker records in its own histograms, one set per scheduling context,
+ * so that recording a value is just a plain increment. The threads which are
+ * not workers share an additional set, under a mutex. The per-worker and
+ * per-context figures are only summed when they are read.
+ */
+
+#include <starpu.h>
+#include <starpu_profiling.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <core/workers.h>
+#include <common/knobs.h>
+#include <profiling/sched_latency.h>
+
+#define SUB_BITS	3
+#define SUB_BUCKETS	(1 << SUB_BITS)
+#define MAX_BITS	40
+#define NBUCKETS	((MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS)
+
+struct sched_latency_hist
+{
+	unsigned long count[NBUCKETS];
+	unsigned long total;
+};
+
+/* The last context slot is for the latencies which are not recorded for a
+ * context */
+#define NCTXS		(STARPU_NMAX_SCHED_CTXS + 1)
+
+int _starpu_sched_latency_enabled;
+
+static unsigned nworkers;
+/* For each worker, plus one for the other threads, and each context slot,
+ * the array of the histograms of each kind, allocated on first use */
+static struct sched_latency_hist **hists;
+static starpu_pthread_mutex_t external_mutex;
+
+static const char *kind_names[STARPU_SCHED_LATENCY_NKINDS] =
+{
+	[STARPU_SCHED_LATENCY_PUSH] = "push",
+	[STARPU_SCHED_LATENCY_POP] = "pop",
+	[STARPU_SCHED_LATENCY_READY_TO_START] = "ready_to_start",
+	[STARPU_SCHED_LATENCY_LOCK_WAIT] = "lock_wait",
+};
+
+static unsigned bucket_index(unsigned long long ns)
+{
+	unsigned msb = SUB_BITS;
+
+	if (ns < SUB_BUCKETS)
+		return ns;
+	while (msb < 63 && (ns >> (msb + 1)))
+		msb++;
+	if (msb >= MAX_BITS)
+		return NBUCKETS - 1;
+	return (msb - SUB_BITS + 1) * SUB_BUCKETS + ((ns >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+/* Middle of the range of values of the bucket, in ns */
+static double bucket_value(unsigned i)
+{
+	unsigned msb;
+	unsigned long long low;
+
+	if (i < SUB_BUCKETS)
+		return i;
+	msb = i / SUB_BUCKETS - 1 + SUB_BITS;
+	low = (unsigned long long) (SUB_BUCKETS + i % SUB_BUCKETS) << (msb - SUB_BITS);
+	return low + (double) (1ULL << (msb - SUB_BITS)) / 2.;
+}
+
+static struct sched_latency_hist *slot_hists(unsigned slot, unsigned ctx)
+{
+	return hists[slot * NCTXS + ctx];
+}
+
+static void hist_add(struct sched_latency_hist *sum, const struct sched_latency_hist *hist)
+{
+	unsigned i;
+
+	for (i = 0; i < NBUCKETS; i++)
+		sum->count[i] += hist->count[i];
+	sum->total += hist->total;
+}
+
+/* Sum the histograms of each kind recorded by the worker \p workerid */
+static void worker_hists(int workerid, struct sched_latency_hist sums[STARPU_SCHED_LATENCY_NKINDS])
+{
+	unsigned ctx, kind;
+
+	memset(sums, 0, STARPU_SCHED_LATENCY_NKINDS * sizeof(*sums));
+	for (ctx = 0; ctx < NCTXS; ctx++)
+	{
+		struct sched_latency_hist *h = slot_hists(workerid, ctx);
+		if (h)
+			for (kind = 0; kind < STARPU_SCHED_LATENCY_NKINDS; kind++)
+				hist_add(&sums[kind], &h[kind]);
+	}
+}
+
+/* Sum the histograms of each kind recorded for the context \p sched_ctx_id */
+static void ctx_hists(unsigned sched_ctx_id, struct sched_latency_hist sums[STARPU_SCHED_LATENCY_NKINDS])
+{
+	unsigned slot, kind;
+
+	memset(sums, 0, STARPU_SCHED_LATENCY_NKINDS * sizeof(*sums));
+	for (slot = 0; slot <= nworkers; slot++)
+	{
+		struct sched_latency_hist *h = slot_hists(slot, sched_ctx_id);
+		if (h)
+			for (kind = 0; kind < STARPU_SCHED_LATENCY_NKINDS; kind++)
+				hist_add(&sums[kind], &h[kind]);
+	}
+}
+
+void _starpu_sched_latency_record(enum starpu_sched_latency_kind kind, int workerid, unsigned sched_ctx_id, double duration)
+{
+	struct sched_latency_hist **h;
+	unsigned long ns;
+	unsigned slot, ctx;
+
+	if (!_starpu_sched_latency_enabled)
+		return;
+
+	slot = workerid >= 0 && (unsigned) workerid < nworkers ? (unsigned) workerid : nworkers;
+	ctx = sched_ctx_id < STARPU_NMAX_SCHED_CTXS ? sched_ctx_id : STARPU_NMAX_SCHED_CTXS;
+	if (slot == nworkers)
+	{
+		if (ctx == STARPU_NMAX_SCHED_CTXS)
+			/* Neither for a worker nor for a context */
+			return;
+		STARPU_PTHREAD_MUTEX_LOCK(&external_mutex);
+	}
+
+	h = &hists[slot * NCTXS + ctx];
+	if (!*h)
+	{
+		struct sched_latency_hist *new;
+		_STARPU_CALLOC(new, STARPU_SCHED_LATENCY_NKINDS, sizeof(*new));
+		/* Readers may look at it as soon as it is published */
+		STARPU_WMB();
+		*h = new;
+	}
+
+	ns = duration > 0. ? (unsigned long) (duration * 1000.) : 0;
+	(*h)[kind].count[bucket_index(ns)]++;
+	(*h)[kind].total += ns;
+
+	if (slot == nworkers)
+		STARPU_PTHREAD_MUTEX_UNLOCK(&external_mutex);
+}
+
+static double hist_percentile(const struct sched_latency_hist *hist, unsigned long count, double q)
+{
+	unsigned long rank = (unsigned long) (q * count);
+	unsigned long seen = 0;
+	unsigned i;
+
+	if (rank >= count)
+		rank = count - 1;
+	for (i = 0; i < NBUCKETS; i++)
+	{
+		seen += hist->count[i];
+		if (seen > rank)
+			break;
+	}
+	return bucket_value(i) / 1000.;
+}
+
+static void hist_get_stats(const struct sched_latency_hist *hist, struct starpu_sched_latency_stats *stats)
+{
+	unsigned long count = 0;
+	int first = -1, last = -1;
+	unsigned i;
+
+	memset(stats, 0, sizeof(*stats));
+
+	for (i = 0; i < NBUCKETS; i++)
+	{
+		if (!hist->count[i])
+			continue;
+		count += hist->count[i];
+		if (first == -1)
+			first = i;
+		last = i;
+	}
+	if (!count)
+		return;
+
+	stats->count = count;
+	stats->mean = (double) hist->total / count / 1000.;
+	stats->min = bucket_value(first) / 1000.;
+	stats->max = bucket_value(last) / 1000.;
+	stats->p50 = hist_percentile(hist, count, .5);
+	stats->p90 = hist_percentile(hist, count, .9);
+	stats->p99 = hist_percentile(hist, count, .99);
+	stats->p999 = hist_percentile(hist, count, .999);
+}
+
+int starpu_sched_latency_get_worker_stats(int workerid, enum starpu_sched_latency_kind kind, struct starpu_sched_latency_stats *stats)
+{
+	struct sched_latency_hist sums[STARPU_SCHED_LATENCY_NKINDS];
+
+	if (workerid < 0 || (unsigned) workerid >= nworkers || (unsigned) kind >= STARPU_SCHED_LATENCY_NKINDS)
+		return -EINVAL;
+	if (!hists)
+	{
+		memset(stats, 0, sizeof(*stats));
+		return 0;
+	}
+	worker_hists(workerid, sums);
+	hist_get_stats(&sums[kind], stats);
+	return 0;
+}
+
+int starpu_sched_latency_get_ctx_stats(unsigned sched_ctx_id, enum starpu_sched_latency_kind kind, struct starpu_sched_latency_stats *stats)
+{
+	struct sched_latency_hist sums[STARPU_SCHED_LATENCY_NKINDS];
+
+	if (sched_ctx_id >= STARPU_NMAX_SCHED_CTXS || (unsigned) kind >= STARPU_SCHED_LATENCY_NKINDS)
+		return -EINVAL;
+	if (!hists)
+	{
+		memset(stats, 0, sizeof(*stats));
+		return 0;
+	}
+	ctx_hists(sched_ctx_id, sums);
+	hist_get_stats(&sums[kind], stats);
+	return 0;
+}
+
+void _starpu_sched_latency_init(void)
+{
+	_starpu_sched_latency_enabled = starpu_getenv_number_default("STARPU_SCHED_LATENCY", 1);
+	if (!_starpu_sched_latency_enabled)
+		return;
+
+	nworkers = starpu_worker_get_count();
+	_STARPU_CALLOC(hists, (nworkers + 1) * NCTXS, sizeof(*hists));
+	STARPU_PTHREAD_MUTEX_INIT(&external_mutex, NULL);
+}
+
+void _starpu_sched_latency_deinit(void)
+{
+	unsigned i;
+
+	if (!hists)
+		return;
+	_starpu_sched_latency_enabled = 0;
+	for (i = 0; i < (nworkers + 1) * NCTXS; i++)
+		free(hists[i]);
+	free(hists);
+	hists = NULL;
+	STARPU_PTHREAD_MUTEX_DESTROY(&external_mutex);
+	nworkers = 0;
+}
+
+void _starpu_sched_latency_reset_ctx(unsigned sched_ctx_id)
+{
+	unsigned slot;
+
+	if (!hists || sched_ctx_id >= STARPU_NMAX_SCHED_CTXS)
+		return;
+	for (slot = 0; slot <= nworkers; slot++)
+	{
+		struct sched_latency_hist *h = slot_hists(slot, sched_ctx_id);
+		if (h)
+			memset(h, 0, STARPU_SCHED_LATENCY_NKINDS * sizeof(*h));
+	}
+}
+
+/* - */
+
+enum
+{
+	COUNTER_COUNT,
+	COUNTER_P50,
+	COUNTER_P99,
+	COUNTER_MAX,
+	NCOUNTERS
+};
+
+static int counter_ids[STARPU_SCHED_LATENCY_NKINDS][NCOUNTERS];
+
+static const char *counter_names[STARPU_SCHED_LATENCY_NKINDS][NCOUNTERS] =
+{
+	[STARPU_SCHED_LATENCY_PUSH] = { "starpu.sched.w_push_count", "starpu.sched.w_push_p50", "starpu.sched.w_push_p99", "starpu.sched.w_push_max" },
+	[STARPU_SCHED_LATENCY_POP] = { "starpu.sched.w_pop_count", "starpu.sched.w_pop_p50", "starpu.sched.w_pop_p99", "starpu.sched.w_pop_max" },
+	[STARPU_SCHED_LATENCY_READY_TO_START] = { "starpu.sched.w_ready_to_start_count", "starpu.sched.w_ready_to_start_p50", "starpu.sched.w_ready_to_start_p99", "starpu.sched.w_ready_to_start_max" },
+	[STARPU_SCHED_LATENCY_LOCK_WAIT] = { "starpu.sched.w_lock_wait_count", "starpu.sched.w_lock_wait_p50", "starpu.sched.w_lock_wait_p99", "starpu.sched.w_lock_wait_max" },
+};
+
+static const char *counter_helps[STARPU_SCHED_LATENCY_NKINDS] =
+{
+	[STARPU_SCHED_LATENCY_PUSH] = "pushing a task to the scheduler from this worker",
+	[STARPU_SCHED_LATENCY_POP] = "popping a task from the scheduler on this worker",
+	[STARPU_SCHED_LATENCY_READY_TO_START] = "between a task getting ready and its starting on this worker",
+	[STARPU_SCHED_LATENCY_LOCK_WAIT] = "by this worker waiting for the scheduling mutex of a worker",
+};
+
+static void per_worker_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
+{
+	STARPU_ASSERT(context != NULL);
+	struct _starpu_worker *worker = context;
+	struct sched_latency_hist sums[STARPU_SCHED_LATENCY_NKINDS];
+	struct starpu_sched_latency_stats stats;
+	unsigned kind;
+
+	if (!hists || (unsigned) worker->workerid >= nworkers)
+		return;
+	worker_hists(worker->workerid, sums);
+	for (kind = 0; kind < STARPU_SCHED_LATENCY_NKINDS; kind++)
+	{
+		hist_get_stats(&sums[kind], &stats);
+		_starpu_perf_counter_sample_set_int64_value(sample, counter_ids[kind][COUNTER_COUNT], stats.count);
+		_starpu_perf_counter_sample_set_double_value(sample, counter_ids[kind][COUNTER_P50], stats.p50);
+		_starpu_perf_counter_sample_set_double_value(sample, counter_ids[kind][COUNTER_P99], stats.p99);
+		_starpu_perf_counter_sample_set_double_value(sample, counter_ids[kind][COUNTER_MAX], stats.max);
+	}
+}
+
+void _starpu__sched_latency_c__register_counters(void)
+{
+	static char helps[STARPU_SCHED_LATENCY_NKINDS][NCOUNTERS][128];
+	const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_per_worker;
+	unsigned kind;
+
+	for (kind = 0; kind < STARPU_SCHED_LATENCY_NKINDS; kind++)
+	{
+		snprintf(helps[kind][COUNTER_COUNT], sizeof(helps[kind][COUNTER_COUNT]), "number of latencies recorded %s (since StarPU initialization)", counter_helps[kind]);
+		snprintf(helps[kind][COUNTER_P50], sizeof(helps[kind][COUNTER_P50]), "median latency %s (microseconds)", counter_helps[kind]);
+		snprintf(helps[kind][COUNTER_P99], sizeof(helps[kind][COUNTER_P99]), "99th percentile of latency %s (microseconds)", counter_helps[kind]);
+		snprintf(helps[kind][COUNTER_MAX], sizeof(helps[kind][COUNTER_MAX]), "maximum latency %s (microseconds)", counter_helps[kind]);
+
+		counter_ids[kind][COUNTER_COUNT] = _starpu_perf_counter_register(scope, counter_names[kind][COUNTER_COUNT], starpu_perf_counter_type_int64, helps[kind][COUNTER_COUNT]);
+		counter_ids[kind][COUNTER_P50] = _starpu_perf_counter_register(scope, counter_names[kind][COUNTER_P50], starpu_perf_counter_type_double, helps[kind][COUNTER_P50]);
+		counter_ids[kind][COUNTER_P99] = _starpu_perf_counter_register(scope, counter_names[kind][COUNTER_P99], starpu_perf_counter_type_double, helps[kind][COUNTER_P99]);
+		counter_ids[kind][COUNTER_MAX] = _starpu_perf_counter_register(scope, counter_names[kind][COUNTER_MAX], starpu_perf_counter_type_double, helps[kind][COUNTER_MAX]);
+	}
+
+	_starpu_perf_counter_register_updater(scope, per_worker_sample_updater);
+}
+
+/* - */
+
+static void display_stats(FILE *stream, const char *name, struct sched_latency_hist *sums)
+{
+	struct starpu_sched_latency_stats stats;
+	unsigned kind;
+
+	for (kind = 0; kind < STARPU_SCHED_LATENCY_NKINDS; kind++)
+	{
+		hist_get_stats(&sums[kind], &stats);
+		if (!stats.count)
+			continue;
+		fprintf(stream, "%s\t%s\t%lu\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\n",
+			name, kind_names[kind], stats.count, stats.mean,
+			stats.min, stats.p50, stats.p90, stats.p99, stats.p999, stats.max);
+	}
+}
+
+static void _starpu_sched_latency_display_summary(FILE *stream)
+{
+	struct sched_latency_hist sums[STARPU_SCHED_LATENCY_NKINDS];
+	char name[64];
+	unsigned i;
+
+	fprintf(stream, "\n#---------------------\n");
+	fprintf(stream, "Scheduling latency stats (us):\n");
+	fprintf(stream, "#\tkind\tcount\tmean\tmin\tp50\tp90\tp99\tp99.9\tmax\n");
+
+	for (i = 0; i < nworkers; i++)
+	{
+		starpu_worker_get_name(i, name, sizeof(name));
+		worker_hists(i, sums);
+		display_stats(stream, name, sums);
+	}
+	for (i = 0; i < STARPU_NMAX_SCHED_CTXS; i++)
+	{
+		snprintf(name, sizeof(name), "context %u", i);
+		ctx_hists(i, sums);
+		display_stats(stream, name, sums);
+	}
+	fprintf(stream, "#---------------------\n");
+}
+
+void starpu_profiling_sched_latency_helper_display_summary(void)
+{
+	if (!starpu_getenv_number_default("STARPU_SCHED_LATENCY_STATS", 0) || !hists)
+		return;
+	const char *filename = starpu_getenv("STARPU_SCHED_LATENCY_STATS_FILE");
+	if (filename==NULL)
+		_starpu_sched_latency_display_summary(stderr);
+	else
+	{
+		FILE *sfile = fopen(filename, "w+");
+		STARPU_ASSERT_MSG(sfile, "Could not open file %s for displaying scheduling latency stats (%s). You can specify another file destination with the STARPU_SCHED_LATENCY_STATS_FILE environment variable", filename, strerror(errno));
+		_starpu_sched_latency_display_summary(sfile);
+		fclose(sfile);
+	}
+}
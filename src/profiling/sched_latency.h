@@ -0,0 +1,47 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __SCHED_LATENCY_H__
+#define __SCHED_LATENCY_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <starpu_profiling.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+/** Whether scheduling latencies are recorded, see STARPU_SCHED_LATENCY */
+extern int _starpu_sched_latency_enabled;
+
+/** Allocate the histograms, must be called once the workers are known */
+void _starpu_sched_latency_init(void);
+void _starpu_sched_latency_deinit(void);
+
+/** Forget the latencies recorded for a scheduling context which is being
+ * created */
+void _starpu_sched_latency_reset_ctx(unsigned sched_ctx_id);
+
+/** Record a latency of \p duration us for the worker \p workerid and the
+ * scheduling context \p sched_ctx_id. \p workerid must be the worker of the
+ * calling thread, or -1 if it is not a worker, \p sched_ctx_id can be
+ * STARPU_NMAX_SCHED_CTXS to record only for the worker. */
+void _starpu_sched_latency_record(enum starpu_sched_latency_kind kind, int workerid, unsigned sched_ctx_id, double duration);
+
+#pragma GCC visibility pop
+
+#endif // __SCHED_LATENCY_H__
@@ -0,0 +1,200 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/* Earliest-deadline-first variant of mct: tasks without deadline are mapped
+ * exactly like mct does. Tasks with a deadline are expected to be run by the
+ * queues below before the tasks without deadline (see the deadline field of
+ * starpu_sched_component_prio_data), so their expected termination on a
+ * child does not depend on the background tasks still queued there, but only
+ * on the deadline tasks queued there and on what the worker has already
+ * pulled, including the task it is running, which is never interrupted.
+ */
+
+#include <starpu_sched_component.h>
+#include <starpu_perfmodel.h>
+#include "helper_mct.h"
+#include <float.h>
+#include <core/sched_policy.h>
+#include <core/task.h>
+#include <sched_policies/sched_component.h>
+
+struct _starpu_edf_data
+{
+	struct _starpu_mct_data *mct_data;
+};
+
+/* When a task with a deadline can start on \p child */
+static double edf_deadline_start(struct starpu_sched_component *child)
+{
+	if (starpu_sched_component_is_prio(child))
+		return _starpu_sched_component_prio_deadline_estimated_end(child);
+	/* No queue to run it first, it waits for everything */
+	return child->estimated_end(child);
+}
+
+static int edf_push_task(struct starpu_sched_component * component, struct starpu_task * task)
+{
+	STARPU_ASSERT(component && task && starpu_sched_component_is_edf(component));
+	struct _starpu_edf_data * d = component->data;
+	struct starpu_sched_component * best_component;
+
+	/* Estimated task duration for each child */
+	double estimated_lengths[component->nchildren];
+	/* Estimated transfer duration for each child */
+	double estimated_transfer_length[component->nchildren];
+	/* Estimated transfer+task termination for each child */
+	double estimated_ends_with_task[component->nchildren];
+
+	unsigned suitable_components[component->nchildren];
+	unsigned nsuitable_components;
+	int best_icomponent;
+	unsigned i;
+
+	nsuitable_components = starpu_mct_compute_execution_times(component, task,
+								  estimated_lengths, estimated_transfer_length, suitable_components);
+
+	/* If no suitable components were found, it means that the perfmodel of
+	 * the task had been purged since it has been pushed on the component. */
+	if(nsuitable_components == 0)
+		return eager_calibration_push_task(component, task);
+
+	/* Entering critical section to make sure no two workers
+	   make scheduling decisions at the same time */
+	STARPU_COMPONENT_MUTEX_LOCK(&d->mct_data->scheduling_mutex);
+
+	if (task->deadline == 0.)
+	{
+		/* estimated energy */
+		double local_energy[component->nchildren];
+		/* Minimum transfer+task termination of the task over all workers */
+		double min_exp_end_of_task;
+		/* Maximum termination of the already-scheduled tasks over all workers */
+		double max_exp_end_of_workers;
+
+		starpu_mct_compute_expected_times(component, task, estimated_lengths, estimated_transfer_length,
+						  estimated_ends_with_task, &min_exp_end_of_task, &max_exp_end_of_workers, suitable_components, nsuitable_components);
+
+		/* Compute the energy, if provided*/
+		starpu_mct_compute_energy(component, task, local_energy, suitable_components, nsuitable_components);
+
+		best_icomponent = starpu_mct_get_best_component(d->mct_data, task, estimated_lengths, estimated_transfer_length,
+								estimated_ends_with_task, local_energy, min_exp_end_of_task, max_exp_end_of_workers, suitable_components, nsuitable_components);
+	}
+	else
+	{
+		double now = starpu_timing_now();
+		/* Earliest termination among the children which meet the
+		 * deadline, and among all children */
+		double best_end = DBL_MAX, best_late_end = DBL_MAX;
+		int best_late_icomponent = -1;
+
+		best_icomponent = -1;
+		for (i = 0; i < nsuitable_components; i++)
+		{
+			unsigned icomponent = suitable_components[i];
+			double start, end;
+
+			start = STARPU_MAX(now, edf_deadline_start(component->children[icomponent]));
+			if (now + estimated_transfer_length[icomponent] > start)
+				start = now + estimated_transfer_length[icomponent];
+			end = start + estimated_lengths[icomponent];
+			estimated_ends_with_task[icomponent] = end;
+
+			if (end <= task->deadline && end < best_end)
+			{
+				best_end = end;
+				best_icomponent = icomponent;
+			}
+			if (end < best_late_end)
+			{
+				best_late_end = end;
+				best_late_icomponent = icomponent;
+			}
+		}
+
+		if (best_icomponent == -1 && best_late_icomponent != -1)
+		{
+			/* Nobody can make it, at least make it as early as
+			 * possible, and let the application know */
+			best_icomponent = best_late_icomponent;
+			_starpu_task_deadline_late(task);
+		}
+
+		if (best_icomponent != -1)
+		{
+			task->predicted = estimated_lengths[best_icomponent];
+			task->predicted_transfer = estimated_transfer_length[best_icomponent];
+		}
+	}
+
+	/* If no best component is found, it means that the perfmodel of
+	 * the task had been purged since it has been pushed on the component. */
+	if(best_icomponent == -1)
+	{
+		STARPU_COMPONENT_MUTEX_UNLOCK(&d->mct_data->scheduling_mutex);
+		return eager_calibration_push_task(component, task);
+	}
+
+	best_component = component->children[best_icomponent];
+
+	if(starpu_sched_component_is_worker(best_component))
+	{
+		best_component->can_pull(best_component);
+		STARPU_COMPONENT_MUTEX_UNLOCK(&d->mct_data->scheduling_mutex);
+
+		return 1;
+	}
+
+	starpu_sched_task_break(task);
+	int ret = starpu_sched_component_push_task(component, best_component, task);
+
+	/* I can now exit the critical section: Pushing the task below ensures that its execution
+	   time will be taken into account for subsequent scheduling decisions */
+	STARPU_COMPONENT_MUTEX_UNLOCK(&d->mct_data->scheduling_mutex);
+
+	return ret;
+}
+
+static void edf_component_deinit_data(struct starpu_sched_component * component)
+{
+	STARPU_ASSERT(starpu_sched_component_is_edf(component));
+	struct _starpu_edf_data * d = component->data;
+
+	STARPU_PTHREAD_MUTEX_DESTROY(&d->mct_data->scheduling_mutex);
+	free(d->mct_data);
+	free(d);
+}
+
+int starpu_sched_component_is_edf(struct starpu_sched_component * component)
+{
+	return component->push_task == edf_push_task;
+}
+
+struct starpu_sched_component * starpu_sched_component_edf_create(struct starpu_sched_tree *tree, struct starpu_sched_component_mct_data * params)
+{
+	struct starpu_sched_component * component = starpu_sched_component_create(tree, "edf");
+	struct _starpu_edf_data *data;
+	_STARPU_CALLOC(data, 1, sizeof(*data));
+
+	data->mct_data = starpu_mct_init_parameters(params);
+	STARPU_PTHREAD_MUTEX_INIT(&data->mct_data->scheduling_mutex, NULL);
+	component->data = data;
+
+	component->push_task = edf_push_task;
+	component->deinit_data = edf_component_deinit_data;
+
+	return component;
+}
@@ -0,0 +1,315 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/* Insertion-based HEFT variant: like mct, but also remembers for each child
+ * the idle gaps that were left in its expected timeline, i.e. when a task was
+ * appended to a child while its data would not be transferred before the child
+ * becomes idle. A later task may then be placed in such a gap instead of being
+ * appended at the end of the child, when it fits in the gap once its own data
+ * is available. The queues below are expected to run first tasks whose data
+ * is ready (the default for modular schedulers) so that such tasks actually
+ * get executed while the tasks around the gap are waiting for their data.
+ */
+
+#include <starpu_sched_component.h>
+#include <starpu_perfmodel.h>
+#include "helper_mct.h"
+#include <float.h>
+#include <core/sched_policy.h>
+#include <core/task.h>
+
+/* Maximum number of gaps remembered per child, the oldest ones are dropped */
+#define MAX_GAPS 16
+
+struct _starpu_heft_insert_gaps
+{
+	unsigned ngaps;
+	/* Sorted by start date */
+	double start[MAX_GAPS];
+	double end[MAX_GAPS];
+};
+
+struct _starpu_heft_insert_data
+{
+	struct _starpu_mct_data *mct_data;
+	/* Gaps of each child */
+	struct _starpu_heft_insert_gaps *gaps;
+	unsigned nchildren;
+	/* Number of tasks placed in a gap, and number of tasks appended */
+	unsigned long ninserted, nappended;
+};
+
+static void gaps_remove(struct _starpu_heft_insert_gaps *gaps, unsigned i)
+{
+	STARPU_ASSERT(i < gaps->ngaps);
+	gaps->ngaps--;
+	memmove(&gaps->start[i], &gaps->start[i+1], (gaps->ngaps - i) * sizeof(gaps->start[0]));
+	memmove(&gaps->end[i], &gaps->end[i+1], (gaps->ngaps - i) * sizeof(gaps->end[0]));
+}
+
+static void gaps_add(struct _starpu_heft_insert_gaps *gaps, double start, double end)
+{
+	unsigned i;
+
+	if (end <= start)
+		return;
+
+	if (gaps->ngaps == MAX_GAPS)
+	{
+		if (start < gaps->start[0])
+			/* Older than all we have, drop it */
+			return;
+		gaps_remove(gaps, 0);
+	}
+
+	for (i = gaps->ngaps; i > 0 && gaps->start[i-1] > start; i--)
+	{
+		gaps->start[i] = gaps->start[i-1];
+		gaps->end[i] = gaps->end[i-1];
+	}
+	gaps->start[i] = start;
+	gaps->end[i] = end;
+	gaps->ngaps++;
+}
+
+/* Drop the gaps which are already in the past */
+static void gaps_prune(struct _starpu_heft_insert_gaps *gaps, double now)
+{
+	unsigned i = 0;
+
+	while (i < gaps->ngaps)
+	{
+		if (gaps->end[i] <= now)
+			gaps_remove(gaps, i);
+		else
+		{
+			if (gaps->start[i] < now)
+				gaps->start[i] = now;
+			i++;
+		}
+	}
+}
+
+/* Return the index of the first gap in which a task of length \p length, whose
+ * data is available at \p ready, fits, and the date at which it would start,
+ * or -1 */
+static int gaps_find(struct _starpu_heft_insert_gaps *gaps, double ready, double length, double *start)
+{
+	unsigned i;
+
+	for (i = 0; i < gaps->ngaps; i++)
+	{
+		double s = STARPU_MAX(gaps->start[i], ready);
+		if (s + length <= gaps->end[i])
+		{
+			*start = s;
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void heft_insert_check_children(struct starpu_sched_component *component)
+{
+	struct _starpu_heft_insert_data *d = component->data;
+
+	if (d->nchildren == component->nchildren)
+		return;
+
+	/* The children changed, we can not trust the gaps any more */
+	free(d->gaps);
+	_STARPU_CALLOC(d->gaps, component->nchildren, sizeof(*d->gaps));
+	d->nchildren = component->nchildren;
+}
+
+static int heft_insert_push_task(struct starpu_sched_component * component, struct starpu_task * task)
+{
+	STARPU_ASSERT(component && task && starpu_sched_component_is_heft_insert(component));
+	struct _starpu_heft_insert_data * d = component->data;
+	struct starpu_sched_component * best_component;
+
+	/* Estimated task duration for each child */
+	double estimated_lengths[component->nchildren];
+	/* Estimated transfer duration for each child */
+	double estimated_transfer_length[component->nchildren];
+	/* Estimated transfer+task termination for each child */
+	double estimated_ends_with_task[component->nchildren];
+	/* Gap in which the task would be inserted for each child, or -1 */
+	int gap[component->nchildren];
+	/* Start of the task in that gap */
+	double gap_start[component->nchildren];
+
+	/* estimated energy */
+	double local_energy[component->nchildren];
+
+	/* Minimum transfer+task termination of the task over all workers */
+	double min_exp_end_of_task;
+	/* Maximum termination of the already-scheduled tasks over all workers */
+	double max_exp_end_of_workers;
+
+	unsigned suitable_components[component->nchildren];
+	unsigned nsuitable_components;
+	unsigned i;
+	double now, end;
+
+	nsuitable_components = starpu_mct_compute_execution_times(component, task,
+								  estimated_lengths, estimated_transfer_length, suitable_components);
+
+	/* If no suitable components were found, it means that the perfmodel of
+	 * the task had been purged since it has been pushed on the component. */
+	if(nsuitable_components == 0)
+		return eager_calibration_push_task(component, task);
+
+	/* Entering critical section to make sure no two workers
+	   make scheduling decisions at the same time */
+	STARPU_COMPONENT_MUTEX_LOCK(&d->mct_data->scheduling_mutex);
+
+	heft_insert_check_children(component);
+
+	starpu_mct_compute_expected_times(component, task, estimated_lengths, estimated_transfer_length,
+					  estimated_ends_with_task, &min_exp_end_of_task, &max_exp_end_of_workers, suitable_components, nsuitable_components);
+
+	/* Check whether the task would rather fit in a gap */
+	now = starpu_timing_now();
+	for (i = 0; i < nsuitable_components; i++)
+	{
+		unsigned icomponent = suitable_components[i];
+		struct _starpu_heft_insert_gaps *gaps = &d->gaps[icomponent];
+
+		gap[icomponent] = -1;
+		gaps_prune(gaps, now);
+		if (!gaps->ngaps)
+			continue;
+
+		gap[icomponent] = gaps_find(gaps, now + estimated_transfer_length[icomponent], estimated_lengths[icomponent], &gap_start[icomponent]);
+		if (gap[icomponent] == -1)
+			continue;
+
+		end = gap_start[icomponent] + estimated_lengths[icomponent];
+		if (end >= estimated_ends_with_task[icomponent])
+		{
+			/* Not better than appending */
+			gap[icomponent] = -1;
+			continue;
+		}
+
+		estimated_ends_with_task[icomponent] = end;
+		if (end < min_exp_end_of_task)
+			min_exp_end_of_task = end;
+	}
+
+	/* Compute the energy, if provided*/
+	starpu_mct_compute_energy(component, task, local_energy, suitable_components, nsuitable_components);
+
+	int best_icomponent = starpu_mct_get_best_component(d->mct_data, task, estimated_lengths, estimated_transfer_length,
+							    estimated_ends_with_task, local_energy, min_exp_end_of_task, max_exp_end_of_workers, suitable_components, nsuitable_components);
+
+	/* If no best component is found, it means that the perfmodel of
+	 * the task had been purged since it has been pushed on the component. */
+	if(best_icomponent == -1)
+	{
+		STARPU_COMPONENT_MUTEX_UNLOCK(&d->mct_data->scheduling_mutex);
+		return eager_calibration_push_task(component, task);
+	}
+
+	best_component = component->children[best_icomponent];
+
+	if(starpu_sched_component_is_worker(best_component))
+	{
+		best_component->can_pull(best_component);
+		STARPU_COMPONENT_MUTEX_UNLOCK(&d->mct_data->scheduling_mutex);
+
+		return 1;
+	}
+
+	{
+		struct _starpu_heft_insert_gaps *gaps = &d->gaps[best_icomponent];
+		int g = gap[best_icomponent];
+
+		if (g != -1)
+		{
+			/* Split the gap around the task */
+			double gstart = gaps->start[g], gend = gaps->end[g];
+			double tstart = gap_start[best_icomponent];
+
+			gaps_remove(gaps, g);
+			gaps_add(gaps, gstart, tstart);
+			gaps_add(gaps, tstart + estimated_lengths[best_icomponent], gend);
+			d->ninserted++;
+
+			/* The task runs while the child would otherwise be
+			 * idle, so it does not push back the expected end of
+			 * the child, which adds the predictions to its
+			 * expected length */
+			task->predicted = 0.;
+			task->predicted_transfer = 0.;
+		}
+		else
+		{
+			/* The child will be idle until the data of the task
+			 * is transferred */
+			double child_end = best_component->estimated_end(best_component);
+			if (child_end < now)
+				child_end = now;
+			gaps_add(gaps, child_end, now + estimated_transfer_length[best_icomponent]);
+			d->nappended++;
+		}
+	}
+
+	starpu_sched_task_break(task);
+	int ret = starpu_sched_component_push_task(component, best_component, task);
+
+	/* I can now exit the critical section: Pushing the task below ensures that its execution
+	   time will be taken into account for subsequent scheduling decisions */
+	STARPU_COMPONENT_MUTEX_UNLOCK(&d->mct_data->scheduling_mutex);
+
+	return ret;
+}
+
+static void heft_insert_component_deinit_data(struct starpu_sched_component * component)
+{
+	STARPU_ASSERT(starpu_sched_component_is_heft_insert(component));
+	struct _starpu_heft_insert_data * d = component->data;
+
+	if (starpu_getenv_number_default("STARPU_SCHED_HEFT_INSERT_STATS", 0))
+		_STARPU_DISP("heft_insert: %lu tasks inserted in gaps, %lu tasks appended\n", d->ninserted, d->nappended);
+
+	STARPU_PTHREAD_MUTEX_DESTROY(&d->mct_data->scheduling_mutex);
+	free(d->mct_data);
+	free(d->gaps);
+	free(d);
+}
+
+int starpu_sched_component_is_heft_insert(struct starpu_sched_component * component)
+{
+	return component->push_task == heft_insert_push_task;
+}
+
+struct starpu_sched_component * starpu_sched_component_heft_insert_create(struct starpu_sched_tree *tree, struct starpu_sched_component_mct_data * params)
+{
+	struct starpu_sched_component * component = starpu_sched_component_create(tree, "heft_insert");
+	struct _starpu_heft_insert_data *data;
+	_STARPU_CALLOC(data, 1, sizeof(*data));
+
+	data->mct_data = starpu_mct_init_parameters(params);
+	STARPU_PTHREAD_MUTEX_INIT(&data->mct_data->scheduling_mutex, NULL);
+	component->data = data;
+
+	component->push_task = heft_insert_push_task;
+	component->deinit_data = heft_insert_component_deinit_data;
+
+	return component;
+}
@@ -0,0 +1,355 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/* Memory-pressure-aware queue: like a fifo, but it keeps track of the
+ * amount of data that the queued tasks will have to allocate on the memory
+ * node of the workers below, i.e. the size of their data which is not already
+ * allocated there. When the memory used on the node plus this planned footprint would
+ * exceed a threshold of the memory available on the node (see
+ * STARPU_LIMIT_CPU_MEM and alike), new tasks are refused, so they stay above
+ * until queued tasks are done, instead of being prefetched and evicting the
+ * data of the tasks before them. And when a worker pulls a task which does
+ * not fit, a task among the next ones whose data is mostly already there is
+ * given instead.
+ *
+ * Without a memory limit on the node, this behaves as a plain fifo. It is
+ * meant to be put above the queue which actually orders the tasks for the
+ * workers, e.g. a prio component, so that it only controls how many tasks get
+ * there.
+ */
+
+#include <starpu_sched_component.h>
+#include <starpu_scheduler.h>
+#include <common/list.h>
+#include <core/workers.h>
+#include <datawizard/coherency.h>
+
+LIST_TYPE(_starpu_mem_pressure_entry,
+	struct starpu_task *task;
+	/* Bytes that the task will have to allocate on the memory node, as
+	 * last computed */
+	size_t missing;
+);
+
+struct _starpu_mem_pressure_data
+{
+	struct _starpu_mem_pressure_entry_list entries;
+	unsigned ntasks;
+	/* Sum of the missing bytes of the queued tasks */
+	size_t planned;
+	double exp_len;
+	unsigned threshold;
+	unsigned window;
+	unsigned long nthrottled, nreordered;
+	starpu_pthread_mutex_t mutex;
+};
+
+/* Memory node of the workers below, or -1 if they do not share one */
+static int mem_pressure_node(struct starpu_sched_component *component)
+{
+	if (!(component->properties & STARPU_SCHED_COMPONENT_SINGLE_MEMORY_NODE))
+		return -1;
+	int workerid = starpu_bitmap_first(&component->workers_in_ctx);
+	if (workerid == -1)
+		return -1;
+	return starpu_worker_get_memory_node(workerid);
+}
+
+/* How many bytes of the memory node we allow the tasks to use, 0 if there is
+ * no limit */
+static size_t mem_pressure_limit(struct _starpu_mem_pressure_data *data, int node)
+{
+	if (node < 0)
+		return 0;
+	starpu_ssize_t total = starpu_memory_get_total(node);
+	if (total == -1)
+		return 0;
+	return (size_t) total / 100 * data->threshold;
+}
+
+/* Size of the data of the task which is not allocated on the node yet */
+static size_t mem_pressure_missing(struct starpu_task *task, int node)
+{
+	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
+	unsigned i, j;
+	size_t missing = 0;
+
+	for (i = 0; i < nbuffers; i++)
+	{
+		starpu_data_handle_t handle = STARPU_TASK_GET_HANDLE(task, i);
+
+		for (j = 0; j < i; j++)
+			if (STARPU_TASK_GET_HANDLE(task, j) == handle)
+				break;
+		if (j < i)
+			/* Already counted */
+			continue;
+
+		if (!starpu_data_test_if_allocated_on_node(handle, node))
+			missing += _starpu_data_get_alloc_size(handle);
+	}
+	return missing;
+}
+
+/* The data of the queued tasks get allocated on the node as they are
+ * prefetched, and are then accounted in the memory used on the node, stop
+ * counting them as planned. Called with the mutex held */
+static void mem_pressure_update_planned(struct _starpu_mem_pressure_data *data, int node)
+{
+	struct _starpu_mem_pressure_entry *entry;
+
+	for (entry = _starpu_mem_pressure_entry_list_begin(&data->entries);
+	     entry != _starpu_mem_pressure_entry_list_end(&data->entries);
+	     entry = _starpu_mem_pressure_entry_list_next(entry))
+	{
+		if (!entry->missing)
+			continue;
+		size_t missing = mem_pressure_missing(entry->task, node);
+		if (missing < entry->missing)
+		{
+			data->planned -= entry->missing - missing;
+			entry->missing = missing;
+		}
+	}
+}
+
+static void mem_pressure_component_deinit_data(struct starpu_sched_component * component)
+{
+	STARPU_ASSERT(component && component->data);
+	struct _starpu_mem_pressure_data * data = component->data;
+
+	if (starpu_getenv_number_default("STARPU_SCHED_MEM_PRESSURE_STATS", 0))
+		_STARPU_DISP("mem_pressure: %lu tasks throttled, %lu tasks reordered\n", data->nthrottled, data->nreordered);
+
+	STARPU_ASSERT(_starpu_mem_pressure_entry_list_empty(&data->entries));
+	STARPU_PTHREAD_MUTEX_DESTROY(&data->mutex);
+	free(data);
+}
+
+static double mem_pressure_estimated_end(struct starpu_sched_component * component)
+{
+	STARPU_ASSERT(component && component->data);
+	struct _starpu_mem_pressure_data * data = component->data;
+	return starpu_sched_component_estimated_end_min_add(component, data->exp_len);
+}
+
+static double mem_pressure_estimated_load(struct starpu_sched_component * component)
+{
+	STARPU_ASSERT(component && component->data);
+	STARPU_ASSERT(starpu_bitmap_cardinal(&component->workers_in_ctx) != 0);
+	struct _starpu_mem_pressure_data * data = component->data;
+	double relative_speedup = 0.0;
+	double load = starpu_sched_component_estimated_load(component);
+	int i;
+
+	for(i = starpu_bitmap_first(&component->workers_in_ctx);
+	    i != -1;
+	    i = starpu_bitmap_next(&component->workers_in_ctx, i))
+		relative_speedup += starpu_worker_get_relative_speedup(starpu_worker_get_perf_archtype(i, component->tree->sched_ctx_id));
+	relative_speedup /= starpu_bitmap_cardinal(&component->workers_in_ctx);
+	STARPU_ASSERT(!_STARPU_IS_ZERO(relative_speedup));
+
+	STARPU_COMPONENT_MUTEX_LOCK(&data->mutex);
+	load += data->ntasks / relative_speedup;
+	STARPU_COMPONENT_MUTEX_UNLOCK(&data->mutex);
+	return load;
+}
+
+static int mem_pressure_push_local_task(struct starpu_sched_component * component, struct starpu_task * task, unsigned is_pushback)
+{
+	STARPU_ASSERT(component && component->data && task);
+	STARPU_ASSERT(starpu_sched_component_can_execute_task(component,task));
+	struct _starpu_mem_pressure_data * data = component->data;
+	int node = mem_pressure_node(component);
+	size_t limit = mem_pressure_limit(data, node);
+	size_t missing = 0;
+	int prefetch = !is_pushback;
+	int ret = 0;
+
+	STARPU_COMPONENT_MUTEX_LOCK(&data->mutex);
+
+	if (limit)
+	{
+		mem_pressure_update_planned(data, node);
+		missing = mem_pressure_missing(task, node);
+		if (starpu_memory_get_used(node) + data->planned + missing > limit)
+		{
+			if (!is_pushback && data->ntasks)
+			{
+				/* No room, let the task wait above until
+				 * the queued tasks are done */
+				data->nthrottled++;
+				ret = 1;
+			}
+			/* Otherwise we have to take it, but do not
+			 * prefetch its data, that would evict others */
+			prefetch = 0;
+		}
+	}
+
+	if (!ret)
+	{
+		struct _starpu_mem_pressure_entry *entry = _starpu_mem_pressure_entry_new();
+		entry->task = task;
+		/* Even if we prefetch it, the data may not be allocated yet,
+		 * so keep it planned until it is */
+		entry->missing = missing;
+		if (is_pushback)
+			_starpu_mem_pressure_entry_list_push_front(&data->entries, entry);
+		else
+			_starpu_mem_pressure_entry_list_push_back(&data->entries, entry);
+		data->ntasks++;
+		data->planned += entry->missing;
+		if (!isnan(task->predicted))
+			data->exp_len += task->predicted;
+		if (prefetch)
+			starpu_sched_component_prefetch_on_node(component, task);
+	}
+
+	STARPU_COMPONENT_MUTEX_UNLOCK(&data->mutex);
+
+	if (!ret && !is_pushback)
+		component->can_pull(component);
+
+	return ret;
+}
+
+static int mem_pressure_push_task(struct starpu_sched_component * component, struct starpu_task * task)
+{
+	return mem_pressure_push_local_task(component, task, 0);
+}
+
+static struct starpu_task * mem_pressure_pull_task(struct starpu_sched_component * component, struct starpu_sched_component * to)
+{
+	STARPU_ASSERT(component && component->data);
+	struct _starpu_mem_pressure_data * data = component->data;
+	struct _starpu_mem_pressure_entry *entry;
+	struct starpu_task *task = NULL;
+	int node;
+	size_t limit;
+
+	if (!STARPU_RUNNING_ON_VALGRIND && !data->ntasks)
+	{
+		starpu_sched_component_send_can_push_to_parents(component);
+		return NULL;
+	}
+
+	if (to->properties & STARPU_SCHED_COMPONENT_SINGLE_MEMORY_NODE)
+		node = starpu_worker_get_memory_node(starpu_bitmap_first(&to->workers_in_ctx));
+	else
+		node = mem_pressure_node(component);
+	limit = mem_pressure_limit(data, node);
+
+	STARPU_COMPONENT_MUTEX_LOCK(&data->mutex);
+	entry = _starpu_mem_pressure_entry_list_begin(&data->entries);
+	if (entry != _starpu_mem_pressure_entry_list_end(&data->entries) && limit
+		&& starpu_memory_get_used(node) + mem_pressure_missing(entry->task, node) > limit)
+	{
+		/* The first task does not fit, look for the task among the
+		 * next ones that needs to bring the least data */
+		struct _starpu_mem_pressure_entry *e, *best = entry;
+		size_t best_missing = SIZE_MAX;
+		unsigned n = 0;
+
+		for (e = entry;
+		     e != _starpu_mem_pressure_entry_list_end(&data->entries) && n < data->window;
+		     e = _starpu_mem_pressure_entry_list_next(e), n++)
+		{
+			size_t missing = mem_pressure_missing(e->task, node);
+			if (missing < best_missing)
+			{
+				best = e;
+				best_missing = missing;
+				if (!missing)
+					break;
+			}
+		}
+		if (best != entry)
+			data->nreordered++;
+		entry = best;
+	}
+
+	if (entry != _starpu_mem_pressure_entry_list_end(&data->entries))
+	{
+		task = entry->task;
+		_starpu_mem_pressure_entry_list_erase(&data->entries, entry);
+		data->ntasks--;
+		data->planned -= entry->missing;
+		if (!isnan(task->predicted))
+			data->exp_len -= task->predicted;
+		if (!data->ntasks || data->exp_len < 0.0)
+			/* Avoid rounding errors */
+			data->exp_len = 0.0;
+		_starpu_mem_pressure_entry_delete(entry);
+	}
+	STARPU_COMPONENT_MUTEX_UNLOCK(&data->mutex);
+
+	/* We may now have room for more tasks */
+	starpu_sched_component_send_can_push_to_parents(component);
+
+	return task;
+}
+
+static int mem_pressure_can_push(struct starpu_sched_component * component, struct starpu_sched_component * to STARPU_ATTRIBUTE_UNUSED)
+{
+	STARPU_ASSERT(component && starpu_sched_component_is_mem_pressure(component));
+	int res = 0;
+	struct starpu_task * task;
+
+	task = starpu_sched_component_pump_downstream(component, &res);
+
+	if(task)
+	{
+		int ret = mem_pressure_push_local_task(component,task,1);
+		STARPU_ASSERT(!ret);
+	}
+
+	return res;
+}
+
+int starpu_sched_component_is_mem_pressure(struct starpu_sched_component * component)
+{
+	return component->push_task == mem_pressure_push_task;
+}
+
+struct starpu_sched_component * starpu_sched_component_mem_pressure_create(struct starpu_sched_tree *tree, struct starpu_sched_component_mem_pressure_data * params)
+{
+	struct starpu_sched_component * component = starpu_sched_component_create(tree, "mem_pressure");
+	struct _starpu_mem_pressure_data *data;
+	_STARPU_CALLOC(data, 1, sizeof(*data));
+	_starpu_mem_pressure_entry_list_init(&data->entries);
+	STARPU_PTHREAD_MUTEX_INIT(&data->mutex,NULL);
+
+	if (params)
+	{
+		data->threshold = params->threshold;
+		data->window = params->window;
+	}
+	if (!data->threshold)
+		data->threshold = 90;
+	if (!data->window)
+		data->window = 16;
+
+	component->data = data;
+	component->estimated_end = mem_pressure_estimated_end;
+	component->estimated_load = mem_pressure_estimated_load;
+	component->push_task = mem_pressure_push_task;
+	component->pull_task = mem_pressure_pull_task;
+	component->can_push = mem_pressure_can_push;
+	component->deinit_data = mem_pressure_component_deinit_data;
+
+	return component;
+}
@@ -20,6 +20,7 @@
 #include <common/fxt.h>
 #include <core/workers.h>
 #include <sched_policies/prio_deque.h>
+#include <sched_policies/sched_component.h>
 
 #ifdef STARPU_USE_FXT
 #define STARPU_TRACE_SCHED_COMPONENT_PUSH_PRIO(component,ntasks,exp_len) do {                                 \
@@ -52,12 +53,91 @@ struct _starpu_prio_data
 	double exp_len_threshold;
 	int ready;
 	int exp;
+	int deadline;
+	/* Tasks with a deadline, sorted by deadline, when deadline is set */
+	struct starpu_task_list deadline_tasks;
+	unsigned ndeadline_tasks;
+	/* Expected length of the tasks with a deadline, kept apart from the
+	 * one of the queue since they are run first */
+	double deadline_exp_len;
 };
 
+/* Insert \p task in the list of tasks with a deadline, in deadline order */
+static void prio_push_deadline_task(struct _starpu_prio_data *data, struct starpu_task *task)
+{
+	struct starpu_task_list *list = &data->deadline_tasks;
+	struct starpu_task *next;
+
+	data->ndeadline_tasks++;
+
+	if (starpu_task_list_empty(list) || starpu_task_list_back(list)->deadline <= task->deadline)
+	{
+		starpu_task_list_push_back(list, task);
+		return;
+	}
+
+	for (next  = starpu_task_list_begin(list);
+	     next->deadline <= task->deadline;
+	     next  = starpu_task_list_next(next))
+		;
+
+	task->prev = next->prev;
+	task->next = next;
+	if (next->prev)
+		next->prev->next = task;
+	else
+		list->_head = task;
+	next->prev = task;
+}
+
+/* Pop the task with the earliest deadline. When \p workerid is not -1, a
+ * later task whose data is already on the worker's node may be taken
+ * instead, if the earliest one can still meet its deadline after it. */
+static struct starpu_task *prio_pop_deadline_task(struct _starpu_prio_data *data, int workerid, double now)
+{
+	struct starpu_task_list *list = &data->deadline_tasks;
+	struct starpu_task *first = starpu_task_list_front(list);
+	struct starpu_task *task = first;
+
+	if (workerid != -1 && !isnan(first->predicted))
+	{
+		size_t non_ready, non_loading, non_allocated;
+		starpu_st_non_ready_buffers_size(first, workerid, &non_ready, &non_loading, &non_allocated);
+		if (non_ready)
+		{
+			struct starpu_task *current;
+			for (current  = starpu_task_list_next(first);
+			     current != starpu_task_list_end(list);
+			     current  = starpu_task_list_next(current))
+			{
+				if (isnan(current->predicted)
+				    || now + current->predicted + first->predicted > first->deadline)
+					continue;
+				starpu_st_non_ready_buffers_size(current, workerid, &non_ready, &non_loading, &non_allocated);
+				if (!non_ready)
+				{
+					task = current;
+					break;
+				}
+			}
+		}
+	}
+
+	starpu_task_list_erase(list, task);
+	data->ndeadline_tasks--;
+	return task;
+}
+
+static inline unsigned prio_ntasks(struct _starpu_prio_data *data)
+{
+	return data->prio.ntasks + data->ndeadline_tasks;
+}
+
 static void prio_component_deinit_data(struct starpu_sched_component * component)
 {
 	STARPU_ASSERT(component && component->data);
 	struct _starpu_prio_data * f = component->data;
+	STARPU_ASSERT(starpu_task_list_empty(&f->deadline_tasks));
 	starpu_st_prio_deque_destroy(&f->prio);
 	STARPU_PTHREAD_MUTEX_DESTROY(&f->mutex);
 	free(f);
@@ -68,7 +148,17 @@ static double prio_estimated_end(struct starpu_sched_component * component)
 	STARPU_ASSERT(component && component->data);
 	struct _starpu_prio_data * data = component->data;
 	struct starpu_st_prio_deque * queue = &data->prio;
-	return starpu_sched_component_estimated_end_min_add(component, queue->exp_len);
+	return starpu_sched_component_estimated_end_min_add(component, queue->exp_len + data->deadline_exp_len);
+}
+
+/* Expected termination of the tasks with a deadline queued in the prio
+ * component \p component: they only wait for what the workers below have
+ * already pulled, including the task they are running */
+double _starpu_sched_component_prio_deadline_estimated_end(struct starpu_sched_component * component)
+{
+	STARPU_ASSERT(component && starpu_sched_component_is_prio(component));
+	struct _starpu_prio_data * data = component->data;
+	return starpu_sched_component_estimated_end_min_add(component, data->deadline_exp_len);
 }
 
 static double prio_estimated_load(struct starpu_sched_component * component)
@@ -76,7 +166,6 @@ static double prio_estimated_load(struct starpu_sched_component * component)
 	STARPU_ASSERT(component && component->data);
 	STARPU_ASSERT(starpu_bitmap_cardinal(&component->workers_in_ctx) != 0);
 	struct _starpu_prio_data * data = component->data;
-	struct starpu_st_prio_deque * queue = &data->prio;
 	starpu_pthread_mutex_t * mutex = &data->mutex;
 	double relative_speedup = 0.0;
 	double load = starpu_sched_component_estimated_load(component);
@@ -85,7 +174,7 @@ static double prio_estimated_load(struct starpu_sched_component * component)
 		int first_worker = starpu_bitmap_first(&component->workers_in_ctx);
 		relative_speedup = starpu_worker_get_relative_speedup(starpu_worker_get_perf_archtype(first_worker, component->tree->sched_ctx_id));
 		STARPU_COMPONENT_MUTEX_LOCK(mutex);
-		load += queue->ntasks / relative_speedup;
+		load += prio_ntasks(data) / relative_speedup;
 		STARPU_COMPONENT_MUTEX_UNLOCK(mutex);
 		return load;
 	}
@@ -99,7 +188,7 @@ static double prio_estimated_load(struct starpu_sched_component * component)
 		relative_speedup /= starpu_bitmap_cardinal(&component->workers_in_ctx);
 		STARPU_ASSERT(!_STARPU_IS_ZERO(relative_speedup));
 		STARPU_COMPONENT_MUTEX_LOCK(mutex);
-		load += queue->ntasks / relative_speedup;
+		load += prio_ntasks(data) / relative_speedup;
 		STARPU_COMPONENT_MUTEX_UNLOCK(mutex);
 	}
 	return load;
@@ -114,23 +203,28 @@ static int prio_push_local_task(struct starpu_sched_component * component, struc
 	starpu_pthread_mutex_t * mutex = &data->mutex;
 	int ret = 0;
 	const double now = starpu_timing_now();
+	int is_deadline = data->deadline && task->deadline != 0.;
 	STARPU_COMPONENT_MUTEX_LOCK(mutex);
 
 	double exp_len = NAN;
 
-	if (!is_pushback && data->ntasks_threshold != 0 && queue->ntasks >= data->ntasks_threshold)
+	if (!is_pushback && data->ntasks_threshold != 0 && prio_ntasks(data) >= data->ntasks_threshold)
 	{
 		ret = 1;
 		STARPU_COMPONENT_MUTEX_UNLOCK(mutex);
 	}
 	else if(data->exp)
 	{
+		/* Deadline tasks are accounted apart */
+		double *len = is_deadline ? &data->deadline_exp_len : &queue->exp_len;
+
 		if(!isnan(task->predicted))
-			exp_len = queue->exp_len + task->predicted;
+			exp_len = *len + task->predicted;
 		else
-			exp_len = queue->exp_len;
+			exp_len = *len;
 
-		if (!is_pushback && data->exp_len_threshold != 0.0 && exp_len >= data->exp_len_threshold)
+		if (!is_pushback && data->exp_len_threshold != 0.0
+		    && queue->exp_len + data->deadline_exp_len - *len + exp_len >= data->exp_len_threshold)
 		{
 			static int warned;
 			STARPU_HG_DISABLE_CHECKING(warned);
@@ -158,8 +252,8 @@ static int prio_push_local_task(struct starpu_sched_component * component, struc
 
 			if(!isnan(task->predicted))
 			{
-				queue->exp_len = exp_len;
-				queue->exp_end = queue->exp_start + queue->exp_len;
+				*len = exp_len;
+				queue->exp_end = queue->exp_start + queue->exp_len + data->deadline_exp_len;
 			}
 			STARPU_ASSERT(!isnan(queue->exp_end));
 			STARPU_ASSERT(!isnan(queue->exp_len));
@@ -169,13 +263,24 @@ static int prio_push_local_task(struct starpu_sched_component * component, struc
 
 	if(!ret)
 	{
-		if(is_pushback)
+		if(is_deadline)
+		{
+			/* Tasks with a deadline go before all others, in
+			 * deadline order */
+			prio_push_deadline_task(data, task);
+			if(!is_pushback)
+			{
+				starpu_sched_component_prefetch_on_node(component, task);
+				STARPU_TRACE_SCHED_COMPONENT_PUSH_PRIO(component, prio_ntasks(data), exp_len);
+			}
+		}
+		else if(is_pushback)
 			ret = starpu_st_prio_deque_push_front_task(queue,task);
 		else
 		{
 			ret = starpu_st_prio_deque_push_back_task(queue,task);
 			starpu_sched_component_prefetch_on_node(component, task);
-			STARPU_TRACE_SCHED_COMPONENT_PUSH_PRIO(component, queue->ntasks, exp_len);
+			STARPU_TRACE_SCHED_COMPONENT_PUSH_PRIO(component, prio_ntasks(data), exp_len);
 		}
 		STARPU_COMPONENT_MUTEX_UNLOCK(mutex);
 		if(!is_pushback)
@@ -199,7 +304,7 @@ static struct starpu_task * prio_pull_task(struct starpu_sched_component * compo
 	starpu_pthread_mutex_t * mutex = &data->mutex;
 	const double now = starpu_timing_now();
 
-	if (!STARPU_RUNNING_ON_VALGRIND && starpu_st_prio_deque_is_empty(queue))
+	if (!STARPU_RUNNING_ON_VALGRIND && starpu_st_prio_deque_is_empty(queue) && !data->ndeadline_tasks)
 	{
 		starpu_sched_component_send_can_push_to_parents(component);
 		return NULL;
@@ -207,7 +312,15 @@ static struct starpu_task * prio_pull_task(struct starpu_sched_component * compo
 
 	STARPU_COMPONENT_MUTEX_LOCK(mutex);
 	struct starpu_task * task;
-	if (data->ready && to->properties & STARPU_SCHED_COMPONENT_SINGLE_MEMORY_NODE)
+	int ready = data->ready && to->properties & STARPU_SCHED_COMPONENT_SINGLE_MEMORY_NODE;
+	double *len = &queue->exp_len;
+	if (data->ndeadline_tasks)
+	{
+		/* Tasks with a deadline preempt the others, in queue order */
+		task = prio_pop_deadline_task(data, ready ? starpu_bitmap_first(&to->workers_in_ctx) : -1, now);
+		len = &data->deadline_exp_len;
+	}
+	else if (ready)
 		task = starpu_st_prio_deque_deque_first_ready_task(queue, starpu_bitmap_first(&to->workers_in_ctx));
 	else
 		task = starpu_st_prio_deque_pop_task(queue);
@@ -215,40 +328,42 @@ static struct starpu_task * prio_pull_task(struct starpu_sched_component * compo
 	{
 		if(!isnan(task->predicted))
 		{
-			const double exp_len = queue->exp_len - task->predicted;
+			const double exp_len = *len - task->predicted;
 			queue->exp_start = now + task->predicted;
 			if (exp_len >= 0.0)
 			{
-				queue->exp_len = exp_len;
+				*len = exp_len;
 			}
 			else
 			{
 				/* exp_len can become negative due to rounding errors */
-				queue->exp_len = 0.0;
+				*len = 0.0;
 			}
 		}
 
-		STARPU_ASSERT_MSG(queue->exp_len>=0, "prio->exp_len=%lf\n",queue->exp_len);
+		STARPU_ASSERT_MSG(*len>=0, "prio->exp_len=%lf\n",*len);
 		if(!isnan(task->predicted_transfer))
 		{
-			if (queue->exp_len > task->predicted_transfer)
+			if (*len > task->predicted_transfer)
 			{
 				queue->exp_start += task->predicted_transfer;
-				queue->exp_len -= task->predicted_transfer;
+				*len -= task->predicted_transfer;
 			}
 			else
 			{
-				queue->exp_start += queue->exp_len;
-				queue->exp_len = 0;
+				queue->exp_start += *len;
+				*len = 0;
 			}
 		}
 
-		queue->exp_end = queue->exp_start + queue->exp_len;
 		if(queue->ntasks == 0)
 			queue->exp_len = 0.0;
+		if(data->ndeadline_tasks == 0)
+			data->deadline_exp_len = 0.0;
+		queue->exp_end = queue->exp_start + queue->exp_len + data->deadline_exp_len;
 	}
 	if(task)
-		STARPU_TRACE_SCHED_COMPONENT_POP_PRIO(component, queue->ntasks, queue->exp_len);
+		STARPU_TRACE_SCHED_COMPONENT_POP_PRIO(component, prio_ntasks(data), queue->exp_len);
 	STARPU_ASSERT(!isnan(queue->exp_end));
 	STARPU_ASSERT(!isnan(queue->exp_len));
 	STARPU_ASSERT(!isnan(queue->exp_start));
@@ -298,6 +413,9 @@ struct starpu_sched_component * starpu_sched_component_prio_create(struct starpu
 	struct _starpu_prio_data *data;
 	_STARPU_MALLOC(data, sizeof(*data));
 	starpu_st_prio_deque_init(&data->prio);
+	starpu_task_list_init(&data->deadline_tasks);
+	data->ndeadline_tasks = 0;
+	data->deadline_exp_len = 0.0;
 	STARPU_PTHREAD_MUTEX_INIT(&data->mutex,NULL);
 	component->data = data;
 	component->estimated_end = prio_estimated_end;
@@ -313,6 +431,7 @@ struct starpu_sched_component * starpu_sched_component_prio_create(struct starpu
 		data->exp_len_threshold=params->exp_len_threshold;
 		data->ready=params->ready;
 		data->exp=params->exp;
+		data->deadline=params->deadline;
 	}
 	else
 	{
@@ -320,6 +439,7 @@ struct starpu_sched_component * starpu_sched_component_prio_create(struct starpu
 		data->exp_len_threshold=0.0;
 		data->ready=0;
 		data->exp=0;
+		data->deadline=0;
 	}
 
 	return component;
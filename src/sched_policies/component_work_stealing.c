@@ -43,21 +43,61 @@ struct _starpu_component_work_stealing_data
  */
 	struct _starpu_component_work_stealing_data_per_worker *per_worker;
 	unsigned performed_total, last_push_child;
+	/* Push tasks to the child which has most of their data */
+	int data_locality;
 
 	starpu_pthread_mutex_t ** mutexes;
 	unsigned size;
 };
 
 
+static int is_worker_of_component(struct starpu_sched_component * component, int workerid)
+{
+	return starpu_bitmap_get(&component->workers, workerid);
+}
+
+/**
+ * steal a task from the queues of a work stealing component, and from the
+ * work stealing components below it
+ * return NULL if none available
+ */
+static struct starpu_task * steal_task_from_subtree(struct starpu_sched_component *component, int workerid)
+{
+	struct _starpu_component_work_stealing_data *wsd = component->data;
+	struct starpu_task * task = NULL;
+	unsigned i;
+
+	if (!starpu_sched_component_is_work_stealing(component))
+		return NULL;
+
+	for (i = 0; i < component->nchildren && !task; i++)
+	{
+		struct starpu_st_prio_deque * fifo = &wsd->per_worker[i].fifo;
+
+		STARPU_COMPONENT_MUTEX_LOCK(wsd->mutexes[i]);
+		task = starpu_st_prio_deque_deque_task_for_worker(fifo, workerid, NULL);
+		if(task && !isnan(task->predicted))
+		{
+			fifo->exp_len -= task->predicted;
+			fifo->nprocessed--;
+		}
+		STARPU_COMPONENT_MUTEX_UNLOCK(wsd->mutexes[i]);
+
+		if (!task)
+			task = steal_task_from_subtree(component->children[i], workerid);
+	}
+	return task;
+}
+
 /**
  * steal a task in a round robin way
  * return NULL if none available
  */
-static struct starpu_task *  steal_task_round_robin(struct starpu_sched_component *component, int workerid)
+static struct starpu_task *  steal_task_round_robin(struct starpu_sched_component *component, unsigned child, int workerid)
 {
 	struct _starpu_component_work_stealing_data *wsd = component->data;
-	unsigned i = wsd->per_worker[workerid].last_pop_child;
-	wsd->per_worker[workerid].last_pop_child = (i + 1) % component->nchildren;
+	unsigned i = wsd->per_worker[child].last_pop_child;
+	wsd->per_worker[child].last_pop_child = (i + 1) % component->nchildren;
 	/* If the worker's queue have no suitable tasks, let's try
 	 * the next ones */
 	struct starpu_task * task = NULL;
@@ -73,13 +113,17 @@ static struct starpu_task *  steal_task_round_robin(struct starpu_sched_componen
 			fifo->nprocessed--;
 		}
 		STARPU_COMPONENT_MUTEX_UNLOCK(wsd->mutexes[i]);
+		if(!task && !is_worker_of_component(component->children[i], workerid))
+			/* Also steal from the queues of the components below,
+			 * when the tree is hierarchical */
+			task = steal_task_from_subtree(component->children[i], workerid);
 		if(task)
 		{
 			starpu_sched_task_break(task);
 			break;
 		}
 
-		if (i == wsd->per_worker[workerid].last_pop_child)
+		if (i == wsd->per_worker[child].last_pop_child)
 		{
 			/* We got back to the first worker,
 			 * don't go in infinite loop */
@@ -109,9 +153,9 @@ static unsigned select_worker_round_robin(struct starpu_sched_component * compon
  * This is a phony function used to call the right
  * function depending on the value of USE_OVERLOAD.
  */
-static inline struct starpu_task * steal_task(struct starpu_sched_component * component, int workerid)
+static inline struct starpu_task * steal_task(struct starpu_sched_component * component, unsigned child, int workerid)
 {
-	return steal_task_round_robin(component, workerid);
+	return steal_task_round_robin(component, child, workerid);
 }
 
 /**
@@ -125,13 +169,6 @@ static inline unsigned select_worker(struct starpu_sched_component * component)
 }
 
 
-static int is_worker_of_component(struct starpu_sched_component * component, int workerid)
-{
-	return starpu_bitmap_get(&component->workers, workerid);
-}
-
-
-
 static struct starpu_task * pull_task(struct starpu_sched_component * component, struct starpu_sched_component * to STARPU_ATTRIBUTE_UNUSED)
 {
 	unsigned workerid = starpu_worker_get_id_check();
@@ -163,7 +200,7 @@ static struct starpu_task * pull_task(struct starpu_sched_component * component,
 		return task;
 	}
 
-	task  = steal_task(component, workerid);
+	task  = steal_task(component, i, workerid);
 	if(task)
 	{
 		STARPU_COMPONENT_MUTEX_LOCK(wsd->mutexes[i]);
@@ -240,32 +277,59 @@ static int push_task(struct starpu_sched_component * component, struct starpu_ta
 	struct _starpu_component_work_stealing_data * wsd = component->data;
 	int ret;
 	unsigned i = wsd->last_push_child;
-	int found = 0;
-
-	/* Find a child component that can execute this task */
-	i = (i+1)%component->nchildren;
-	while(1)
+	unsigned n;
+	int best = -1;
+	unsigned best_impl = 0;
+	size_t non_ready_best = SIZE_MAX;
+
+	/* Find a child component that can execute this task, in a round robin
+	 * way, or the one which has most of its data if requested */
+	for (n = 0; n < component->nchildren && non_ready_best; n++)
 	{
 		int workerid;
+		int last_node = -1;
+		i = (i+1)%component->nchildren;
+		/* The workers of a child may be on different memory nodes,
+		 * consider all those which can run the task */
 		for(workerid = starpu_bitmap_first(&component->children[i]->workers_in_ctx);
 		    -1 != workerid;
 		    workerid = starpu_bitmap_next(&component->children[i]->workers_in_ctx, workerid))
 		{
 			unsigned impl;
-			int can_execute = starpu_worker_can_execute_task_first_impl(workerid, task, &impl);
-			if (can_execute)
+			if (!starpu_worker_can_execute_task_first_impl(workerid, task, &impl))
+				continue;
+
+			if (!wsd->data_locality)
 			{
-				/* Found one, set the implementation by the way */
-				starpu_task_set_implementation(task, impl);
-				found = 1;
+				/* Found one, that is enough */
+				best = i;
+				best_impl = impl;
+				non_ready_best = 0;
 				break;
 			}
+
+			int node = starpu_worker_get_memory_node(workerid);
+			if (node == last_node)
+				/* Same data as the previous worker */
+				continue;
+			last_node = node;
+
+			size_t non_ready, non_loading, non_allocated;
+			starpu_st_non_ready_buffers_size(task, workerid, &non_ready, &non_loading, &non_allocated);
+			if (non_ready < non_ready_best)
+			{
+				non_ready_best = non_ready;
+				best = i;
+				best_impl = impl;
+				if (non_ready == 0)
+					break;
+			}
 		}
-		if (found)
-			break;
-		STARPU_ASSERT_MSG(i != wsd->last_push_child, "Could not find child able to execute this task");
-		i = (i+1)%component->nchildren;
 	}
+	STARPU_ASSERT_MSG(best != -1, "Could not find child able to execute this task");
+	i = best;
+	/* Set the implementation by the way */
+	starpu_task_set_implementation(task, best_impl);
 
 	STARPU_COMPONENT_MUTEX_LOCK(wsd->mutexes[i]);
 	starpu_sched_task_break(task);
@@ -389,10 +453,12 @@ int starpu_sched_component_is_work_stealing(struct starpu_sched_component * comp
 
 struct starpu_sched_component * starpu_sched_component_work_stealing_create(struct starpu_sched_tree *tree, void *arg)
 {
-	(void)arg;
+	struct starpu_sched_component_work_stealing_data *params = arg;
 	struct starpu_sched_component *component = starpu_sched_component_create(tree, "work_stealing");
 	struct _starpu_component_work_stealing_data *wsd;
 	_STARPU_CALLOC(wsd, 1, sizeof(*wsd));
+	if (params)
+		wsd->data_locality = params->data_locality;
 	component->pull_task = pull_task;
 	component->push_task = push_task;
 	component->add_child = _ws_add_child;
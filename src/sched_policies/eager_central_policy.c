@@ -33,6 +33,9 @@ struct _starpu_eager_center_policy_data
 	struct starpu_st_fifo_taskq fifo;
 	starpu_pthread_mutex_t policy_mutex;
 	struct starpu_bitmap waiters;
+	/* How many tasks to look at to find one with local data */
+	unsigned lookahead;
+	unsigned max_skips;
 };
 
 static void initialize_eager_center_policy(unsigned sched_ctx_id)
@@ -43,6 +46,8 @@ static void initialize_eager_center_policy(unsigned sched_ctx_id)
 	/* there is only a single queue in that trivial design */
 	starpu_st_fifo_taskq_init(&data->fifo);
 	starpu_bitmap_init(&data->waiters);
+	data->lookahead = starpu_getenv_number_default("STARPU_SCHED_LOCALITY_LOOKAHEAD", 0);
+	data->max_skips = starpu_getenv_number_default("STARPU_SCHED_LOCALITY_MAX_SKIPS", 4);
 
 	starpu_sched_ctx_set_policy_data(sched_ctx_id, (void*)data);
 	STARPU_PTHREAD_MUTEX_INIT(&data->policy_mutex, NULL);
@@ -159,7 +164,7 @@ static struct starpu_task *pop_task_eager_policy(unsigned sched_ctx_id)
 	STARPU_PTHREAD_MUTEX_LOCK(&data->policy_mutex);
 	starpu_worker_relax_off();
 
-	chosen_task = starpu_st_fifo_taskq_pop_task(&data->fifo, workerid);
+	chosen_task = starpu_st_fifo_taskq_pop_task_lookahead(&data->fifo, workerid, data->lookahead, data->max_skips);
 	if (!chosen_task)
 		/* Tell pushers that we are waiting for tasks for us */
 		starpu_bitmap_set(&data->waiters, workerid);
@@ -38,6 +38,9 @@ struct _starpu_eager_central_prio_data
 	struct starpu_st_prio_deque taskq;
 	starpu_pthread_mutex_t policy_mutex;
 	struct starpu_bitmap waiters;
+	/* How many tasks to look at to find one with local data */
+	unsigned lookahead;
+	unsigned max_skips;
 };
 
 /*
@@ -52,6 +55,8 @@ static void initialize_eager_center_priority_policy(unsigned sched_ctx_id)
 	/* only a single queue (even though there are several internally) */
 	starpu_st_prio_deque_init(&data->taskq);
 	starpu_bitmap_init(&data->waiters);
+	data->lookahead = starpu_getenv_number_default("STARPU_SCHED_LOCALITY_LOOKAHEAD", 0);
+	data->max_skips = starpu_getenv_number_default("STARPU_SCHED_LOCALITY_MAX_SKIPS", 4);
 
 	/* Tell helgrind that it's fine to check for empty fifo in
 	 * _starpu_priority_pop_task without actual mutex (it's just an
@@ -182,7 +187,7 @@ static struct starpu_task *_starpu_priority_pop_task(unsigned sched_ctx_id)
 	STARPU_PTHREAD_MUTEX_LOCK(&data->policy_mutex);
 	starpu_worker_relax_off();
 
-	chosen_task = starpu_st_prio_deque_pop_task_for_worker(taskq, workerid, &skipped);
+	chosen_task = starpu_st_prio_deque_pop_task_lookahead(taskq, workerid, data->lookahead, data->max_skips, &skipped);
 
 	if (!chosen_task && skipped)
 	{
@@ -0,0 +1,546 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ *	This is the eager and prio policies, but with the central queue split
+ *	into one shard per NUMA node, each with its own mutex, to avoid having
+ *	all workers of the machine contend on a single mutex and cache line.
+ *
+ *	Tasks are pushed to the shard of the NUMA node of the submitter, and
+ *	workers pop from the shard of their NUMA node first, then from the
+ *	other shards. To approximately preserve the global order, a worker
+ *	rather pops from another shard when its first task has a higher
+ *	priority, or has been waiting for a long time while nobody popped from
+ *	that shard.
+ */
+
+#include <starpu.h>
+#include <starpu_scheduler.h>
+#include <schedulers/starpu_scheduler_toolbox.h>
+
+#include <starpu_bitmap.h>
+#include <limits.h>
+
+#include <common/thread.h>
+#include <core/workers.h>
+#include <core/topology.h>
+#include <sched_policies/fifo_queues.h>
+#include <sched_policies/prio_deque.h>
+
+/* How long (in µs) the first task of a shard may be waiting more than the
+ * first task of the local shard before a worker rather pops it */
+#define EAGER_NUMA_MAX_DELAY 1000.
+
+struct _starpu_eager_numa_shard
+{
+	/* Avoid false sharing between shards */
+	char padding[STARPU_CACHELINE_SIZE];
+	starpu_pthread_mutex_t mutex;
+	/* For eager_numa */
+	struct starpu_st_fifo_taskq fifo;
+	/* For prio_numa */
+	struct starpu_st_prio_deque taskq;
+	/* Priority of the first task of the shard, for prio_numa */
+	int head_prio;
+	/* Date since when the first task of the shard has at least been
+	 * waiting, i.e. the last time it changed */
+	double since;
+};
+
+struct _starpu_eager_numa_data
+{
+	struct _starpu_eager_numa_shard shards[STARPU_MAXNUMANODES];
+	unsigned nshards;
+	unsigned prio;
+	/* Shard of each worker, -1 when not known yet */
+	int worker_shard[STARPU_NMAXWORKERS];
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+	starpu_pthread_mutex_t waiters_mutex;
+	struct starpu_bitmap waiters;
+	/* Number of workers set in waiters, for pushers to avoid taking
+	 * waiters_mutex when nobody waits */
+	unsigned nwaiters;
+#endif
+};
+
+static void initialize_eager_numa_policy_common(unsigned sched_ctx_id, unsigned prio)
+{
+	struct _starpu_eager_numa_data *data;
+	unsigned i;
+
+	_STARPU_MALLOC(data, sizeof(struct _starpu_eager_numa_data));
+
+	data->prio = prio;
+	data->nshards = starpu_memory_nodes_get_numa_count();
+	if (data->nshards < 1)
+		data->nshards = 1;
+	STARPU_ASSERT(data->nshards <= STARPU_MAXNUMANODES);
+
+	for (i = 0; i < data->nshards; i++)
+	{
+		struct _starpu_eager_numa_shard *shard = &data->shards[i];
+
+		STARPU_PTHREAD_MUTEX_INIT(&shard->mutex, NULL);
+		if (prio)
+			starpu_st_prio_deque_init(&shard->taskq);
+		else
+			starpu_st_fifo_taskq_init(&shard->fifo);
+		shard->head_prio = INT_MIN;
+		shard->since = 0.;
+
+		/* Tell helgrind that it's fine to check for empty shards
+		 * without actual mutex (it's just integers) */
+		STARPU_HG_DISABLE_CHECKING(shard->fifo.ntasks);
+		STARPU_HG_DISABLE_CHECKING(shard->taskq.ntasks);
+		STARPU_HG_DISABLE_CHECKING(shard->head_prio);
+		STARPU_HG_DISABLE_CHECKING(shard->since);
+	}
+
+	for (i = 0; i < STARPU_NMAXWORKERS; i++)
+		data->worker_shard[i] = -1;
+
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+	STARPU_PTHREAD_MUTEX_INIT(&data->waiters_mutex, NULL);
+	starpu_bitmap_init(&data->waiters);
+	data->nwaiters = 0;
+	STARPU_HG_DISABLE_CHECKING(data->nwaiters);
+#endif
+
+	starpu_sched_ctx_set_policy_data(sched_ctx_id, (void*)data);
+
+	if (prio)
+	{
+		/* The application may use any integer */
+		if (starpu_sched_ctx_min_priority_is_set(sched_ctx_id) == 0)
+			starpu_sched_ctx_set_min_priority(sched_ctx_id, INT_MIN);
+		if (starpu_sched_ctx_max_priority_is_set(sched_ctx_id) == 0)
+			starpu_sched_ctx_set_max_priority(sched_ctx_id, INT_MAX);
+	}
+}
+
+static void initialize_eager_numa_policy(unsigned sched_ctx_id)
+{
+	initialize_eager_numa_policy_common(sched_ctx_id, 0);
+}
+
+static void initialize_prio_numa_policy(unsigned sched_ctx_id)
+{
+	initialize_eager_numa_policy_common(sched_ctx_id, 1);
+}
+
+static void deinitialize_eager_numa_policy(unsigned sched_ctx_id)
+{
+	struct _starpu_eager_numa_data *data = (struct _starpu_eager_numa_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned i;
+
+	for (i = 0; i < data->nshards; i++)
+	{
+		struct _starpu_eager_numa_shard *shard = &data->shards[i];
+
+		if (data->prio)
+		{
+			STARPU_ASSERT(starpu_st_prio_deque_is_empty(&shard->taskq));
+			starpu_st_prio_deque_destroy(&shard->taskq);
+		}
+		else
+			STARPU_ASSERT(starpu_task_list_empty(&shard->fifo.taskq));
+		STARPU_PTHREAD_MUTEX_DESTROY(&shard->mutex);
+	}
+
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+	STARPU_PTHREAD_MUTEX_DESTROY(&data->waiters_mutex);
+#endif
+	free(data);
+}
+
+static inline unsigned shard_ntasks(struct _starpu_eager_numa_data *data, struct _starpu_eager_numa_shard *shard)
+{
+	return data->prio ? shard->taskq.ntasks : shard->fifo.ntasks;
+}
+
+/* Return the shard of the NUMA node of the calling thread */
+static unsigned current_shard(struct _starpu_eager_numa_data *data)
+{
+	int workerid = starpu_worker_get_id();
+	int node;
+
+	if (data->nshards == 1)
+		return 0;
+
+	if (workerid >= 0)
+	{
+		node = data->worker_shard[workerid];
+		if (node >= 0)
+			return node;
+	}
+
+	node = _starpu_get_current_numa_memory_node();
+	if (node < 0 || (unsigned) node >= data->nshards)
+		node = 0;
+
+	if (workerid >= 0)
+		data->worker_shard[workerid] = node;
+	return node;
+}
+
+/* Update the information about the first task of the shard, called with the
+ * shard mutex held after it was modified */
+static void shard_update_head(struct _starpu_eager_numa_data *data, struct _starpu_eager_numa_shard *shard)
+{
+	if (!shard_ntasks(data, shard))
+		return;
+
+	shard->since = starpu_timing_now();
+	if (data->prio)
+		shard->head_prio = starpu_st_prio_deque_highest_task(&shard->taskq)->priority;
+}
+
+static int push_task_eager_numa_policy(struct starpu_task *task)
+{
+	unsigned sched_ctx_id = task->sched_ctx;
+	struct _starpu_eager_numa_data *data = (struct _starpu_eager_numa_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned shardid = current_shard(data);
+	struct _starpu_eager_numa_shard *shard = &data->shards[shardid];
+	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
+	struct starpu_sched_ctx_iterator it;
+	int local;
+#ifndef STARPU_NON_BLOCKING_DRIVERS
+	int dowake[STARPU_NMAXWORKERS];
+	unsigned ndowake = 0, i;
+#endif
+
+	starpu_worker_relax_on();
+	STARPU_PTHREAD_MUTEX_LOCK(&shard->mutex);
+	starpu_worker_relax_off();
+
+	if (data->prio)
+	{
+		starpu_st_prio_deque_push_back_task(&shard->taskq, task);
+		if (shard->taskq.ntasks == 1)
+			shard_update_head(data, shard);
+		else if (task->priority > shard->head_prio)
+			shard->head_prio = task->priority;
+	}
+	else
+	{
+		starpu_task_list_push_back(&shard->fifo.taskq, task);
+		shard->fifo.ntasks++;
+		shard->fifo.nprocessed++;
+		if (shard->fifo.ntasks == 1)
+			shard_update_head(data, shard);
+	}
+
+	if (_starpu_get_nsched_ctxs() > 1)
+	{
+		starpu_worker_relax_on();
+		_starpu_sched_ctx_lock_write(sched_ctx_id);
+		starpu_worker_relax_off();
+		starpu_sched_ctx_list_task_counters_increment_all_ctx_locked(task, sched_ctx_id);
+		_starpu_sched_ctx_unlock_write(sched_ctx_id);
+	}
+
+	starpu_push_task_end(task);
+
+	/* wake people waiting for a task, preferably on the same NUMA node */
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+	/* Make sure that a popper which is registering itself as waiter
+	 * either sees our task or gets seen by us */
+	STARPU_SYNCHRONIZE();
+	if (data->nwaiters)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&data->waiters_mutex);
+		for (local = 1; local >= 0; local--)
+		{
+			workers->init_iterator_for_parallel_tasks(workers, &it, task);
+			while(workers->has_next(workers, &it))
+			{
+				unsigned worker = workers->get_next(workers, &it);
+
+				if (!starpu_bitmap_get(&data->waiters, worker))
+					/* This worker is not waiting for a task */
+					continue;
+				if (local && data->worker_shard[worker] != (int) shardid)
+					continue;
+
+				if (starpu_worker_can_execute_task_first_impl(worker, task, NULL))
+				{
+					/* It can execute this one, tell him! */
+					starpu_bitmap_unset(&data->waiters, worker);
+					data->nwaiters--;
+					/* We really woke at least somebody, no need to wake somebody else */
+					goto woken;
+				}
+			}
+		}
+woken:
+		STARPU_PTHREAD_MUTEX_UNLOCK(&data->waiters_mutex);
+	}
+	/* Let the task free */
+	STARPU_PTHREAD_MUTEX_UNLOCK(&shard->mutex);
+#else
+	for (local = 1; local >= 0; local--)
+	{
+		workers->init_iterator_for_parallel_tasks(workers, &it, task);
+		while(workers->has_next(workers, &it))
+		{
+			unsigned worker = workers->get_next(workers, &it);
+
+			if ((data->worker_shard[worker] == (int) shardid) != local)
+				continue;
+			if (starpu_worker_can_execute_task_first_impl(worker, task, NULL))
+				/* It can execute this one, tell him! */
+				dowake[ndowake++] = worker;
+		}
+	}
+	/* Let the task free */
+	STARPU_PTHREAD_MUTEX_UNLOCK(&shard->mutex);
+
+	/* Now that we have a list of potential workers, try to wake one */
+	for (i = 0; i < ndowake; i++)
+		if (starpu_wake_worker_relax_light(dowake[i]))
+			break; // wake up a single worker
+#endif
+
+	return 0;
+}
+
+/* \p skipped could not be executed by \p workerid, notify another worker to
+ * do that task. Called with the shard mutex held. */
+static void notify_skipped(struct _starpu_eager_numa_data *data, unsigned sched_ctx_id, unsigned workerid, struct starpu_task *skipped)
+{
+	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
+	struct starpu_sched_ctx_iterator it;
+
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+	STARPU_PTHREAD_MUTEX_LOCK(&data->waiters_mutex);
+#else
+	(void) data;
+#endif
+	workers->init_iterator(workers, &it);
+	while(workers->has_next(workers, &it))
+	{
+		unsigned worker = workers->get_next(workers, &it);
+
+		if(worker != workerid && starpu_worker_can_execute_task_first_impl(worker, skipped, NULL))
+		{
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+			if (starpu_bitmap_get(&data->waiters, worker))
+			{
+				starpu_bitmap_unset(&data->waiters, worker);
+				data->nwaiters--;
+			}
+#else
+			starpu_wake_worker_relax_light(worker);
+#endif
+		}
+	}
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+	STARPU_PTHREAD_MUTEX_UNLOCK(&data->waiters_mutex);
+#endif
+}
+
+static struct starpu_task *pop_from_shard(struct _starpu_eager_numa_data *data, unsigned sched_ctx_id, unsigned workerid, struct _starpu_eager_numa_shard *shard)
+{
+	struct starpu_task *task;
+
+	starpu_worker_relax_on();
+	STARPU_PTHREAD_MUTEX_LOCK(&shard->mutex);
+	starpu_worker_relax_off();
+
+	if (data->prio)
+	{
+		struct starpu_task *skipped;
+
+		task = starpu_st_prio_deque_pop_task_for_worker(&shard->taskq, workerid, &skipped);
+		if (!task && skipped)
+			notify_skipped(data, sched_ctx_id, workerid, skipped);
+	}
+	else
+		task = starpu_st_fifo_taskq_pop_task(&shard->fifo, workerid);
+
+	if (task)
+		shard_update_head(data, shard);
+
+	STARPU_PTHREAD_MUTEX_UNLOCK(&shard->mutex);
+	return task;
+}
+
+/* Pop a task from the shards, the local one first, unless another one has a
+ * more urgent task */
+static struct starpu_task *pop_from_shards(struct _starpu_eager_numa_data *data, unsigned sched_ctx_id, unsigned workerid, unsigned local)
+{
+	struct starpu_task *task;
+	int best = -1;
+	unsigned i;
+
+	/* Here helgrind would shout that this is unprotected, we just look
+	 * at the integers to get a hint of where to pop from */
+	for (i = 0; i < data->nshards; i++)
+	{
+		unsigned s = (local + i) % data->nshards;
+		struct _starpu_eager_numa_shard *shard = &data->shards[s];
+
+		if (!shard_ntasks(data, shard))
+			continue;
+		if (best == -1)
+			best = s;
+		else if (data->prio && shard->head_prio != data->shards[best].head_prio)
+		{
+			if (shard->head_prio > data->shards[best].head_prio)
+				best = s;
+		}
+		else if (shard->since + EAGER_NUMA_MAX_DELAY < data->shards[best].since)
+			best = s;
+	}
+
+	if (best == -1)
+		return NULL;
+
+	task = pop_from_shard(data, sched_ctx_id, workerid, &data->shards[best]);
+	if (task)
+		return task;
+
+	/* We can not execute the tasks from there, try the other shards */
+	for (i = 0; i < data->nshards; i++)
+	{
+		unsigned s = (local + i) % data->nshards;
+		struct _starpu_eager_numa_shard *shard = &data->shards[s];
+
+		if ((int) s == best || !shard_ntasks(data, shard))
+			continue;
+		task = pop_from_shard(data, sched_ctx_id, workerid, shard);
+		if (task)
+			return task;
+	}
+
+	return NULL;
+}
+
+static struct starpu_task *pop_task_eager_numa_policy(unsigned sched_ctx_id)
+{
+	struct starpu_task *chosen_task;
+	unsigned workerid = starpu_worker_get_id_check();
+	struct _starpu_eager_numa_data *data = (struct _starpu_eager_numa_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned local = current_shard(data);
+
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+	if (!STARPU_RUNNING_ON_VALGRIND && starpu_bitmap_get(&data->waiters, workerid))
+		/* Nobody woke us, avoid bothering the mutexes */
+	{
+		return NULL;
+	}
+#endif
+
+	/* Here helgrind would shout that this is unprotected, these are just
+	 * integer accesses, and we hold the sched mutex, so we can not miss
+	 * any wake up. */
+	chosen_task = pop_from_shards(data, sched_ctx_id, workerid, local);
+
+#ifdef STARPU_NON_BLOCKING_DRIVERS
+	if (!chosen_task)
+	{
+		/* Tell pushers that we are waiting for tasks for us */
+		STARPU_PTHREAD_MUTEX_LOCK(&data->waiters_mutex);
+		if (!starpu_bitmap_get(&data->waiters, workerid))
+		{
+			starpu_bitmap_set(&data->waiters, workerid);
+			data->nwaiters++;
+		}
+		STARPU_PTHREAD_MUTEX_UNLOCK(&data->waiters_mutex);
+
+		/* And check again, in case a pusher did not see us yet */
+		STARPU_SYNCHRONIZE();
+		chosen_task = pop_from_shards(data, sched_ctx_id, workerid, local);
+		if (chosen_task)
+		{
+			STARPU_PTHREAD_MUTEX_LOCK(&data->waiters_mutex);
+			if (starpu_bitmap_get(&data->waiters, workerid))
+			{
+				starpu_bitmap_unset(&data->waiters, workerid);
+				data->nwaiters--;
+			}
+			STARPU_PTHREAD_MUTEX_UNLOCK(&data->waiters_mutex);
+		}
+	}
+#endif
+
+	if(chosen_task &&_starpu_get_nsched_ctxs() > 1)
+	{
+		starpu_worker_relax_on();
+		_starpu_sched_ctx_lock_write(sched_ctx_id);
+		starpu_worker_relax_off();
+		starpu_sched_ctx_list_task_counters_decrement_all_ctx_locked(chosen_task, sched_ctx_id);
+
+		if (_starpu_sched_ctx_worker_is_master_for_child_ctx(sched_ctx_id, workerid, chosen_task))
+			chosen_task = NULL;
+		_starpu_sched_ctx_unlock_write(sched_ctx_id);
+	}
+
+	return chosen_task;
+}
+
+static void eager_numa_add_workers(unsigned sched_ctx_id, int *workerids, unsigned nworkers)
+{
+	struct _starpu_eager_numa_data *data = (struct _starpu_eager_numa_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned i;
+
+	for (i = 0; i < nworkers; i++)
+	{
+		int workerid = workerids[i];
+		int curr_workerid = _starpu_worker_get_id();
+		int node = _starpu_get_close_numa_memory_node_worker(workerid);
+
+		if (node < 0 || (unsigned) node >= data->nshards)
+			node = 0;
+		data->worker_shard[workerid] = node;
+
+		if(workerid != curr_workerid)
+			starpu_wake_worker_locked(workerid);
+
+		starpu_sched_ctx_worker_shares_tasks_lists(workerid, sched_ctx_id);
+	}
+}
+
+struct starpu_sched_policy _starpu_sched_eager_numa_policy =
+{
+	.init_sched = initialize_eager_numa_policy,
+	.deinit_sched = deinitialize_eager_numa_policy,
+	.add_workers = eager_numa_add_workers,
+	.remove_workers = NULL,
+	.push_task = push_task_eager_numa_policy,
+	.pop_task = pop_task_eager_numa_policy,
+	.pre_exec_hook = NULL,
+	.post_exec_hook = NULL,
+	.policy_name = "eager_numa",
+	.policy_description = "eager policy with a central queue sharded per NUMA node",
+	.worker_type = STARPU_WORKER_LIST,
+};
+
+struct starpu_sched_policy _starpu_sched_prio_numa_policy =
+{
+	.init_sched = initialize_prio_numa_policy,
+	.deinit_sched = deinitialize_eager_numa_policy,
+	.add_workers = eager_numa_add_workers,
+	.remove_workers = NULL,
+	/* we always use priorities in that policy */
+	.push_task = push_task_eager_numa_policy,
+	.pop_task = pop_task_eager_numa_policy,
+	.pre_exec_hook = NULL,
+	.post_exec_hook = NULL,
+	.policy_name = "prio_numa",
+	.policy_description = "eager (with priorities) with a central queue sharded per NUMA node",
+	.worker_type = STARPU_WORKER_LIST,
+};
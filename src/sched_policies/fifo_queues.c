@@ -357,6 +357,62 @@ struct starpu_task *starpu_st_fifo_taskq_pop_task(struct starpu_st_fifo_taskq *f
 	return NULL;
 }
 
+struct starpu_task *starpu_st_fifo_taskq_pop_task_lookahead(struct starpu_st_fifo_taskq *fifo_queue, int workerid, unsigned lookahead, unsigned max_skips)
+{
+	struct starpu_task *task, *best = NULL;
+	size_t non_ready_best = SIZE_MAX, non_loading_best = SIZE_MAX;
+	unsigned nimpl, nimpl_best = 0, n = 0;
+
+	if (lookahead <= 1 || workerid < 0)
+		return starpu_st_fifo_taskq_pop_task(fifo_queue, workerid);
+
+	for (task  = starpu_task_list_begin(&fifo_queue->taskq);
+	     task != starpu_task_list_end(&fifo_queue->taskq) && n < lookahead;
+	     task  = starpu_task_list_next(task))
+	{
+		size_t non_ready, non_loading, non_allocated;
+
+		if (!starpu_worker_can_execute_task_first_impl(workerid, task, &nimpl))
+			continue;
+		n++;
+
+		if (_starpu_get_job_associated_to_task(task)->nskipped >= max_skips)
+		{
+			/* It has waited long enough */
+			best = task;
+			nimpl_best = nimpl;
+			break;
+		}
+
+		starpu_st_non_ready_buffers_size(task, workerid, &non_ready, &non_loading, &non_allocated);
+		if (non_ready < non_ready_best || (non_ready == non_ready_best && non_loading < non_loading_best))
+		{
+			non_ready_best = non_ready;
+			non_loading_best = non_loading;
+			best = task;
+			nimpl_best = nimpl;
+			if (non_ready == 0)
+				break;
+		}
+	}
+
+	if (!best)
+		return NULL;
+
+	/* Age the tasks that we passed over, but not those which this worker
+	 * could not run anyway */
+	for (task  = starpu_task_list_begin(&fifo_queue->taskq);
+	     task != best;
+	     task  = starpu_task_list_next(task))
+		if (starpu_worker_can_execute_task_first_impl(workerid, task, NULL))
+			_starpu_get_job_associated_to_task(task)->nskipped++;
+
+	starpu_task_set_implementation(best, nimpl_best);
+	starpu_task_list_erase(&fifo_queue->taskq, best);
+	fifo_queue->ntasks--;
+	return best;
+}
+
 struct starpu_task *starpu_st_fifo_taskq_pop_local_task(struct starpu_st_fifo_taskq *fifo_queue)
 {
 	struct starpu_task *task = NULL;
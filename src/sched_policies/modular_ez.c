@@ -240,13 +240,19 @@ void starpu_sched_component_initialize_simple_schedulers(unsigned sched_ctx_id,
 		else
 			pre_decision_component = decision_component;
 
+		int deadline = (flags & STARPU_SCHED_SIMPLE_DEADLINE) ? 1 : 0;
+
 		/* First, a fifo if requested */
 		if (flags & STARPU_SCHED_SIMPLE_FIFO_ABOVE)
 		{
 			struct starpu_sched_component *fifo_above;
 			if (above_prio)
 			{
-				fifo_above = starpu_sched_component_prio_create(t, NULL);
+				struct starpu_sched_component_prio_data prio_above_data =
+				{
+					.deadline = deadline,
+				};
+				fifo_above = starpu_sched_component_prio_create(t, &prio_above_data);
 			}
 			else
 			{
@@ -300,6 +306,8 @@ void starpu_sched_component_initialize_simple_schedulers(unsigned sched_ctx_id,
 		unsigned ntasks_threshold;
 		if (starpu_sched_component_is_heft(decision_component) ||
 		    starpu_sched_component_is_mct(decision_component) ||
+		    starpu_sched_component_is_heft_insert(decision_component) ||
+		    starpu_sched_component_is_edf(decision_component) ||
 		    starpu_sched_component_is_heteroprio(decision_component))
 		{
 			/* These need more queueing to allow CPUs to take some share of the work */
@@ -326,6 +334,7 @@ void starpu_sched_component_initialize_simple_schedulers(unsigned sched_ctx_id,
 			.exp_len_threshold = exp_len_threshold,
 			.ready = ready,
 			.exp = exp,
+			.deadline = deadline,
 		};
 
 		struct starpu_sched_component_fifo_data fifo_data =
@@ -337,6 +346,13 @@ void starpu_sched_component_initialize_simple_schedulers(unsigned sched_ctx_id,
 			.ready_first = ready_first,
 		};
 
+		/* Queues below may rather take the memory of the nodes into account */
+		struct starpu_sched_component_mem_pressure_data mem_pressure_data =
+		{
+			.threshold = starpu_getenv_number_default("STARPU_SCHED_MEM_PRESSURE", 0),
+			.window = starpu_getenv_number_default("STARPU_SCHED_MEM_PRESSURE_WINDOW", 0),
+		};
+
 		/* Create one fifo+eager component pair per choice, below scheduling decision */
 		for(i = 0; i < nbelow; i++)
 		{
@@ -347,6 +363,14 @@ void starpu_sched_component_initialize_simple_schedulers(unsigned sched_ctx_id,
 					&& i >= starpu_worker_get_count()))
 			{
 				struct starpu_sched_component *fifo_below;
+				if (mem_pressure_data.threshold)
+				{
+					/* Only let into the queue below the
+					 * tasks which fit in memory */
+					struct starpu_sched_component *mem_pressure = starpu_sched_component_mem_pressure_create(t, &mem_pressure_data);
+					starpu_sched_component_connect(last, mem_pressure);
+					last = mem_pressure;
+				}
 				if (below_prio)
 				{
 					fifo_below = starpu_sched_component_prio_create(t, &prio_data);
@@ -0,0 +1,194 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/* Hierarchical work stealing: a work stealing component is put at the
+ * machine level, and below it for each package and each L3 cache which
+ * contain several CPU workers, following the hwloc topology. Tasks are
+ * pushed down towards the subtree which already has most of their data, the
+ * tasks released by a worker are queued next to it like with lws, and idle
+ * workers steal first from the workers sharing their L3 cache, then from
+ * their package, and only then from the rest of the machine.
+ */
+
+#include <starpu_sched_component.h>
+#include <starpu_scheduler.h>
+#include <schedulers/starpu_scheduler_toolbox.h>
+#include <core/workers.h>
+
+#include <hwloc.h>
+#ifndef HWLOC_API_VERSION
+#define HWLOC_OBJ_PU HWLOC_OBJ_PROC
+#endif
+
+struct ws_hierarchical_list
+{
+	struct starpu_sched_component **arr;
+	unsigned size;
+};
+
+static void list_add(struct ws_hierarchical_list *l, struct starpu_sched_component *component)
+{
+	_STARPU_REALLOC(l->arr, sizeof(*l->arr) * (l->size + 1));
+	l->arr[l->size++] = component;
+}
+
+/* Whether we want a level of work stealing at this object */
+static int is_ws_level(hwloc_obj_t obj)
+{
+	switch(obj->type)
+	{
+	case HWLOC_OBJ_MACHINE:
+	case HWLOC_OBJ_SOCKET:
+		return 1;
+#if HWLOC_API_VERSION >= 0x00020000
+	case HWLOC_OBJ_L3CACHE:
+		return 1;
+#else
+	case HWLOC_OBJ_CACHE:
+		return obj->attr->cache.depth == 3;
+#endif
+	default:
+		return 0;
+	}
+}
+
+static struct starpu_sched_component *ws_create(struct starpu_sched_tree *tree, hwloc_obj_t obj)
+{
+	struct starpu_sched_component_work_stealing_data ws_data =
+	{
+		.data_locality = 1,
+	};
+	struct starpu_sched_component *component = starpu_sched_component_work_stealing_create(tree, &ws_data);
+	component->obj = obj;
+	return component;
+}
+
+static struct starpu_sched_component *worker_leaf(struct starpu_sched_tree *tree, unsigned workerid)
+{
+	struct starpu_sched_component *worker_component = starpu_sched_component_worker_new(tree->sched_ctx_id, workerid);
+	struct starpu_sched_component *impl_component = starpu_sched_component_best_implementation_create(tree, NULL);
+	starpu_sched_component_connect(impl_component, worker_component);
+	return impl_component;
+}
+
+/* Return the components to be plugged above \p obj */
+static struct ws_hierarchical_list build_level(struct starpu_sched_tree *tree, hwloc_obj_t obj)
+{
+	struct ws_hierarchical_list l = { NULL, 0 };
+	unsigned i;
+
+	if (obj->type == HWLOC_OBJ_PU)
+	{
+		for (i = 0; i < starpu_worker_get_count(); i++)
+		{
+			struct _starpu_worker *worker = _starpu_get_worker_struct(i);
+			if (worker->arch == STARPU_CPU_WORKER && worker->hwloc_obj == obj)
+				list_add(&l, worker_leaf(tree, i));
+		}
+		return l;
+	}
+
+	for (i = 0; i < obj->arity; i++)
+	{
+		struct ws_hierarchical_list sub = build_level(tree, obj->children[i]);
+		unsigned j;
+		for (j = 0; j < sub.size; j++)
+			list_add(&l, sub.arr[j]);
+		free(sub.arr);
+	}
+
+	if (l.size > 1 && obj->type != HWLOC_OBJ_MACHINE && is_ws_level(obj))
+	{
+		/* Gather the workers below in a work stealing component */
+		struct starpu_sched_component *ws = ws_create(tree, obj);
+		for (i = 0; i < l.size; i++)
+			starpu_sched_component_connect(ws, l.arr[i]);
+		l.size = 0;
+		list_add(&l, ws);
+	}
+	return l;
+}
+
+static void initialize_ws_hierarchical_policy(unsigned sched_ctx_id)
+{
+	struct _starpu_machine_config *config = _starpu_get_machine_config();
+	hwloc_topology_t topology = config->topology.hwtopology;
+	hwloc_obj_t root_obj = hwloc_get_root_obj(topology);
+	struct starpu_sched_tree *t;
+	struct ws_hierarchical_list l;
+	unsigned i;
+
+	t = starpu_sched_tree_create(sched_ctx_id);
+	starpu_sched_ctx_set_policy_data(sched_ctx_id, (void*)t);
+
+	/* The machine level always has a work stealing component, so that
+	 * the workers which are not below a CPU core have somewhere to go */
+	t->root = ws_create(t, root_obj);
+
+	l = build_level(t, root_obj);
+	for (i = 0; i < l.size; i++)
+		starpu_sched_component_connect(t->root, l.arr[i]);
+	free(l.arr);
+
+	/* Accelerators, CPU workers which are not bound, and combined workers
+	 * are plugged directly at the machine level */
+	for (i = 0; i < starpu_worker_get_count() + starpu_combined_worker_get_count(); i++)
+	{
+		if (i < starpu_worker_get_count())
+		{
+			struct _starpu_worker *worker = _starpu_get_worker_struct(i);
+			if (worker->arch == STARPU_CPU_WORKER && worker->hwloc_obj)
+				continue;
+		}
+		starpu_sched_component_connect(t->root, worker_leaf(t, i));
+	}
+
+	starpu_sched_tree_update_workers(t);
+	starpu_sched_tree_update_workers_in_ctx(t);
+}
+
+static int ws_hierarchical_push_task(struct starpu_task *task)
+{
+	int workerid = starpu_worker_get_id();
+
+	if (workerid != -1)
+	{
+		size_t non_ready, non_loading, non_allocated;
+		starpu_st_non_ready_buffers_size(task, workerid, &non_ready, &non_loading, &non_allocated);
+		if (non_ready)
+			/* The releasing worker does not have all the data,
+			 * let the tree look for the place which has it */
+			return starpu_sched_tree_push_task(task);
+	}
+
+	/* Keep the task next to the worker which released it */
+	return starpu_sched_tree_work_stealing_push_task(task);
+}
+
+struct starpu_sched_policy _starpu_sched_modular_ws_hierarchical_policy =
+{
+	.init_sched = initialize_ws_hierarchical_policy,
+	.deinit_sched = starpu_sched_tree_deinitialize,
+	.add_workers = starpu_sched_tree_add_workers,
+	.remove_workers = starpu_sched_tree_remove_workers,
+	.push_task = ws_hierarchical_push_task,
+	.pop_task = starpu_sched_tree_pop_task,
+	.pre_exec_hook = NULL,
+	.post_exec_hook = NULL,
+	.policy_name = "modular-ws-hierarchical",
+	.policy_description = "hierarchical work stealing modular policy following the machine topology",
+	.worker_type = STARPU_WORKER_LIST,
+};
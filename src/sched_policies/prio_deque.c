@@ -160,6 +160,76 @@ struct starpu_task *starpu_st_prio_deque_deque_task_for_worker(struct starpu_st_
 	REMOVE_TASK(pdeque, list_back_highest, list_prev_highest, pred_can_execute, &workerid);
 }
 
+struct starpu_task *starpu_st_prio_deque_pop_task_lookahead(struct starpu_st_prio_deque * pdeque, int workerid, unsigned lookahead, unsigned max_skips, struct starpu_task * *skipped)
+{
+	struct starpu_task *task, *best = NULL;
+	size_t non_ready_best = SIZE_MAX, non_loading_best = SIZE_MAX;
+	unsigned nimpl, nimpl_best = 0, n = 0;
+
+	STARPU_ASSERT(pdeque);
+	STARPU_ASSERT(workerid >= 0 && (unsigned) workerid < starpu_worker_get_count());
+
+	if (lookahead <= 1)
+		return starpu_st_prio_deque_pop_task_for_worker(pdeque, workerid, skipped);
+
+	if (skipped)
+		*skipped = NULL;
+
+	for (task  = starpu_task_prio_list_begin(&pdeque->list);
+	     task != starpu_task_prio_list_end(&pdeque->list) && n < lookahead;
+	     task  = starpu_task_prio_list_next(&pdeque->list, task))
+	{
+		size_t non_ready, non_loading, non_allocated;
+
+		if (best && task->priority < best->priority)
+			/* Do not let data locality override priorities */
+			break;
+
+		if (!starpu_worker_can_execute_task_first_impl(workerid, task, &nimpl))
+		{
+			if (skipped)
+				*skipped = task;
+			continue;
+		}
+		n++;
+
+		if (_starpu_get_job_associated_to_task(task)->nskipped >= max_skips)
+		{
+			/* It has waited long enough */
+			best = task;
+			nimpl_best = nimpl;
+			break;
+		}
+
+		starpu_st_non_ready_buffers_size(task, workerid, &non_ready, &non_loading, &non_allocated);
+		if (non_ready < non_ready_best || (non_ready == non_ready_best && non_loading < non_loading_best))
+		{
+			non_ready_best = non_ready;
+			non_loading_best = non_loading;
+			best = task;
+			nimpl_best = nimpl;
+			if (non_ready == 0)
+				break;
+		}
+	}
+
+	if (!best)
+		return NULL;
+
+	/* Age the tasks that we passed over, but not those which this worker
+	 * could not run anyway */
+	for (task  = starpu_task_prio_list_begin(&pdeque->list);
+	     task != best;
+	     task  = starpu_task_prio_list_next(&pdeque->list, task))
+		if (starpu_worker_can_execute_task_first_impl(workerid, task, NULL))
+			_starpu_get_job_associated_to_task(task)->nskipped++;
+
+	starpu_task_set_implementation(best, nimpl_best);
+	starpu_task_prio_list_erase(&pdeque->list, best);
+	pdeque->ntasks--;
+	return best;
+}
+
 struct starpu_task *starpu_st_prio_deque_deque_first_ready_task(struct starpu_st_prio_deque * pdeque, unsigned workerid)
 {
 	struct starpu_task *task = NULL, *current;
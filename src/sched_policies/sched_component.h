@@ -34,6 +34,9 @@ struct _starpu_worker * _starpu_sched_component_worker_get_worker(struct starpu_
 
 struct starpu_bitmap * _starpu_get_worker_mask(unsigned sched_ctx_id);
 
+/** Expected termination of the tasks with a deadline queued in a prio component */
+double _starpu_sched_component_prio_deadline_estimated_end(struct starpu_sched_component *component);
+
 #pragma GCC visibility pop
 
 #endif
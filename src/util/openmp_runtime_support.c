@@ -522,7 +522,7 @@ void starpu_omp_handle_unregister(starpu_data_handle_t handle)
 	unsigned node;
 	for (node = 0; node < STARPU_MAXNODES; node++)
 	{
-		struct _starpu_data_replicate *local = &handle->per_node[node];
+		const struct _starpu_data_replicate *local = _starpu_data_peek_replicate(handle, node);
 		STARPU_ASSERT(!local->refcnt);
 		if (local->allocated)
 		{
@@ -534,6 +534,10 @@ int _starpu_task_insert_create(struct starpu_codelet *cl, struct starpu_task *ta
 		{
 			task->sched_data = va_arg(varg_list, void *);
 		}
+		else if (arg_type==STARPU_TASK_DEADLINE)
+		{
+			task->deadline = va_arg(varg_list, double);
+		}
 		else if (arg_type==STARPU_TASK_FILE)
 		{
 			task->file = va_arg(varg_list, const char *);
@@ -918,6 +922,11 @@ int _fstarpu_task_insert_create(struct starpu_codelet *cl, struct starpu_task *t
 			arg_i++;
 			task->sched_data = (void*)arglist[arg_i];
 		}
+		else if (arg_type == STARPU_TASK_DEADLINE)
+		{
+			arg_i++;
+			task->deadline = *(double *)arglist[arg_i];
+		}
 		else if (arg_type == STARPU_TASK_FILE)
 		{
 			arg_i++;
@@ -23,6 +23,10 @@
 #include <starpu.h>
 #include <common/config.h>
 
+#ifdef __SSE3__
+#include <pmmintrin.h>
+#endif
+
 #include "starpufft.h"
 #ifdef STARPU_USE_CUDA
 #define _externC extern
@@ -91,22 +95,23 @@ struct STARPUFFT(plan)
 	STARPUFFT(complex) *roots[2];
 	starpu_data_handle_t roots_handle[2];
 
+#ifdef STARPU_USE_CUDA
 	/* For each worker, we need some data */
 	struct
 	{
-#ifdef STARPU_USE_CUDA
 		/* CUFFT plans */
 		cufftHandle plan1_cuda, plan2_cuda;
 		/* Sequential version */
 		cufftHandle plan_cuda;
+	} plans[STARPU_NMAXWORKERS];
 #endif
+
 #ifdef STARPU_HAVE_FFTW
-		/* FFTW plans */
-		_fftw_plan plan1_cpu, plan2_cpu;
-		/* Sequential version */
-		_fftw_plan plan_cpu;
+	/* FFTW plans, shared by all CPU workers, see the plan cache below */
+	_fftw_plan plan1_cpu, plan2_cpu;
+	/* Sequential version */
+	_fftw_plan plan_cpu;
 #endif
-	} plans[STARPU_NMAXWORKERS];
 
 	/* Buffers for codelets */
 	STARPUFFT(complex) *in, *twisted1, *fft1, *twisted2, *fft2, *out;
@@ -141,22 +146,162 @@ check_dims(STARPUFFT(plan) plan)
 		}
 }
 
+#ifdef STARPU_HAVE_FFTW
+/*
+ * Cache of FFTW plans, shared by all the starpufft plans of the current
+ * precision.  FFTW plans are created for unaligned out-of-place buffers and
+ * only used through the new-array execute functions, which are thread-safe, so
+ * a single FFTW plan can be used by all CPU workers, for all the starpufft
+ * plans with the same sizes and direction.  FFTW planning is however not
+ * thread-safe, hence the mutex.  Up to PLAN_CACHE_UNUSED unused plans are kept
+ * around, so that applications which repeatedly create and destroy starpufft
+ * plans of the same size do not plan again.
+ */
+#define PLAN_CACHE_UNUSED 8
+
+struct STARPUFFT(plan_cache_entry)
+{
+	struct STARPUFFT(plan_cache_entry) *next;
+	int rank;
+	int n[3];
+	int howmany;
+	int sign;
+	unsigned refcount;
+	_fftw_plan plan;
+};
+
+/* Most recently used first */
+static struct STARPUFFT(plan_cache_entry) *STARPUFFT(plan_cache);
+static unsigned STARPUFFT(plan_cache_nunused);
+static starpu_pthread_mutex_t STARPUFFT(plan_cache_mutex) = STARPU_PTHREAD_MUTEX_INITIALIZER;
+
+/* Get a plan for howmany contiguous ffts of size n[0] x ... x n[rank-1] */
+static _fftw_plan
+STARPUFFT(plan_cache_get)(int rank, const int *n, int howmany, int sign)
+{
+	struct STARPUFFT(plan_cache_entry) *entry, **prev;
+	_fftw_plan fftw_plan;
+	int dim, size = 1;
+
+	STARPU_ASSERT(rank <= 3);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&STARPUFFT(plan_cache_mutex));
+	for (prev = &STARPUFFT(plan_cache); (entry = *prev); prev = &entry->next)
+	{
+		if (entry->rank != rank || entry->howmany != howmany || entry->sign != sign)
+			continue;
+		for (dim = 0; dim < rank; dim++)
+			if (entry->n[dim] != n[dim])
+				break;
+		if (dim == rank)
+			break;
+	}
+
+	if (entry)
+	{
+		/* Move it to the front */
+		*prev = entry->next;
+		if (entry->refcount++ == 0)
+			STARPUFFT(plan_cache_nunused)--;
+	}
+	else
+	{
+		entry = malloc(sizeof(*entry));
+		entry->rank = rank;
+		for (dim = 0; dim < rank; dim++)
+		{
+			entry->n[dim] = n[dim];
+			size *= n[dim];
+		}
+		entry->howmany = howmany;
+		entry->sign = sign;
+		entry->refcount = 1;
+		/* FFTW imposes that buffer pointers are known at planning
+		 * time, make it plan for unaligned ones. */
+		entry->plan = _FFTW(plan_many_dft)(rank, n, howmany,
+				NULL, NULL, 1, size,
+				(void*) 1, NULL, 1, size,
+				sign, _FFTW_FLAGS);
+		STARPU_ASSERT(entry->plan);
+	}
+	entry->next = STARPUFFT(plan_cache);
+	STARPUFFT(plan_cache) = entry;
+	fftw_plan = entry->plan;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&STARPUFFT(plan_cache_mutex));
+
+	return fftw_plan;
+}
+
 static void
-compute_roots(STARPUFFT(plan) plan)
+STARPUFFT(plan_cache_release)(_fftw_plan fftw_plan)
 {
-	int dim, k;
+	struct STARPUFFT(plan_cache_entry) *entry, **prev, **victim = NULL;
 
-	/* Compute the n-roots and m-roots of unity for twiddling */
-	for (dim = 0; dim < plan->dim; dim++)
+	STARPU_PTHREAD_MUTEX_LOCK(&STARPUFFT(plan_cache_mutex));
+	for (entry = STARPUFFT(plan_cache); entry; entry = entry->next)
+		if (entry->plan == fftw_plan)
+			break;
+	STARPU_ASSERT(entry && entry->refcount > 0);
+
+	if (--entry->refcount == 0 && ++STARPUFFT(plan_cache_nunused) > PLAN_CACHE_UNUSED)
 	{
-		STARPUFFT(complex) exp = (plan->sign * 2. * 4.*atan(1.)) * _Complex_I / (STARPUFFT(complex)) plan->n[dim];
-		plan->roots[dim] = malloc(plan->n[dim] * sizeof(**plan->roots));
-		for (k = 0; k < plan->n[dim]; k++)
-			plan->roots[dim][k] = cexp(exp*k);
-		starpu_vector_data_register(&plan->roots_handle[dim], STARPU_MAIN_RAM, (uintptr_t) plan->roots[dim], plan->n[dim], sizeof(**plan->roots));
+		/* Too many unused plans, destroy the least recently used one */
+		for (prev = &STARPUFFT(plan_cache); *prev; prev = &(*prev)->next)
+			if ((*prev)->refcount == 0)
+				victim = prev;
+		entry = *victim;
+		*victim = entry->next;
+		STARPUFFT(plan_cache_nunused)--;
+		_FFTW(destroy_plan)(entry->plan);
+		free(entry);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&STARPUFFT(plan_cache_mutex));
+}
+#endif
+
+/* The n-roots of unity for twiddling are likewise shared between plans, they
+ * are only ever read by the tasks. */
+struct STARPUFFT(roots_cache_entry)
+{
+	struct STARPUFFT(roots_cache_entry) *next;
+	int n;
+	int sign;
+	unsigned refcount;
+	STARPUFFT(complex) *roots;
+	starpu_data_handle_t handle;
+};
+
+static struct STARPUFFT(roots_cache_entry) *STARPUFFT(roots_cache);
+static starpu_pthread_mutex_t STARPUFFT(roots_cache_mutex) = STARPU_PTHREAD_MUTEX_INITIALIZER;
+
+static void
+STARPUFFT(roots_cache_get)(int n, int sign, STARPUFFT(complex) **roots, starpu_data_handle_t *handle)
+{
+	struct STARPUFFT(roots_cache_entry) *entry;
+	int k;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&STARPUFFT(roots_cache_mutex));
+	for (entry = STARPUFFT(roots_cache); entry; entry = entry->next)
+		if (entry->n == n && entry->sign == sign)
+			break;
+
+	if (entry)
+		entry->refcount++;
+	else
+	{
+		STARPUFFT(complex) exp = (sign * 2. * 4.*atan(1.)) * _Complex_I / (STARPUFFT(complex)) n;
+
+		entry = malloc(sizeof(*entry));
+		entry->n = n;
+		entry->sign = sign;
+		entry->refcount = 1;
+		entry->roots = malloc(n * sizeof(*entry->roots));
+		for (k = 0; k < n; k++)
+			entry->roots[k] = cexp(exp*k);
+		starpu_vector_data_register(&entry->handle, STARPU_MAIN_RAM, (uintptr_t) entry->roots, n, sizeof(*entry->roots));
 
 #ifdef STARPU_USE_CUDA
-		if (plan->n[dim] > 100000)
+		if (n > 100000)
 		{
 			/* prefetch the big root array on GPUs */
 			unsigned worker;
@@ -165,10 +310,120 @@ compute_roots(STARPUFFT(plan) plan)
 			{
 				unsigned node = starpu_worker_get_memory_node(worker);
 				if (starpu_worker_get_type(worker) == STARPU_CUDA_WORKER)
-					starpu_data_prefetch_on_node(plan->roots_handle[dim], node, 0);
+					starpu_data_prefetch_on_node(entry->handle, node, 0);
 			}
 		}
 #endif
+
+		entry->next = STARPUFFT(roots_cache);
+		STARPUFFT(roots_cache) = entry;
+	}
+	*roots = entry->roots;
+	*handle = entry->handle;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&STARPUFFT(roots_cache_mutex));
+}
+
+static void
+STARPUFFT(roots_cache_release)(starpu_data_handle_t handle)
+{
+	struct STARPUFFT(roots_cache_entry) *entry, **prev;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&STARPUFFT(roots_cache_mutex));
+	for (prev = &STARPUFFT(roots_cache); (entry = *prev); prev = &entry->next)
+		if (entry->handle == handle)
+			break;
+	STARPU_ASSERT(entry && entry->refcount > 0);
+	if (--entry->refcount == 0)
+		*prev = entry->next;
+	else
+		entry = NULL;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&STARPUFFT(roots_cache_mutex));
+
+	if (entry)
+	{
+		/* This may have to wait for tasks of other plans */
+		starpu_data_unregister(entry->handle);
+		free(entry->roots);
+		free(entry);
+	}
+}
+
+static void
+compute_roots(STARPUFFT(plan) plan)
+{
+	int dim;
+
+	/* Get the n-roots and m-roots of unity for twiddling */
+	for (dim = 0; dim < plan->dim; dim++)
+		STARPUFFT(roots_cache_get)(plan->n[dim], plan->sign, &plan->roots[dim], &plan->roots_handle[dim]);
+}
+
+/*
+ * CPU helpers for the twist and twiddle steps
+ */
+
+/* Multiply v[j] by roots[j*stride] for j < n.  This is written with explicit
+ * real and imaginary parts, since the C99 complex product has to cope with
+ * infinities and NaNs, and would thus not get vectorized. */
+static void
+STARPUFFT(twiddle_cpu)(STARPUFFT(complex) * restrict v, const STARPUFFT(complex) * restrict roots, int stride, int n)
+{
+	real * restrict x = (real *) v;
+	const real * restrict r = (const real *) roots;
+	int j = 0;
+
+#if defined(__SSE3__) && defined(STARPUFFT_FLOAT)
+	/* Two complex numbers at a time */
+	for (; j + 2 <= n; j += 2)
+	{
+		__m128 vv = _mm_loadu_ps(&x[2*j]);
+		__m128 rr = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *) &r[2*j*stride]);
+		rr = _mm_loadh_pi(rr, (const __m64 *) &r[2*(j+1)*stride]);
+		__m128 re = _mm_moveldup_ps(rr);
+		__m128 im = _mm_movehdup_ps(rr);
+		__m128 swapped = _mm_shuffle_ps(vv, vv, _MM_SHUFFLE(2,3,0,1));
+		_mm_storeu_ps(&x[2*j], _mm_addsub_ps(_mm_mul_ps(vv, re), _mm_mul_ps(swapped, im)));
+	}
+#elif defined(__SSE3__) && defined(STARPUFFT_DOUBLE)
+	for (; j < n; j++)
+	{
+		__m128d vv = _mm_loadu_pd(&x[2*j]);
+		__m128d rr = _mm_loadu_pd(&r[2*j*stride]);
+		__m128d re = _mm_movedup_pd(rr);
+		__m128d im = _mm_unpackhi_pd(rr, rr);
+		__m128d swapped = _mm_shuffle_pd(vv, vv, 1);
+		_mm_storeu_pd(&x[2*j], _mm_addsub_pd(_mm_mul_pd(vv, re), _mm_mul_pd(swapped, im)));
+	}
+#endif
+	for (; j < n; j++)
+	{
+		real a = x[2*j], b = x[2*j+1];
+		real c = r[2*j*stride], d = r[2*j*stride+1];
+		x[2*j] = a*c - b*d;
+		x[2*j+1] = a*d + b*c;
+	}
+}
+
+/* Tile size for the transpositions, so that a source and a destination tile
+ * stay in the L1 cache */
+#define TRANSPOSE_BLOCK 16
+
+/* dst[c*dst_ld + r] = src[r*src_ld + c] for r < rows and c < cols */
+static void
+STARPUFFT(transpose_cpu)(STARPUFFT(complex) * restrict dst, int dst_ld, const STARPUFFT(complex) * restrict src, int src_ld, int rows, int cols)
+{
+	int r0, c0, r, c;
+
+	for (r0 = 0; r0 < rows; r0 += TRANSPOSE_BLOCK)
+	{
+		int rmax = r0 + TRANSPOSE_BLOCK < rows ? r0 + TRANSPOSE_BLOCK : rows;
+		for (c0 = 0; c0 < cols; c0 += TRANSPOSE_BLOCK)
+		{
+			int cmax = c0 + TRANSPOSE_BLOCK < cols ? c0 + TRANSPOSE_BLOCK : cols;
+			for (r = r0; r < rmax; r++)
+				for (c = c0; c < cmax; c++)
+					dst[c*dst_ld + r] = src[r*src_ld + c];
+		}
 	}
 }
 
@@ -319,36 +574,23 @@ STARPUFFT(execute_handle)(STARPUFFT(plan) plan, starpu_data_handle_t in, starpu_
 void
 STARPUFFT(destroy_plan)(STARPUFFT(plan) plan)
 {
-	unsigned workerid;
 	int dim, i;
 
-	for (workerid = 0; workerid < starpu_worker_get_count(); workerid++)
+#ifdef STARPU_HAVE_FFTW
+	if (starpu_cpu_worker_get_count() > 0)
 	{
-		switch (starpu_worker_get_type(workerid))
+		if (PARALLEL)
 		{
-		case STARPU_CPU_WORKER:
-#ifdef STARPU_HAVE_FFTW
-			if (PARALLEL)
-			{
-				_FFTW(destroy_plan)(plan->plans[workerid].plan1_cpu);
-				_FFTW(destroy_plan)(plan->plans[workerid].plan2_cpu);
-			}
-			else
-			{
-				_FFTW(destroy_plan)(plan->plans[workerid].plan_cpu);
-			}
-#endif
-			break;
-		case STARPU_CUDA_WORKER:
-#ifdef STARPU_USE_CUDA
-			/* FIXME: Can't deallocate */
-#endif
-			break;
-		default:
-			/* Do not care, we won't be executing anything there. */
-			break;
+			STARPUFFT(plan_cache_release)(plan->plan1_cpu);
+			STARPUFFT(plan_cache_release)(plan->plan2_cpu);
+		}
+		else
+		{
+			STARPUFFT(plan_cache_release)(plan->plan_cpu);
 		}
 	}
+#endif
+	/* FIXME: CUFFT plans can't be deallocated */
 
 	if (PARALLEL)
 	{
@@ -387,10 +629,7 @@ STARPUFFT(destroy_plan)(STARPUFFT(plan) plan)
 		free(plan->fft2_args);
 
 		for (dim = 0; dim < plan->dim; dim++)
-		{
-			starpu_data_unregister(plan->roots_handle[dim]);
-			free(plan->roots[dim]);
-		}
+			STARPUFFT(roots_cache_release)(plan->roots_handle[dim]);
 
 		switch (plan->dim)
 		{
@@ -202,7 +202,6 @@ STARPUFFT(fft1_1d_kernel_cpu)(void *descr[], void *_args)
 	struct STARPUFFT(args) *args = _args;
 	STARPUFFT(plan) plan = args->plan;
 	int i = args->i;
-	int j;
 	int n2 = plan->n2[0];
 	int workerid = starpu_worker_get_id_check();
 
@@ -213,11 +212,10 @@ STARPUFFT(fft1_1d_kernel_cpu)(void *descr[], void *_args)
 
 	/* printf("fft1 %d %g\n", i, (double) cabs(twisted1[0])); */
 
-	_FFTW(execute_dft)(plan->plans[workerid].plan1_cpu, twisted1, fft1);
+	_FFTW(execute_dft)(plan->plan1_cpu, twisted1, fft1);
 
-	/* twiddle fft1 buffer */
-	for (j = 0; j < n2; j++)
-		fft1[j] = fft1[j] * plan->roots[0][i*j];
+	/* twiddle fft1 buffer: fft1[j] *= roots[i*j] */
+	STARPUFFT(twiddle_cpu)(fft1, plan->roots[0], i, n2);
 }
 #endif
 
@@ -231,8 +229,6 @@ STARPUFFT(twist2_1d_kernel_cpu)(void *descr[], void *_args)
 	struct STARPUFFT(args) *args = _args;
 	STARPUFFT(plan) plan = args->plan;
 	int jj = args->jj;	/* between 0 and DIV_1D */
-	int jjj;		/* between 0 and n3 */
-	int i;
 	int n1 = plan->n1[0];
 	int n2 = plan->n2[0];
 	int n3 = n2/DIV_1D;
@@ -241,11 +237,8 @@ STARPUFFT(twist2_1d_kernel_cpu)(void *descr[], void *_args)
 
 	/* printf("twist2 %d %g\n", jj, (double) cabs(plan->fft1[jj])); */
 
-	for (jjj = 0; jjj < n3; jjj++) {
-		int j = jj * n3 + jjj;
-		for (i = 0; i < n1; i++)
-			twisted2[jjj*n1+i] = plan->fft1[i*n2+j];
-	}
+	/* twisted2[jjj*n1+i] = fft1[i*n2+jj*n3+jjj] */
+	STARPUFFT(transpose_cpu)(twisted2, n1, plan->fft1 + jj*n3, n2, n1, n3);
 }
 
 #ifdef STARPU_HAVE_FFTW
@@ -267,7 +260,7 @@ STARPUFFT(fft2_1d_kernel_cpu)(void *descr[], void *_args)
 
 	/* printf("fft2 %d %g\n", jj, (double) cabs(twisted2[plan->totsize4-1])); */
 
-	_FFTW(execute_dft)(plan->plans[workerid].plan2_cpu, twisted2, fft2);
+	_FFTW(execute_dft)(plan->plan2_cpu, twisted2, fft2);
 }
 #endif
 
@@ -280,8 +273,6 @@ STARPUFFT(twist3_1d_kernel_cpu)(void *descr[], void *_args)
 	struct STARPUFFT(args) *args = _args;
 	STARPUFFT(plan) plan = args->plan;
 	int jj = args->jj;	/* between 0 and DIV_1D */
-	int jjj;		/* between 0 and n3 */
-	int i;
 	int n1 = plan->n1[0];
 	int n2 = plan->n2[0];
 	int n3 = n2/DIV_1D;
@@ -290,11 +281,8 @@ STARPUFFT(twist3_1d_kernel_cpu)(void *descr[], void *_args)
 
 	/* printf("twist3 %d %g\n", jj, (double) cabs(fft2[0])); */
 
-	for (jjj = 0; jjj < n3; jjj++) {
-		int j = jj * n3 + jjj;
-		for (i = 0; i < n1; i++)
-			plan->out[i*n2+j] = fft2[jjj*n1+i];
-	}
+	/* out[i*n2+jj*n3+jjj] = fft2[jjj*n1+i] */
+	STARPUFFT(transpose_cpu)(plan->out + jj*n3, n2, fft2, n1, n3, n1);
 }
 
 /* Performance models for the 5 kinds of tasks */
@@ -463,7 +451,7 @@ STARPUFFT(fft_1d_kernel_cpu)(void *descr[], void *_args)
 	STARPUFFT(complex) * restrict in = (STARPUFFT(complex) *)STARPU_VECTOR_GET_PTR(descr[0]);
 	STARPUFFT(complex) * restrict out = (STARPUFFT(complex) *)STARPU_VECTOR_GET_PTR(descr[1]);
 
-	_FFTW(execute_dft)(plan->plans[workerid].plan_cpu, in, out);
+	_FFTW(execute_dft)(plan->plan_cpu, in, out);
 }
 #endif
 
@@ -574,33 +562,29 @@ if (PARALLEL) {
 	compute_roots(plan);
 }
 
-	/* Initialize per-worker working set */
-	for (workerid = 0; workerid < starpu_worker_get_count(); workerid++) {
-		switch (starpu_worker_get_type(workerid)) {
-		case STARPU_CPU_WORKER:
 #ifdef STARPU_HAVE_FFTW
+	/* Get FFTW plans from the cache */
+	if (starpu_cpu_worker_get_count() > 0) {
 if (PARALLEL) {
-			/* first fft plan: one fft of size n2.
-			 * FFTW imposes that buffer pointers are known at
-			 * planning time. */
-			plan->plans[workerid].plan1_cpu = _FFTW(plan_dft_1d)(n2, NULL, (void*) 1, sign, _FFTW_FLAGS);
-			STARPU_ASSERT(plan->plans[workerid].plan1_cpu);
-
-			/* second fft plan: n3 ffts of size n1 */
-			plan->plans[workerid].plan2_cpu = _FFTW(plan_many_dft)(plan->dim,
-					plan->n1, n3,
-					NULL, NULL, 1, plan->totsize1,
-					(void*) 1, NULL, 1, plan->totsize1,
-					sign, _FFTW_FLAGS);
-			STARPU_ASSERT(plan->plans[workerid].plan2_cpu);
+		/* first fft plan: one fft of size n2 */
+		plan->plan1_cpu = STARPUFFT(plan_cache_get)(1, &n2, 1, sign);
+
+		/* second fft plan: n3 ffts of size n1 */
+		plan->plan2_cpu = STARPUFFT(plan_cache_get)(plan->dim, plan->n1, n3, sign);
 } else {
-			/* fft plan: one fft of size n. */
-			plan->plans[workerid].plan_cpu = _FFTW(plan_dft_1d)(n, NULL, (void*) 1, sign, _FFTW_FLAGS);
-			STARPU_ASSERT(plan->plans[workerid].plan_cpu);
+		/* fft plan: one fft of size n. */
+		plan->plan_cpu = STARPUFFT(plan_cache_get)(1, &n, 1, sign);
 }
+	}
 #else
 /* #warning libstarpufft can not work correctly if libfftw3 is not installed */
 #endif
+
+	/* Initialize per-worker working set */
+	for (workerid = 0; workerid < starpu_worker_get_count(); workerid++) {
+		switch (starpu_worker_get_type(workerid)) {
+		case STARPU_CPU_WORKER:
+			/* The FFTW plans are shared by all CPU workers */
 			break;
 		case STARPU_CUDA_WORKER:
 			break;
@@ -178,7 +178,7 @@ STARPUFFT(fft1_2d_kernel_cpu)(void *descr[], void *_args)
 	STARPUFFT(plan) plan = args->plan;
 	int i = args->i;
 	int j = args->j;
-	int k, l;
+	int k;
 	int n2 = plan->n2[0];
 	int m2 = plan->n2[1];
 	int workerid = starpu_worker_get_id_check();
@@ -190,10 +190,12 @@ STARPUFFT(fft1_2d_kernel_cpu)(void *descr[], void *_args)
 
 	/* printf("fft1 %d %d %g\n", i, j, (double) cabs(twisted1[0])); */
 
-	_FFTW(execute_dft)(plan->plans[workerid].plan1_cpu, twisted1, fft1);
-	for (k = 0; k < n2; k++)
-		for (l = 0; l < m2; l++)
-			fft1[k*m2 + l] = fft1[k*m2 + l] * plan->roots[0][i*k] * plan->roots[1][j*l];
+	_FFTW(execute_dft)(plan->plan1_cpu, twisted1, fft1);
+	/* fft1[k*m2 + l] *= roots0[i*k] * roots1[j*l] */
+	for (k = 0; k < n2; k++) {
+		STARPUFFT(twiddle_cpu)(fft1 + k*m2, plan->roots[1], j, m2);
+		STARPUFFT(twiddle_cpu)(fft1 + k*m2, plan->roots[0] + i*k, 0, m2);
+	}
 }
 #endif
 
@@ -205,8 +207,8 @@ STARPUFFT(twist2_2d_kernel_cpu)(void *descr[], void *_args)
 	STARPUFFT(plan) plan = args->plan;
 	int kk = args->kk;	/* between 0 and DIV_2D_N */
 	int ll = args->ll;	/* between 0 and DIV_2D_M */
-	int kkk, lll;		/* between 0,0 and n3,m3 */
-	int i, j;
+	int kkk;		/* between 0 and n3 */
+	int i;
 	int n1 = plan->n1[0];
 	int n2 = plan->n2[0];
 	int m1 = plan->n1[1];
@@ -218,14 +220,14 @@ STARPUFFT(twist2_2d_kernel_cpu)(void *descr[], void *_args)
 
 	/* printf("twist2 %d %d %g\n", kk, ll, (double) cabs(plan->fft1[kk+ll])); */
 
+	/* twisted2[kkk*m3*n1*m1+lll*n1*m1+i*m1+j] = fft1[i*n1*n2*m2+j*n2*m2+k*m2+l],
+	 * i.e. for each kkk and i, a transposition between j and lll */
 	for (kkk = 0; kkk < n3; kkk++) {
 		int k = kk * n3 + kkk;
-		for (lll = 0; lll < m3; lll++) {
-			int l = ll * m3 + lll;
-			for (i = 0; i < n1; i++)
-				for (j = 0; j < m1; j++)
-					twisted2[kkk*m3*n1*m1+lll*n1*m1+i*m1+j] = plan->fft1[i*n1*n2*m2+j*n2*m2+k*m2+l];
-		}
+		for (i = 0; i < n1; i++)
+			STARPUFFT(transpose_cpu)(twisted2 + kkk*m3*n1*m1 + i*m1, n1*m1,
+						 plan->fft1 + i*n1*n2*m2 + k*m2 + ll*m3, n2*m2,
+						 m1, m3);
 	}
 }
 
@@ -247,7 +249,7 @@ STARPUFFT(fft2_2d_kernel_cpu)(void *descr[], void *_args)
 
 	/* printf("fft2 %d %d %g\n", kk, ll, (double) cabs(twisted2[plan->totsize4-1])); */
 
-	_FFTW(execute_dft)(plan->plans[workerid].plan2_cpu, twisted2, fft2);
+	_FFTW(execute_dft)(plan->plan2_cpu, twisted2, fft2);
 }
 #endif
 
@@ -259,8 +261,8 @@ STARPUFFT(twist3_2d_kernel_cpu)(void *descr[], void *_args)
 	STARPUFFT(plan) plan = args->plan;
 	int kk = args->kk;	/* between 0 and DIV_2D_N */
 	int ll = args->ll;	/* between 0 and DIV_2D_M */
-	int kkk, lll;		/* between 0,0 and n3,m3 */
-	int i, j;
+	int kkk;		/* between 0 and n3 */
+	int i;
 	int n1 = plan->n1[0];
 	int n2 = plan->n2[0];
 	int m1 = plan->n1[1];
@@ -273,14 +275,14 @@ STARPUFFT(twist3_2d_kernel_cpu)(void *descr[], void *_args)
 
 	/* printf("twist3 %d %d %g\n", kk, ll, (double) cabs(fft2[0])); */
 
+	/* out[i*n2*m+j*m2+k*m+l] = fft2[kkk*m3*n1*m1+lll*n1*m1+i*m1+j],
+	 * i.e. for each kkk and i, a transposition between lll and j */
 	for (kkk = 0; kkk < n3; kkk++) {
 		int k = kk * n3 + kkk;
-		for (lll = 0; lll < m3; lll++) {
-			int l = ll * m3 + lll;
-			for (i = 0; i < n1; i++)
-				for (j = 0; j < m1; j++)
-					plan->out[i*n2*m+j*m2+k*m+l] = fft2[kkk*m3*n1*m1+lll*n1*m1+i*m1+j];
-		}
+		for (i = 0; i < n1; i++)
+			STARPUFFT(transpose_cpu)(plan->out + i*n2*m + k*m + ll*m3, m2,
+						 fft2 + kkk*m3*n1*m1 + i*m1, n1*m1,
+						 m3, m1);
 	}
 }
 
@@ -449,7 +451,7 @@ STARPUFFT(fft_2d_kernel_cpu)(void *descr[], void *_args)
 	STARPUFFT(complex) * restrict in = (STARPUFFT(complex) *)STARPU_VECTOR_GET_PTR(descr[0]);
 	STARPUFFT(complex) * restrict out = (STARPUFFT(complex) *)STARPU_VECTOR_GET_PTR(descr[1]);
 
-	_FFTW(execute_dft)(plan->plans[workerid].plan_cpu, in, out);
+	_FFTW(execute_dft)(plan->plan_cpu, in, out);
 }
 #endif
 
@@ -578,31 +580,29 @@ if (PARALLEL) {
 	compute_roots(plan);
 }
 
-	/* Initialize per-worker working set */
-	for (workerid = 0; workerid < starpu_worker_get_count(); workerid++) {
-		switch (starpu_worker_get_type(workerid)) {
-		case STARPU_CPU_WORKER:
 #ifdef STARPU_HAVE_FFTW
+	/* Get FFTW plans from the cache */
+	if (starpu_cpu_worker_get_count() > 0) {
 if (PARALLEL) {
-			/* first fft plan: one n2*m2 fft */
-			plan->plans[workerid].plan1_cpu = _FFTW(plan_dft_2d)(n2, m2, NULL, (void*) 1, sign, _FFTW_FLAGS);
-			STARPU_ASSERT(plan->plans[workerid].plan1_cpu);
-
-			/* second fft plan: n3*m3 n1*m1 ffts */
-			plan->plans[workerid].plan2_cpu = _FFTW(plan_many_dft)(plan->dim,
-					plan->n1, n3*m3,
-					NULL, NULL, 1, plan->totsize1,
-					(void*) 1, NULL, 1, plan->totsize1,
-					sign, _FFTW_FLAGS);
-			STARPU_ASSERT(plan->plans[workerid].plan2_cpu);
+		/* first fft plan: one n2*m2 fft */
+		plan->plan1_cpu = STARPUFFT(plan_cache_get)(plan->dim, plan->n2, 1, sign);
+
+		/* second fft plan: n3*m3 n1*m1 ffts */
+		plan->plan2_cpu = STARPUFFT(plan_cache_get)(plan->dim, plan->n1, n3*m3, sign);
 } else {
-			/* fft plan: one fft of size n, m. */
-			plan->plans[workerid].plan_cpu = _FFTW(plan_dft_2d)(n, m, NULL, (void*) 1, sign, _FFTW_FLAGS);
-			STARPU_ASSERT(plan->plans[workerid].plan_cpu);
+		/* fft plan: one fft of size n, m. */
+		plan->plan_cpu = STARPUFFT(plan_cache_get)(plan->dim, plan->n, 1, sign);
 }
+	}
 #else
 /* #warning libstarpufft can not work correctly if libfftw3 is not installed */
 #endif
+
+	/* Initialize per-worker working set */
+	for (workerid = 0; workerid < starpu_worker_get_count(); workerid++) {
+		switch (starpu_worker_get_type(workerid)) {
+		case STARPU_CPU_WORKER:
+			/* The FFTW plans are shared by all CPU workers */
 			break;
 		case STARPU_CUDA_WORKER:
 			break;
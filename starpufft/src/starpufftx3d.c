@@ -74,7 +74,7 @@ STARPUFFT(fft_3d_kernel_cpu)(void *descr[], void *_args)
 	STARPUFFT(complex) * restrict in = (STARPUFFT(complex) *)STARPU_VECTOR_GET_PTR(descr[0]);
 	STARPUFFT(complex) * restrict out = (STARPUFFT(complex) *)STARPU_VECTOR_GET_PTR(descr[1]);
 
-	_FFTW(execute_dft)(plan->plans[workerid].plan_cpu, in, out);
+	_FFTW(execute_dft)(plan->plan_cpu, in, out);
 }
 #endif
 
@@ -133,17 +133,21 @@ if (PARALLEL) {
 	plan->sign = sign;
 
 
-	/* Initialize per-worker working set */
-	for (workerid = 0; workerid < starpu_worker_get_count(); workerid++) {
-		switch (starpu_worker_get_type(workerid)) {
-		case STARPU_CPU_WORKER:
 #ifdef STARPU_HAVE_FFTW
-			/* fft plan: one fft of size n, m. */
-			plan->plans[workerid].plan_cpu = _FFTW(plan_dft_3d)(n, m, p, NULL, (void*) 1, sign, _FFTW_FLAGS);
-			STARPU_ASSERT(plan->plans[workerid].plan_cpu);
+	/* Get FFTW plans from the cache */
+	if (starpu_cpu_worker_get_count() > 0) {
+		/* fft plan: one fft of size n, m, p. */
+		plan->plan_cpu = STARPUFFT(plan_cache_get)(plan->dim, plan->n, 1, sign);
+	}
 #else
 /* #warning libstarpufft can not work correctly if libfftw3 is not installed */
 #endif
+
+	/* Initialize per-worker working set */
+	for (workerid = 0; workerid < starpu_worker_get_count(); workerid++) {
+		switch (starpu_worker_get_type(workerid)) {
+		case STARPU_CPU_WORKER:
+			/* The FFTW plans are shared by all CPU workers */
 			break;
 		case STARPU_CUDA_WORKER:
 			break;
@@ -0,0 +1,37 @@
+#!/bin/bash
+# StarPU --- Runtime system for heterogeneous multicore architectures.
+#
+# Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+#
+# StarPU is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or (at
+# your option) any later version.
+#
+# StarPU is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU Lesser General Public License in COPYING.LGPL for more details.
+#
+
+# Run the starpufft throughput benchmark under several schedulers, in single
+# and double precision. Set STARPU_SCHED to a space-separated list of
+# schedulers to override the default list.
+
+set -e
+
+DIR=$(dirname $0)
+SCHEDS=${STARPU_SCHED:-"eager prio lws dmda dmdas"}
+
+for sched in $SCHEDS
+do
+	for bench in benchf bench
+	do
+		if [ -x $DIR/$bench ]
+		then
+			echo "# STARPU_SCHED=$sched $bench"
+			STARPU_SCHED=$sched $STARPU_LAUNCH $DIR/$bench "$@"
+		fi
+	done
+done
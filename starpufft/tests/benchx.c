@@ -0,0 +1,149 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Throughput of repeated same-size FFTs: for each size, create a plan, submit
+ * NFFTS independent transforms over NBUFS pairs of buffers, and report the
+ * number of transforms per second. The plan creation time is measured twice,
+ * the second creation hitting the plan cache. Run it with various STARPU_SCHED
+ * values to compare schedulers, see bench_scheds.sh
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <starpu.h>
+
+#include <starpu_config.h>
+#include "starpufft.h"
+
+#define SIGN (-1)
+
+#ifdef STARPU_QUICK_CHECK
+#define NFFTS	16
+#define NBUFS	4
+#define MIN_N	(1<<8)
+#define MAX_N	(1<<12)
+#else
+#define NFFTS	256
+#define NBUFS	16
+#define MIN_N	(1<<8)
+#define MAX_N	(1<<20)
+#endif
+
+static double plan_time(int n, int m)
+{
+	STARPUFFT(plan) plan;
+	double start = starpu_timing_now();
+
+	if (m)
+		plan = STARPUFFT(plan_dft_2d)(n, m, SIGN, 0);
+	else
+		plan = STARPUFFT(plan_dft_1d)(n, SIGN, 0);
+	STARPUFFT(destroy_plan)(plan);
+
+	return starpu_timing_now() - start;
+}
+
+static void bench(int n, int m)
+{
+	STARPUFFT(plan) plan;
+	STARPUFFT(complex) *in[NBUFS], *out[NBUFS];
+	starpu_data_handle_t in_handle[NBUFS], out_handle[NBUFS];
+	struct starpu_task *tasks[NFFTS];
+	int size = m ? n * m : n;
+	double first, cached, start, end;
+	int i, b, ret;
+
+	first = plan_time(n, m);
+	cached = plan_time(n, m);
+
+	if (m)
+		plan = STARPUFFT(plan_dft_2d)(n, m, SIGN, 0);
+	else
+		plan = STARPUFFT(plan_dft_1d)(n, SIGN, 0);
+
+	for (b = 0; b < NBUFS; b++)
+	{
+		in[b] = STARPUFFT(malloc)(size * sizeof(*in[b]));
+		out[b] = STARPUFFT(malloc)(size * sizeof(*out[b]));
+		for (i = 0; i < size; i++)
+			in[b][i] = cos(i) + I * sin(i + b);
+		starpu_vector_data_register(&in_handle[b], STARPU_MAIN_RAM, (uintptr_t) in[b], size, sizeof(*in[b]));
+		starpu_vector_data_register(&out_handle[b], STARPU_MAIN_RAM, (uintptr_t) out[b], size, sizeof(*out[b]));
+	}
+
+	/* Warm up the performance models and the caches */
+	for (b = 0; b < NBUFS; b++)
+	{
+		tasks[b] = STARPUFFT(start_handle)(plan, in_handle[b], out_handle[b]);
+		STARPU_ASSERT(tasks[b]);
+	}
+	for (b = 0; b < NBUFS; b++)
+	{
+		ret = starpu_task_wait(tasks[b]);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait");
+	}
+
+	start = starpu_timing_now();
+	for (i = 0; i < NFFTS; i++)
+	{
+		tasks[i] = STARPUFFT(start_handle)(plan, in_handle[i % NBUFS], out_handle[i % NBUFS]);
+		STARPU_ASSERT(tasks[i]);
+	}
+	for (i = 0; i < NFFTS; i++)
+	{
+		ret = starpu_task_wait(tasks[i]);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait");
+	}
+	end = starpu_timing_now();
+
+	for (b = 0; b < NBUFS; b++)
+	{
+		starpu_data_unregister(in_handle[b]);
+		starpu_data_unregister(out_handle[b]);
+		STARPUFFT(free)(in[b], size * sizeof(*in[b]));
+		STARPUFFT(free)(out[b], size * sizeof(*out[b]));
+	}
+	STARPUFFT(destroy_plan)(plan);
+
+	printf("%s\t%d\t%d\t%.1f\t%.1f\t%.1f\t%.3f\n",
+	       TYPE[0] ? TYPE : "d", n, m ? m : 1, first, cached,
+	       NFFTS / ((end - start) / 1000000.),
+	       /* 5 n log2(n) flops per complex transform */
+	       NFFTS * 5. * size * log2(size) / (end - start) / 1000.);
+}
+
+int main(void)
+{
+	int ret, n;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV)
+		return 77;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	printf("# type\tn\tm\tplan(us)\tcached plan(us)\tffts/s\tGflop/s\n");
+	for (n = MIN_N; n <= MAX_N; n *= 4)
+		bench(n, 0);
+	for (n = 1<<4; n * n <= MAX_N; n *= 2)
+		bench(n, n);
+
+	starpu_shutdown();
+
+	return 0;
+}
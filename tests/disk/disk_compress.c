@@ -0,0 +1,203 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Push vectors to the disk and back, half of them being sparse and thus
+ * compressing well, and the other half being random, without compression
+ * (STARPU_DISK_COMPRESS=0), with compression when it pays off (1), and always
+ * compressed (2), and check that the data is read back correctly.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#  define NVECTORS	8
+#  define NX		(256*1024)
+#else
+#  define NVECTORS	64
+#  define NX		(4*1024*1024)
+#endif
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#elif STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static char value(unsigned i, unsigned j)
+{
+	if (i % 2)
+		/* Sparse */
+		return j % 1024 ? 0 : i;
+	/* Random */
+	uint32_t x = i * NX + j;
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return (char) x;
+}
+
+static int dotest(const char *mode, void *param)
+{
+	starpu_data_handle_t handles[NVECTORS];
+	struct starpu_conf conf;
+	double start, write, read;
+	int new_dd, ret;
+	unsigned i, j;
+
+	setenv("STARPU_DISK_COMPRESS", mode, 1);
+
+	ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 1;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	new_dd = starpu_disk_register(&starpu_disk_unistd_ops, param, STARPU_MAX(2*NVECTORS*NX, STARPU_DISK_SIZE_MIN));
+	if (new_dd == -ENOENT)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (i = 0; i < NVECTORS; i++)
+	{
+		char *v;
+
+		starpu_vector_data_register(&handles[i], -1, 0, NX, 1);
+		ret = starpu_data_acquire(handles[i], STARPU_W);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		v = (char *) starpu_data_get_local_ptr(handles[i]);
+		for (j = 0; j < NX; j++)
+			v[j] = value(i, j);
+		starpu_data_release(handles[i]);
+	}
+
+	/* Write everything to the disk */
+	start = starpu_timing_now();
+	for (i = 0; i < NVECTORS; i++)
+		starpu_data_prefetch_on_node(handles[i], new_dd, 1);
+	for (i = 0; i < NVECTORS; i++)
+	{
+		ret = starpu_data_acquire_on_node(handles[i], new_dd, STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+		starpu_data_release_on_node(handles[i], new_dd);
+	}
+	write = starpu_timing_now() - start;
+
+	/* Invalidate the copies in main memory */
+	for (i = 0; i < NVECTORS; i++)
+	{
+		ret = starpu_data_acquire_on_node(handles[i], new_dd, STARPU_RW);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+		starpu_data_release_on_node(handles[i], new_dd);
+	}
+
+	/* And read everything back */
+	start = starpu_timing_now();
+	for (i = 0; i < NVECTORS; i++)
+		starpu_data_prefetch_on_node(handles[i], STARPU_MAIN_RAM, 1);
+	for (i = 0; i < NVECTORS; i++)
+	{
+		ret = starpu_data_acquire_on_node(handles[i], STARPU_MAIN_RAM, STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+		starpu_data_release_on_node(handles[i], STARPU_MAIN_RAM);
+	}
+	read = starpu_timing_now() - start;
+
+	for (i = 0; i < NVECTORS; i++)
+	{
+		char *v;
+
+		ret = starpu_data_acquire(handles[i], STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		v = (char *) starpu_data_get_local_ptr(handles[i]);
+		for (j = 0; j < NX; j++)
+			if (v[j] != value(i, j))
+			{
+				FPRINTF(stderr, "compression %s: vector %u has %d at %u instead of %d\n", mode, i, v[j], j, value(i, j));
+				starpu_data_release(handles[i]);
+				starpu_shutdown();
+				return EXIT_FAILURE;
+			}
+		starpu_data_release(handles[i]);
+		starpu_data_unregister(handles[i]);
+	}
+
+	printf("%s\t%.1f\t%.1f\n", mode, (double) NVECTORS*NX / write, (double) NVECTORS*NX / read);
+
+	starpu_shutdown();
+	return EXIT_SUCCESS;
+}
+
+static int merge_result(int old, int new)
+{
+	if (new == EXIT_FAILURE)
+		return EXIT_FAILURE;
+	if (old == 0)
+		return 0;
+	return new;
+}
+
+int main(void)
+{
+	int ret = 0;
+	int ret2;
+	char s[128];
+	char *ptr;
+
+	setenv("STARPU_CALIBRATE_MINIMUM", "1", 1);
+
+	snprintf(s, sizeof(s), "/tmp/%s-disk-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory <%s>\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+
+	printf("# compress\twrite MB/s\tread MB/s\n");
+	ret = merge_result(ret, dotest("0", s));
+	ret = merge_result(ret, dotest("1", s));
+	ret = merge_result(ret, dotest("2", s));
+
+	ret2 = rmdir(s);
+	if (ret2 < 0)
+		STARPU_CHECK_RETURN_VALUE(-errno, "rmdir '%s'\n", s);
+	return ret;
+}
+#endif
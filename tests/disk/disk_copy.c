@@ -187,6 +187,7 @@ int main(void)
 	ret = merge_result(ret, dotest(&starpu_disk_unistd_ops, s));
 #ifdef STARPU_LINUX_SYS
 	ret = merge_result(ret, dotest(&starpu_disk_unistd_o_direct_ops, s));
+	ret = merge_result(ret, dotest(&starpu_disk_unistd_io_uring_ops, s));
 #endif
 #ifdef STARPU_HAVE_HDF5
 	ret = merge_result(ret, dotest(&starpu_disk_hdf5_ops, s));
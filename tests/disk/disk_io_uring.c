@@ -0,0 +1,182 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Push a set of vectors to the disk and back with asynchronous prefetches, so
+ * that many disk requests are pending at the same time, and compare the
+ * throughput of the unistd, unistd_o_direct and unistd_io_uring backends.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#  define NVECTORS	8
+#  define NX		(256*1024)
+#else
+#  define NVECTORS	64
+#  define NX		(4*1024*1024)
+#endif
+
+#if STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static int dotest(const char *name, struct starpu_disk_ops *ops, void *param)
+{
+	starpu_data_handle_t handles[NVECTORS];
+	struct starpu_conf conf;
+	double start, write, read;
+	int new_dd, ret;
+	unsigned i, j;
+
+	ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 1;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	new_dd = starpu_disk_register(ops, param, STARPU_MAX(2*NVECTORS*NX, STARPU_DISK_SIZE_MIN));
+	if (new_dd == -ENOENT)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (i = 0; i < NVECTORS; i++)
+	{
+		char *v;
+
+		starpu_vector_data_register(&handles[i], -1, 0, NX, 1);
+		ret = starpu_data_acquire(handles[i], STARPU_W);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		v = (char *) starpu_data_get_local_ptr(handles[i]);
+		for (j = 0; j < NX; j++)
+			v[j] = i + j;
+		starpu_data_release(handles[i]);
+	}
+
+	/* Write everything to the disk */
+	start = starpu_timing_now();
+	for (i = 0; i < NVECTORS; i++)
+		starpu_data_prefetch_on_node(handles[i], new_dd, 1);
+	for (i = 0; i < NVECTORS; i++)
+	{
+		ret = starpu_data_acquire_on_node(handles[i], new_dd, STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+		starpu_data_release_on_node(handles[i], new_dd);
+	}
+	write = starpu_timing_now() - start;
+
+	/* Invalidate the copies in main memory */
+	for (i = 0; i < NVECTORS; i++)
+	{
+		ret = starpu_data_acquire_on_node(handles[i], new_dd, STARPU_RW);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+		starpu_data_release_on_node(handles[i], new_dd);
+	}
+
+	/* And read everything back */
+	start = starpu_timing_now();
+	for (i = 0; i < NVECTORS; i++)
+		starpu_data_prefetch_on_node(handles[i], STARPU_MAIN_RAM, 1);
+	for (i = 0; i < NVECTORS; i++)
+	{
+		ret = starpu_data_acquire_on_node(handles[i], STARPU_MAIN_RAM, STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+		starpu_data_release_on_node(handles[i], STARPU_MAIN_RAM);
+	}
+	read = starpu_timing_now() - start;
+
+	for (i = 0; i < NVECTORS; i++)
+	{
+		char *v;
+
+		ret = starpu_data_acquire(handles[i], STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		v = (char *) starpu_data_get_local_ptr(handles[i]);
+		for (j = 0; j < NX; j++)
+			if (v[j] != (char) (i + j))
+			{
+				FPRINTF(stderr, "%s: vector %u has %d at %u instead of %d\n", name, i, v[j], j, (char) (i + j));
+				starpu_data_release(handles[i]);
+				starpu_shutdown();
+				return EXIT_FAILURE;
+			}
+		starpu_data_release(handles[i]);
+		starpu_data_unregister(handles[i]);
+	}
+
+	printf("%s\t%.1f\t%.1f\n", name, (double) NVECTORS*NX / write, (double) NVECTORS*NX / read);
+
+	starpu_shutdown();
+	return EXIT_SUCCESS;
+}
+
+static int merge_result(int old, int new)
+{
+	if (new == EXIT_FAILURE)
+		return EXIT_FAILURE;
+	if (old == 0)
+		return 0;
+	return new;
+}
+
+int main(void)
+{
+	int ret = 0;
+	int ret2;
+	char s[128];
+	char *ptr;
+
+#ifdef STARPU_HAVE_SETENV
+	setenv("STARPU_CALIBRATE_MINIMUM", "1", 1);
+#endif
+
+	snprintf(s, sizeof(s), "/tmp/%s-disk-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory <%s>\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+
+	printf("# backend\twrite MB/s\tread MB/s\n");
+	ret = merge_result(ret, dotest("unistd", &starpu_disk_unistd_ops, s));
+#ifdef STARPU_LINUX_SYS
+	ret = merge_result(ret, dotest("unistd_o_direct", &starpu_disk_unistd_o_direct_ops, s));
+	ret = merge_result(ret, dotest("unistd_io_uring", &starpu_disk_unistd_io_uring_ops, s));
+#endif
+
+	ret2 = rmdir(s);
+	if (ret2 < 0)
+		STARPU_CHECK_RETURN_VALUE(-errno, "rmdir '%s'\n", s);
+	return ret;
+}
+#endif
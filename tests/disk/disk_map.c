@@ -0,0 +1,171 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <fcntl.h>
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../helper.h"
+
+#if STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+/*
+ * Access data which lives in a file from CPU tasks with memory mapping
+ * enabled, so that the unistd disk backend maps the file instead of reading
+ * it, and check that reads get the file content and writes go to the file.
+ */
+
+#define NX (1024*1024)
+
+void check_func(void *descr[], void *arg)
+{
+	int *v = (int *) STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	int offset;
+	unsigned i;
+
+	starpu_codelet_unpack_args(arg, &offset);
+	for (i = 0; i < n; i++)
+		STARPU_ASSERT(v[i] == (int) i + offset);
+}
+
+static struct starpu_codelet check_cl =
+{
+	.cpu_funcs = {check_func},
+	.nbuffers = 1,
+	.modes = {STARPU_R},
+};
+
+void increment_func(void *descr[], void *arg)
+{
+	(void)arg;
+	int *v = (int *) STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	unsigned i;
+
+	for (i = 0; i < n; i++)
+		v[i]++;
+}
+
+static struct starpu_codelet increment_cl =
+{
+	.cpu_funcs = {increment_func},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+};
+
+int main(int argc, char **argv)
+{
+	const char *name = "STARPU_DISK_MAP_DATA";
+	struct starpu_conf conf;
+	starpu_data_handle_t handle;
+	char *base, *path;
+	int *A;
+	void *data;
+	int fd, new_dd, ret, offset;
+	unsigned j;
+	int success = 1;
+
+	(void)argc;
+	(void)argv;
+
+	base = starpu_getenv("STARPU_DISK_MAP_DIR");
+	if (!base)
+		base = "/tmp";
+
+	ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 1;
+	conf.enable_map = 1;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	new_dd = starpu_disk_register(&starpu_disk_unistd_ops, (void *) base, STARPU_DISK_SIZE_MIN);
+	if (new_dd == -ENOENT)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	/* Create the input file */
+	path = malloc(strlen(base) + 1 + strlen(name) + 1);
+	sprintf(path, "%s/%s", base, name);
+	A = malloc(NX*sizeof(int));
+	for (j = 0; j < NX; j++)
+		A[j] = j;
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0 || write(fd, A, NX*sizeof(int)) != NX*sizeof(int))
+	{
+		if (fd >= 0)
+			close(fd);
+		free(A);
+		free(path);
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+	close(fd);
+
+	data = starpu_disk_open(new_dd, (void *) name, NX*sizeof(int));
+	STARPU_ASSERT(data);
+	starpu_vector_data_register(&handle, new_dd, (uintptr_t) data, NX, sizeof(int));
+
+	/* The prefetch maps the file and starts reading it */
+	starpu_data_prefetch_on_node(handle, STARPU_MAIN_RAM, 1);
+
+	offset = 0;
+	ret = starpu_task_insert(&check_cl, STARPU_R, handle, STARPU_VALUE, &offset, sizeof(offset), 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	ret = starpu_task_insert(&increment_cl, STARPU_RW, handle, 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	offset = 1;
+	ret = starpu_task_insert(&check_cl, STARPU_R, handle, STARPU_VALUE, &offset, sizeof(offset), 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+
+	starpu_data_unregister(handle);
+	starpu_disk_close(new_dd, data, NX*sizeof(int));
+	starpu_shutdown();
+
+	/* The file must have been updated */
+	fd = open(path, O_RDONLY);
+	STARPU_ASSERT(fd >= 0);
+	ret = read(fd, A, NX*sizeof(int));
+	STARPU_ASSERT(ret == NX*sizeof(int));
+	close(fd);
+	for (j = 0; j < NX; j++)
+		if (A[j] != (int) j + 1)
+		{
+			FPRINTF(stderr, "Fail A[%u] = %d\n", j, A[j]);
+			success = 0;
+			break;
+		}
+
+	unlink(path);
+	free(path);
+	free(A);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#endif
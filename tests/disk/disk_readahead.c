@@ -0,0 +1,188 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Run tasks on vectors which live on the disk, with a prefetching scheduler,
+ * without read-ahead (STARPU_DISK_READAHEAD=0) and with read-ahead of the data
+ * of the next few tasks of each worker, check that the tasks get the right
+ * data, and display the time taken.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#  define NVECTORS	16
+#  define NX		(256*1024)
+#else
+#  define NVECTORS	64
+#  define NX		(4*1024*1024)
+#endif
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#elif STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static unsigned errors;
+
+void check_func(void *descr[], void *arg)
+{
+	char *v = (char *) STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	unsigned i, j;
+
+	starpu_codelet_unpack_args(arg, &i);
+	for (j = 0; j < n; j++)
+		if (v[j] != (char) (i + j))
+		{
+			FPRINTF(stderr, "vector %u has %d at %u instead of %d\n", i, v[j], j, (char) (i + j));
+			STARPU_ATOMIC_ADD(&errors, 1);
+			break;
+		}
+}
+
+static struct starpu_codelet check_cl =
+{
+	.cpu_funcs = {check_func},
+	.nbuffers = 1,
+	.modes = {STARPU_R},
+};
+
+static int dotest(const char *readahead, void *param)
+{
+	starpu_data_handle_t handles[NVECTORS];
+	struct starpu_conf conf;
+	double start, end;
+	int new_dd, ret;
+	unsigned i, j;
+
+	setenv("STARPU_DISK_READAHEAD", readahead, 1);
+
+	ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 1;
+	conf.sched_policy_name = "dmda";
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	new_dd = starpu_disk_register(&starpu_disk_unistd_ops, param, STARPU_MAX(2*NVECTORS*NX, STARPU_DISK_SIZE_MIN));
+	if (new_dd == -ENOENT)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (i = 0; i < NVECTORS; i++)
+	{
+		char *v;
+
+		starpu_vector_data_register(&handles[i], -1, 0, NX, 1);
+		ret = starpu_data_acquire(handles[i], STARPU_W);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		v = (char *) starpu_data_get_local_ptr(handles[i]);
+		for (j = 0; j < NX; j++)
+			v[j] = i + j;
+		starpu_data_release(handles[i]);
+
+		/* Move it to the disk */
+		ret = starpu_data_acquire_on_node(handles[i], new_dd, STARPU_RW);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+		starpu_data_release_on_node(handles[i], new_dd);
+	}
+
+	errors = 0;
+	start = starpu_timing_now();
+	for (i = 0; i < NVECTORS; i++)
+	{
+		ret = starpu_task_insert(&check_cl, STARPU_R, handles[i], STARPU_VALUE, &i, sizeof(i), 0);
+		if (ret == -ENODEV)
+			goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+	end = starpu_timing_now();
+
+	for (i = 0; i < NVECTORS; i++)
+		starpu_data_unregister(handles[i]);
+
+	printf("%s\t%.1f\n", readahead, (double) NVECTORS*NX / (end - start));
+
+	starpu_shutdown();
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+
+enodev:
+	for (i = 0; i < NVECTORS; i++)
+		starpu_data_unregister(handles[i]);
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
+
+static int merge_result(int old, int new)
+{
+	if (new == EXIT_FAILURE)
+		return EXIT_FAILURE;
+	if (old == 0)
+		return 0;
+	return new;
+}
+
+int main(void)
+{
+	int ret = 0;
+	int ret2;
+	char s[128];
+	char *ptr;
+
+	setenv("STARPU_CALIBRATE_MINIMUM", "1", 1);
+	setenv("STARPU_DISK_READAHEAD_STATS", "1", 1);
+
+	snprintf(s, sizeof(s), "/tmp/%s-disk-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory <%s>\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+
+	printf("# readahead\tMB/s\n");
+	ret = merge_result(ret, dotest("0", s));
+	ret = merge_result(ret, dotest("4", s));
+
+	ret2 = rmdir(s);
+	if (ret2 < 0)
+		STARPU_CHECK_RETURN_VALUE(-errno, "rmdir '%s'\n", s);
+	return ret;
+}
+#endif
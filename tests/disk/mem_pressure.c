@@ -0,0 +1,208 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Run tasks on vectors which live on the disk, twice as big as the limited
+ * main memory, with modular-heft, without (STARPU_SCHED_MEM_PRESSURE=0)
+ * and with the memory-pressure queues, check that the tasks get the right
+ * data, and display the time taken.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#  define NVECTORS	16
+#  define NTASKS	64
+#else
+#  define NVECTORS	32
+#  define NTASKS	512
+#endif
+#define MEMSIZE 4
+#define MEMSIZE_STR "4"
+#define NX		((2*MEMSIZE*1024*1024) / NVECTORS)
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#elif STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static unsigned errors;
+
+void check_func(void *descr[], void *arg)
+{
+	char *v = (char *) STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	unsigned i, j;
+
+	starpu_codelet_unpack_args(arg, &i);
+	for (j = 0; j < n; j++)
+		if (v[j] != (char) (i + j))
+		{
+			FPRINTF(stderr, "vector %u has %d at %u instead of %d\n", i, v[j], j, (char) (i + j));
+			STARPU_ATOMIC_ADD(&errors, 1);
+			break;
+		}
+}
+
+/* Give a model, so that modular-heft maps the tasks through the queues below
+ * instead of handing them directly to idle workers */
+static double cost_function(struct starpu_task *t, struct starpu_perfmodel_arch *a, unsigned i)
+{
+	(void) t; (void) a; (void) i;
+	return 100.;
+}
+
+static struct starpu_perfmodel check_model =
+{
+	.type = STARPU_PER_ARCH,
+	.arch_cost_function = cost_function,
+};
+
+static struct starpu_codelet check_cl =
+{
+	.cpu_funcs = {check_func},
+	.nbuffers = 1,
+	.modes = {STARPU_R},
+	.model = &check_model,
+};
+
+static int dotest(const char *mem_pressure, void *param)
+{
+	starpu_data_handle_t handles[NVECTORS];
+	struct starpu_conf conf;
+	double start, end;
+	int new_dd, ret;
+	unsigned i, j;
+
+	setenv("STARPU_SCHED_MEM_PRESSURE", mem_pressure, 1);
+
+	ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 2;
+	conf.sched_policy_name = "modular-heft";
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	new_dd = starpu_disk_register(&starpu_disk_unistd_ops, param, STARPU_MAX(2*NVECTORS*NX, STARPU_DISK_SIZE_MIN));
+	if (new_dd == -ENOENT)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (i = 0; i < NVECTORS; i++)
+	{
+		char *v;
+
+		starpu_vector_data_register(&handles[i], -1, 0, NX, 1);
+		ret = starpu_data_acquire(handles[i], STARPU_W);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		v = (char *) starpu_data_get_local_ptr(handles[i]);
+		for (j = 0; j < NX; j++)
+			v[j] = i + j;
+		starpu_data_release(handles[i]);
+
+		/* Move it to the disk */
+		ret = starpu_data_acquire_on_node(handles[i], new_dd, STARPU_RW);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+		starpu_data_release_on_node(handles[i], new_dd);
+	}
+
+	errors = 0;
+	starpu_srand48(0);
+	start = starpu_timing_now();
+	for (i = 0; i < NTASKS; i++)
+	{
+		j = starpu_lrand48() % NVECTORS;
+		ret = starpu_task_insert(&check_cl, STARPU_R, handles[j], STARPU_VALUE, &j, sizeof(j), 0);
+		if (ret == -ENODEV)
+			goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+	end = starpu_timing_now();
+
+	for (i = 0; i < NVECTORS; i++)
+		starpu_data_unregister(handles[i]);
+
+	printf("%s\t%.1f\n", mem_pressure, (end - start) / 1000.);
+
+	starpu_shutdown();
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+
+enodev:
+	for (i = 0; i < NVECTORS; i++)
+		starpu_data_unregister(handles[i]);
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
+
+static int merge_result(int old, int new)
+{
+	if (new == EXIT_FAILURE)
+		return EXIT_FAILURE;
+	if (old == 0)
+		return 0;
+	return new;
+}
+
+int main(void)
+{
+	int ret = 0;
+	int ret2;
+	char s[128];
+	char *ptr;
+
+	setenv("STARPU_LIMIT_CPU_MEM", MEMSIZE_STR, 1);
+	setenv("STARPU_SCHED_MEM_PRESSURE_STATS", "1", 1);
+
+	snprintf(s, sizeof(s), "/tmp/%s-disk-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory <%s>\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+
+	printf("# mem_pressure\tms\n");
+	ret = merge_result(ret, dotest("0", s));
+	ret = merge_result(ret, dotest("90", s));
+
+	ret2 = rmdir(s);
+	if (ret2 < 0)
+		STARPU_CHECK_RETURN_VALUE(-errno, "rmdir '%s'\n", s);
+	return ret;
+}
+#endif
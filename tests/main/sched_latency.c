@@ -0,0 +1,118 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include "../helper.h"
+
+/*
+ * Submit a few tasks and check that the scheduling latencies were recorded
+ * for all of them, and that the statistics are consistent.
+ */
+
+#define NTASKS 100
+
+void func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {func},
+	.cuda_funcs = {func},
+	.opencl_funcs = {func},
+	.nbuffers = 0,
+};
+
+static int check_stats(const char *what, struct starpu_sched_latency_stats *stats)
+{
+	if (stats->count == 0)
+		return 0;
+	if (stats->min > stats->p50 || stats->p50 > stats->p90 || stats->p90 > stats->p99
+	    || stats->p99 > stats->p999 || stats->p999 > stats->max)
+	{
+		FPRINTF(stderr, "%s: inconsistent percentiles %f %f %f %f %f %f\n", what,
+			stats->min, stats->p50, stats->p90, stats->p99, stats->p999, stats->max);
+		return 1;
+	}
+	return 0;
+}
+
+int main(void)
+{
+	struct starpu_sched_latency_stats stats;
+	unsigned long npop = 0;
+	unsigned i, nworkers;
+	int ret, errors = 0;
+
+	setenv("STARPU_SCHED_LATENCY", "1", 1);
+
+	ret = starpu_initialize(NULL, NULL, NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		ret = starpu_task_insert(&cl, 0);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+
+	ret = starpu_sched_latency_get_ctx_stats(STARPU_NMAX_SCHED_CTXS, STARPU_SCHED_LATENCY_PUSH, &stats);
+	STARPU_ASSERT(ret == -EINVAL);
+
+	ret = starpu_sched_latency_get_ctx_stats(0, STARPU_SCHED_LATENCY_PUSH, &stats);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_sched_latency_get_ctx_stats");
+	if (stats.count < NTASKS)
+	{
+		FPRINTF(stderr, "only %lu push latencies recorded\n", stats.count);
+		errors++;
+	}
+	errors += check_stats("push", &stats);
+
+	ret = starpu_sched_latency_get_ctx_stats(0, STARPU_SCHED_LATENCY_READY_TO_START, &stats);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_sched_latency_get_ctx_stats");
+	if (stats.count < NTASKS)
+	{
+		FPRINTF(stderr, "only %lu ready-to-start latencies recorded\n", stats.count);
+		errors++;
+	}
+	errors += check_stats("ready to start", &stats);
+
+	nworkers = starpu_worker_get_count();
+	for (i = 0; i < nworkers; i++)
+	{
+		ret = starpu_sched_latency_get_worker_stats(i, STARPU_SCHED_LATENCY_POP, &stats);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_sched_latency_get_worker_stats");
+		npop += stats.count;
+		errors += check_stats("pop", &stats);
+	}
+	if (npop < NTASKS)
+	{
+		FPRINTF(stderr, "only %lu pop latencies recorded\n", npop);
+		errors++;
+	}
+
+	starpu_shutdown();
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+
+enodev:
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
@@ -22,7 +22,8 @@
 
 /*
  * Measure the memory bandwidth available to kernels depending on the number of
- * kernels and number of idle workers.
+ * kernels and number of idle workers, and the bandwidth of StarPU RAM-to-RAM
+ * transfers depending on the number of copy helper threads.
  */
 
 #if defined(STARPU_QUICK_CHECK) || defined(STARPU_SANITIZE_LEAK) || defined(STARPU_SANITIZE_ADDRESS) || defined(STARPU_SANITIZE_UNDEFINED)
@@ -34,6 +35,7 @@ static size_t size = 64UL << 20;
 static unsigned cpustep = 0;
 
 static unsigned noalone = 0;
+static unsigned onlycopy = 0;
 static unsigned iter = 30;
 static unsigned total_ncpus;
 static starpu_pthread_barrier_t barrier_begin, barrier_end;
@@ -134,18 +136,19 @@ static struct starpu_codelet sync_codelet =
 
 static void usage(char **argv)
 {
-	fprintf(stderr, "Usage: %s [-n niter] [-s size (MB)] [-c cpustep] [-a]\n", argv[0]);
+	fprintf(stderr, "Usage: %s [-n niter] [-s size (MB)] [-c cpustep] [-a] [-r]\n", argv[0]);
 	fprintf(stderr, "\t-n niter\tNumber of iterations\n");
 	fprintf(stderr, "\t-s size\tBuffer size in MB\n");
 	fprintf(stderr, "\t-c cpustep\tCpu number increment\n");
 	fprintf(stderr, "\t-a Do not run the alone test\n");
+	fprintf(stderr, "\t-r Only run the RAM-to-RAM transfer test\n");
 	exit(EXIT_FAILURE);
 }
 
 static void parse_args(int argc, char **argv)
 {
 	int c;
-	while ((c = getopt(argc, argv, "n:s:c:ah")) != -1)
+	while ((c = getopt(argc, argv, "n:s:c:arh")) != -1)
 	switch(c)
 	{
 		case 'n':
@@ -160,6 +163,9 @@ static void parse_args(int argc, char **argv)
 		case 'a':
 			noalone = 1;
 			break;
+		case 'r':
+			onlycopy = 1;
+			break;
 		case 'h':
 			usage(argv);
 			break;
@@ -279,6 +285,69 @@ static float bench(int *argc, char ***argv, unsigned nbusy, unsigned ncpus, int
 	return bw;
 }
 
+/* Measure the bandwidth of RAM-to-RAM transfers from the first CPU memory
+ * node to each CPU memory node, with the given number of copy helper threads */
+static int bench_copy(int *argc, char ***argv, unsigned nthreads, int nt)
+{
+	int ret;
+	unsigned i, n, nnodes;
+	unsigned nodes[STARPU_MAXNUMANODES];
+	struct starpu_conf conf;
+	char s[16];
+	char *src, *dst;
+	double start, stop;
+
+	snprintf(s, sizeof(s), "%u", nthreads);
+	setenv("STARPU_RAM_COPY_NTHREADS", s, 1);
+	setenv("STARPU_RAM_COPY_NT", nt ? "1" : "0", 1);
+	/* Always use the copy engine, to check it even with small sizes */
+	setenv("STARPU_RAM_COPY_MIN_SIZE", "0", 1);
+
+	starpu_conf_init(&conf);
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 1;
+
+	ret = starpu_initialize(&conf, argc, argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	nnodes = starpu_memory_node_get_ids_by_type(STARPU_CPU_RAM, nodes, STARPU_MAXNUMANODES);
+	src = (char *) starpu_malloc_on_node(nodes[0], size);
+	for (i = 0; i < size; i++)
+		src[i] = i;
+
+	for (n = 0; n < nnodes; n++)
+	{
+		dst = (char *) starpu_malloc_on_node(nodes[n], size);
+		/* Make sure the pages are allocated */
+		memset(dst, 0, size);
+
+		start = starpu_timing_now();
+		for (i = 0; i < iter; i++)
+			starpu_interface_copy((uintptr_t) src, 0, nodes[0], (uintptr_t) dst, 0, nodes[n], size, NULL);
+		stop = starpu_timing_now();
+
+		if (memcmp(src, dst, size))
+		{
+			FPRINTF(stderr, "copy from node %u to node %u is wrong\n", nodes[0], nodes[n]);
+			ret = EXIT_FAILURE;
+		}
+		starpu_free_on_node(nodes[n], (uintptr_t) dst, size);
+
+		printf("%u\t%d\t%u\t%u\t%.2f\n", nthreads, nt, nodes[0], nodes[n], (size*iter) / (stop - start));
+		fflush(stdout);
+	}
+
+	starpu_free_on_node(nodes[0], (uintptr_t) src, size);
+	starpu_shutdown();
+
+	unsetenv("STARPU_RAM_COPY_NTHREADS");
+	unsetenv("STARPU_RAM_COPY_NT");
+	unsetenv("STARPU_RAM_COPY_MIN_SIZE");
+	return ret;
+}
+
 int main(int argc, char **argv)
 {
 	int ret;
@@ -307,6 +376,9 @@ int main(int argc, char **argv)
 
 	result = malloc(total_ncpus * sizeof(result[0]));
 
+	if (onlycopy)
+		goto copy;
+
 	if (cpustep == 0)
 	{
 #if defined(STARPU_QUICK_CHECK) || defined(STARPU_SANITIZE_LEAK) || defined(STARPU_SANITIZE_ADDRESS)
@@ -350,11 +422,22 @@ int main(int argc, char **argv)
 		fflush(stdout);
 	}
 
+copy:
+	printf("# helpers\tnt\tsrc\tdst\tMB/s\n");
+	for (n = 0; n <= total_ncpus; n = n ? 2*n : 1)
+	{
+		ret = bench_copy(&argc, &argv, n, 0);
+		if (ret == 0)
+			ret = bench_copy(&argc, &argv, n, 1);
+		if (ret)
+			break;
+	}
+
 	free(result);
 
 	for (n = 0; n < total_ncpus; n++)
 		free(buffers[n]);
 	free(buffers);
 
-	return EXIT_SUCCESS;
+	return ret == STARPU_TEST_SKIPPED ? EXIT_SUCCESS : ret;
 }
@@ -0,0 +1,181 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the latency of short latency-critical tasks which have a deadline,
+ * submitted periodically while a batch of long background tasks is queued,
+ * with the modular-heft and modular-edf schedulers, and display the median and
+ * 99th percentile of their latencies, and how many of them missed their
+ * deadline.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+static unsigned nbackground = 64;
+static unsigned ncritical = 32;
+#else
+static unsigned nbackground = 1024;
+static unsigned ncritical = 512;
+#endif
+
+/* Durations of the tasks, in us */
+static double background_length = 2000.;
+static double critical_length = 100.;
+/* Period of the submission of the critical tasks, and their relative
+ * deadline, in us */
+static double period = 1000.;
+static double relative_deadline = 5000.;
+
+static double *submitted;
+static double *latencies;
+
+void busy_func(void *descr[], void *arg)
+{
+	(void)descr;
+	double length = *(double *) arg;
+	double start = starpu_timing_now();
+
+	while (starpu_timing_now() - start < length)
+		;
+}
+
+static struct starpu_perfmodel background_model =
+{
+	.type = STARPU_HISTORY_BASED,
+	.symbol = "deadline_latency_background",
+};
+
+static struct starpu_perfmodel critical_model =
+{
+	.type = STARPU_HISTORY_BASED,
+	.symbol = "deadline_latency_critical",
+};
+
+static struct starpu_codelet background_cl =
+{
+	.cpu_funcs = {busy_func},
+	.nbuffers = 0,
+	.model = &background_model,
+};
+
+static struct starpu_codelet critical_cl =
+{
+	.cpu_funcs = {busy_func},
+	.nbuffers = 0,
+	.model = &critical_model,
+};
+
+static void critical_callback(void *arg)
+{
+	uintptr_t i = (uintptr_t) arg;
+	latencies[i] = starpu_timing_now() - submitted[i];
+}
+
+static int compar(const void *a, const void *b)
+{
+	double da = *(const double *) a, db = *(const double *) b;
+	return (da > db) - (da < db);
+}
+
+static int submit(struct starpu_codelet *cl, double *length, double deadline, void (*callback)(void *), void *arg)
+{
+	struct starpu_task *task = starpu_task_create();
+	task->cl = cl;
+	task->cl_arg = length;
+	task->deadline = deadline;
+	task->callback_func = callback;
+	task->callback_arg = arg;
+	return starpu_task_submit(task);
+}
+
+static int bench(int argc, char **argv, const char *sched)
+{
+	struct starpu_task_deadline_stats stats;
+	double start, end;
+	unsigned i;
+	int ret;
+
+	setenv("STARPU_SCHED", sched, 1);
+	ret = starpu_initialize(NULL, &argc, &argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	/* Calibrate the performance models */
+	for (i = 0; i < 16; i++)
+	{
+		ret = submit(&background_cl, &background_length, 0., NULL, NULL);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+		ret = submit(&critical_cl, &critical_length, 0., NULL, NULL);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	}
+	ret = starpu_task_wait_for_all();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+
+	start = starpu_timing_now();
+	for (i = 0; i < nbackground; i++)
+	{
+		ret = submit(&background_cl, &background_length, 0., NULL, NULL);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	}
+
+	for (i = 0; i < ncritical; i++)
+	{
+		submitted[i] = starpu_timing_now();
+		ret = submit(&critical_cl, &critical_length, submitted[i] + relative_deadline, critical_callback, (void *) (uintptr_t) i);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+		starpu_usleep(period);
+	}
+	ret = starpu_task_wait_for_all();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+	end = starpu_timing_now();
+
+	starpu_task_deadline_get_stats(&stats);
+	STARPU_ASSERT(stats.ntasks == ncritical);
+
+	qsort(latencies, ncritical, sizeof(*latencies), compar);
+	printf("%s\t%.0f\t%.0f\t%lu/%lu\t%lu\t%.0f\n", sched,
+	       latencies[ncritical/2], latencies[(ncritical*99)/100],
+	       stats.nmissed, stats.ntasks, stats.nlate, (end - start) / 1000.);
+
+	starpu_shutdown();
+	return 0;
+
+enodev:
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+
+	submitted = malloc(ncritical * sizeof(*submitted));
+	latencies = malloc(ncritical * sizeof(*latencies));
+
+	printf("# sched\tp50 us\tp99 us\tmissed\tlate\tms\n");
+	ret = bench(argc, argv, "modular-heft");
+	if (!ret)
+		ret = bench(argc, argv, "modular-edf");
+
+	free(submitted);
+	free(latencies);
+	return ret;
+}
@@ -0,0 +1,186 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the registration and unregistration cost of many small data
+ * handles, and the memory they use, both one handle at a time and with the
+ * array variants. Compare builds with and without --enable-compact-handles.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+static unsigned nhandles = 10000;
+#else
+static unsigned nhandles = 1000000;
+#endif
+
+void dummy_func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_codelet dummy_cl =
+{
+	.cpu_funcs = {dummy_func},
+	.cuda_funcs = {dummy_func},
+	.opencl_funcs = {dummy_func},
+	.model = NULL,
+	.nbuffers = 1,
+	.modes = {STARPU_RW}
+};
+
+/* Resident memory size, in bytes, or 0 if unknown */
+static size_t resident_size(void)
+{
+	unsigned long size, resident;
+	size_t ret = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+
+	if (!f)
+		return 0;
+	if (fscanf(f, "%lu %lu", &size, &resident) == 2)
+		ret = resident * sysconf(_SC_PAGESIZE);
+	fclose(f);
+	return ret;
+}
+
+static void print(const char *operation, double start, double end)
+{
+	printf("%s\t%.0f\n", operation, (end - start) * 1000. / nhandles);
+}
+
+static void do_register(starpu_data_handle_t *handles, float *values, struct starpu_variable_interface *interfaces, int array)
+{
+	unsigned i;
+
+	if (array)
+	{
+		for (i = 0; i < nhandles; i++)
+			interfaces[i] = (struct starpu_variable_interface)
+			{
+				.id = STARPU_VARIABLE_INTERFACE_ID,
+				.ptr = (uintptr_t)&values[i],
+				.dev_handle = (uintptr_t)&values[i],
+				.elemsize = sizeof(values[i]),
+			};
+		starpu_data_register_array(handles, nhandles, STARPU_MAIN_RAM, interfaces, &starpu_interface_variable_ops);
+	}
+	else
+		for (i = 0; i < nhandles; i++)
+			starpu_variable_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t)&values[i], sizeof(values[i]));
+}
+
+static int bench(starpu_data_handle_t *handles, float *values, struct starpu_variable_interface *interfaces, int array)
+{
+	double start, end;
+	size_t before, after;
+	unsigned i;
+	int ret;
+
+	before = resident_size();
+	start = starpu_timing_now();
+	do_register(handles, values, interfaces, array);
+	end = starpu_timing_now();
+	after = resident_size();
+	print(array ? "register_array" : "register", start, end);
+	/* The second pass reuses the memory freed by the first one */
+	if (!array && before && after)
+		FPRINTF(stderr, "%lu bytes per handle\n", (unsigned long) ((after - before) / nhandles));
+
+	start = starpu_timing_now();
+	for (i = 0; i < nhandles; i++)
+		starpu_data_unregister(handles[i]);
+	end = starpu_timing_now();
+	print("unregister", start, end);
+
+	/* Now with the data actually used by a task */
+	do_register(handles, values, interfaces, array);
+	for (i = 0; i < nhandles; i++)
+	{
+		ret = starpu_task_insert(&dummy_cl, STARPU_RW, handles[i], 0);
+		if (ret == -ENODEV)
+		{
+			for (i = 0; i < nhandles; i++)
+				starpu_data_unregister(handles[i]);
+			return ret;
+		}
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	ret = starpu_task_wait_for_all();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+
+	start = starpu_timing_now();
+	if (array)
+		starpu_data_unregister_submit_array(handles, nhandles);
+	else
+		for (i = 0; i < nhandles; i++)
+			starpu_data_unregister_submit(handles[i]);
+	end = starpu_timing_now();
+	ret = starpu_task_wait_for_all();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+	print(array ? "unregister_submit_array" : "unregister_submit", start, end);
+	print(array ? "unregister_submit_array+wait" : "unregister_submit+wait", start, starpu_timing_now());
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	starpu_data_handle_t *handles;
+	float *values;
+	struct starpu_variable_interface *interfaces;
+	int ret;
+
+	if (argc > 1)
+		nhandles = atoi(argv[1]);
+
+	ret = starpu_initialize(NULL, &argc, &argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	handles = malloc(nhandles * sizeof(*handles));
+	values = calloc(nhandles, sizeof(*values));
+	interfaces = malloc(nhandles * sizeof(*interfaces));
+	/* Make sure the arrays themselves are resident */
+	memset(handles, 0, nhandles * sizeof(*handles));
+	memset(interfaces, 0, nhandles * sizeof(*interfaces));
+
+	printf("# operation\tns/handle\n");
+	ret = bench(handles, values, interfaces, 0);
+	if (!ret)
+		ret = bench(handles, values, interfaces, 1);
+
+	free(handles);
+	free(values);
+	free(interfaces);
+	starpu_shutdown();
+
+	if (ret == -ENODEV)
+	{
+		fprintf(stderr, "WARNING: No one can execute this task\n");
+		/* yes, we do not perform the computation but we did detect that no one
+		 * could perform the kernel, so this is not an error from StarPU */
+		return STARPU_TEST_SKIPPED;
+	}
+	return EXIT_SUCCESS;
+}
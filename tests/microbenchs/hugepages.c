@@ -0,0 +1,134 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the cost of allocating tiles and of accessing them at random
+ * pages, which stresses the TLB, with small pages (STARPU_HUGEPAGES=0),
+ * transparent huge pages (1) and hugetlbfs pages (2). Run with STARPU_STATS=1
+ * to get the huge page coverage of the allocations.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+static unsigned ntiles = 4;
+static unsigned naccesses = 1<<16;
+#else
+static unsigned ntiles = 64;
+static unsigned naccesses = 1<<22;
+#endif
+static size_t tile_size = 8*1024*1024;
+
+#define PAGE 4096
+
+void access_func(void *descr[], void *arg)
+{
+	(void)arg;
+	char *v = (char *) STARPU_VECTOR_GET_PTR(descr[0]);
+	size_t npages = STARPU_VECTOR_GET_NX(descr[0]) / PAGE;
+	unsigned long seed = 1;
+	unsigned i;
+
+	for (i = 0; i < naccesses; i++)
+	{
+		seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+		v[((seed >> 33) % npages) * PAGE]++;
+	}
+}
+
+static struct starpu_codelet access_cl =
+{
+	.cpu_funcs = {access_func},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+};
+
+static int bench(int argc, char **argv, const char *mode)
+{
+	starpu_data_handle_t *handles;
+	uintptr_t *tiles;
+	double start, alloc, access;
+	unsigned i;
+	int ret;
+
+	setenv("STARPU_HUGEPAGES", mode, 1);
+	ret = starpu_initialize(NULL, &argc, &argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	handles = malloc(ntiles * sizeof(*handles));
+	tiles = malloc(ntiles * sizeof(*tiles));
+
+	/* Allocate twice, to also measure reusing freed areas */
+	start = starpu_timing_now();
+	for (i = 0; i < ntiles; i++)
+	{
+		tiles[i] = starpu_malloc_on_node(STARPU_MAIN_RAM, tile_size);
+		STARPU_ASSERT(tiles[i]);
+		starpu_free_on_node(STARPU_MAIN_RAM, tiles[i], tile_size);
+		tiles[i] = starpu_malloc_on_node(STARPU_MAIN_RAM, tile_size);
+		STARPU_ASSERT(tiles[i]);
+	}
+	alloc = starpu_timing_now() - start;
+
+	for (i = 0; i < ntiles; i++)
+		starpu_vector_data_register(&handles[i], STARPU_MAIN_RAM, tiles[i], tile_size, 1);
+
+	start = starpu_timing_now();
+	for (i = 0; i < ntiles; i++)
+	{
+		ret = starpu_task_insert(&access_cl, STARPU_RW, handles[i], 0);
+		if (ret == -ENODEV)
+			break;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	ret = starpu_task_wait_for_all();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+	access = starpu_timing_now() - start;
+
+	for (i = 0; i < ntiles; i++)
+	{
+		starpu_data_unregister(handles[i]);
+		starpu_free_on_node(STARPU_MAIN_RAM, tiles[i], tile_size);
+	}
+
+	printf("%s\t%.3f\t%.3f\n", mode, alloc / (2*ntiles), access * 1000. / ((double) ntiles * naccesses));
+
+	free(handles);
+	free(tiles);
+	starpu_shutdown();
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+
+	if (argc > 1)
+		tile_size = atol(argv[1]) * 1024 * 1024;
+
+	printf("# hugepages\tus/alloc\tns/access\n");
+	ret = bench(argc, argv, "0");
+	if (!ret)
+		ret = bench(argc, argv, "1");
+	if (!ret)
+		ret = bench(argc, argv, "2");
+
+	return ret;
+}
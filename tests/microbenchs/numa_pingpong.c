@@ -0,0 +1,151 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Ping-pong a vector between CPU workers of two different NUMA nodes, with
+ * each task reading and writing the whole vector. Compare copying the data
+ * between the NUMA nodes, mapping it, and mapping it with page migration
+ * (STARPU_NUMA_MIGRATE).
+ */
+
+#ifdef STARPU_QUICK_CHECK
+static size_t size = 4*1024*1024;
+static int niter = 4;
+#else
+static size_t size = 64*1024*1024;
+static int niter = 32;
+#endif
+
+void touch_func(void *descr[], void *arg)
+{
+	(void)arg;
+	char *v = (char *) STARPU_VECTOR_GET_PTR(descr[0]);
+	size_t n = STARPU_VECTOR_GET_NX(descr[0]);
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		v[i]++;
+}
+
+static struct starpu_codelet touch_cl =
+{
+	.cpu_funcs = {touch_func},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+};
+
+static int bench(int argc, char **argv, const char *mode, const char *map, const char *migrate)
+{
+	starpu_data_handle_t handle;
+	struct starpu_conf conf;
+	int workers[2];
+	unsigned nodes[2];
+	unsigned nworkers, w;
+	unsigned found = 0;
+	double start, end;
+	char *v;
+	int i, ret;
+
+	setenv("STARPU_USE_NUMA", "1", 1);
+	setenv("STARPU_ENABLE_MAP", map, 1);
+	setenv("STARPU_NUMA_MIGRATE", migrate, 1);
+
+	starpu_conf_init(&conf);
+	conf.ncuda = 0;
+	conf.nopencl = 0;
+	conf.nmax_fpga = 0;
+	ret = starpu_initialize(&conf, &argc, &argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	/* Find two CPU workers on different NUMA nodes */
+	nworkers = starpu_worker_get_count();
+	for (w = 0; w < nworkers && found < 2; w++)
+	{
+		if (starpu_worker_get_type(w) != STARPU_CPU_WORKER)
+			continue;
+		if (found == 1 && starpu_worker_get_memory_node(w) == nodes[0])
+			continue;
+		workers[found] = w;
+		nodes[found] = starpu_worker_get_memory_node(w);
+		found++;
+	}
+	if (found < 2)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	v = (char *) starpu_malloc_on_node(nodes[0], size);
+	memset(v, 0, size);
+	starpu_vector_data_register(&handle, nodes[0], (uintptr_t) v, size, 1);
+
+	start = 0;
+	for (i = -1; i < 2*niter; i++)
+	{
+		/* The first iteration is a warm-up */
+		if (i == 0)
+		{
+			ret = starpu_task_wait_for_all();
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+			start = starpu_timing_now();
+		}
+		ret = starpu_task_insert(&touch_cl,
+					 STARPU_RW, handle,
+					 STARPU_EXECUTE_ON_WORKER, workers[(i+2) % 2],
+					 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	ret = starpu_task_wait_for_all();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_wait_for_all");
+	end = starpu_timing_now();
+
+	starpu_data_unregister(handle);
+	STARPU_ASSERT(v[0] == (char) (2*niter+1));
+	STARPU_ASSERT(v[size-1] == (char) (2*niter+1));
+	starpu_free_on_node(nodes[0], (uintptr_t) v, size);
+
+	printf("%s\t%u\t%u\t%.3f\n", mode, nodes[0], nodes[1], (end - start) / niter / 1000.);
+
+	starpu_shutdown();
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+
+	if (argc > 1)
+		size = atol(argv[1]) * 1024 * 1024;
+
+	printf("# mode\tnode0\tnode1\tms/round-trip\n");
+	ret = bench(argc, argv, "copy", "0", "0");
+	if (ret)
+		goto out;
+	ret = bench(argc, argv, "map", "1", "0");
+	if (ret)
+		goto out;
+	ret = bench(argc, argv, "migrate", "1", "1");
+
+out:
+	return ret == STARPU_TEST_SKIPPED ? STARPU_TEST_SKIPPED : ret;
+}
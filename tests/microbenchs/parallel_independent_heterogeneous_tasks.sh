@@ -19,6 +19,6 @@ if test -n "$STARPU_MICROBENCHS_DISABLED" ; then exit 77 ; fi
 
 source $(dirname $0)/microbench.sh
 
-XFAIL="lws ws eager prio modular-prio modular-eager modular-eager-prio modular-eager-prefetching modular-prio-prefetching modular-random modular-random-prio modular-random-prefetching modular-random-prio-prefetching modular-prandom modular-prandom-prio modular-ws modular-heft modular-heft-prio modular-heft2 modular-heteroprio modular-gemm random peager heteroprio graph_test"
+XFAIL="lws ws eager prio eager_numa prio_numa modular-prio modular-eager modular-eager-prio modular-eager-prefetching modular-prio-prefetching modular-random modular-random-prio modular-random-prefetching modular-random-prio-prefetching modular-prandom modular-prandom-prio modular-ws modular-ws-hierarchical modular-heft modular-edf modular-heft-prio modular-heft2 modular-heft-insert modular-heteroprio modular-gemm random peager heteroprio graph_test"
 
 test_scheds parallel_independent_heterogeneous_tasks
@@ -27,6 +27,9 @@
  *
  * Use ./tasks_size_overhead.sh to generate a plot of the result.
  *
+ * With -a, the codelet also provides a batch implementation, which is used
+ * when tasks are run in batches with STARPU_CPU_BATCH.
+ *
  * Thanks Martin Tillenius for the idea.
  */
 
@@ -68,6 +71,13 @@ void func(void *descr[], void *arg)
 	while (usec < (long) n);
 }
 
+void batch_func(unsigned n, void **descr[], void *arg[])
+{
+	unsigned i;
+	for (i = 0; i < n; i++)
+		func(descr[i], arg[i]);
+}
+
 double cost_function(struct starpu_task *t, struct starpu_perfmodel_arch *a, unsigned i)
 {
 	(void) t; (void) i; (void) a;
@@ -92,7 +102,7 @@ static struct starpu_codelet codelet =
 static void parse_args(int argc, char **argv)
 {
 	int c;
-	while ((c = getopt(argc, argv, "i:b:B:c:C:s:t:T:f:h")) != -1)
+	while ((c = getopt(argc, argv, "i:b:B:c:C:s:t:T:f:ah")) != -1)
 	switch(c)
 	{
 		case 'i':
@@ -123,17 +133,21 @@ static void parse_args(int argc, char **argv)
 		case 'f':
 			factortime = atoi(optarg);
 			break;
+		case 'a':
+			codelet.cpu_batch_func = batch_func;
+			break;
 		case 'h':
 			fprintf(stderr, "\
 Usage: %s [-h]\n\
 	  [-i ntasks] [-b nbuffers] [-B total_nbuffers]\n\
 	  [-c mincpus] [ -C maxcpus] [-s cpustep]\n\
-	  [-t mintime] [-T maxtime] [-f factortime]\n\n", argv[0]);
+	  [-t mintime] [-T maxtime] [-f factortime] [-a]\n\n", argv[0]);
 			fprintf(stderr,"\
 runs 'ntasks' tasks\n\
 - using 'nbuffers' data each, randomly among 'total_nbuffers' choices,\n\
 - with varying task durations, from 'mintime' to 'maxtime' (using 'factortime')\n\
 - on varying numbers of cpus, from 'mincpus' to 'maxcpus' (using 'cpustep')\n\
+- with -a, providing a batch implementation for STARPU_CPU_BATCH\n\
 \n\
 currently selected parameters: %u tasks using %u buffers among %u, from %uus to %uus (factor %u), from %u cpus to %u cpus (step %u)\n\
 ", ntasks, nbuffers, total_nbuffers, mintime, maxtime, factortime, mincpus, maxcpus, cpustep);
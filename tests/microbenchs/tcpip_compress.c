@@ -0,0 +1,163 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure round-trip transfers between the main memory and a TCP/IP
+ * master-slave device, for data with various compressibility, and check that
+ * the data comes back intact. Run with STARPU_TCPIP_MS_COMPRESS=0, 1 or 2 to
+ * compare raw, adaptive and forced compression, see tcpip_compress.sh
+ */
+
+#ifdef STARPU_QUICK_CHECK
+static unsigned niter = 4;
+static size_t max_size = 1024*1024;
+#else
+static unsigned niter = 32;
+static size_t max_size = 32*1024*1024;
+#endif
+
+enum kind
+{
+	KIND_ZERO,
+	KIND_SPARSE,
+	KIND_RANDOM,
+	NKINDS
+};
+
+static const char *kind_names[NKINDS] = { "zero", "sparse", "random" };
+
+static void fill(float *v, size_t n, enum kind kind)
+{
+	size_t i;
+	for (i = 0; i < n; i++)
+	{
+		switch (kind)
+		{
+			case KIND_ZERO:
+				v[i] = 0.;
+				break;
+			case KIND_SPARSE:
+				/* one non-zero out of 16 */
+				v[i] = (starpu_lrand48() % 16) ? 0. : (float) starpu_drand48();
+				break;
+			case KIND_RANDOM:
+			default:
+				v[i] = (float) starpu_drand48();
+				break;
+		}
+	}
+}
+
+static int check(float *v, float *ref, size_t n)
+{
+	return memcmp(v, ref, n * sizeof(*v));
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+	unsigned node;
+	unsigned iter;
+	size_t size;
+	enum kind kind;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-n"))
+			niter = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-s"))
+			max_size = strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "Usage: %s [-n niter] [-s max_size]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	ret = starpu_initialize(NULL, &argc, &argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (starpu_tcpip_ms_worker_get_count() == 0)
+	{
+		FPRINTF(stderr, "This test needs a TCP/IP master-slave device\n");
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	int workerid = starpu_worker_get_by_type(STARPU_TCPIP_MS_WORKER, 0);
+	node = starpu_worker_get_memory_node(workerid);
+
+	printf("# kind\tsize\tround-trip (us)\tMB/s\n");
+	for (kind = 0; kind < NKINDS; kind++)
+	{
+		for (size = 64*1024; size <= max_size; size *= 4)
+		{
+			size_t n = size / sizeof(float);
+			float *v, *ref;
+			starpu_data_handle_t handle;
+
+			starpu_malloc((void **) &v, size);
+			ref = malloc(size);
+			fill(ref, n, kind);
+			memcpy(v, ref, size);
+
+			starpu_vector_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t) v, n, sizeof(float));
+
+			double start = starpu_timing_now();
+			for (iter = 0; iter < niter; iter++)
+			{
+				/* Host to device, and make the device the owner */
+				ret = starpu_data_acquire_on_node(handle, node, STARPU_RW);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+				starpu_data_release_on_node(handle, node);
+
+				/* And back */
+				ret = starpu_data_acquire(handle, STARPU_RW);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+				starpu_data_release(handle);
+			}
+			double end = starpu_timing_now();
+
+			starpu_data_unregister(handle);
+
+			if (check(v, ref, n))
+			{
+				FPRINTF(stderr, "%s data of size %lu got corrupted\n", kind_names[kind], (unsigned long) size);
+				starpu_free_noflag(v, size);
+				free(ref);
+				starpu_shutdown();
+				return EXIT_FAILURE;
+			}
+
+			double timing = (end - start) / niter;
+			printf("%s\t%lu\t%.2f\t%.2f\n", kind_names[kind], (unsigned long) size, timing, 2. * size / timing);
+
+			starpu_free_noflag(v, size);
+			free(ref);
+		}
+	}
+
+	starpu_shutdown();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+#!/bin/bash
+# StarPU --- Runtime system for heterogeneous multicore architectures.
+#
+# Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+#
+# StarPU is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or (at
+# your option) any later version.
+#
+# StarPU is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU Lesser General Public License in COPYING.LGPL for more details.
+#
+
+# Compare raw, adaptive and forced compression of TCP/IP master-slave
+# transfers over localhost. Set STARPU_TCPIP_THROTTLE to a tc rate (e.g.
+# 1gbit) to throttle the loopback interface while running, this needs root
+# permissions.
+
+if test -n "$STARPU_MICROBENCHS_DISABLED" ; then exit 77 ; fi
+
+set -e
+
+DIR=$(dirname $0)
+MS_LAUNCHER=${MS_LAUNCHER:-$DIR/../../tools/starpu_tcpipexec -np 2 -nobind -ncpus 1}
+
+if [ -n "$STARPU_TCPIP_THROTTLE" ]
+then
+	tc qdisc add dev lo root tbf rate $STARPU_TCPIP_THROTTLE burst 64kb latency 50ms
+	trap "tc qdisc del dev lo root" EXIT
+	# Let the bus calibration see the throttled link
+	export STARPU_BUS_CALIBRATE=1
+	# And avoid the local socket shortcut
+	export STARPU_TCPIP_USE_LOCAL_SOCKET=0
+fi
+
+for compress in 0 1 2
+do
+	echo "# STARPU_TCPIP_MS_COMPRESS=$compress"
+	STARPU_TCPIP_MS_COMPRESS=$compress STARPU_TCPIP_MS_COMPRESS_STATS=1 $MS_LAUNCHER $STARPU_LAUNCH $DIR/tcpip_compress "$@"
+done
@@ -0,0 +1,163 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include "../helper.h"
+
+/*
+ * Calibrate a codelet with a fast and a slow implementation on one CPU
+ * worker, submitting the tasks synchronously so that each measurement is taken
+ * into account for the next task. Display how many times the slow one is run
+ * until the model is calibrated, with the default calibration and with
+ * STARPU_CALIBRATE_BANDIT=1, and check that the latter runs it less.
+ *
+ * Then, with STARPU_CALIBRATE_BANDIT=1, make the fast implementation become
+ * the slowest one, and check that the other one gets selected again.
+ */
+
+#if !defined(STARPU_HAVE_SETENV) || !defined(STARPU_USE_CPU)
+#warning setenv is not available, or CPU are not enabled. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NTASKS 100
+
+/* Durations of the implementations, in µs */
+#define FAST 200
+#define SLOW 1000
+#define DRIFTED 3000
+
+/* Whether the first implementation has drifted */
+static unsigned drifted;
+
+/* Number of runs of each implementation */
+static unsigned nruns[2];
+
+void fast_cpu(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+	(void) STARPU_ATOMIC_ADD(&nruns[0], 1);
+	starpu_usleep(drifted ? DRIFTED : FAST);
+}
+
+void slow_cpu(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+	(void) STARPU_ATOMIC_ADD(&nruns[1], 1);
+	starpu_usleep(SLOW);
+}
+
+static struct starpu_perfmodel model =
+{
+	.type = STARPU_HISTORY_BASED,
+	.symbol = "bandit"
+};
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {fast_cpu, slow_cpu},
+	.cpu_funcs_name = {"fast_cpu", "slow_cpu"},
+	.model = &model,
+	.nbuffers = 0,
+};
+
+static void init(const char *bandit)
+{
+	struct starpu_conf conf;
+	int ret;
+
+	setenv("STARPU_CALIBRATE_BANDIT", bandit, 1);
+
+	starpu_conf_init(&conf);
+	conf.sched_policy_name = "dmda";
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 1;
+	/* Start from an empty model */
+	conf.calibrate = 2;
+
+	ret = starpu_initialize(&conf, NULL, NULL);
+	if (ret == -ENODEV) exit(STARPU_TEST_SKIPPED);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+}
+
+/* Run NTASKS tasks, and return the time it took, in ms */
+static double run(void)
+{
+	double start = starpu_timing_now();
+	unsigned i;
+
+	nruns[0] = nruns[1] = 0;
+	for (i = 0; i < NTASKS; i++)
+	{
+		struct starpu_task *task = starpu_task_create();
+		task->cl = &cl;
+		/* Let the scheduler take the measurement into account for
+		 * the next task */
+		task->synchronous = 1;
+
+		int ret = starpu_task_submit(task);
+		if (ret == -ENODEV)
+			exit(STARPU_TEST_SKIPPED);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	}
+	return (starpu_timing_now() - start) / 1000.;
+}
+
+int main(void)
+{
+	unsigned default_slow, bandit_slow;
+	double time;
+	int ret = EXIT_SUCCESS;
+
+	init("0");
+	time = run();
+	default_slow = nruns[1];
+	FPRINTF(stderr, "default calibration: %u runs of the fast implementation and %u runs of the slow one, in %.1f ms\n", nruns[0], nruns[1], time);
+	starpu_shutdown();
+
+	init("1");
+	time = run();
+	bandit_slow = nruns[1];
+	FPRINTF(stderr, "bandit calibration: %u runs of the fast implementation and %u runs of the slow one, in %.1f ms\n", nruns[0], nruns[1], time);
+
+	if (bandit_slow >= default_slow)
+	{
+		FPRINTF(stderr, "the bandit calibration ran the slow implementation %u times, not less than the default calibration (%u)\n", bandit_slow, default_slow);
+		ret = EXIT_FAILURE;
+	}
+
+	/* Now the calibrated fast implementation becomes the slowest one */
+	drifted = 1;
+	time = run();
+	FPRINTF(stderr, "after drift: %u runs of the drifted implementation and %u runs of the other one, in %.1f ms\n", nruns[0], nruns[1], time);
+
+	if (nruns[1] < NTASKS / 2)
+	{
+		FPRINTF(stderr, "the other implementation was run only %u times out of %d after the drift\n", nruns[1], NTASKS);
+		ret = EXIT_FAILURE;
+	}
+
+	starpu_shutdown();
+	return ret;
+}
+#endif
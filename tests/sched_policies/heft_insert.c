@@ -0,0 +1,247 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <fcntl.h>
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <math.h>
+#include "../helper.h"
+
+/*
+ * Run modular-heft-insert on two CPU workers with a task whose data is
+ * stored on a disk, so that the worker which gets it is expected to stay idle
+ * while the data is loaded, followed by short tasks without data which fit in
+ * that gap. Check that all tasks are run and that the data is correctly updated.
+ *
+ * heft_insert.sh runs this with STARPU_SCHED_HEFT_INSERT_STATS=1 and checks
+ * that the short tasks were actually inserted in the gap.
+ */
+
+#if STARPU_MAXNODES == 1 || !defined(STARPU_USE_CPU) || !defined(STARPU_HAVE_SETENV)
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NX (1024*1024)
+#define NSHORT 8
+
+/* Expected durations, in µs */
+#define LOAD_LENGTH 1000.
+static double short_length;
+
+static unsigned nshort;
+
+static double load_cost(struct starpu_task *task, unsigned nimpl)
+{
+	(void)task;
+	(void)nimpl;
+	return LOAD_LENGTH;
+}
+
+static struct starpu_perfmodel load_model =
+{
+	.type = STARPU_COMMON,
+	.cost_function = load_cost,
+	.symbol = "heft_insert_load",
+};
+
+static double short_cost(struct starpu_task *task, unsigned nimpl)
+{
+	(void)task;
+	(void)nimpl;
+	return short_length;
+}
+
+static struct starpu_perfmodel short_model =
+{
+	.type = STARPU_COMMON,
+	.cost_function = short_cost,
+	.symbol = "heft_insert_short",
+};
+
+void load_func(void *descr[], void *arg)
+{
+	(void)arg;
+	int *v = (int *) STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	unsigned i;
+	for (i = 0; i < n; i++)
+		v[i] *= 2;
+}
+
+static struct starpu_codelet load_cl =
+{
+	.cpu_funcs = {load_func},
+	.cpu_funcs_name = {"load_func"},
+	.modes = {STARPU_RW},
+	.nbuffers = 1,
+	.model = &load_model,
+};
+
+void short_func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+	(void) STARPU_ATOMIC_ADD(&nshort, 1);
+}
+
+static struct starpu_codelet short_cl =
+{
+	.cpu_funcs = {short_func},
+	.cpu_funcs_name = {"short_func"},
+	.nbuffers = 0,
+	.model = &short_model,
+};
+
+static int dotest(char *base)
+{
+	const char *name = "STARPU_HEFT_INSERT_DATA";
+	char path[256];
+	struct starpu_conf conf;
+	starpu_data_handle_t handle;
+	double transfer;
+	int *A;
+	unsigned i;
+	int ret;
+
+	starpu_conf_init(&conf);
+	conf.sched_policy_name = "modular-heft-insert";
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	/* With only one worker there is no decision to make */
+	conf.ncpus = 2;
+	ret = starpu_initialize(&conf, NULL, NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+	if (starpu_cpu_worker_get_count() < 2)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	int new_dd = starpu_disk_register(&starpu_disk_unistd_ops, (void *) base, STARPU_DISK_SIZE_MIN);
+	if (new_dd == -ENOENT)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+	unsigned dd = (unsigned) new_dd;
+
+	/* Store the data in a file of the disk */
+	A = malloc(NX * sizeof(int));
+	for (i = 0; i < NX; i++)
+		A[i] = i;
+	snprintf(path, sizeof(path), "%s/%s", base, name);
+	FILE *f = fopen(path, "wb+");
+	if (f == NULL)
+	{
+		free(A);
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+	fwrite(A, sizeof(int), NX, f);
+	fclose(f);
+	free(A);
+
+	void *data = starpu_disk_open(dd, (void *) name, NX * sizeof(int));
+	starpu_vector_data_register(&handle, dd, (uintptr_t) data, NX, sizeof(int));
+
+	/* Make the short tasks fill half of the time the worker is expected
+	 * to wait for the data */
+	transfer = starpu_data_expected_transfer_time(handle, STARPU_MAIN_RAM, STARPU_RW);
+	if (isnan(transfer) || transfer <= 0.)
+	{
+		FPRINTF(stderr, "the disk transfer time is not known, skipping\n");
+		starpu_data_unregister(handle);
+		starpu_shutdown();
+		unlink(path);
+		return STARPU_TEST_SKIPPED;
+	}
+	short_length = transfer / (2 * NSHORT);
+	FPRINTF(stderr, "expected transfer %f µs, short tasks of %f µs\n", transfer, short_length);
+
+	starpu_pause();
+	ret = starpu_task_insert(&load_cl, STARPU_RW, handle, 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	for (i = 0; i < NSHORT; i++)
+	{
+		ret = starpu_task_insert(&short_cl, 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_resume();
+	starpu_task_wait_for_all();
+
+	ret = EXIT_SUCCESS;
+	if (nshort != NSHORT)
+	{
+		FPRINTF(stderr, "%u short tasks were run instead of %d\n", nshort, NSHORT);
+		ret = EXIT_FAILURE;
+	}
+
+	starpu_data_acquire(handle, STARPU_R);
+	A = (int *) starpu_data_get_local_ptr(handle);
+	for (i = 0; i < NX; i++)
+		if (A[i] != (int) (2*i))
+		{
+			FPRINTF(stderr, "element %u is %d instead of %u\n", i, A[i], 2*i);
+			ret = EXIT_FAILURE;
+			break;
+		}
+	starpu_data_release(handle);
+
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+	unlink(path);
+	return ret;
+}
+
+int main(void)
+{
+	char *sched = getenv("STARPU_SCHED");
+	char s[128];
+	char *ptr;
+	int ret;
+
+	if (sched && strcmp(sched, "modular-heft-insert"))
+		/* Testing another specific scheduler, no need to run this */
+		return STARPU_TEST_SKIPPED;
+
+	/* Otherwise the queue above the decision already starts loading the
+	 * data, and the decision does not see the gap any more */
+	setenv("STARPU_PREFETCH", "0", 1);
+
+	snprintf(s, sizeof(s), "/tmp/%s-heft-insert-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory '%s'\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+
+	ret = dotest(s);
+
+	if (rmdir(s) < 0)
+		STARPU_CHECK_RETURN_VALUE(-errno, "rmdir '%s'\n", s);
+	return ret;
+}
+#endif
@@ -0,0 +1,35 @@
+#!/bin/sh
+# StarPU --- Runtime system for heterogeneous multicore architectures.
+#
+# Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+#
+# StarPU is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or (at
+# your option) any later version.
+#
+# StarPU is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU Lesser General Public License in COPYING.LGPL for more details.
+#
+# Check that modular-heft-insert actually inserts tasks in the gap left while
+# loading data from a disk
+
+# Testing another specific scheduler, no need to run this
+[ -z "$STARPU_SCHED" -o "$STARPU_SCHED" = modular-heft-insert ] || exit 77
+
+PREFIX=$(dirname $0)
+
+OUT=$(STARPU_SCHED_HEFT_INSERT_STATS=1 $MS_LAUNCHER $STARPU_LAUNCH $PREFIX/heft_insert 2>&1)
+ret=$?
+echo "$OUT"
+[ $ret = 0 ] || exit $ret
+
+INSERTED=$(echo "$OUT" | sed -n 's/.*heft_insert: \([0-9]*\) tasks inserted in gaps.*/\1/p')
+if [ -z "$INSERTED" -o "$INSERTED" = 0 ]
+then
+	echo "no task was inserted in a gap"
+	exit 1
+fi
@@ -0,0 +1,116 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include "../helper.h"
+
+/*
+ * Run tasks with data and priorities with the eager and prio policies, with
+ * the lookahead locality pop enabled and a small aging bound, and check that
+ * all of them get executed, in the order of their data dependencies.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NTASKS 64
+#else
+#define NTASKS 1024
+#endif
+#define NHANDLES 8
+
+static unsigned values[NHANDLES];
+
+void increment(void *descr[], void *arg)
+{
+	(void)arg;
+	unsigned *v = (unsigned *) STARPU_VARIABLE_GET_PTR(descr[0]);
+	(*v)++;
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {increment},
+	.cpu_funcs_name = {"increment"},
+	.modes = {STARPU_RW},
+	.nbuffers = 1,
+};
+
+static int run(const char *sched)
+{
+	starpu_data_handle_t handles[NHANDLES];
+	unsigned expected[NHANDLES];
+	struct starpu_conf conf;
+	unsigned i;
+	int ret;
+
+	starpu_conf_init(&conf);
+	conf.sched_policy_name = sched;
+	ret = starpu_initialize(&conf, NULL, NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	for (i = 0; i < NHANDLES; i++)
+	{
+		values[i] = 0;
+		expected[i] = 0;
+		starpu_variable_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t) &values[i], sizeof(values[i]));
+	}
+
+	starpu_pause();
+	for (i = 0; i < NTASKS; i++)
+	{
+		unsigned h = (i * 7) % NHANDLES;
+		ret = starpu_task_insert(&cl, STARPU_RW, handles[h], STARPU_PRIORITY, (int) (i % 3), 0);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+		expected[h]++;
+	}
+	starpu_resume();
+	starpu_task_wait_for_all();
+
+	for (i = 0; i < NHANDLES; i++)
+		starpu_data_unregister(handles[i]);
+	starpu_shutdown();
+
+	for (i = 0; i < NHANDLES; i++)
+		if (values[i] != expected[i])
+		{
+			FPRINTF(stderr, "%s: handle %u was incremented %u times instead of %u\n", sched, i, values[i], expected[i]);
+			return EXIT_FAILURE;
+		}
+	return EXIT_SUCCESS;
+
+enodev:
+	starpu_resume();
+	starpu_task_wait_for_all();
+	for (i = 0; i < NHANDLES; i++)
+		starpu_data_unregister(handles[i]);
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
+
+int main(void)
+{
+	int ret;
+
+	setenv("STARPU_SCHED_LOCALITY_LOOKAHEAD", "8", 1);
+	setenv("STARPU_SCHED_LOCALITY_MAX_SKIPS", "2", 1);
+
+	ret = run("eager");
+	if (ret == EXIT_SUCCESS)
+		ret = run("prio");
+	return ret;
+}
@@ -0,0 +1,220 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023       Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../helper.h"
+
+/*
+ * Run the modular-ws-hierarchical policy on a synthetic machine with two
+ * packages of two cores. A worker of each package queues tasks next to itself
+ * and keeps busy, as does the other worker of the second package. The only
+ * idle worker must then steal all the tasks of its own package before
+ * stealing any task from the other package.
+ */
+
+#if !defined(STARPU_HAVE_HWLOC) || !defined(STARPU_HAVE_SETENV) || !defined(STARPU_USE_CPU)
+#warning hwloc or setenv are not available, or CPU are not enabled. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#if HWLOC_API_VERSION < 0x00010b00
+#define HWLOC_OBJ_PACKAGE HWLOC_OBJ_SOCKET
+#endif
+
+#ifdef STARPU_QUICK_CHECK
+#define NSUB 16
+#else
+#define NSUB 64
+#endif
+
+/* Origins of the queued tasks */
+#define SIBLING 1
+#define REMOTE 2
+
+static int workers[4];
+#define STEALER (workers[0])
+#define SIBLING_WORKER (workers[1])
+#define REMOTE_WORKER (workers[2])
+#define REMOTE_SIBLING_WORKER (workers[3])
+
+static unsigned started;
+static unsigned queued;
+static unsigned done;
+static unsigned nexecuted;
+static int order[2*NSUB];
+
+static int sibling = SIBLING;
+static int remote = REMOTE;
+
+void sub(void *descr[], void *arg)
+{
+	(void)descr;
+	int origin = *(int *) arg;
+	unsigned n = STARPU_ATOMIC_ADD(&nexecuted, 1) - 1;
+	order[n] = origin;
+	STARPU_WMB();
+	(void) STARPU_ATOMIC_ADD(&done, 1);
+}
+
+static struct starpu_codelet sub_cl =
+{
+	.cpu_funcs = {sub},
+	.cpu_funcs_name = {"sub"},
+	.nbuffers = 0,
+};
+
+static void wait_for(unsigned *counter, unsigned value)
+{
+	while (STARPU_VAL_COMPARE_AND_SWAP(counter, value, value) != value)
+		starpu_sleep(0.0001);
+}
+
+void blocker(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+	int workerid = starpu_worker_get_id_check();
+
+	(void) STARPU_ATOMIC_ADD(&started, 1);
+	wait_for(&started, 4);
+
+	if (workerid == STEALER)
+	{
+		/* Let the others queue their tasks before starting to steal */
+		wait_for(&queued, 2);
+		return;
+	}
+
+	if (workerid == SIBLING_WORKER || workerid == REMOTE_WORKER)
+	{
+		/* Queue tasks next to ourself */
+		unsigned i;
+		for (i = 0; i < NSUB; i++)
+		{
+			int ret = starpu_task_insert(&sub_cl,
+						     STARPU_CL_ARGS_NFREE, workerid == SIBLING_WORKER ? &sibling : &remote, sizeof(int),
+						     0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+		}
+		(void) STARPU_ATOMIC_ADD(&queued, 1);
+	}
+
+	/* Keep busy until the stealer has run everything */
+	wait_for(&done, 2*NSUB);
+}
+
+static struct starpu_codelet blocker_cl =
+{
+	.cpu_funcs = {blocker},
+	.cpu_funcs_name = {"blocker"},
+	.nbuffers = 0,
+};
+
+static hwloc_obj_t get_package(int workerid)
+{
+	hwloc_obj_t obj = starpu_worker_get_hwloc_obj(workerid);
+	while (obj && obj->type != HWLOC_OBJ_PACKAGE)
+		obj = obj->parent;
+	return obj;
+}
+
+/* Put a worker of the first package first, then its sibling, then the two
+ * workers of the other package */
+static int find_workers(void)
+{
+	hwloc_obj_t packages[4];
+	int i, j, n = 0;
+
+	if (starpu_worker_get_count() != 4 || starpu_cpu_worker_get_count() != 4)
+		return -1;
+
+	for (i = 0; i < 4; i++)
+	{
+		packages[i] = get_package(i);
+		if (!packages[i])
+			return -1;
+	}
+
+	workers[n++] = 0;
+	for (j = 1; j < 4; j++)
+		if (packages[j] == packages[0])
+			workers[n++] = j;
+	if (n != 2)
+		return -1;
+	for (j = 1; j < 4; j++)
+		if (packages[j] != packages[0])
+			workers[n++] = j;
+	if (packages[workers[2]] != packages[workers[3]])
+		return -1;
+	return 0;
+}
+
+int main(void)
+{
+	struct starpu_conf conf;
+	char *sched = getenv("STARPU_SCHED");
+	unsigned i;
+	int ret;
+
+	if (sched && strcmp(sched, "modular-ws-hierarchical"))
+		/* Testing another specific scheduler, no need to run this */
+		return STARPU_TEST_SKIPPED;
+
+	setenv("HWLOC_SYNTHETIC", "pack:2 core:2 pu:1", 1);
+	/* Keep the bus calibration of the fake machine apart */
+	setenv("STARPU_HOSTNAME", "ws_hierarchical_synthetic", 1);
+	setenv("STARPU_NCPU", "4", 1);
+	setenv("STARPU_WORKERS_NOBIND", "1", 1);
+	setenv("STARPU_WORKERS_GETBIND", "0", 1);
+
+	starpu_conf_init(&conf);
+	conf.sched_policy_name = "modular-ws-hierarchical";
+	conf.ncuda = 0;
+	conf.nopencl = 0;
+	ret = starpu_initialize(&conf, NULL, NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (find_workers() != 0)
+	{
+		FPRINTF(stderr, "the machine does not look like two packages of two workers, skipping\n");
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	for (i = 0; i < 4; i++)
+	{
+		ret = starpu_task_insert(&blocker_cl, STARPU_EXECUTE_ON_WORKER, workers[i], 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+	starpu_shutdown();
+
+	STARPU_ASSERT(nexecuted == 2*NSUB);
+	for (i = 0; i < NSUB; i++)
+		if (order[i] != SIBLING)
+		{
+			FPRINTF(stderr, "task %u executed by the stealer came from the other package while tasks were still queued in its own package\n", i);
+			return EXIT_FAILURE;
+		}
+	return EXIT_SUCCESS;
+}
+#endif